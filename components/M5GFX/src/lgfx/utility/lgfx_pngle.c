@@ -92,6 +92,9 @@ struct _pngle_t {
 
   uint32_t drawing_y;
 
+  // region of interest (inclusive, reset on prepare)
+  uint32_t roi_left, roi_top, roi_right, roi_bottom;
+
   // for grayscale
   uint32_t magni;
 
@@ -163,6 +166,15 @@ uint32_t lgfx_pngle_get_height(pngle_t *pngle)
   return pngle->hdr.height;
 }
 
+void lgfx_pngle_set_roi(pngle_t *pngle, uint32_t left, uint32_t top, uint32_t right, uint32_t bottom)
+{
+  if (!pngle) return;
+  pngle->roi_left   = left;
+  pngle->roi_top    = top;
+  pngle->roi_right  = right;
+  pngle->roi_bottom = bottom;
+}
+
 pngle_ihdr_t *lgfx_pngle_get_ihdr(pngle_t *pngle)
 {
   if (!pngle) return NULL;
@@ -359,23 +371,34 @@ static int pngle_on_data(pngle_t *pngle, uint8_t *lzbuf, size_t len, size_t outb
     remain_bytes = pngle->scanline_stride; // reset
     filter_type = ~0;
 
-    uint32_t draw_x = pgm_read_byte(&interlace_off_x[pngle->interlace_pass]);
-    uint32_t div_x  = pgm_read_byte(&interlace_div_x[pngle->interlace_pass]);
-    size_t scanline_pixels = pngle->scanline_pixels;
-    size_t out_pos = 0;
-    size_t out_len = ((((scanline_pixels + 7) & ~7) - 1) % outbuf_len) + 1;
-
-    do
+    if (pngle->drawing_y >= pngle->roi_top && pngle->drawing_y <= pngle->roi_bottom)
     {
-      if (out_len > scanline_pixels - out_pos) { out_len = scanline_pixels - out_pos; }
-      make_pixels(pngle, &scanline[(out_pos * pngle->channels * pngle->hdr.depth) >> 3], pngle->out_buf, out_len);
-      pngle->draw_callback(pngle->user_data, draw_x + out_pos * div_x, pngle->drawing_y, div_x, out_len, (const uint8_t*)pngle->out_buf);
+      uint32_t draw_x = pgm_read_byte(&interlace_off_x[pngle->interlace_pass]);
+      uint32_t div_x  = pgm_read_byte(&interlace_div_x[pngle->interlace_pass]);
+      // Pixels of this pass within the region. Start on a multiple of 8 pixels to stay byte aligned for depth < 8.
+      size_t out_pos = (pngle->roi_left > draw_x) ? ((pngle->roi_left - draw_x) / div_x) & ~7 : 0;
+      size_t out_end = (pngle->roi_right >= draw_x) ? (pngle->roi_right - draw_x) / div_x + 1 : 0;
+      if (out_end > pngle->scanline_pixels) { out_end = pngle->scanline_pixels; }
+      if (out_pos < out_end)
+      {
+        size_t out_len = ((((out_end - out_pos + 7) & ~7) - 1) % outbuf_len) + 1;
+        do
+        {
+          if (out_len > out_end - out_pos) { out_len = out_end - out_pos; }
+          make_pixels(pngle, &scanline[(out_pos * pngle->channels * pngle->hdr.depth) >> 3], pngle->out_buf, out_len);
+          pngle->draw_callback(pngle->user_data, draw_x + out_pos * div_x, pngle->drawing_y, div_x, out_len, (const uint8_t*)pngle->out_buf);
 
-      out_pos += out_len;
-      out_len = outbuf_len;
-    } while (out_pos < scanline_pixels);
+          out_pos += out_len;
+          out_len = outbuf_len;
+        } while (out_pos < out_end);
+      }
+    }
 
     pngle->drawing_y += pgm_read_byte(&interlace_div_y[pngle->interlace_pass]);
+    if (pngle->interlace_pass >= 6 && pngle->drawing_y > pngle->roi_bottom && pngle->roi_bottom + 1 < pngle->hdr.height)
+    { // Last pass went below the region, the rest of the image is not needed
+      return 1;
+    }
     if (pngle->drawing_y >= pngle->hdr.height) {
       if (pngle->interlace_pass >= 6) { return 0; } // Do nothing further
 
@@ -413,6 +436,7 @@ int lgfx_pngle_prepare(pngle_t *pngle, lgfx_pngle_read_callback_t read_cb, void*
   memcpy(&(pngle->hdr), &pngle->read_buf[16], sizeof(pngle_ihdr_t));
   pngle->hdr.width  = swap32(pngle->hdr.width );
   pngle->hdr.height = swap32(pngle->hdr.height);
+  lgfx_pngle_set_roi(pngle, 0, 0, pngle->hdr.width - 1, pngle->hdr.height - 1);
 
   debug_printf("[pngle]     width      : %d\n", pngle->hdr.width      );
   debug_printf("[pngle]     height     : %d\n", pngle->hdr.height     );
@@ -537,7 +561,9 @@ int lgfx_pngle_decomp(pngle_t *pngle, lgfx_pngle_draw_callback_t draw_cb)
 
           if (out_bytes)
           {
-            if (pngle_on_data(pngle, pngle->next_out, out_bytes, (LGFX_PNGLE_OUTBUF_LEN >> 2) + (len ? in_pos >> 2 : (LGFX_PNGLE_READBUF_LEN >> 2))) < 0) return -1;
+            int res = pngle_on_data(pngle, pngle->next_out, out_bytes, (LGFX_PNGLE_OUTBUF_LEN >> 2) + (len ? in_pos >> 2 : (LGFX_PNGLE_READBUF_LEN >> 2)));
+            if (res < 0) return -1;
+            if (res > 0) return 0; // region of interest is complete
           }
           pngle->next_out += out_bytes;
           pngle->avail_out -= out_bytes;
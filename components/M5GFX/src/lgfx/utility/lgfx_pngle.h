@@ -27,6 +27,7 @@
 /
 / Modified for LGFX  by lovyan03, 2020-2022
 / tweak for 32bit processor
+/ add region of interest (skip pixel conversion outside of it, stop after it)
 /----------------------------------------------------------------------------*/
 
 #ifndef __LGFX_PNGLE_H__
@@ -58,6 +59,10 @@ void lgfx_pngle_destroy(pngle_t *pngle);
 uint32_t lgfx_pngle_get_width(pngle_t *pngle);
 uint32_t lgfx_pngle_get_height(pngle_t *pngle);
 
+// Limit the draw callback to the region (inclusive, image pixels). Call after lgfx_pngle_prepare, which resets it to the whole image.
+// Rows below the region are not decoded at all unless the image is interlaced.
+void lgfx_pngle_set_roi(pngle_t *pngle, uint32_t left, uint32_t top, uint32_t right, uint32_t bottom);
+
 // ----------------
 // Debug interfaces
 // ----------------
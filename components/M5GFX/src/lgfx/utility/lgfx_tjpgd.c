@@ -468,7 +468,8 @@ static void block_idct (
 /*-----------------------------------------------------------------------*/
 
 static JRESULT mcu_load (
-	lgfxJdec* jd		/* Pointer to the decompressor object */
+	lgfxJdec* jd,		/* Pointer to the decompressor object */
+	uint_fast8_t skip	/* 1:Only advance the bit stream (MCU is out of the region of interest) */
 )
 {
 	int32_t *tmp = (int32_t*)jd->workbuf;	/* Block working buffer for de-quantize and IDCT */
@@ -506,7 +507,7 @@ static JRESULT mcu_load (
 		tmp[0] = d * dqf[0] >> 8;				/* De-quantize, apply scale factor of Arai algorithm and descale 8 bits */
 
 		/* Extract following 63 AC elements from input stream */
-		memset(&tmp[1], 0, 63*sizeof(int32_t));	/* Clear rest of elements */
+		if (!skip) memset(&tmp[1], 0, 63*sizeof(int32_t));	/* Clear rest of elements */
 		hb = jd->huffbits[id][1];				/* Huffman table for the AC elements */
 		hc = jd->huffcode[id][1];
 		hd = jd->huffdata[id][1];
@@ -526,6 +527,8 @@ static JRESULT mcu_load (
 			}
 		} while (++i < 64);		/* Next AC element */
 
+		if (skip) continue;		/* Block is not output, IDCT is not needed */
+
 		if (i == 1 || (JD_USE_SCALE && jd->scale == 3)) {
 			d = (int16_t)((*tmp >> 8) + 128);	/* If scale ratio is 1/8, IDCT can be ommited and only DC element is used */
 			for (i = 0; i < 64; bp[i++] = d) ;
@@ -812,6 +815,8 @@ JRESULT lgfx_jd_prepare (
 
 			jd->width = LDB_WORD(seg+3);		/* Image width in unit of pixel */
 			jd->height = LDB_WORD(seg+1);		/* Image height in unit of pixel */
+			jd->roi.left = 0; jd->roi.right = jd->width - 1;	/* Output whole image by default */
+			jd->roi.top = 0; jd->roi.bottom = jd->height - 1;
 			jd->comps_in_frame = seg[5];
 			if (seg[5] != 1 && seg[5] != 3)
 				return JDR_FMT3;	/* Err: Supports only Y/Cb/Cr or Y(Grayscale) format */
@@ -967,7 +972,8 @@ JRESULT lgfx_jd_decomp (
 
 	rc = JDR_OK;
 
-	for (y = 0; y < jd->height; y += my) {		/* Vertical loop of MCUs */
+	for (y = 0; y < jd->height && y <= jd->roi.bottom; y += my) {	/* Vertical loop of MCUs, stop below the region of interest */
+		uint_fast8_t skip_row = (y + my <= jd->roi.top);
 		x = 0;
 		do {	/* Horizontal loop of MCUs */
 			if (nrst && rst++ == nrst) {	/* Process restart interval if enabled */
@@ -975,8 +981,11 @@ JRESULT lgfx_jd_decomp (
 				if (rc != JDR_OK) return rc;
 				rst = 1;
 			}
-			rc = mcu_load(jd);					/* Load an MCU (decompress huffman coded stream and apply IDCT) */
+			/* MCUs out of the region of interest are only huffman decoded to keep the stream and DC values in sync */
+			uint_fast8_t skip = skip_row || x + mx <= jd->roi.left || x > jd->roi.right;
+			rc = mcu_load(jd, skip);			/* Load an MCU (decompress huffman coded stream and apply IDCT) */
 			if (rc != JDR_OK) return rc;
+			if (skip) continue;
 			rc = mcu_output(jd, outfunc, x, y);	/* Output the MCU (color space conversion, scaling and output) */
 			if (rc != JDR_OK) return rc;
 		} while ( (x += mx) < jd->width);
@@ -7,6 +7,7 @@
 / add support grayscale jpeg
 / add bayer pattern
 / tweak for 32bit processor
+/ add region of interest (skip IDCT and output outside of it)
 /----------------------------------------------------------------------------*/
 #ifndef __LGFX_TJPGDEC_H__
 #define __LGFX_TJPGDEC_H__
@@ -81,6 +82,7 @@ struct lgfxJdec {
 	uint32_t (*infunc)(void*, uint8_t*, uint32_t);/* Pointer to jpeg stream input function */
 	void* device;				/* Pointer to I/O device identifiler for the session */
 	uint8_t comps_in_frame;		/* 1=Y(grayscale)  3=YCrCb */
+	JRECT roi;					/* Region to output (pixel, before descaling). Whole image after lgfx_jd_prepare */
 };
 
 
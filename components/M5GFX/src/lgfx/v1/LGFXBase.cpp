@@ -1151,29 +1151,45 @@ namespace lgfx
 //----------------------------------------------------------------------------
 
 
-  void LGFXBase::fillSmoothRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r)
-  {
-    startWrite();
-    int32_t xs = 0;
-    int32_t cx = 0;
-    uint32_t rgb888 = _write_conv.revert_rgb888(_color.raw);
-    // Limit radius to half width or height
-    if (r > w / 2) r = w / 2;
-    if (r > h / 2) r = h / 2;
+  // Precomputed anti-aliased quarter circle used by fillSmoothRoundRect.
+  // Row k is the scanline k+1 pixels outside the straight edge; it holds the
+  // coverage pixels [aa_end[k-1], aa_end[k]) followed by a solid run starting at solid[k].
+  struct smooth_corner_t
+  {
+    int32_t radius;
+    uint16_t* solid;
+    uint16_t* aa_end;
+    uint16_t* aa_x;
+    uint8_t*  aa_alpha;
+  };
 
-    y += r;
-    h -= 2 * r;
-    fillRect(x, y, w, h);
-    h--;
-    x += r;
-    w -= 2 * r + 1;
-    int32_t r1 = r * r;
-    r++;
+  static constexpr const int32_t SMOOTH_CORNER_CACHE_MAX = 64;
+  static smooth_corner_t* smooth_corner_cache[SMOOTH_CORNER_CACHE_MAX + 1];
+
+  static smooth_corner_t* create_smooth_corner(int32_t radius)
+  {
+    int32_t r = radius + 1;
+    // Every coverage pixel advances the row start, which may repeat once per row.
+    int32_t aa_max = 2 * r + radius;
+    size_t len = sizeof(smooth_corner_t)
+               + radius * 2 * sizeof(uint16_t)
+               + aa_max * (sizeof(uint16_t) + sizeof(uint8_t));
+    auto corner = (smooth_corner_t*)heap_alloc(len);
+    if (corner == nullptr) return nullptr;
+    corner->radius   = radius;
+    corner->solid    = (uint16_t*)&corner[1];
+    corner->aa_end   = &corner->solid[radius];
+    corner->aa_x     = &corner->aa_end[radius];
+    corner->aa_alpha = (uint8_t*)&corner->aa_x[aa_max];
+
+    int32_t r1 = radius * radius;
     int32_t r2 = r * r;
-
-    for (int32_t cy = r - 1; cy > 0; cy--)
+    int32_t xs = 0;
+    int32_t cx = 0;
+    uint_fast16_t count = 0;
+    for (int32_t k = 0; k < radius; ++k)
     {
-      int32_t dy2 = (r - cy) * (r - cy);
+      int32_t dy2 = (k + 1) * (k + 1);
       for (cx = xs; cx < r; cx++)
       {
         int32_t hyp2 = (r - cx) * (r - cx) + dy2;
@@ -1183,15 +1199,74 @@ namespace lgfx
         if (alphaf > HiAlphaTheshold) break;
         xs = cx;
         if (alphaf < LoAlphaTheshold) continue;
-        uint8_t alpha = alphaf * 255;
-        fillRectAlpha(x + cx - r    , y + cy - r    , 1, 1, alpha, rgb888);
-        fillRectAlpha(x - cx + r + w, y + cy - r    , 1, 1, alpha, rgb888);
-        fillRectAlpha(x - cx + r + w, y - cy + r + h, 1, 1, alpha, rgb888);
-        fillRectAlpha(x + cx - r    , y - cy + r + h, 1, 1, alpha, rgb888);
+        corner->aa_x[count] = cx;
+        corner->aa_alpha[count] = alphaf * 255;
+        ++count;
       }
-      writeFastHLine(x + cx - r, y + cy - r, 2 * (r - cx) + 1 + w);
-      writeFastHLine(x + cx - r, y - cy + r + h, 2 * (r - cx) + 1 + w);
+      corner->solid[k] = cx;
+      corner->aa_end[k] = count;
     }
+    return corner;
+  }
+
+  void LGFXBase::fillSmoothRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r)
+  {
+    startWrite();
+    uint32_t rgb888 = _write_conv.revert_rgb888(_color.raw);
+    // Limit radius to half width or height
+    if (r > w / 2) r = w / 2;
+    if (r > h / 2) r = h / 2;
+
+    fillRect(x, y + r, w, h - 2 * r);
+    if (r <= 0) { endWrite(); return; }
+
+    smooth_corner_t* corner = nullptr;
+    if (r <= SMOOTH_CORNER_CACHE_MAX)
+    {
+      corner = smooth_corner_cache[r];
+      if (corner == nullptr)
+      {
+        corner = smooth_corner_cache[r] = create_smooth_corner(r);
+      }
+    }
+    else
+    {
+      corner = create_smooth_corner(r);
+    }
+    if (corner == nullptr) { endWrite(); return; }
+
+    int32_t cl = _clip_l;
+    int32_t cr = _clip_r;
+    int32_t ct = _clip_t;
+    int32_t cb = _clip_b;
+    int32_t ys[2] = { y + r - 1, y + h - r };
+    int32_t xr = x + w;
+    uint_fast16_t aa = 0;
+    for (int32_t k = 0; k < r; ++k, --ys[0], ++ys[1])
+    {
+      uint_fast16_t aa_end = corner->aa_end[k];
+      int32_t xl = x + corner->solid[k] - 1;
+      int32_t sl = std::max(cl, xl);
+      int32_t sr = std::min(cr, xr - corner->solid[k]);
+      for (int i = 0; i < 2; ++i)
+      {
+        int32_t yy = ys[i];
+        if (yy < ct || yy > cb) continue;
+        for (auto j = aa; j < aa_end; ++j)
+        {
+          uint32_t color = rgb888 | (uint32_t)corner->aa_alpha[j] << 24;
+          int32_t cx = corner->aa_x[j];
+          int32_t px = x + cx - 1;
+          if (px >= cl && px <= cr) _panel->writeFillRectAlphaPreclipped(px, yy, 1, 1, color);
+          px = xr - cx;
+          if (px >= cl && px <= cr) _panel->writeFillRectAlphaPreclipped(px, yy, 1, 1, color);
+        }
+        if (sl <= sr) writeFillRectPreclipped(sl, yy, sr - sl + 1, 1);
+      }
+      aa = aa_end;
+    }
+
+    if (r > SMOOTH_CORNER_CACHE_MAX) heap_free(corner);
     endWrite();
   }
 
@@ -2749,6 +2824,15 @@ namespace lgfx
       gfx_->setClipRect(x_, y_, maxWidth_, maxHeight_);
       return true;
     }
+
+    /// Source pixel range (inclusive) that reaches the visible area after begin(), with one pixel margin for rounding.
+    void get_source_rect(int32_t w_, int32_t h_, int32_t* left, int32_t* top, int32_t* right, int32_t* bottom) const
+    {
+      *left   = std::max<int32_t>(0,      floorf(offX / zoom_x) - 1);
+      *top    = std::max<int32_t>(0,      floorf(offY / zoom_y) - 1);
+      *right  = std::min<int32_t>(w_ - 1, ceilf((offX + maxWidth ) / zoom_x));
+      *bottom = std::min<int32_t>(h_ - 1, ceilf((offY + maxHeight) / zoom_y));
+    }
   };
 
   bool LGFXBase::draw_bmp(DataWrapper* data, int32_t x, int32_t y, int32_t maxWidth, int32_t maxHeight, int32_t offX, int32_t offY, float zoom_x, float zoom_y, datum_t datum)
@@ -2980,6 +3064,16 @@ namespace lgfx
       return false;
     }
 
+    {
+      // MCUs outside of the visible area are only huffman decoded, decoding stops below it.
+      int32_t left, top, right, bottom;
+      drawinfo.get_source_rect(jpegdec.width, jpegdec.height, &left, &top, &right, &bottom);
+      jpegdec.roi.left   = left;
+      jpegdec.roi.top    = top;
+      jpegdec.roi.right  = right;
+      jpegdec.roi.bottom = bottom;
+    }
+
     if (drawinfo.offX) { drawinfo.x -= drawinfo.offX; drawinfo.offX = 0; }
     if (drawinfo.offY) { drawinfo.y -= drawinfo.offY; drawinfo.offY = 0; }
 
@@ -3367,6 +3461,13 @@ namespace lgfx
 
     png.pc = &pc;
 
+    {
+      // Rows outside of the visible area are only unfiltered, decoding stops below it.
+      int32_t left, top, right, bottom;
+      png.get_source_rect(lgfx_pngle_get_width(pngle), lgfx_pngle_get_height(pngle), &left, &top, &right, &bottom);
+      lgfx_pngle_set_roi(pngle, left, top, right, bottom);
+    }
+
     this->startWrite(!data->hasParent());
 
     auto res = lgfx_pngle_decomp(pngle, png.zoom_x == 1.0f && png.zoom_y == 1.0f ? png_draw_alpha_callback : png_draw_alpha_scale_callback);
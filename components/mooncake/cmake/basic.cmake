@@ -48,6 +48,8 @@ enable_testing()
 # Framework Test
 # App manager basic
 add_test(app_manager_basic example/framework/app_manager_basic)
+# App manager benchmark
+add_test(app_manager_benchmark example/framework/app_manager_benchmark)
 # App register test
 add_test(app_register_test example/framework/app_register_test)
 # App user data test
@@ -58,6 +60,12 @@ add_test(input_device_register_test example/framework/input_device_register_test
 add_test(mooncake_framework_test example/framework/mooncake_framework_test)
 # SimpleKV test
 add_test(simplekv_test example/framework/simplekv_test)
+# SimpleKV benchmark
+add_test(simplekv_benchmark example/framework/simplekv_benchmark)
+# Scheduler test
+add_test(scheduler_test example/framework/scheduler_test)
+# Trace test
+add_test(trace_test example/framework/trace_test)
 
 
 # Mooncake Test
@@ -26,6 +26,7 @@ set(MOONCAKE_REQUIRES
 
 # Private component requirement
 set(MOONCAKE_PRIV_REQUIRES
+    esp_timer
 )
 
 # Register component
@@ -0,0 +1,90 @@
+/**
+ * @file app_manager_benchmark.cpp
+ * @brief Cost of APP_Manager::update() with many installed but idle apps
+ * @version 0.1
+ * @date 2025-12-11
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <app/app_manager.h>
+
+
+using namespace MOONCAKE;
+
+
+#define UPDATES_PER_RUN                 100000
+
+
+/* ---------------------- App_Counter ---------------------- */
+/* Counts its lifecycle calls, so the benchmark can check who was touched */
+class App_Counter : public APP_BASE
+{
+    public: long running_count = 0;
+    public: long running_bg_count = 0;
+    void onRunning() override { running_count++; }
+    void onRunningBG() override { running_bg_count++; }
+};
+class App_Counter_packer : public APP_PACKER_BASE
+{
+    std::string getAppName() override { return "App-Counter"; }
+    void * newApp() override { return new App_Counter; }
+    void deleteApp(void *app) override { delete (App_Counter*)app; }
+};
+/* --------------------------------------------------- */
+
+
+/* One foreground app, plus idle apps that were created and never started */
+static int _run(int idleNum)
+{
+    APP_Manager app_manager;
+    App_Counter_packer packer;
+
+    App_Counter* foreground = (App_Counter*)app_manager.createApp(packer.getAddr());
+    app_manager.startApp(foreground);
+    std::vector<App_Counter*> idle_apps;
+    for (int i = 0; i < idleNum; i++)
+        idle_apps.push_back((App_Counter*)app_manager.createApp(packer.getAddr()));
+
+    /* Add, resume */
+    app_manager.update();
+    app_manager.update();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < UPDATES_PER_RUN; i++)
+        app_manager.update();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / UPDATES_PER_RUN;
+
+    printf("%4d idle apps: %7.1f ns per update\n", idleNum, ns);
+
+    if (foreground->running_count != UPDATES_PER_RUN)
+        return -1;
+    for (auto app : idle_apps)
+    {
+        if (app->running_count != 0 || app->running_bg_count != 0)
+            return -1;
+    }
+    if (app_manager.getCreatedAppNum() != (size_t)idleNum + 1)
+        return -1;
+    return 0;
+}
+
+
+int main()
+{
+    std::cout << "[App manager benchmark]\n\n";
+
+    for (int idle_num : {0, 10, 100, 500})
+    {
+        if (_run(idle_num) != 0)
+            return -1;
+    }
+
+    std::cout << "\ndone\n";
+    return 0;
+}
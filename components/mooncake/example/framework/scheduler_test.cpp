@@ -0,0 +1,219 @@
+/**
+ * @file scheduler_test.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-08
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <app/app_manager.h>
+#include <scheduler/scheduler.h>
+
+
+using namespace MOONCAKE;
+
+
+/* ---------------------- App_Sleepy ---------------------- */
+/* An app that only wants to be updated every now and then */
+class App_Sleepy : public APP_BASE
+{
+    public: uint32_t update_in = 50;
+    public: uint32_t wake_events = MC_EVENT_ALL;
+    public: int running_count = 0;
+    void onCreate() override { startApp(); }
+    void onRunning() override
+    {
+        running_count++;
+        requestUpdateIn(update_in, wake_events);
+    }
+};
+class App_Sleepy_packer : public APP_PACKER_BASE
+{
+    std::string getAppName() override { return "App-Sleepy"; }
+    void * newApp() override { return new App_Sleepy; }
+    void deleteApp(void *app) override { delete (App_Sleepy*)app; }
+};
+/* --------------------------------------------------- */
+
+
+/* ---------------------- App_Ticker ---------------------- */
+/* A background app that only needs a tick now and then */
+class App_Ticker : public APP_BASE
+{
+    public: int bg_count = 0;
+    void onCreate() override
+    {
+        setAllowBgRunning(true);
+        setBgTickInterval(30);
+        startApp();
+    }
+    void onRunning() override { closeApp(); }
+    void onRunningBG() override { bg_count++; }
+};
+class App_Ticker_packer : public APP_PACKER_BASE
+{
+    std::string getAppName() override { return "App-Ticker"; }
+    void * newApp() override { return new App_Ticker; }
+    void deleteApp(void *app) override { delete (App_Ticker*)app; }
+};
+/* --------------------------------------------------- */
+
+
+/* ---------------------- App_Busy ---------------------- */
+/* An old style app, wants every frame */
+class App_Busy : public APP_BASE
+{
+    void onCreate() override { startApp(); }
+};
+class App_Busy_packer : public APP_PACKER_BASE
+{
+    std::string getAppName() override { return "App-Busy"; }
+    void * newApp() override { return new App_Busy; }
+    void deleteApp(void *app) override { delete (App_Busy*)app; }
+};
+/* --------------------------------------------------- */
+
+
+static uint32_t _timed_wait(Scheduler& scheduler, APP_Manager& app_manager, uint32_t* events = nullptr)
+{
+    uint32_t start = Scheduler::getTick();
+    uint32_t ret = scheduler.wait(app_manager.getNextUpdateIn(), app_manager.getWakeEvents());
+    if (events != nullptr)
+        *events = ret;
+    return Scheduler::getTick() - start;
+}
+
+
+int main()
+{
+    std::cout << "[Scheduler test]\n\n";
+
+    APP_Manager app_manager;
+    Scheduler scheduler;
+    App_Sleepy_packer sleepy_packer;
+    App_Busy_packer busy_packer;
+
+
+    /* Nothing created yet, update right away */
+    if (app_manager.getNextUpdateIn() != 0)
+        return -1;
+
+
+    /* Sleepy app, first update adds it, second resumes it, third runs it */
+    App_Sleepy* sleepy = (App_Sleepy*)app_manager.createApp(sleepy_packer.getAddr());
+    app_manager.update();
+    app_manager.update();
+    app_manager.update();
+    std::cout << "next update in: " << app_manager.getNextUpdateIn() << "\n";
+    if (sleepy->running_count != 1 || app_manager.getNextUpdateIn() != 50)
+        return -1;
+
+    /* Should sleep for the requested time */
+    _timed_wait(scheduler, app_manager);
+    uint32_t slept = _timed_wait(scheduler, app_manager);
+    std::cout << "slept: " << slept << "ms\n";
+    if (slept < 45 || slept > 80)
+        return -1;
+
+
+    /* Requests only last for one update */
+    sleepy->update_in = 20;
+    app_manager.update();
+    if (app_manager.getNextUpdateIn() != 20)
+        return -1;
+
+
+    /* Wait for events only, woken up by another thread */
+    sleepy->update_in = MC_UPDATE_IDLE;
+    sleepy->wake_events = MC_EVENT_USER;
+    app_manager.update();
+    if (app_manager.getNextUpdateIn() != MC_UPDATE_IDLE || app_manager.getWakeEvents() != MC_EVENT_USER)
+        return -1;
+
+    scheduler.setMaxIdleTime(500);
+    std::thread notifier([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        /* Not waited for, stays pending */
+        scheduler.notify(MC_EVENT_INPUT);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        scheduler.notify(MC_EVENT_USER);
+    });
+    uint32_t events = 0;
+    slept = _timed_wait(scheduler, app_manager, &events);
+    notifier.join();
+    std::cout << "woken after: " << slept << "ms, events: " << events << "\n";
+    if (events != MC_EVENT_USER || slept < 45 || slept > 200)
+        return -1;
+
+
+    /* Nothing scheduled, capped by max idle time */
+    sleepy->wake_events = MC_EVENT_TIMER;
+    app_manager.update();
+    scheduler.setMaxIdleTime(40);
+    slept = _timed_wait(scheduler, app_manager, &events);
+    std::cout << "idle capped: " << slept << "ms\n";
+    if (events != 0 || slept < 35 || slept > 80)
+        return -1;
+
+
+    /* A busy app pulls the next update to now, but the frame rate holds it */
+    app_manager.createApp(busy_packer.getAddr());
+    app_manager.update();
+    app_manager.update();
+    app_manager.update();
+    if (app_manager.getNextUpdateIn() != 0)
+        return -1;
+
+    scheduler.setTargetFps(50);
+    _timed_wait(scheduler, app_manager);
+    uint32_t start = Scheduler::getTick();
+    for (int i = 0; i < 5; i++)
+    {
+        app_manager.update();
+        _timed_wait(scheduler, app_manager);
+    }
+    uint32_t elapsed = Scheduler::getTick() - start;
+    std::cout << "5 frames at 50 fps: " << elapsed << "ms\n";
+    if (elapsed < 95 || elapsed > 200)
+        return -1;
+
+
+    /* Lifecycle changes need the next update asap */
+    sleepy->update_in = 1000;
+    app_manager.closeApp(sleepy);
+    if (app_manager.getNextUpdateIn() != 0)
+        return -1;
+
+
+    /* Background app ticks at its own interval, not every update */
+    APP_Manager bg_manager;
+    App_Ticker_packer ticker_packer;
+    App_Ticker* ticker = (App_Ticker*)bg_manager.createApp(ticker_packer.getAddr());
+    /* Add, resume, run and close, pause */
+    for (int i = 0; i < 4; i++)
+        bg_manager.update();
+    if (ticker->bg_count != 0)
+        return -1;
+
+    bg_manager.update();
+    bg_manager.update();
+    std::cout << "bg next update in: " << bg_manager.getNextUpdateIn() << "\n";
+    if (ticker->bg_count != 1 || bg_manager.getNextUpdateIn() == 0 || bg_manager.getNextUpdateIn() > 30)
+        return -1;
+
+    start = Scheduler::getTick();
+    while (Scheduler::getTick() - start < 100)
+        bg_manager.update();
+    std::cout << "bg ticks in 100ms: " << ticker->bg_count << "\n";
+    if (ticker->bg_count < 3 || ticker->bg_count > 6)
+        return -1;
+
+
+    std::cout << "idle time: " << scheduler.getIdleTime() << "ms, frames: " << scheduler.getFrameCount() << "\n";
+    std::cout << "\ndone\n";
+    return 0;
+}
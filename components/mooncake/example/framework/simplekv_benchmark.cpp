@@ -0,0 +1,141 @@
+/**
+ * @file simplekv_benchmark.cpp
+ * @brief Lookup cost of the database, string keys vs handles vs the old unordered_map store
+ * @version 0.1
+ * @date 2025-12-10
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <simplekv/simplekv.h>
+#include <mc_conf_internal.h>
+#include <unordered_map>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+
+#define LOOKUPS_PER_KEY                 200000
+
+
+/* What every app looks up */
+static const char* _keys[] = {
+    MC_DB_DISP_HOR, MC_DB_DISP_VER, MC_DB_DISP_BRIGHTNESS, MC_DB_BATTERY_LEVEL, MC_DB_BATTERY_IS_CHARGING,
+    "HAL", "SETTINGS", "WIFI", "SDCARD", "KEYBOARD",
+};
+static const int _key_num = sizeof(_keys) / sizeof(_keys[0]);
+
+
+/* The previous SimpleKV store, kept here as baseline */
+class OldKV
+{
+    private:
+        std::unordered_map<std::string, SIMPLEKV::ValueInfo_t> _value_map;
+        SIMPLEKV::ValueInfo_t _ret_buffer;
+
+    public:
+        ~OldKV()
+        {
+            for (auto& kv : _value_map)
+                free(kv.second.addr);
+        }
+
+        bool Add(const std::string& key, void* value, size_t size)
+        {
+            if (_value_map.find(key) != _value_map.end() || size == 0)
+                return false;
+            SIMPLEKV::ValueInfo_t new_item;
+            new_item.size = size;
+            new_item.addr = malloc(size);
+            memcpy(new_item.addr, value, size);
+            _value_map[key] = new_item;
+            return true;
+        }
+
+        SIMPLEKV::ValueInfo_t* Get(const std::string& key)
+        {
+            auto iter = _value_map.find(key);
+            if (iter != _value_map.end())
+                _ret_buffer = iter->second;
+            else
+                _ret_buffer = SIMPLEKV::ValueInfo_t();
+            return &_ret_buffer;
+        }
+};
+
+
+template<typename F>
+static double _ns_per_lookup(F lookup)
+{
+    auto start = std::chrono::steady_clock::now();
+    lookup();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (LOOKUPS_PER_KEY * _key_num);
+}
+
+
+int main()
+{
+    std::cout << "[SimpleKV benchmark]\n\n";
+
+    OldKV old_db;
+    SIMPLEKV::SimpleKV db;
+    SIMPLEKV::Handle_t handles[_key_num];
+
+    for (int i = 0; i < _key_num; i++)
+    {
+        int value = i;
+        old_db.Add(_keys[i], &value, sizeof(value));
+        db.Add<int>(_keys[i], value);
+        handles[i] = db.GetHandle(_keys[i]);
+        if (!handles[i].valid())
+            return -1;
+    }
+    printf("%d keys, arena usage: %zu bytes\n\n", _key_num, db.ArenaUsage());
+
+    /* Sum the values so lookups can't be optimized away */
+    volatile long sink = 0;
+    long expected = 0;
+    for (int i = 0; i < _key_num; i++)
+        expected += i;
+    expected *= LOOKUPS_PER_KEY;
+
+    long sum = 0;
+    double old_ns = _ns_per_lookup([&]() {
+        for (int n = 0; n < LOOKUPS_PER_KEY; n++)
+            for (int i = 0; i < _key_num; i++)
+                sum += old_db.Get(_keys[i])->value<int>();
+    });
+    sink = sum;
+    if (sum != expected)
+        return -1;
+
+    sum = 0;
+    double key_ns = _ns_per_lookup([&]() {
+        for (int n = 0; n < LOOKUPS_PER_KEY; n++)
+            for (int i = 0; i < _key_num; i++)
+                sum += db.Get(_keys[i])->value<int>();
+    });
+    sink = sum;
+    if (sum != expected)
+        return -1;
+
+    sum = 0;
+    double handle_ns = _ns_per_lookup([&]() {
+        for (int n = 0; n < LOOKUPS_PER_KEY; n++)
+            for (int i = 0; i < _key_num; i++)
+                sum += db.Get(handles[i])->value<int>();
+    });
+    sink = sum;
+    if (sum != expected)
+        return -1;
+    (void)sink;
+
+    printf("unordered_map Get(key): %6.1f ns\n", old_ns);
+    printf("SimpleKV Get(key):      %6.1f ns\n", key_ns);
+    printf("SimpleKV Get(handle):   %6.1f ns\n", handle_ns);
+
+    std::cout << "\ndone\n";
+    return 0;
+}
@@ -187,5 +187,68 @@ int main()
     /* -------------------------------------------------------------- */
 
 
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Handle]\n");
+
+    db.Add<int>("Score", 100);
+    SIMPLEKV::Handle_t score = db.GetHandle("Score");
+    printf("Score: %d\n", db.Get(score)->value<int>());
+    // > Score: 100
+
+    if (!score.valid() || db.Get(score)->value<int>() != 100)
+        return -1;
+
+    /* Handle and key point to the same data */
+    db.Put<int>(score, 200);
+    if (db.Get("Score")->value<int>() != 200)
+        return -1;
+
+    /* Handle goes stale with the key, even if the key comes back */
+    db.Delete("Score");
+    db.Add<int>("Score", 300);
+    printf("stale handle exist? %s\n", db.Exist(score) ? "yes" : "no");
+    // > stale handle exist? no
+
+    if (db.Exist(score) || db.Get(score)->addr != nullptr || db.Put<int>(score, 1))
+        return -1;
+    if (db.GetHandle("nope").valid())
+        return -1;
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Capacity]\n");
+
+    db.DeleteAll();
+
+    /* Values bigger than the arena go to heap */
+    static uint8_t big[SIMPLEKV_ARENA_SIZE] = {1, 2, 3};
+    db.Add("Big", (void*)big, sizeof(big));
+    printf("big value in arena? %s\n", db.ArenaUsage() ? "yes" : "no");
+    // > big value in arena? no
+
+    if (db.ArenaUsage() != 0 || db.Get("Big")->value<uint8_t>() != 1)
+        return -1;
+
+    /* Table is fixed size */
+    for (size_t i = db.Size(); i < db.Capacity(); i++)
+    {
+        if (!db.Add<size_t>("key" + std::to_string(i), i))
+            return -1;
+    }
+    printf("database has %ld elements, full\n", db.Size());
+
+    if (db.Add<int>("one more", 1))
+        return -1;
+    for (size_t i = 1; i < db.Capacity(); i++)
+    {
+        if (db.Get("key" + std::to_string(i))->value<size_t>() != i)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
     return 0;
 }
@@ -0,0 +1,187 @@
+/**
+ * @file trace_test.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <app/app_manager.h>
+#include <trace/trace.h>
+
+
+using namespace MOONCAKE;
+
+
+/* ---------------------- App_Busy ---------------------- */
+/* Runs a traced zone in every update */
+class App_Busy : public APP_BASE
+{
+    void onCreate() override { startApp(); }
+    void onRunning() override
+    {
+        MC_TRACE_ZONE("busy");
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+};
+class App_Busy_packer : public APP_PACKER_BASE
+{
+    std::string getAppName() override { return "App-Busy"; }
+    void * newApp() override { return new App_Busy; }
+    void deleteApp(void *app) override { delete (App_Busy*)app; }
+};
+/* --------------------------------------------------- */
+
+
+static std::string _export()
+{
+    FILE* file = tmpfile();
+    if (!Trace::exportChromeJson(file))
+        return "";
+    std::string json(ftell(file), '\0');
+    rewind(file);
+    json.resize(fread(&json[0], 1, json.size(), file));
+    fclose(file);
+    return json;
+}
+
+
+static size_t _count(const std::string& str, const std::string& what)
+{
+    size_t num = 0;
+    for (size_t pos = str.find(what); pos != std::string::npos; pos = str.find(what, pos + 1))
+        num++;
+    return num;
+}
+
+
+int main()
+{
+    /* -------------------------------------------------------------- */
+    printf("\n[Stopped]\n");
+
+    /* Nothing is recorded till started */
+    {
+        MC_TRACE_ZONE("nothing");
+        MC_TRACE_COUNTER("nothing", 1);
+    }
+    printf("events: %ld\n", Trace::getEventNum());
+    if (Trace::getEventNum() != 0 || !_export().empty())
+        return -1;
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Zones and counters]\n");
+
+    if (!Trace::start(16))
+        return -1;
+    {
+        MC_TRACE_ZONE("outer");
+        {
+            MC_TRACE_ZONE("inner");
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        MC_TRACE_COUNTER("level", 42);
+        MC_TRACE_INSTANT("mark");
+    }
+    printf("events: %ld\n", Trace::getEventNum());
+    // > events: 4
+
+    std::string json = _export();
+    printf("%s", json.c_str());
+    if (Trace::getEventNum() != 4)
+        return -1;
+    if (json.find("{\"displayTimeUnit\"") != 0 || json.rfind("]}\n") != json.size() - 3)
+        return -1;
+    if (_count(json, "\"ph\":\"X\"") != 2 || _count(json, "\"ph\":\"C\"") != 1 || _count(json, "\"ph\":\"i\"") != 1)
+        return -1;
+    if (json.find("\"name\":\"level\",\"ph\":\"C\"") == std::string::npos || json.find("{\"value\":42}") == std::string::npos)
+        return -1;
+
+    /* Inner zone is recorded first, as zones are written when they end */
+    size_t inner = json.find("\"inner\"");
+    size_t outer = json.find("\"outer\"");
+    if (inner == std::string::npos || outer == std::string::npos || inner > outer)
+        return -1;
+    long dur = atol(json.c_str() + json.find("\"dur\":", inner) + 6);
+    printf("inner zone: %ld us\n", dur);
+    if (dur < 5000)
+        return -1;
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Ring buffer]\n");
+
+    /* Oldest events are dropped */
+    for (int i = 0; i < 100; i++)
+        MC_TRACE_COUNTER("count", i);
+    json = _export();
+    printf("events: %ld\n", Trace::getEventNum());
+    // > events: 16
+
+    if (Trace::getEventNum() != 16 || _count(json, "\"ph\":\"C\"") != 16)
+        return -1;
+    if (json.find("{\"value\":83}") != std::string::npos || json.find("{\"value\":84}") == std::string::npos
+        || json.find("{\"value\":99}") == std::string::npos)
+        return -1;
+
+    /* Stopped keeps events */
+    Trace::stop();
+    MC_TRACE_INSTANT("ignored");
+    if (Trace::getEventNum() != 16 || _export().find("ignored") != std::string::npos)
+        return -1;
+    Trace::release();
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Frames]\n");
+
+    if (!Trace::start())
+        return -1;
+
+    APP_Manager app_manager;
+    App_Busy_packer packer;
+    app_manager.createApp(packer.getAddr());
+
+    /* A bit over a window, with one slow frame */
+    auto start = std::chrono::steady_clock::now();
+    int frames = 0;
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1100))
+    {
+        Trace::frameBegin();
+        app_manager.update();
+        if (frames == 10)
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        Trace::frameEnd();
+        frames++;
+    }
+    printf("fps: %d worst frame: %d us\n", Trace::getFps(), Trace::getWorstFrame());
+
+    if (Trace::getFps() == 0 || Trace::getFps() > 1000)
+        return -1;
+    if (Trace::getWorstFrame() < 20000)
+        return -1;
+
+    json = _export();
+    if (_count(json, "\"name\":\"busy\"") == 0 || _count(json, "\"name\":\"app_manager\"") == 0
+        || _count(json, "\"name\":\"frame\"") == 0 || _count(json, "\"name\":\"fps\"") != 1)
+        return -1;
+    Trace::release();
+    /* -------------------------------------------------------------- */
+
+
+    printf("\ndone\n");
+    return 0;
+}
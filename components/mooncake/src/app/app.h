@@ -10,10 +10,14 @@
  */
 #pragma once
 #include <string>
+#include "../scheduler/scheduler.h"
 
 
 namespace MOONCAKE
 {   
+    class APP_Manager;
+
+
     /* App packer base */
     /* Contains the static elements of an app, like name, icon... */
     /* Also an app's memory allocation, freeing... */
@@ -91,6 +95,20 @@ namespace MOONCAKE
             bool _go_start;
             bool _go_close;
             bool _go_destroy;
+
+            /* Scheduling request, only lasts for one update */
+            bool _update_requested;
+            uint32_t _update_in;
+            uint32_t _wake_events;
+
+            /* Min time between two onRunningBG() calls, 0 for every update */
+            uint32_t _bg_tick_interval;
+
+            /* Set by the app manager that holds this app, so flag changes reach it */
+            friend class APP_Manager;
+            APP_Manager* _app_manager;
+            void* _lifecycle;
+            void _notify_transition();
             
 
         protected:
@@ -107,19 +125,40 @@ namespace MOONCAKE
              * @brief Notice the app manager, that this app want to be started
              * 
              */
-            inline void startApp() { _go_start = true; }
+            inline void startApp() { _go_start = true; _notify_transition(); }
 
             /**
              * @brief Notice the app manager, that this app want to be cloesd 
              * , better call this in onRunning() only, to avoid repeat method callback
              */
-            inline void closeApp() { _go_close = true; }
+            inline void closeApp() { _go_close = true; _notify_transition(); }
 
             /**
              * @brief Notice the app manager, that this app want to be destroyed 
              * , better call this in onRunning() or onRunningBG() only, to avoid repeat method callback
              */
-            inline void destroyApp() { _go_destroy = true; }
+            inline void destroyApp() { _go_destroy = true; _notify_transition(); }
+
+            /**
+             * @brief Notice the app manager, that this app has nothing to do for the next few ms
+             * , unless one of the wake events is notified. Only lasts for the current update, so call it in every
+             * onRunning() or onRunningBG(). Apps that never call it are updated every frame
+             * @param ms Time from now till the app wants to be updated again, MC_UPDATE_IDLE for events only
+             * @param wakeEvents MC_EVENT_* bits that wake the app up earlier
+             */
+            inline void requestUpdateIn(uint32_t ms, uint32_t wakeEvents = MC_EVENT_ALL)
+            {
+                _update_in = (_update_requested && _update_in < ms) ? _update_in : ms;
+                _wake_events = _update_requested ? (_wake_events | wakeEvents) : wakeEvents;
+                _update_requested = true;
+            }
+
+            /**
+             * @brief Set the min time between two onRunningBG() calls, the app manager skips the app in between
+             * , instead of calling onRunningBG() every update
+             * @param ms 0 for every update
+             */
+            inline void setBgTickInterval(uint32_t ms) { _bg_tick_interval = ms; }
 
 
         public:
@@ -128,7 +167,13 @@ namespace MOONCAKE
                 _allow_bg_running(false),
                 _go_start(false),
                 _go_close(false),
-                _go_destroy(false)
+                _go_destroy(false),
+                _update_requested(false),
+                _update_in(0),
+                _wake_events(0),
+                _bg_tick_interval(0),
+                _app_manager(nullptr),
+                _lifecycle(nullptr)
                 {}
             virtual ~APP_BASE() {}
 
@@ -145,11 +190,20 @@ namespace MOONCAKE
             inline bool isGoingStart() { return _go_start; }
             inline bool isGoingClose() { return _go_close; }
             inline bool isGoingDestroy() { return _go_destroy; }
+            inline bool isGoingAnywhere() { return _go_start || _go_close || _go_destroy; }
             inline void resetGoingStartFlag() { _go_start = false; }
             inline void resetGoingCloseFlag() { _go_close = false; }
             inline void resetGoingDestroyFlag() { _go_destroy = false; }
 
 
+            /* API for scheduling request checking */
+            inline bool isUpdateRequested() { return _update_requested; }
+            inline uint32_t getUpdateIn() { return _update_in; }
+            inline uint32_t getWakeEvents() { return _wake_events; }
+            inline void resetUpdateRequest() { _update_requested = false; }
+            inline uint32_t getBgTickInterval() { return _bg_tick_interval; }
+
+
             /**
              * @brief Set the App Packer
              * 
@@ -1,19 +1,27 @@
 /**
  * @file app_manager.cpp
  * @author Forairaaaaa
- * @brief 
+ * @brief
  * @version 0.2
  * @date 2023-08-19
- * 
+ *
  * @copyright Copyright (c) 2023
- * 
+ *
  */
 #include "app_manager.h"
+#include "../trace/trace.h"
 
 
 using namespace MOONCAKE;
 
 
+void APP_BASE::_notify_transition()
+{
+    if (_app_manager != nullptr)
+        _app_manager->_on_app_transition(this);
+}
+
+
 APP_Manager::~APP_Manager()
 {
     /* Free all the app's memory */
@@ -21,83 +29,190 @@ APP_Manager::~APP_Manager()
 }
 
 
-APP_BASE* APP_Manager::createApp(APP_PACKER_BASE* appPacker)
+void APP_Manager::_list_push(AppList_t& list, AppNode_t* node)
 {
-    if (appPacker == nullptr)
-        return nullptr;
+    node->list = &list;
+    node->prev = list.tail;
+    node->next = nullptr;
+    if (list.tail != nullptr)
+        list.tail->next = node;
+    else
+        list.head = node;
+    list.tail = node;
+}
 
-    /* Create a new app with app packer */
-    APP_BASE* new_app = (APP_BASE*)appPacker->newApp();
-    if (new_app == nullptr)
-        return nullptr;
 
-    /* Pass the app packer to the new app */
-    new_app->setAppPacker(appPacker);
+void APP_Manager::_list_remove(AppNode_t* node)
+{
+    if (node->list == nullptr)
+        return;
+
+    /* Keep the iteration going if the next node is the one removed */
+    if (_iter_next == node)
+        _iter_next = node->next;
+
+    if (node->prev != nullptr)
+        node->prev->next = node->next;
+    else
+        node->list->head = node->next;
+    if (node->next != nullptr)
+        node->next->prev = node->prev;
+    else
+        node->list->tail = node->prev;
+
+    node->list = nullptr;
+    node->prev = nullptr;
+    node->next = nullptr;
+}
 
-    /* Call app's onCreate method */
-    new_app->onCreate();
 
-    /* Create a new lifecycle container */
-    AppLifecycle_t new_lifecycle;
-    new_lifecycle.app = new_app;
-    new_lifecycle.state = ON_CREATE;
+void APP_Manager::_all_push(AppNode_t* node)
+{
+    node->all_prev = _all_tail;
+    node->all_next = nullptr;
+    if (_all_tail != nullptr)
+        _all_tail->all_next = node;
+    else
+        _all_head = node;
+    _all_tail = node;
+    _app_num++;
+}
 
-    /* Push into lifecycle list */
-    _app_create_buffer.push_back(new_lifecycle);
 
-    /* Return the app pointer for further mangement */
-    return new_app;
+void APP_Manager::_all_remove(AppNode_t* node)
+{
+    if (node->all_prev != nullptr)
+        node->all_prev->all_next = node->all_next;
+    else
+        _all_head = node->all_next;
+    if (node->all_next != nullptr)
+        node->all_next->all_prev = node->all_prev;
+    else
+        _all_tail = node->all_prev;
+    _app_num--;
 }
 
 
-int APP_Manager::_search_app_lifecycle_list(APP_BASE* app)
+APP_Manager::AppNode_t* APP_Manager::_get_node(APP_BASE* app)
 {
-    if (app == nullptr)
-        return -1;
+    if (app == nullptr || app->_app_manager != this)
+        return nullptr;
+    return (AppNode_t*)app->_lifecycle;
+}
 
-    for (int i = 0; i < _app_lifecycle_list.size(); i++)
-    {
-        if (_app_lifecycle_list[i].app == app)
-            return i;
-    }
-    return -1;
+
+void APP_Manager::_free_node(AppNode_t* node)
+{
+    bool added = (node->list != &_created);
+    _list_remove(node);
+    if (added)
+        _all_remove(node);
+    node->app->_app_manager = nullptr;
+    node->app->_lifecycle = nullptr;
+    delete node;
 }
 
 
-int APP_Manager::_search_app_create_buffer(APP_BASE* app)
+void APP_Manager::_place(AppNode_t* node)
 {
-    if (app == nullptr)
-        return -1;
+    /* Anything to do goes to the next update */
+    if (node->app->isGoingAnywhere())
+    {
+        _list_push(_pending, node);
+        return;
+    }
 
-    for (int i = 0; i < _app_create_buffer.size(); i++)
+    switch (node->state)
     {
-        if (_app_create_buffer[i].app == app)
-            return i;
+        case ON_CREATE:
+            _list_push(_idle, node);
+            break;
+        case ON_RUNNING:
+            _list_push(_running, node);
+            break;
+        case ON_RUNNING_BG:
+            _list_push(_background, node);
+            break;
+        default:
+            _list_push(_pending, node);
+            break;
     }
-    return -1;
+}
+
+
+void APP_Manager::_move_to_pending(AppNode_t* node)
+{
+    /* Not added yet, or already waiting, or being handled right now */
+    if (node->list == nullptr || node->list == &_created || node->list == &_pending || node->list == &_batch)
+        return;
+
+    _list_remove(node);
+    _list_push(_pending, node);
+}
+
+
+void APP_Manager::_on_app_transition(APP_BASE* app)
+{
+    AppNode_t* node = _get_node(app);
+    if (node == nullptr)
+        return;
+
+    _move_to_pending(node);
+    _update_asap();
+}
+
+
+APP_BASE* APP_Manager::createApp(APP_PACKER_BASE* appPacker)
+{
+    if (appPacker == nullptr)
+        return nullptr;
+
+    /* Create a new app with app packer */
+    APP_BASE* new_app = (APP_BASE*)appPacker->newApp();
+    if (new_app == nullptr)
+        return nullptr;
+
+    /* Pass the app packer to the new app */
+    new_app->setAppPacker(appPacker);
+
+    /* Create a new lifecycle node, before onCreate() so the app can start itself */
+    AppNode_t* node = new AppNode_t;
+    node->app = new_app;
+    node->state = ON_CREATE;
+    new_app->_app_manager = this;
+    new_app->_lifecycle = node;
+    _list_push(_created, node);
+
+    /* Call app's onCreate method */
+    new_app->onCreate();
+    _update_asap();
+
+    /* Return the app pointer for further mangement */
+    return new_app;
 }
 
 
 bool APP_Manager::startApp(APP_BASE* app)
 {
-    // If not pushed into lifecycle yet 
+    _update_asap();
+
+    AppNode_t* node = _get_node(app);
+    if (node == nullptr)
+        return false;
+
+    // If not pushed into lifecycle yet
     // Like call createApp() and then startApp() inside an app
-    int index = _search_app_create_buffer(app);
-    if (index >= 0)
+    if (node->list == &_created)
     {
-        _app_create_buffer[index].state = ON_RESUME;
+        node->state = ON_RESUME;
         return true;
     }
 
-    index = _search_app_lifecycle_list(app);
-    if (index < 0)
-        return false;
-
     /* Update state */
-    switch (_app_lifecycle_list[index].state)
+    switch (node->state)
     {
         case ON_CREATE:
-            _app_lifecycle_list[index].state = ON_RESUME;
+            node->state = ON_RESUME;
             break;
         case ON_RESUME:
             /* Do nothing */
@@ -106,10 +221,10 @@ bool APP_Manager::startApp(APP_BASE* app)
             /* Do nothing */
             break;
         case ON_RUNNING_BG:
-            _app_lifecycle_list[index].state = ON_RESUME;
+            node->state = ON_RESUME;
             break;
         case ON_PAUSE:
-            _app_lifecycle_list[index].state = ON_RESUME;
+            node->state = ON_RESUME;
             break;
         case ON_DESTROY:
             /* Not gonna happen */
@@ -118,36 +233,40 @@ bool APP_Manager::startApp(APP_BASE* app)
             break;
     }
 
+    if (node->state == ON_RESUME)
+        _move_to_pending(node);
+
     return true;
 }
 
 
 bool APP_Manager::closeApp(APP_BASE* app)
 {
-    // If not pushed into lifecycle yet 
+    _update_asap();
+
+    AppNode_t* node = _get_node(app);
+    if (node == nullptr)
+        return false;
+
+    // If not pushed into lifecycle yet
     // Like call createApp() and then closeApp() inside an app
-    int index = _search_app_create_buffer(app);
-    if (index >= 0)
+    if (node->list == &_created)
     {
-        _app_create_buffer[index].state = ON_PAUSE;
+        node->state = ON_PAUSE;
         return true;
     }
 
-    index = _search_app_lifecycle_list(app);
-    if (index < 0)
-        return false;
-    
     /* Update state */
-    switch (_app_lifecycle_list[index].state)
+    switch (node->state)
     {
         case ON_CREATE:
             /* Do nothing */
             break;
         case ON_RESUME:
-            _app_lifecycle_list[index].state = ON_PAUSE;
+            node->state = ON_PAUSE;
             break;
         case ON_RUNNING:
-            _app_lifecycle_list[index].state = ON_PAUSE;
+            node->state = ON_PAUSE;
             break;
         case ON_RUNNING_BG:
             /* Do nothing */
@@ -162,152 +281,289 @@ bool APP_Manager::closeApp(APP_BASE* app)
             break;
     }
 
+    if (node->state == ON_PAUSE)
+        _move_to_pending(node);
+
     return true;
 }
 
 
-void APP_Manager::update()
+void APP_Manager::_collect_update_request(APP_BASE* app)
 {
-    /* Iterate the shit out */
-    for (auto iter = _app_lifecycle_list.begin(); iter != _app_lifecycle_list.end();)
+    /* Lifecycle change pending, next update can't wait */
+    if (app->isGoingAnywhere())
     {
-        /* If app wants to be started */
-        if (iter->app->isGoingStart())
-        {
-            /* Reset flag */
-            iter->app->resetGoingStartFlag();
+        _update_asap();
+        return;
+    }
+
+    /* Apps not asking for anything are updated every frame */
+    if (!app->isUpdateRequested())
+    {
+        _update_asap();
+        return;
+    }
+
+    if (app->getUpdateIn() < _next_update_in)
+        _next_update_in = app->getUpdateIn();
+    _wake_events |= app->getWakeEvents();
+    _has_update_request = true;
+}
 
-            /* Update state */
-            iter->state = ON_RESUME;
-        }
 
-        /* If app wants to be closed */
-        if (iter->app->isGoingClose())
+void APP_Manager::_tick_bg(AppNode_t* node, uint32_t now)
+{
+    APP_BASE* app = node->app;
+    uint32_t interval = app->getBgTickInterval();
+
+    /* Skip till the interval has passed, and ask to be woken by then */
+    if (interval != 0 && node->bg_ticked)
+    {
+        uint32_t elapsed = now - node->last_bg_tick;
+        if (elapsed < interval)
         {
-            /* Reset flag */
-            iter->app->resetGoingCloseFlag();
-
-            /* Update state */
-            if (iter->app->isAllowBgRunning())
-                iter->state = ON_PAUSE;
-            else
-                iter->state = ON_DESTROY;
+            if (interval - elapsed < _next_update_in)
+                _next_update_in = interval - elapsed;
+            _has_update_request = true;
+            return;
         }
+    }
+    node->bg_ticked = true;
+    node->last_bg_tick = now;
 
-        /* If app wants to be destroyed */
-        if (iter->app->isGoingDestroy())
-        {
-            /* Reset flag */
-            iter->app->resetGoingDestroyFlag();
+    app->resetUpdateRequest();
+    app->onRunningBG();
 
-            /* Update state */
-            iter->state = ON_DESTROY;
-        }
+    /* An interval means no need for every frame */
+    if (interval != 0 && !app->isUpdateRequested() && !app->isGoingAnywhere())
+    {
+        if (interval < _next_update_in)
+            _next_update_in = interval;
+        _has_update_request = true;
+        return;
+    }
+    _collect_update_request(app);
+}
 
 
-        /* Lifecycle FSM */
-        switch (iter->state)
-        {
-            case ON_CREATE:
-                /* Do nothing */
-                break;
-            case ON_RESUME:
-                iter->app->onResume();
-                iter->state = ON_RUNNING;
-                break;
-            case ON_RUNNING:
-                iter->app->onRunning();
-                break;
-            case ON_RUNNING_BG:
-                iter->app->onRunningBG();
-                break;
-            case ON_PAUSE:
-                iter->app->onPause();
-                iter->state = ON_RUNNING_BG;
-                break;
-            case ON_DESTROY:
-                /* Same as destroyApp() */
-                iter->app->onPause();
-                iter->app->onDestroy();
-                iter->app->getAppPacker()->deleteApp(iter->app);
-                /* Remove and update iterator */
-                iter = _app_lifecycle_list.erase(iter);
-                continue;
-            default:
-                break;
-        }
+void APP_Manager::_handle_pending(AppNode_t* node, uint32_t now)
+{
+    APP_BASE* app = node->app;
+
+    /* If app wants to be started */
+    if (app->isGoingStart())
+    {
+        /* Reset flag */
+        app->resetGoingStartFlag();
+
+        /* Update state */
+        node->state = ON_RESUME;
+    }
+
+    /* If app wants to be closed */
+    if (app->isGoingClose())
+    {
+        /* Reset flag */
+        app->resetGoingCloseFlag();
+
+        /* Update state */
+        if (app->isAllowBgRunning())
+            node->state = ON_PAUSE;
+        else
+            node->state = ON_DESTROY;
+    }
+
+    /* If app wants to be destroyed */
+    if (app->isGoingDestroy())
+    {
+        /* Reset flag */
+        app->resetGoingDestroyFlag();
+
+        /* Update state */
+        node->state = ON_DESTROY;
+    }
+
+
+    /* Lifecycle FSM */
+    switch (node->state)
+    {
+        case ON_CREATE:
+            /* Do nothing */
+            break;
+        case ON_RESUME:
+            app->onResume();
+            node->state = ON_RUNNING;
+            _update_asap();
+            break;
+        case ON_RUNNING:
+            app->resetUpdateRequest();
+            app->onRunning();
+            _collect_update_request(app);
+            break;
+        case ON_RUNNING_BG:
+            _tick_bg(node, now);
+            break;
+        case ON_PAUSE:
+            app->onPause();
+            node->state = ON_RUNNING_BG;
+            node->bg_ticked = false;
+            _update_asap();
+            break;
+        case ON_DESTROY:
+            _update_asap();
+            /* Same as destroyApp() */
+            app->onPause();
+            app->onDestroy();
+            app->getAppPacker()->deleteApp(app);
+            _free_node(node);
+            return;
+        default:
+            break;
+    }
+
+    /* Into the list of its new state */
+    _place(node);
+}
+
+
+void APP_Manager::update()
+{
+    MC_TRACE_ZONE("app_manager");
+
+    /* Collect scheduling requests from scratch */
+    _next_update_in = MC_UPDATE_IDLE;
+    _wake_events = 0;
+    _has_update_request = false;
+
+    /* Transitions asked for till now are handled in this update, new ones in the next */
+    _batch = _pending;
+    _pending = AppList_t();
+    for (AppNode_t* node = _batch.head; node != nullptr; node = node->next)
+        node->list = &_batch;
 
-        /* Next */
-        iter++;
+    /* Only running apps are iterated, idle ones cost nothing */
+    for (AppNode_t* node = _running.head; node != nullptr; node = _iter_next)
+    {
+        _iter_next = node->next;
+        node->app->resetUpdateRequest();
+        node->app->onRunning();
+        _collect_update_request(node->app);
+    }
+
+    uint32_t now = (_background.head != nullptr || _batch.head != nullptr) ? Scheduler::getTick() : 0;
+    for (AppNode_t* node = _background.head; node != nullptr; node = _iter_next)
+    {
+        _iter_next = node->next;
+        _tick_bg(node, now);
     }
 
+    /* Then the apps changing state */
+    while (_batch.head != nullptr)
+    {
+        AppNode_t* node = _batch.head;
+        _list_remove(node);
+        _handle_pending(node, now);
+    }
+    _iter_next = nullptr;
+
+    /* No app asked for anything (or no app at all), keep looping like before */
+    if (!_has_update_request)
+        _update_asap();
+
     /* Push created apps buffer into lifecycle list */
-    if (_app_create_buffer.size() != 0)
+    while (_created.head != nullptr)
     {
-        for (const auto& app : _app_create_buffer)
-        {
-            _app_lifecycle_list.push_back(app);
-        }
-        _app_create_buffer.clear();
+        AppNode_t* node = _created.head;
+        _list_remove(node);
+        _all_push(node);
+        _place(node);
     }
 }
 
 
 bool APP_Manager::destroyApp(APP_BASE* app)
 {
-    if (app == nullptr)
+    AppNode_t* node = _get_node(app);
+    if (node == nullptr)
         return false;
+    _update_asap();
 
     /* If not push into lifecycle list yet */
-    for (auto iter = _app_create_buffer.begin(); iter != _app_create_buffer.end(); iter++)
+    if (node->list == &_created)
     {
-        if (iter->app == app)
-        {
-            _app_create_buffer.erase(iter);
-            return true;
-        }
+        _free_node(node);
+        return true;
     }
 
-    /* Iterate the shit out */
-    for (auto iter = _app_lifecycle_list.begin(); iter != _app_lifecycle_list.end(); iter++)
-    {
-        if (iter->app == app)
-        {
-            /* Call app's onPause method */
-            iter->app->onPause();
+    /* Call app's onPause method */
+    app->onPause();
 
-            /* Call app's onDestroy method */
-            iter->app->onDestroy();
+    /* Call app's onDestroy method */
+    app->onDestroy();
 
-            /* Delete this app by it's app packer */
-            iter->app->getAppPacker()->deleteApp(iter->app);
+    /* Remove it from the lifecycle lists */
+    _free_node(node);
 
-            /* Remove it from the lifecycle list */
-            _app_lifecycle_list.erase(iter);
+    /* Delete this app by it's app packer */
+    app->getAppPacker()->deleteApp(app);
 
-            return true;
-        }
-    }
-
-    return false;
+    return true;
 }
 
 
 void APP_Manager::destroyAllApps()
 {
     /* Iterate the shit out */
-    for (auto& i : _app_lifecycle_list)
+    for (AppNode_t* node = _all_head; node != nullptr;)
     {
+        AppNode_t* next = node->all_next;
+
         /* Call app's onPause method */
-        i.app->onPause();
+        node->app->onPause();
 
         /* Call app's onDestroy method */
-        i.app->onDestroy();
+        node->app->onDestroy();
 
         /* Delete this app by it's app packer */
-        i.app->getAppPacker()->deleteApp(i.app);
+        node->app->getAppPacker()->deleteApp(node->app);
+
+        delete node;
+        node = next;
     }
 
+    /* Not added apps are dropped, as before */
+    for (AppNode_t* node = _created.head; node != nullptr;)
+    {
+        AppNode_t* next = node->next;
+        node->app->_app_manager = nullptr;
+        node->app->_lifecycle = nullptr;
+        delete node;
+        node = next;
+    }
+
+    _created = AppList_t();
+    _idle = AppList_t();
+    _running = AppList_t();
+    _background = AppList_t();
+    _pending = AppList_t();
+    _batch = AppList_t();
+    _all_head = nullptr;
+    _all_tail = nullptr;
+    _app_num = 0;
+    _iter_next = nullptr;
+    _app_lifecycle_list.clear();
+}
+
+
+const std::vector<APP_Manager::AppLifecycle_t>* APP_Manager::getAppLifecycleList()
+{
     _app_lifecycle_list.clear();
-    _app_create_buffer.clear();
+    for (AppNode_t* node = _all_head; node != nullptr; node = node->all_next)
+    {
+        AppLifecycle_t lifecycle;
+        lifecycle.app = node->app;
+        lifecycle.state = node->state;
+        _app_lifecycle_list.push_back(lifecycle);
+    }
+    return &_app_lifecycle_list;
 }
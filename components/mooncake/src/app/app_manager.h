@@ -43,17 +43,90 @@ namespace MOONCAKE
 
 
         private:
-            /* A list of apps' lifecycle */
+            /* Manager's node of an app, kept in one state list at a time */
+            struct AppList_t;
+            struct AppNode_t
+            {
+                APP_BASE* app = nullptr;
+                AppLifecycleState_t state = ON_CREATE;
+
+                /* State list links */
+                AppList_t* list = nullptr;
+                AppNode_t* prev = nullptr;
+                AppNode_t* next = nullptr;
+
+                /* Creation order links */
+                AppNode_t* all_prev = nullptr;
+                AppNode_t* all_next = nullptr;
+
+                /* Last onRunningBG() call, for apps with a bg tick interval */
+                bool bg_ticked = false;
+                uint32_t last_bg_tick = 0;
+            };
+
+            /* Intrusive doubly linked list of app nodes */
+            struct AppList_t
+            {
+                AppNode_t* head = nullptr;
+                AppNode_t* tail = nullptr;
+            };
+
+            /* Apps created since the last update, added to the lists at the end of update() */
+            /* To keep the old one update delay of createApp() */
+            AppList_t _created;
+            /* Created but not started, never touched by update() */
+            AppList_t _idle;
+            AppList_t _running;
+            AppList_t _background;
+            /* Apps with a state change or lifecycle flag, handled by the next update() */
+            AppList_t _pending;
+            /* Pending apps being handled by the current update() */
+            AppList_t _batch;
+
+            /* All added apps in creation order */
+            AppNode_t* _all_head;
+            AppNode_t* _all_tail;
+            std::size_t _app_num;
+
+            /* Next node of the list being iterated, kept valid when nodes are unlinked */
+            AppNode_t* _iter_next;
+
+            /* Snapshot for getAppLifecycleList() */
             std::vector<AppLifecycle_t> _app_lifecycle_list;
-            int _search_app_lifecycle_list(APP_BASE* app);
 
-            /* A buffer of apps that about to add in lifecycle */
-            /* To avoid push_back method while lifecycle list's iterating */
-            std::vector<AppLifecycle_t> _app_create_buffer;
-            int _search_app_create_buffer(APP_BASE* app);
+            void _list_push(AppList_t& list, AppNode_t* node);
+            void _list_remove(AppNode_t* node);
+            void _all_push(AppNode_t* node);
+            void _all_remove(AppNode_t* node);
+            AppNode_t* _get_node(APP_BASE* app);
+            void _free_node(AppNode_t* node);
+            void _place(AppNode_t* node);
+            void _move_to_pending(AppNode_t* node);
+            void _handle_pending(AppNode_t* node, uint32_t now);
+            void _tick_bg(AppNode_t* node, uint32_t now);
+
+            /* Called by apps when a lifecycle flag is set */
+            friend class APP_BASE;
+            void _on_app_transition(APP_BASE* app);
+
+            /* When the next update is needed, collected from apps' scheduling requests */
+            uint32_t _next_update_in;
+            uint32_t _wake_events;
+            bool _has_update_request;
+            inline void _update_asap() { _next_update_in = 0; }
+            void _collect_update_request(APP_BASE* app);
 
 
         public:
+            APP_Manager() :
+                _all_head(nullptr),
+                _all_tail(nullptr),
+                _app_num(0),
+                _iter_next(nullptr),
+                _next_update_in(0),
+                _wake_events(0),
+                _has_update_request(false)
+                {}
             /* Free all the app's memory */
             ~APP_Manager();
 
@@ -109,13 +182,27 @@ namespace MOONCAKE
              * 
              * @return std::size_t 
              */
-            inline std::size_t getCreatedAppNum() { return _app_lifecycle_list.size(); }
+            inline std::size_t getCreatedAppNum() { return _app_num; }
 
             /**
-             * @brief Get the managing app lifecycle list 
+             * @brief Get a snapshot of the managing apps and their states, in creation order
              * 
              * @return const std::vector<AppLifecycle_t>*
              */
-            inline const std::vector<AppLifecycle_t>* getAppLifecycleList() { return &_app_lifecycle_list; }
+            const std::vector<AppLifecycle_t>* getAppLifecycleList();
+
+            /**
+             * @brief Get the time from the last update() till an app needs updating again
+             * , 0 if any app wants every frame, MC_UPDATE_IDLE if all apps only wait for events
+             * @return uint32_t 
+             */
+            inline uint32_t getNextUpdateIn() { return _next_update_in; }
+
+            /**
+             * @brief Get the events that apps waiting in the last update() want to be woken by
+             * 
+             * @return uint32_t MC_EVENT_* bits
+             */
+            inline uint32_t getWakeEvents() { return _wake_events; }
     };      
 }
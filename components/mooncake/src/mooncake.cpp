@@ -101,9 +101,14 @@ void Mooncake::_data_base_setup_internal()
 
 void Mooncake::update()
 {
+    /* Sleep till there is something to do */
+    _scheduler.wait(_app_manager.getNextUpdateIn(), _app_manager.getWakeEvents());
+    Trace::frameBegin();
+
     /* Update input devices */
     _input_device_register.update();
 
     /* Update apps' lifecycles */
     _app_manager.update();
+    Trace::frameEnd();
 }
@@ -13,7 +13,9 @@
 #include "app/app_register.h"
 #include "app/app_manager.h"
 #include "input_system/input_device_register.h"
+#include "scheduler/scheduler.h"
 #include "simplekv/simplekv.h"
+#include "trace/trace.h"
 #include "mc_conf_internal.h"
 
 namespace MOONCAKE
@@ -50,6 +52,9 @@ namespace MOONCAKE
         /* Component Database */
         SIMPLEKV::SimpleKV _database;
 
+        /* Component Scheduler */
+        Scheduler _scheduler;
+
         /* User data pointer */
         APP_UserData_t* _user_data;
 
@@ -76,6 +81,7 @@ namespace MOONCAKE
         inline APP_Register& getAppRegister() { return _app_register; }
         inline APP_Manager& getAppManager() { return _app_manager; }
         inline SIMPLEKV::SimpleKV& getDatabase() { return _database; }
+        inline Scheduler& getScheduler() { return _scheduler; }
 
         /**
          * @brief Set the user data, which will be passed to every apps
@@ -117,10 +123,33 @@ namespace MOONCAKE
 
         /**
          * @brief Calling this to keep framework running
-         *
+         * , blocks until the target frame period has passed and an app needs updating (see APP_BASE::requestUpdateIn())
          */
         void update();
 
+        /* Framework wrap to the Scheduler */
+
+        /**
+         * @brief Set the max frame rate of update()
+         *
+         * @param fps 0 for no limit, default
+         */
+        inline void setTargetFps(uint32_t fps) { _scheduler.setTargetFps(fps); }
+
+        /**
+         * @brief Wake up a sleeping update(), thread safe
+         *
+         * @param events MC_EVENT_* bits
+         */
+        inline void wakeUp(uint32_t events = MC_EVENT_USER) { _scheduler.notify(events); }
+
+        /**
+         * @brief Same as wakeUp(), callable from an ISR
+         *
+         * @param events MC_EVENT_* bits
+         */
+        inline void wakeUpFromISR(uint32_t events = MC_EVENT_USER) { _scheduler.notifyFromISR(events); }
+
         /* Framework wrap to the App register */
 
         /* *Important*: this wrap will pass user data pointer to the app packer */
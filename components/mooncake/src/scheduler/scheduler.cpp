@@ -0,0 +1,166 @@
+/**
+ * @file scheduler.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-08
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "scheduler.h"
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+
+using namespace MOONCAKE;
+
+
+Scheduler::Scheduler() :
+    _frame_period(0),
+    _max_idle_time(1000),
+    _idle_time(0),
+    _frame_count(0)
+{
+    #ifdef ESP_PLATFORM
+    _event_group = xEventGroupCreate();
+    #else
+    _pending_events = 0;
+    #endif
+    _frame_start = getTick();
+}
+
+
+Scheduler::~Scheduler()
+{
+    #ifdef ESP_PLATFORM
+    if (_event_group != nullptr)
+        vEventGroupDelete((EventGroupHandle_t)_event_group);
+    #endif
+}
+
+
+void Scheduler::setTargetFps(uint32_t fps)
+{
+    _frame_period = (fps == 0) ? 0 : 1000 / fps;
+}
+
+
+#ifdef ESP_PLATFORM
+
+uint32_t Scheduler::getTick()
+{
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+
+void Scheduler::_sleep(uint32_t ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+
+uint32_t Scheduler::_wait_events(uint32_t eventMask, uint32_t timeout)
+{
+    /* Event group can't wait for nothing */
+    if (eventMask == 0 || _event_group == nullptr)
+    {
+        if (timeout > 0)
+            _sleep(timeout);
+        return 0;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(
+        (EventGroupHandle_t)_event_group, eventMask, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout));
+    return bits & eventMask;
+}
+
+
+void Scheduler::notify(uint32_t events)
+{
+    if (_event_group != nullptr)
+        xEventGroupSetBits((EventGroupHandle_t)_event_group, events & MC_EVENT_ALL);
+}
+
+
+void Scheduler::notifyFromISR(uint32_t events)
+{
+    if (_event_group == nullptr)
+        return;
+
+    /* Deferred to the timer daemon task */
+    BaseType_t woken = pdFALSE;
+    xEventGroupSetBitsFromISR((EventGroupHandle_t)_event_group, events & MC_EVENT_ALL, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+#else
+
+uint32_t Scheduler::getTick()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void Scheduler::_sleep(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+
+uint32_t Scheduler::_wait_events(uint32_t eventMask, uint32_t timeout)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond.wait_for(lock, std::chrono::milliseconds(timeout), [&]() { return (_pending_events & eventMask) != 0; });
+    uint32_t events = _pending_events & eventMask;
+    _pending_events &= ~eventMask;
+    return events;
+}
+
+
+void Scheduler::notify(uint32_t events)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending_events |= events & MC_EVENT_ALL;
+    }
+    _cond.notify_all();
+}
+
+
+void Scheduler::notifyFromISR(uint32_t events)
+{
+    notify(events);
+}
+
+#endif
+
+
+uint32_t Scheduler::wait(uint32_t updateIn, uint32_t eventMask)
+{
+    uint32_t wait_start = getTick();
+
+    /* Hold the frame rate, events stay pending meanwhile */
+    uint32_t elapsed = wait_start - _frame_start;
+    if (elapsed < _frame_period)
+        _sleep(_frame_period - elapsed);
+
+    /* Then sleep till the next app deadline, or an event */
+    if (updateIn > _max_idle_time)
+        updateIn = _max_idle_time;
+    elapsed = getTick() - _frame_start;
+    uint32_t events = _wait_events(eventMask, (elapsed < updateIn) ? updateIn - elapsed : 0);
+
+    /* New frame */
+    _frame_start = getTick();
+    _idle_time += _frame_start - wait_start;
+    _frame_count++;
+
+    return events;
+}
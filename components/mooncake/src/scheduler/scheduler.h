@@ -0,0 +1,122 @@
+/**
+ * @file scheduler.h
+ * @brief Frame pacing and event driven wake up for the framework loop
+ * @version 0.1
+ * @date 2025-12-08
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <cstdint>
+#ifndef ESP_PLATFORM
+#include <condition_variable>
+#include <mutex>
+#endif
+
+
+/* Event bits that wake up the framework loop */
+/* FreeRTOS event groups hold 24 bits, so do we */
+#define MC_EVENT_INPUT                  (1UL << 0)
+#define MC_EVENT_TIMER                  (1UL << 1)
+/* First bit free for user defined events */
+#define MC_EVENT_USER                   (1UL << 2)
+#define MC_EVENT_ALL                    (0x00FFFFFFUL)
+
+/* Update delay meaning "nothing to do until an event comes" */
+#define MC_UPDATE_IDLE                  (0xFFFFFFFFUL)
+
+
+namespace MOONCAKE
+{
+    /* Scheduler */
+    /* Paces the framework loop and puts it to sleep until there is work to do */
+    /* A frame starts when the target frame period has passed, and the next app deadline is due */
+    /* or a waited event is notified, whichever comes first after the frame period */
+    class Scheduler
+    {
+        private:
+            uint32_t _frame_period;
+            uint32_t _max_idle_time;
+            uint32_t _frame_start;
+            uint32_t _idle_time;
+            uint32_t _frame_count;
+
+            #ifdef ESP_PLATFORM
+            /* EventGroupHandle_t */
+            void* _event_group;
+            #else
+            std::mutex _mutex;
+            std::condition_variable _cond;
+            uint32_t _pending_events;
+            #endif
+
+            void _sleep(uint32_t ms);
+            uint32_t _wait_events(uint32_t eventMask, uint32_t timeout);
+
+
+        public:
+            Scheduler();
+            ~Scheduler();
+
+            /**
+             * @brief Get the scheduler's clock in ms, wraps around like millis()
+             *
+             * @return uint32_t
+             */
+            static uint32_t getTick();
+
+            /**
+             * @brief Set the max frame rate, frames never start closer than 1000 / fps ms apart
+             *
+             * @param fps 0 for no limit (update as fast as apps ask for)
+             */
+            void setTargetFps(uint32_t fps);
+            inline uint32_t getTargetFps() { return _frame_period == 0 ? 0 : 1000 / _frame_period; }
+
+            /**
+             * @brief Set the longest single sleep, so the loop still comes around when nothing is scheduled
+             *
+             * @param ms
+             */
+            inline void setMaxIdleTime(uint32_t ms) { _max_idle_time = ms; }
+            inline uint32_t getMaxIdleTime() { return _max_idle_time; }
+
+            /**
+             * @brief Notify events to wake the framework loop, thread safe
+             *
+             * @param events MC_EVENT_* bits
+             */
+            void notify(uint32_t events);
+
+            /**
+             * @brief Same as notify(), callable from an ISR
+             *
+             * @param events MC_EVENT_* bits
+             */
+            void notifyFromISR(uint32_t events);
+
+            /**
+             * @brief Block until the next frame is due
+             *
+             * @param updateIn ms from the last frame's start until an app needs updating, MC_UPDATE_IDLE if none
+             * @param eventMask Events that end the wait early, they are cleared when returned
+             * @return uint32_t Events that were notified out of the mask, 0 if woken by time
+             */
+            uint32_t wait(uint32_t updateIn, uint32_t eventMask);
+
+            /**
+             * @brief Total time spent blocked in wait(), in ms
+             *
+             * @return uint32_t
+             */
+            inline uint32_t getIdleTime() { return _idle_time; }
+
+            /**
+             * @brief Total number of frames started by wait()
+             *
+             * @return uint32_t
+             */
+            inline uint32_t getFrameCount() { return _frame_count; }
+    };
+}
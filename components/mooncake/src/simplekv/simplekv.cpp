@@ -11,24 +11,105 @@
 #include "simplekv.h"
 
 
+static_assert((SIMPLEKV_TABLE_SIZE & (SIMPLEKV_TABLE_SIZE - 1)) == 0, "SIMPLEKV_TABLE_SIZE must be a power of 2");
+static_assert(SIMPLEKV_TABLE_SIZE < 0xFFFF, "SIMPLEKV_TABLE_SIZE too large for Handle_t");
+
+#define _TABLE_MASK                     (SIMPLEKV_TABLE_SIZE - 1)
+
+
+/* Blocks keep the arena aligned for any value type */
+static inline size_t _align_up(size_t size)
+{
+    return (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+}
+
+
+/* Value, then key chars with '\0' */
+static inline size_t _block_size(size_t valueSize, size_t keyLen)
+{
+    return _align_up(_align_up(valueSize) + keyLen + 1);
+}
+
+
 namespace SIMPLEKV
 {
-    bool SimpleKV::Exist(const std::string& key)
+    int SimpleKV::_find(const char* key, size_t keyLen, uint32_t hash)
     {
-        if (_value_map.find(key) != _value_map.end())
+        /* Linear probing, an empty slot ends the chain */
+        uint32_t index = hash & _TABLE_MASK;
+        for (int i = 0; i < SIMPLEKV_TABLE_SIZE; i++)
         {
-            return true;
+            Slot_t& slot = _table[index];
+            if (slot.state == SLOT_EMPTY)
+            {
+                return -1;
+            }
+            if (slot.state == SLOT_USED && slot.hash == hash && slot.key_len == keyLen && memcmp(slot.key, key, keyLen) == 0)
+            {
+                return index;
+            }
+            index = (index + 1) & _TABLE_MASK;
         }
-        return false;
+        return -1;
+    }
+
+
+    void* SimpleKV::_alloc_block(size_t size, bool& inArena)
+    {
+        if (_arena_used + size <= SIMPLEKV_ARENA_SIZE)
+        {
+            inArena = true;
+            void* block = &_arena[_arena_used];
+            _arena_used += size;
+            return block;
+        }
+
+        /* Arena full, fall back to heap */
+        inArena = false;
+        return _malloc(size);
+    }
+
+
+    void SimpleKV::_free_slot(Slot_t& slot)
+    {
+        if (slot.in_arena)
+        {
+            /* Give the space back if it's the last block */
+            size_t size = _block_size(slot.info.size, slot.key_len);
+            if ((uint8_t*)slot.info.addr + size == &_arena[_arena_used])
+            {
+                _arena_used -= size;
+            }
+        }
+        else
+        {
+            _free(slot.info.addr);
+        }
+
+        slot.state = SLOT_DELETED;
+        slot.generation++;
+        slot.key = nullptr;
+        slot.info.addr = nullptr;
+        slot.info.size = 0;
+        _size--;
+    }
+
+
+    bool SimpleKV::Exist(const std::string& key)
+    {
+        return _find(key.data(), key.size(), Hash(key.data(), key.size())) >= 0;
     }
 
 
     size_t SimpleKV::MemoryUsage()
     {
         size_t ret = 0;
-        for (auto& kv : _value_map)
+        for (auto& slot : _table)
         {
-            ret += kv.second.size;
+            if (slot.state == SLOT_USED)
+            {
+                ret += slot.info.size;
+            }
         }
         return ret;
     }
@@ -36,22 +117,52 @@ namespace SIMPLEKV
     
     bool SimpleKV::Add(const std::string& key, void* value, size_t size)
     {
-        if (Exist(key) || (size == 0))
+        uint32_t hash = Hash(key.data(), key.size());
+        if ((size == 0) || (key.size() > 0xFFFF) || (_find(key.data(), key.size(), hash) >= 0))
         {
             return false;
         }
         
-        /* Create */
-        ValueInfo_t new_item;
-        new_item.size = size;
+        /* Take the first free slot in the chain, deleted ones included */
+        uint32_t index = hash & _TABLE_MASK;
+        int i = 0;
+        for (; i < SIMPLEKV_TABLE_SIZE; i++)
+        {
+            if (_table[index].state != SLOT_USED)
+            {
+                break;
+            }
+            index = (index + 1) & _TABLE_MASK;
+        }
+        if (i == SIMPLEKV_TABLE_SIZE)
+        {
+            return false;
+        }
 
         /* Create buffer  */
-        new_item.addr = _malloc(size);
-        /* Copy data */
-        _memcpy(new_item.addr, value, size);
+        bool in_arena = false;
+        uint8_t* block = (uint8_t*)_alloc_block(_block_size(size, key.size()), in_arena);
+        if (block == nullptr)
+        {
+            return false;
+        }
+
+        /* Copy data and key */
+        char* key_copy = (char*)block + _align_up(size);
+        _memcpy(block, value, size);
+        _memcpy(key_copy, key.data(), key.size());
+        key_copy[key.size()] = '\0';
 
         /* Create link */
-        _value_map[key] = new_item;
+        Slot_t& slot = _table[index];
+        slot.hash = hash;
+        slot.key_len = key.size();
+        slot.state = SLOT_USED;
+        slot.in_arena = in_arena;
+        slot.key = key_copy;
+        slot.info.size = size;
+        slot.info.addr = block;
+        _size++;
 
         return true;
     }
@@ -59,14 +170,13 @@ namespace SIMPLEKV
 
     bool SimpleKV::Put(const std::string& key, void* value)
     {
-        /* Get iterater */
-        auto iter = _value_map.find(key);
+        int index = _find(key.data(), key.size(), Hash(key.data(), key.size()));
 
         /* If exist */
-        if (iter != _value_map.end())
+        if (index >= 0)
         {
             /* Copy new data */
-            _memcpy(iter->second.addr, value, iter->second.size);
+            _memcpy(_table[index].info.addr, value, _table[index].info.size);
 
             return true;
         }
@@ -77,14 +187,13 @@ namespace SIMPLEKV
 
     ValueInfo_t* SimpleKV::Get(const std::string& key)
     {
-        /* Get iterater */
-        auto iter = _value_map.find(key);
+        int index = _find(key.data(), key.size(), Hash(key.data(), key.size()));
 
         /* If exist */
-        if (iter != _value_map.end())
+        if (index >= 0)
         {
             /* Copy value info */
-            _memcpy((void*)&_ret_buffer, (void*)&iter->second, sizeof(ValueInfo_t));
+            _ret_buffer = _table[index].info;
         }
         else
         {
@@ -98,17 +207,22 @@ namespace SIMPLEKV
 
     bool SimpleKV::Delete(const std::string& key)
     {
-        /* Get iterater */
-        auto iter = _value_map.find(key);
+        int index = _find(key.data(), key.size(), Hash(key.data(), key.size()));
 
         /* If exist */
-        if (iter != _value_map.end())
+        if (index >= 0)
         {
-            /* Free memory */
-            _free(iter->second.addr);
+            _free_slot(_table[index]);
 
-            /* Remove elemant */
-            _value_map.erase(iter);
+            /* Nothing left, clear the deleted marks so probing stays short */
+            if (_size == 0)
+            {
+                for (auto& slot : _table)
+                {
+                    slot.state = SLOT_EMPTY;
+                }
+                _arena_used = 0;
+            }
 
             return true;
         }
@@ -120,12 +234,70 @@ namespace SIMPLEKV
     void SimpleKV::DeleteAll()
     {
         /* Free memory */
-        for (auto& kv : _value_map)
+        for (auto& slot : _table)
+        {
+            if (slot.state == SLOT_USED)
+            {
+                _free_slot(slot);
+            }
+            /* Generations are kept, so old handles stay stale */
+            slot.state = SLOT_EMPTY;
+        }
+
+        _size = 0;
+        _arena_used = 0;
+    }
+
+
+    Handle_t SimpleKV::GetHandle(const std::string& key)
+    {
+        Handle_t handle;
+        int index = _find(key.data(), key.size(), Hash(key.data(), key.size()));
+        if (index >= 0)
+        {
+            handle.index = index;
+            handle.generation = _table[index].generation;
+        }
+        return handle;
+    }
+
+
+    bool SimpleKV::Exist(Handle_t handle)
+    {
+        if (handle.index >= SIMPLEKV_TABLE_SIZE)
+        {
+            return false;
+        }
+        const Slot_t& slot = _table[handle.index];
+        return (slot.state == SLOT_USED) && (slot.generation == handle.generation);
+    }
+
+
+    ValueInfo_t* SimpleKV::Get(Handle_t handle)
+    {
+        if (Exist(handle))
+        {
+            _ret_buffer = _table[handle.index].info;
+        }
+        else
+        {
+            _ret_buffer.size = 0;
+            _ret_buffer.addr = nullptr;
+        }
+
+        return &_ret_buffer;
+    }
+
+
+    bool SimpleKV::Put(Handle_t handle, void* value)
+    {
+        if (!Exist(handle))
         {
-            _free(kv.second.addr);
+            return false;
         }
 
-        /* Remove all element */
-        _value_map.erase(_value_map.begin(), _value_map.end());
+        ValueInfo_t& info = _table[handle.index].info;
+        _memcpy(info.addr, value, info.size);
+        return true;
     }
 }
@@ -12,7 +12,19 @@
 #include <iostream>
 #include <string>
 #include <cstring>
-#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+
+/* Max number of keys, power of 2 */
+#ifndef SIMPLEKV_TABLE_SIZE
+#define SIMPLEKV_TABLE_SIZE             64
+#endif
+
+/* Bytes of the value arena, values and keys that don't fit go to _malloc() */
+#ifndef SIMPLEKV_ARENA_SIZE
+#define SIMPLEKV_ARENA_SIZE             2048
+#endif
 
 
 namespace SIMPLEKV
@@ -39,12 +51,52 @@ namespace SIMPLEKV
     };
     
 
+    /* Resolved key, lookups through it skip hashing and probing */
+    /* Goes stale when the key is deleted */
+    struct Handle_t
+    {
+        uint16_t index = 0xFFFF;
+        uint16_t generation = 0;
+
+        inline bool valid() const { return index != 0xFFFF; }
+    };
+
+
     class SimpleKV
     {
         private:
-            std::unordered_map<std::string, ValueInfo_t> _value_map;
+            enum SlotState_t : uint8_t
+            {
+                SLOT_EMPTY = 0,
+                SLOT_USED,
+                SLOT_DELETED
+            };
+
+            /* Table slot, key chars are stored right after the value */
+            struct Slot_t
+            {
+                uint32_t hash = 0;
+                uint16_t key_len = 0;
+                uint16_t generation = 0;
+                SlotState_t state = SLOT_EMPTY;
+                bool in_arena = false;
+                const char* key = nullptr;
+                ValueInfo_t info;
+            };
+
+            Slot_t _table[SIMPLEKV_TABLE_SIZE];
+            size_t _size = 0;
+
+            /* Bump allocator, only the last block can be given back */
+            alignas(std::max_align_t) uint8_t _arena[SIMPLEKV_ARENA_SIZE];
+            size_t _arena_used = 0;
+
             ValueInfo_t _ret_buffer;
 
+            int _find(const char* key, size_t keyLen, uint32_t hash);
+            void* _alloc_block(size_t size, bool& inArena);
+            void _free_slot(Slot_t& slot);
+
 
         protected:
             /* Memory API */
@@ -58,12 +110,44 @@ namespace SIMPLEKV
             ~SimpleKV() { DeleteAll(); }
 
 
+            /**
+             * @brief FNV-1a hash of a key, usable at compile time
+             *
+             * @param key
+             * @param len
+             * @return uint32_t
+             */
+            static constexpr uint32_t Hash(const char* key, size_t len)
+            {
+                uint32_t hash = 2166136261u;
+                for (size_t i = 0; i < len; i++)
+                {
+                    hash ^= (uint8_t)key[i];
+                    hash *= 16777619u;
+                }
+                return hash;
+            }
+
             /**
              * @brief Get the map size (number of elements)
              * 
              * @return size_t 
              */
-            inline size_t Size() { return _value_map.size(); }
+            inline size_t Size() { return _size; }
+
+            /**
+             * @brief Get the max number of elements
+             *
+             * @return size_t
+             */
+            inline size_t Capacity() { return SIMPLEKV_TABLE_SIZE; }
+
+            /**
+             * @brief Get the arena bytes in use, keys included
+             *
+             * @return size_t
+             */
+            inline size_t ArenaUsage() { return _arena_used; }
 
             /**
              * @brief Check if the passing key is pointing to a data 
@@ -88,7 +172,7 @@ namespace SIMPLEKV
              * @param value 
              * @param size 
              * @return true - ok
-             * @return false - already exist or 0 size
+             * @return false - already exist, 0 size or table full
              */
             bool Add(const std::string& key, void* value, size_t size);
 
@@ -127,6 +211,45 @@ namespace SIMPLEKV
 
             
 
+            /* Handle API */
+
+            /**
+             * @brief Resolve a key once, for lookups in hot paths
+             *
+             * @param key
+             * @return Handle_t invalid if key not exist
+             */
+            Handle_t GetHandle(const std::string& key);
+
+            /**
+             * @brief Check if the handle still points to its data
+             *
+             * @param handle
+             * @return true
+             * @return false - invalid, or the key was deleted
+             */
+            bool Exist(Handle_t handle);
+
+            /**
+             * @brief Get a value info pointer by handle, constant time
+             *
+             * @param handle
+             * @return ValueInfo_t* addr=nullptr if handle is stale
+             */
+            ValueInfo_t* Get(Handle_t handle);
+
+            /**
+             * @brief Database will copy the passing data into the memory the handle points to
+             *
+             * @param handle
+             * @param value
+             * @return true - ok
+             * @return false - handle is stale
+             */
+            bool Put(Handle_t handle, void* value);
+
+
+
             /* Wrap for differnt types */
 
             /**
@@ -136,7 +259,7 @@ namespace SIMPLEKV
              * @param key 
              * @param value 
              * @return true - ok
-             * @return false - already exist or 0 size
+             * @return false - already exist, 0 size or table full
              */
             template<typename T>
             inline bool Add(const std::string& key, T value) { return Add(key, (void*)&value, sizeof(T)); }
@@ -152,5 +275,17 @@ namespace SIMPLEKV
              */
             template<typename T>
             inline bool Put(const std::string& key, T value) { return Put(key, (void*)&value); }
+
+            /**
+             * @brief Database will copy the passing data into the memory the handle points to
+             *
+             * @tparam T
+             * @param handle
+             * @param value
+             * @return true - ok
+             * @return false - handle is stale
+             */
+            template<typename T>
+            inline bool Put(Handle_t handle, T value) { return Put(handle, (void*)&value); }
     };
 }
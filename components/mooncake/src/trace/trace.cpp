@@ -0,0 +1,277 @@
+/**
+ * @file trace.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "trace.h"
+#include <cstdlib>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#define MC_TRACE_CORES                  portNUM_PROCESSORS
+#else
+#include <chrono>
+#define MC_TRACE_CORES                  1
+#endif
+
+
+using namespace MOONCAKE;
+
+
+std::atomic<bool> Trace::_running(false);
+Trace::CoreBuffer_t Trace::_buffers[MC_TRACE_CORES];
+uint32_t Trace::_mask = 0;
+int64_t Trace::_start_time = 0;
+int64_t Trace::_frame_start = -1;
+int64_t Trace::_window_start = -1;
+uint32_t Trace::_window_frames = 0;
+uint32_t Trace::_window_worst = 0;
+uint32_t Trace::_fps = 0;
+uint32_t Trace::_worst_frame = 0;
+
+
+#ifdef ESP_PLATFORM
+
+int64_t Trace::getTime()
+{
+    return esp_timer_get_time();
+}
+
+
+int Trace::_get_core_id()
+{
+    return xPortGetCoreID();
+}
+
+
+static TraceEvent_t* _alloc_events(size_t size)
+{
+    /* Keep internal ram for the system when there is PSRAM */
+    void* events = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (events == nullptr)
+        events = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return (TraceEvent_t*)events;
+}
+
+
+void Trace::_sample_heap()
+{
+    counter("heap", heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0)
+        counter("psram", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+}
+
+#else
+
+int64_t Trace::getTime()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+int Trace::_get_core_id()
+{
+    return 0;
+}
+
+
+static TraceEvent_t* _alloc_events(size_t size)
+{
+    return (TraceEvent_t*)malloc(size);
+}
+
+
+void Trace::_sample_heap()
+{
+}
+
+#endif
+
+
+bool Trace::start(uint32_t eventsPerCore)
+{
+    if (_buffers[0].events == nullptr)
+    {
+        uint32_t size = 1;
+        while (size < eventsPerCore)
+            size <<= 1;
+
+        for (int i = 0; i < MC_TRACE_CORES; i++)
+        {
+            _buffers[i].events = _alloc_events(size * sizeof(TraceEvent_t));
+            _buffers[i].head = 0;
+            if (_buffers[i].events == nullptr)
+            {
+                release();
+                return false;
+            }
+        }
+        _mask = size - 1;
+        _start_time = getTime();
+    }
+    _running = true;
+    return true;
+}
+
+
+void Trace::stop()
+{
+    _running = false;
+}
+
+
+void Trace::release()
+{
+    _running = false;
+    for (int i = 0; i < MC_TRACE_CORES; i++)
+    {
+        free(_buffers[i].events);
+        _buffers[i].events = nullptr;
+        _buffers[i].head = 0;
+    }
+    _fps = 0;
+    _worst_frame = 0;
+    _frame_start = -1;
+    _window_start = -1;
+}
+
+
+void Trace::_push(TraceEventType_t type, const char* name, int64_t time, int32_t value)
+{
+    if (!isRunning())
+        return;
+
+    /* Reserve a slot first, so tasks preempting each other on a core never share one */
+    CoreBuffer_t& buffer = _buffers[_get_core_id()];
+    TraceEvent_t& event = buffer.events[buffer.head.fetch_add(1, std::memory_order_relaxed) & _mask];
+    event.time = (uint32_t)(time - _start_time);
+    event.value = value;
+    event.name = name;
+    event.type = type;
+}
+
+
+void Trace::zone(const char* name, int64_t start)
+{
+    _push(TRACE_EVENT_ZONE, name, start, (int32_t)(getTime() - start));
+}
+
+
+void Trace::instant(const char* name)
+{
+    _push(TRACE_EVENT_INSTANT, name, getTime(), 0);
+}
+
+
+void Trace::counter(const char* name, int32_t value)
+{
+    _push(TRACE_EVENT_COUNTER, name, getTime(), value);
+}
+
+
+void Trace::frameBegin()
+{
+    if (!isRunning())
+        return;
+    _frame_start = getTime();
+}
+
+
+void Trace::frameEnd()
+{
+    if (!isRunning() || _frame_start < 0)
+        return;
+
+    int64_t now = getTime();
+    uint32_t frame_time = now - _frame_start;
+    zone("frame", _frame_start);
+    _frame_start = -1;
+
+    if (_window_start < 0)
+        _window_start = now;
+    _window_frames++;
+    if (frame_time > _window_worst)
+        _window_worst = frame_time;
+
+    /* Publish the window's stats */
+    if (now - _window_start >= MC_TRACE_FRAME_WINDOW_US)
+    {
+        _fps = (uint64_t)_window_frames * 1000000 / (now - _window_start);
+        _worst_frame = _window_worst;
+        _window_start = now;
+        _window_frames = 0;
+        _window_worst = 0;
+        counter("fps", _fps);
+        _sample_heap();
+    }
+}
+
+
+size_t Trace::getEventNum()
+{
+    if (_buffers[0].events == nullptr)
+        return 0;
+
+    size_t num = 0;
+    for (int i = 0; i < MC_TRACE_CORES; i++)
+    {
+        uint32_t head = _buffers[i].head;
+        num += (head > _mask) ? _mask + 1 : head;
+    }
+    return num;
+}
+
+
+bool Trace::exportChromeJson(FILE* file)
+{
+    if (file == nullptr || _buffers[0].events == nullptr)
+        return false;
+
+    bool was_running = isRunning();
+    _running = false;
+
+    bool ok = fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file) >= 0;
+    bool first = true;
+    for (int core = 0; core < MC_TRACE_CORES && ok; core++)
+    {
+        ok = fprintf(file,
+                     "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"core %d\"}}",
+                     first ? "" : ",\n", core, core) >= 0;
+        first = false;
+
+        /* Oldest to newest */
+        uint32_t head = _buffers[core].head;
+        uint32_t tail = (head > _mask) ? head - _mask - 1 : 0;
+        for (uint32_t i = tail; i != head && ok; i++)
+        {
+            const TraceEvent_t& event = _buffers[core].events[i & _mask];
+            switch (event.type)
+            {
+                case TRACE_EVENT_ZONE:
+                    ok = fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%lu,\"dur\":%ld}",
+                                 event.name, core, (unsigned long)event.time, (long)event.value) >= 0;
+                    break;
+                case TRACE_EVENT_INSTANT:
+                    ok = fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%lu}",
+                                 event.name, core, (unsigned long)event.time) >= 0;
+                    break;
+                case TRACE_EVENT_COUNTER:
+                    ok = fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"tid\":%d,\"ts\":%lu,\"args\":{\"value\":%ld}}",
+                                 event.name, core, (unsigned long)event.time, (long)event.value) >= 0;
+                    break;
+            }
+        }
+    }
+    if (ok)
+        ok = fputs("\n]}\n", file) >= 0;
+
+    _running = was_running;
+    return ok;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file trace.h
+ * @brief Lightweight timing trace, scoped zones and counters in per core ring buffers
+ * @version 0.1
+ * @date 2025-12-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <atomic>
+
+
+/* Compile zones in, recording still has to be started with Trace::start() */
+#ifndef MC_TRACE_ENABLE
+#define MC_TRACE_ENABLE                 1
+#endif
+
+/* Ring buffer size of each core, power of 2 */
+#ifndef MC_TRACE_EVENTS_PER_CORE
+#define MC_TRACE_EVENTS_PER_CORE        512
+#endif
+
+/* Window that fps and the worst frame are measured over */
+#define MC_TRACE_FRAME_WINDOW_US        1000000
+
+
+namespace MOONCAKE
+{
+    /* Trace event types */
+    enum TraceEventType_t : uint8_t
+    {
+        TRACE_EVENT_ZONE = 0,
+        TRACE_EVENT_INSTANT,
+        TRACE_EVENT_COUNTER,
+    };
+
+    /* One recorded event, name must be a string literal or live till export */
+    struct TraceEvent_t
+    {
+        /* us since Trace::start(), wraps after ~71 min */
+        uint32_t time;
+        /* Duration in us for zones, value for counters */
+        int32_t value;
+        const char* name;
+        TraceEventType_t type;
+    };
+
+
+    /* Trace */
+    /* Global recorder, events are written lock free into the ring buffer of the core they happen on */
+    /* The oldest events are overwritten when a buffer is full */
+    class Trace
+    {
+        private:
+            struct CoreBuffer_t
+            {
+                TraceEvent_t* events;
+                std::atomic<uint32_t> head;
+            };
+
+            static std::atomic<bool> _running;
+            static CoreBuffer_t _buffers[];
+            static uint32_t _mask;
+            static int64_t _start_time;
+
+            /* Frame stats */
+            static int64_t _frame_start;
+            static int64_t _window_start;
+            static uint32_t _window_frames;
+            static uint32_t _window_worst;
+            static uint32_t _fps;
+            static uint32_t _worst_frame;
+
+            static int _get_core_id();
+            static void _push(TraceEventType_t type, const char* name, int64_t time, int32_t value);
+            static void _sample_heap();
+
+
+        public:
+            /**
+             * @brief Allocate the buffers on first call and start recording
+             *
+             * @param eventsPerCore rounded up to a power of 2
+             * @return true if recording
+             */
+            static bool start(uint32_t eventsPerCore = MC_TRACE_EVENTS_PER_CORE);
+
+            /**
+             * @brief Stop recording, recorded events are kept for export
+             */
+            static void stop();
+
+            /**
+             * @brief Stop recording and free the buffers
+             */
+            static void release();
+
+            static inline bool isRunning() { return _running.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief Monotonic clock of the trace in us
+             *
+             * @return int64_t
+             */
+            static int64_t getTime();
+
+            /**
+             * @brief Record a finished zone
+             *
+             * @param name
+             * @param start from getTime()
+             */
+            static void zone(const char* name, int64_t start);
+            static void instant(const char* name);
+            static void counter(const char* name, int32_t value);
+
+            /**
+             * @brief Mark a frame's work, feeds fps and worst frame stats
+             * Heap counters are sampled once per window
+             */
+            static void frameBegin();
+            static void frameEnd();
+
+            /**
+             * @brief Frames per second over the last full window
+             *
+             * @return uint32_t
+             */
+            static inline uint32_t getFps() { return _fps; }
+
+            /**
+             * @brief Longest frame work in us over the last full window
+             *
+             * @return uint32_t
+             */
+            static inline uint32_t getWorstFrame() { return _worst_frame; }
+
+            /**
+             * @brief Number of events held in the buffers
+             *
+             * @return size_t
+             */
+            static size_t getEventNum();
+
+            /**
+             * @brief Write recorded events as Chrome trace JSON (chrome://tracing, Perfetto)
+             * Recording pauses while writing
+             *
+             * @param file
+             * @return true if all written
+             */
+            static bool exportChromeJson(FILE* file);
+    };
+
+
+    /* Records a zone from construction till destruction */
+    class TraceZone
+    {
+        private:
+            const char* _name;
+            int64_t _start;
+
+        public:
+            TraceZone(const char* name) : _name(name), _start(Trace::isRunning() ? Trace::getTime() : -1) {}
+            ~TraceZone()
+            {
+                if (_start >= 0)
+                    Trace::zone(_name, _start);
+            }
+    };
+}
+
+
+#define _MC_TRACE_CONCAT(a, b)          a##b
+#define _MC_TRACE_NAME(line)            _MC_TRACE_CONCAT(_mc_trace_zone_, line)
+
+#if MC_TRACE_ENABLE
+/* Trace the rest of the enclosing scope */
+#define MC_TRACE_ZONE(name)             MOONCAKE::TraceZone _MC_TRACE_NAME(__LINE__)(name)
+#define MC_TRACE_INSTANT(name)          MOONCAKE::Trace::instant(name)
+#define MC_TRACE_COUNTER(name, value)   MOONCAKE::Trace::counter(name, value)
+#else
+#define MC_TRACE_ZONE(name)
+#define MC_TRACE_INSTANT(name)
+#define MC_TRACE_COUNTER(name, value)
+#endif
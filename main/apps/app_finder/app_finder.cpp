@@ -31,6 +31,7 @@ static const char* TAG = "APP_FINDER";
 #define PATH_MAX_DISPLAY_CHARS 18
 #define KEY_HOLD_MS 500
 #define KEY_REPEAT_MS 100
+#define AUDIO_CHANNEL 7 // Clear of the key sounds, they take the first free channel
 
 static bool is_repeat = false;
 static uint32_t next_fire_ts = 0xFFFFFFFF;
@@ -114,6 +115,12 @@ void AppFinder::onRunning()
         return;
     }
 
+    // Release the stream once played
+    if (_data.audio_stream && !_data.hal->speaker()->isPlaying(AUDIO_CHANNEL))
+    {
+        _stop_audio();
+    }
+
     // Render both panels
     int panel_width = _data.hal->canvas()->width() / 2;
     // Render panel info if needed (always render for active panel highlighting)
@@ -155,6 +162,7 @@ void AppFinder::onRunning()
 
 void AppFinder::onDestroy()
 {
+    _stop_audio();
     // Free scroll contexts
     scroll_text_free(&_data.left_panel.list_scroll_ctx);
     scroll_text_free(&_data.left_panel.path_scroll_ctx);
@@ -1034,7 +1042,7 @@ bool AppFinder::_handle_file_selection(PanelData_t& panel)
         uint32_t now = millis();
         bool handle = false;
         // check Fn key hold
-        auto keys_state = _data.hal->keyboard()->keysState();
+        const auto& keys_state = _data.hal->keyboard()->keysState();
         // Tab to switch between panels
         if (_data.hal->keyboard()->isKeyPressing(KEY_NUM_TAB))
         {
@@ -1214,6 +1222,26 @@ bool AppFinder::_handle_file_selection(PanelData_t& panel)
                 }
                 _navigate_panel_directory(panel, new_path);
             }
+            else if (_has_extension(selected_item.name, ".wav") && panel.current_path != "/")
+            {
+                // Play from the card, enter again to stop
+                bool was_playing = _data.audio_stream != nullptr;
+                _stop_audio();
+                if (!was_playing)
+                {
+                    std::string path = panel.current_path + "/" +
+                                       (selected_item.fname.empty() ? selected_item.name : selected_item.fname);
+                    if (!_play_audio(path))
+                    {
+                        UTILS::UI::show_error_dialog(_data.hal, "Play failed", std::string("Cannot play ") + selected_item.name);
+                        // redraw all
+                        _data.left_panel.panel_info_needs_update = true;
+                        _data.right_panel.panel_info_needs_update = true;
+                        _data.left_panel.needs_update = true;
+                        _data.right_panel.needs_update = true;
+                    }
+                }
+            }
             selection_changed = true;
         }
         // Copy (KEY 5)
@@ -1447,6 +1475,37 @@ bool AppFinder::_handle_file_selection(PanelData_t& panel)
     return selection_changed;
 }
 
+bool AppFinder::_play_audio(const std::string& path)
+{
+    _data.audio_source = new HAL::FileStreamSource;
+    if (_data.audio_source->openWav(path.c_str()))
+    {
+        _data.audio_stream = new HAL::SpeakerStream(_data.audio_source);
+        if (_data.audio_stream->begin() && _data.hal->speaker()->playStream(_data.audio_stream, AUDIO_CHANNEL))
+        {
+            ESP_LOGI(TAG, "Playing %s", path.c_str());
+            return true;
+        }
+    }
+    _stop_audio();
+    return false;
+}
+
+void AppFinder::_stop_audio()
+{
+    if (_data.audio_stream)
+    {
+        _data.hal->speaker()->stop(AUDIO_CHANNEL);
+        delete _data.audio_stream;
+        _data.audio_stream = nullptr;
+    }
+    if (_data.audio_source)
+    {
+        delete _data.audio_source;
+        _data.audio_source = nullptr;
+    }
+}
+
 void AppFinder::_mount_sdcard()
 {
     if (!_data.hal->sdcard()->mount(false))
@@ -97,6 +97,10 @@ namespace MOONCAKE
                 // bool sdcard_initialized = false;
                 // bool usb_initialized = false;
                 bool panel_info_needs_update = false;
+
+                // WAV file playing from the card
+                HAL::FileStreamSource* audio_source = nullptr;
+                HAL::SpeakerStream* audio_stream = nullptr;
             };
             Data_t _data;
 
@@ -140,6 +144,10 @@ namespace MOONCAKE
             void _mount_sdcard();
             void _mount_usb();
 
+            // Audio
+            bool _play_audio(const std::string& path);
+            void _stop_audio();
+
         public:
             void onCreate() override;
             void onResume() override;
@@ -36,6 +36,7 @@ static const char* TAG = "APP_INSTALLER";
 #define WIFI_CONNECT_TIMEOUT_MS 10000
 #define HTTP_RESPONSE_BUFFER_SIZE (16 * 1024)
 #define FILE_DOWNLOAD_BUFFER_SIZE (4 * 1024)
+#define FILE_WRITE_BUFFER_SIZE (16 * 1024) // whole-cluster writes, not a sector at a time
 #define KEY_HOLD_MS 500
 #define KEY_REPEAT_MS 100
 #define SCROLLBAR_MIN_HEIGHT 10
@@ -415,7 +416,7 @@ void AppInstaller::_init_cloud_source()
         return;
     }
     // check wifi is enabled
-    if (!_data.hal->settings()->getBool("wifi", "enabled"))
+    if (!_data.hal->settings()->getBool(SETTINGS::WIFI_ENABLED))
     {
         _data.error_message = "WiFi is disabled in Settings";
         _data.state = state_source;
@@ -645,6 +646,10 @@ bool AppInstaller::_render_usb_info()
     // Get volume label and size info
     std::string name = _data.hal->usb()->get_device_name();
     uint64_t totalBytes = _data.hal->usb()->get_capacity();
+    // Measured read speed takes the label's place once known
+    uint32_t speed = _data.hal->usb()->get_read_speed();
+    if (speed > 0)
+        name = std::format("{:.1f}MB/s", speed / 1024.0f);
 
     // Draw volume label and size info
     const int width = 8 * 8; // _999.9MB
@@ -807,7 +812,7 @@ bool AppInstaller::_handle_file_selection()
     {
         uint32_t now = millis();
         bool handle = false;
-        auto keys_state = _data.hal->keyboard()->keysState();
+        const auto& keys_state = _data.hal->keyboard()->keysState();
         // up navigation
         if (_data.hal->keyboard()->isKeyPressing(KEY_NUM_UP))
         {
@@ -971,7 +976,7 @@ bool AppInstaller::_handle_file_selection()
                     if (_show_confirmation_dialog(selected_item.name, "Download the app?"))
                     {
                         // chck if dest path starts from /sdcard
-                        std::string dl_path = _data.hal->settings()->getString("installer", "dl_path");
+                        std::string dl_path = _data.hal->settings()->getString(SETTINGS::INSTALLER_DL_PATH);
                         if (dl_path.find("/sdcard") != 0)
                         {
                             UTILS::UI::show_error_dialog(_data.hal,
@@ -1012,7 +1017,7 @@ bool AppInstaller::_handle_file_selection()
                                         // Start the installation process
                                         _install_firmware(dest);
                                         // check delete settings
-                                        if (_data.hal->settings()->getBool("installer", "auto_delete"))
+                                        if (_data.hal->settings()->getBool(SETTINGS::INSTALLER_AUTO_DELETE))
                                         {
                                             // delete file
                                             UTILS::UI::show_progress(_data.hal,
@@ -1327,7 +1332,7 @@ void AppInstaller::_install_firmware(const std::string& filepath)
     _data.install_title = app_name;
 
     // read settings
-    bool custom_install = _data.hal->settings()->getBool("installer", "custom_install");
+    bool custom_install = _data.hal->settings()->getBool(SETTINGS::INSTALLER_CUSTOM_INSTALL);
 
     _installation_progress_callback(-1, "Reading PT...", this);
     delay(500);
@@ -1510,7 +1515,7 @@ void AppInstaller::_install_firmware(const std::string& filepath)
     delay(500);
     flash_ptable.save();
     // setting boot partition
-    if (boot_partition != nullptr && _data.hal->settings()->getBool("installer", "run_on_install"))
+    if (boot_partition != nullptr && _data.hal->settings()->getBool(SETTINGS::INSTALLER_RUN_ON_INSTALL))
     {
         _installation_progress_callback(-1, "Making bootable...", this);
         delay(500);
@@ -1799,6 +1804,8 @@ bool AppInstaller::_download_cloud_file(const std::string& url, const std::strin
         esp_http_client_cleanup(client);
         return false;
     }
+    // HTTP chunks come in odd sizes, batch them into aligned multi-sector writes
+    setvbuf(f, nullptr, _IOFBF, FILE_WRITE_BUFFER_SIZE);
 
     // Create buffer for reading data
     const int buffer_size = FILE_DOWNLOAD_BUFFER_SIZE;
@@ -1,4 +1,5 @@
 #include "app_ota.h"
+#include "../utils/flash/ota_registry.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
 
@@ -24,6 +25,8 @@ void OtaApp::onCreate()
     else
     {
         ESP_LOGE(TAG, "Failed to set boot partition");
+        // Image is gone or broken, scan partitions again on the next boot
+        UTILS::OTA_REGISTRY::invalidate();
         destroyApp();
     }
 }
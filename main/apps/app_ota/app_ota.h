@@ -46,16 +46,17 @@ namespace MOONCAKE
         {
         private:
             const esp_partition_t* _partition;
-            std::string _name;
 
         public:
-            OtaApp_Packer(const esp_partition_t* partition) : _partition(partition)
-            {
-                _name = std::string(((const char*)partition->label));
-            };
-            std::string getAppName() override { return _name; }
+            OtaApp_Packer(const esp_partition_t* partition) : _partition(partition) {};
+            std::string getAppName() override { return std::string((const char*)_partition->label); }
             std::string getAppDesc() override { return "App installed by user. To delete or rename use FDISK app"; }
-            void* getAppIcon() override { return (void*)(new AppIcon_t(image_data_ota_big, nullptr)); }
+            void* getAppIcon() override
+            {
+                // Same icon for all OTA apps, made when the launcher first asks for it
+                static AppIcon_t* icon = new AppIcon_t(image_data_ota_big, nullptr);
+                return (void*)icon;
+            }
             void* newApp() override { return new OtaApp(_partition); };
             void deleteApp(void* app) override { delete static_cast<OtaApp*>(app); }
         };
@@ -1,9 +1,12 @@
 #include "app_settings.h"
 #include "apps/utils/ui/settings_screen.h"
 #include "esp_log.h"
+#include <sys/stat.h>
 
 static const char* TAG = "APP_SETTINGS";
-static const std::string SETTINGS_FILE_NAME = "/sdcard/settings.txt";
+static const std::string SETTINGS_FILE_NAME = "/sdcard/settings.bin";
+// Text files from older versions, imported when there is no snapshot
+static const std::string SETTINGS_TEXT_FILE_NAME = "/sdcard/settings.txt";
 
 // scroll constants
 #define DESC_SCROLL_PAUSE 1000
@@ -64,9 +67,16 @@ void AppSettings::onRunning()
                 _data.hal->sdcard()->mount(false);
                 if (_data.hal->sdcard()->is_mounted())
                 {
-                    _data.hal->settings()->exportToFile(SETTINGS_FILE_NAME);
+                    bool exported = _data.hal->settings()->exportSnapshot(SETTINGS_FILE_NAME);
                     _data.hal->sdcard()->eject();
-                    UTILS::UI::show_message_dialog(_data.hal, "Success", "Settings saved to: " + SETTINGS_FILE_NAME, 0);
+                    if (exported)
+                    {
+                        UTILS::UI::show_message_dialog(_data.hal, "Success", "Settings saved to: " + SETTINGS_FILE_NAME, 0);
+                    }
+                    else
+                    {
+                        UTILS::UI::show_error_dialog(_data.hal, "Error", "Failed to save settings to: " + SETTINGS_FILE_NAME);
+                    }
                 }
                 else
                 {
@@ -78,33 +88,37 @@ void AppSettings::onRunning()
                 _data.hal->sdcard()->mount(false);
                 if (_data.hal->sdcard()->is_mounted())
                 {
-                    if (_data.hal->settings()->importFromFile(SETTINGS_FILE_NAME))
+                    struct stat st;
+                    bool has_snapshot = stat(SETTINGS_FILE_NAME.c_str(), &st) == 0;
+                    std::string file_name = has_snapshot ? SETTINGS_FILE_NAME : SETTINGS_TEXT_FILE_NAME;
+                    bool imported = has_snapshot ? _data.hal->settings()->importSnapshot(file_name)
+                                                 : _data.hal->settings()->importFromFile(file_name);
+                    if (imported)
                     {
                         _data.hal->sdcard()->eject();
                         // Stop WiFi
                         UTILS::UI::show_progress(_data.hal, "WiFi", -1, "Stopping...");
                         // Stop LED
-                        if (!_data.hal->settings()->getBool("system", "use_led"))
+                        if (!_data.hal->settings()->getBool(SETTINGS::SYSTEM_USE_LED))
                         {
                             _data.hal->led()->off();
                         }
                         delay(500);
+                        _data.hal->waitInit();
                         _data.hal->wifi()->init();
                         // Connect to WiFi if enabled
-                        if (_data.hal->settings()->getBool("wifi", "enabled"))
+                        if (_data.hal->settings()->getBool(SETTINGS::WIFI_ENABLED))
                         {
                             _data.hal->wifi()->update_status();
                             UTILS::UI::show_progress(_data.hal, "WiFi", -1, "Starting...");
                             delay(500);
                             _data.hal->wifi()->connect();
                         }
-                        UTILS::UI::show_message_dialog(_data.hal, "Success", "Loaded from: " + SETTINGS_FILE_NAME, 0);
+                        UTILS::UI::show_message_dialog(_data.hal, "Success", "Loaded from: " + file_name, 0);
                     }
                     else
                     {
-                        UTILS::UI::show_error_dialog(_data.hal,
-                                                     "Error",
-                                                     "Failed to import settings from: " + SETTINGS_FILE_NAME);
+                        UTILS::UI::show_error_dialog(_data.hal, "Error", "Failed to import settings from: " + file_name);
                     }
                 }
                 else
@@ -124,6 +138,8 @@ void AppSettings::onRunning()
 
 void AppSettings::onDestroy()
 {
+    // Don't wait for the flush delay, changes are done
+    _data.hal->settings()->flush();
     // Free scroll context
     scroll_text_free(&_data.desc_scroll_ctx);
     // Free hint text context
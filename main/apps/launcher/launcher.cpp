@@ -18,10 +18,12 @@
 #include "apps/utils/flash/flash_tools.h"
 #include "apps/utils/ui/dialog.h"
 #include "apps/utils/screenshot/screenshot_tools.h"
+#include "apps/utils/trace/trace_tools.h"
 #include "esp_partition.h"
 #include "wifi/wifi.h"
 #include <format>
 #include <ctime>
+#include <algorithm>
 
 static const char* TAG = "APP_LAUNCHER";
 // Repeat timing consistent with apps
@@ -29,6 +31,8 @@ static const char* TAG = "APP_LAUNCHER";
 #define KEY_REPEAT_MS 200
 
 #define BAT_UPDATE_INTERVAL 30000
+// Brightness fade out step when dimming
+#define DIM_STEP_INTERVAL 50
 
 static bool is_repeat = false;
 static uint32_t next_fire_ts = 0;
@@ -48,20 +52,12 @@ void Launcher::onCreate()
     _data.hal = mcAppGetDatabase()->Get("HAL")->value<HAL::Hal*>();
     _data.system_bar_force_update_flag = mcAppGetDatabase()->Get("SYSTEM_BAR_FORCE_UPDATE")->value<bool*>();
     // settings
-    _data.hal->display()->setBrightness(_data.hal->settings()->getNumber("system", "brightness"));
-    _data.hal->speaker()->setVolume(_data.hal->settings()->getNumber("system", "volume"));
+    _data.hal->display()->setBrightness(_data.hal->settings()->getNumber(SETTINGS::SYSTEM_BRIGHTNESS));
+    _data.hal->speaker()->setVolume(_data.hal->settings()->getNumber(SETTINGS::SYSTEM_VOLUME));
     // _data.is_dimmed = false;
     _data.hal->keyboard()->setDimmed(false);
 
-    // Initialize WiFi module
-    if (_data.hal->wifi()->init())
-    {
-        // Connect to WiFi if enabled
-        if (_data.hal->settings()->getBool("wifi", "enabled"))
-        {
-            _data.hal->wifi()->connect();
-        }
-    }
+    // WiFi is started by hal in background
     // Init
     _boot_anim();
     _start_menu();
@@ -79,14 +75,17 @@ void Launcher::onResume() { _stop_repeat(); }
 // onRunning
 void Launcher::onRunning()
 {
+    MC_TRACE_ZONE("launcher");
     _update_menu();
     _update_system_bar();
     _update_space_bar();
     _update_keyboard_state();
+    _request_next_update(true);
 }
 
 void Launcher::onRunningBG()
 {
+    MC_TRACE_ZONE("launcher_bg");
     // If only launcher standing still
     if (mcAppGetFramework()->getAppManager().getCreatedAppNum() == 1)
     {
@@ -100,6 +99,29 @@ void Launcher::onRunningBG()
     _update_system_bar();
     _update_space_bar();
     _update_keyboard_state();
+    _request_next_update(false);
+}
+
+// Views update once their period has passed
+static uint32_t _time_left(uint32_t now, uint32_t last_update, uint32_t period)
+{
+    uint32_t elapsed = now - last_update;
+    return elapsed > period ? 0 : period - elapsed + 1;
+}
+
+void Launcher::_request_next_update(bool with_menu)
+{
+    // Let mooncake sleep till the next view is due instead of spinning, key events wake it up earlier.
+    // A dimmed menu has nothing to animate, unless a key is held for repeat
+    uint32_t now = millis();
+    uint32_t next = _time_left(now, _data.system_bar_update_count, _data.system_bar_update_preiod);
+    next = std::min(next, _time_left(now, _data.space_bar_update_count, _data.space_bar_update_preiod));
+    auto keyboard = _data.hal->keyboard();
+    if (with_menu && (!keyboard->isDimmed() || keyboard->isPressed()))
+        next = std::min(next, _time_left(now, _data.menu_update_count, _data.menu_update_preiod));
+    else if (keyboard->isDimmed() && _data.hal->display()->getBrightness() > 0)
+        next = std::min(next, (uint32_t)DIM_STEP_INTERVAL + 1);
+    requestUpdateIn(next);
 }
 
 void Launcher::_init_progress_bar()
@@ -179,7 +201,7 @@ void Launcher::_wait_enter()
     _data.hal->display()->setTextColor(TFT_LIGHTGREY);
 
     _data.hal->keyboard()->updateKeyList();
-    bool has_boot_sound = _data.hal->settings()->getBool("system", "boot_sound");
+    bool has_boot_sound = _data.hal->settings()->getBool(SETTINGS::SYSTEM_BOOT_SOUND);
     if (_data.hal->keyboard()->isPressed())
     {
         if (has_boot_sound)
@@ -200,8 +222,8 @@ void Launcher::_wait_enter()
     // factory means apps partition, skipping
     bool has_bootable_app = UTILS::FLASH_TOOLS::is_partition_bootable(ota_partition) &&
                             (ota_partition->subtype != ESP_PARTITION_SUBTYPE_APP_FACTORY) &&
-                            _data.hal->settings()->getBool("system", "last_app");
-    uint32_t timeout = _data.hal->settings()->getNumber("system", "last_app_to") * 1000;
+                            _data.hal->settings()->getBool(SETTINGS::SYSTEM_LAST_APP);
+    uint32_t timeout = _data.hal->settings()->getNumber(SETTINGS::SYSTEM_LAST_APP_TO) * 1000;
     // check is it current boot partition
     if (has_bootable_app)
     {
@@ -368,7 +390,7 @@ void Launcher::_update_keyboard_state()
     _data.hal->keyboard()->updateKeysState();
 
     // check dim settings
-    uint32_t din_time = _data.hal->settings()->getNumber("system", "dim_time") * 1000;
+    uint32_t din_time = _data.hal->settings()->getNumber(SETTINGS::SYSTEM_DIM_TIME) * 1000;
     uint32_t now = millis();
     if ((now - _data.hal->keyboard()->lastPressedTime()) > din_time)
     {
@@ -385,13 +407,13 @@ void Launcher::_update_keyboard_state()
         if (_data.hal->keyboard()->isDimmed())
         {
             ESP_LOGD(TAG, "Screen on");
-            _data.hal->display()->setBrightness(_data.hal->settings()->getNumber("system", "brightness"));
+            _data.hal->display()->setBrightness(_data.hal->settings()->getNumber(SETTINGS::SYSTEM_BRIGHTNESS));
             _data.hal->keyboard()->setDimmed(false);
         }
     }
     // Dimming slowly
     static uint32_t last_dim_step_time = 0;
-    if (now - last_dim_step_time > 50)
+    if (now - last_dim_step_time > DIM_STEP_INTERVAL)
     {
         last_dim_step_time = now;
         auto brightness = _data.hal->display()->getBrightness();
@@ -403,6 +425,8 @@ void Launcher::_update_keyboard_state()
     }
     // Check for screenshot key combination: CTRL + SPACE
     UTILS::SCREENSHOT_TOOLS::check_and_handle_screenshot(_data.hal, _data.system_bar_force_update_flag);
+    // Check for trace key combination: CTRL + T
+    UTILS::TRACE_TOOLS::check_and_handle_trace(_data.hal, _data.system_bar_force_update_flag);
 }
 
 uint32_t _bat_update_time_count = 0;
@@ -411,14 +435,14 @@ void Launcher::_update_system_state()
 {
     // brightness
     int32_t brightness = _data.hal->display()->getBrightness();
-    int32_t new_brightness = _data.hal->settings()->getNumber("system", "brightness");
+    int32_t new_brightness = _data.hal->settings()->getNumber(SETTINGS::SYSTEM_BRIGHTNESS);
     if (!_data.hal->keyboard()->isDimmed() && brightness != new_brightness)
     {
         _data.hal->display()->setBrightness(new_brightness);
     }
     // volume
     int32_t volume = _data.hal->speaker()->getVolume();
-    int32_t new_volume = _data.hal->settings()->getNumber("system", "volume");
+    int32_t new_volume = _data.hal->settings()->getNumber(SETTINGS::SYSTEM_VOLUME);
     if (volume != new_volume)
     {
         _data.hal->speaker()->setVolume(new_volume);
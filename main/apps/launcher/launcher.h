@@ -93,12 +93,19 @@ namespace MOONCAKE
             void _stop_repeat();
             void _update_keyboard_state();
             void _update_system_state();
+            void _request_next_update(bool with_menu);
 
         public:
             void onCreate() override;
             void onRunning() override;
             void onRunningBG() override;
             void onResume() override;
+
+            /**
+             * @brief Start decoding the boot logo on the image service, called before hal init so the two overlap
+             *
+             */
+            static void prefetchBootLogo();
         };
 
         class Launcher_Packer : public APP_PACKER_BASE
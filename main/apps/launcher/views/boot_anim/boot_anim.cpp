@@ -13,18 +13,47 @@
 #include "esp_log.h"
 #include "apps/utils/theme/theme_define.h"
 #include "apps/utils/common_define.h"
+#include "apps/utils/image/image_service.h"
 
 using namespace MOONCAKE::APPS;
 
 extern const uint8_t boot_logo_start[] asm("_binary_boot_logo_png_start");
 extern const uint8_t boot_logo_end[] asm("_binary_boot_logo_png_end");
 
+static const char* TAG = "APP_LAUNCHER";
+// The logo is full screen
+#define BOOT_LOGO_KEY "boot_logo"
+#define BOOT_LOGO_W 240
+#define BOOT_LOGO_H 135
+#define BOOT_LOGO_TIMEOUT_MS 1000
+
+void Launcher::prefetchBootLogo()
+{
+    UTILS::IMAGE_SERVICE::request_memory(
+        BOOT_LOGO_KEY, boot_logo_start, boot_logo_end - boot_logo_start, BOOT_LOGO_W, BOOT_LOGO_H);
+}
+
 void Launcher::_boot_anim()
 {
+    using namespace UTILS::IMAGE_SERVICE;
 
-    // Show logo
+    // Show logo, decoded while hal was starting
     // * _data.hal->display()->pushImage(0, 0, 240, 135, image_data_logo);
-    _data.hal->display()->drawPng(boot_logo_start, boot_logo_end - boot_logo_start);
+    if (wait(BOOT_LOGO_KEY, BOOT_LOGO_W, BOOT_LOGO_H, BOOT_LOGO_TIMEOUT_MS))
+    {
+        get(BOOT_LOGO_KEY, BOOT_LOGO_W, BOOT_LOGO_H)->pushSprite(_data.hal->display(), 0, 0);
+    }
+    else if (get_state(BOOT_LOGO_KEY, BOOT_LOGO_W, BOOT_LOGO_H) != IMAGE_PENDING)
+    {
+        // Not prefetched or no memory for it. drawPng shares its decoder with the worker, so only when that is idle
+        _data.hal->display()->drawPng(boot_logo_start, boot_logo_end - boot_logo_start);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Boot logo still decoding, skipped");
+    }
+    // Only shown once
+    remove(BOOT_LOGO_KEY, BOOT_LOGO_W, BOOT_LOGO_H);
     // Show version
     const int32_t pos_x = _data.hal->display()->width() - 4;
     const int32_t pos_y = _data.hal->display()->height() / 2;
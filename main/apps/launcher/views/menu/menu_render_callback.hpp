@@ -12,6 +12,7 @@
 #include "hal.h"
 #include "apps/utils/smooth_menu/src/smooth_menu.h"
 #include "apps/utils/icon/icon_define.h"
+#include "apps/utils/icon/icon_cache.h"
 #include "apps/utils/common_define.h"
 #include "apps/utils/anim/scroll_text.h"
 #include "apps/utils/anim/hl_text.h"
@@ -128,11 +129,22 @@ public:
                 // Icon
                 if (item->userData != nullptr)
                 {
-                    if (((AppIcon_t*)(item->userData))->iconSmall == nullptr)
+                    AppIcon_t* icon = (AppIcon_t*)(item->userData);
+                    // no small image, downsample the big one once into the icon cache
+                    if (icon->iconSmall == nullptr)
                     {
-                        // no small image, render with resize to 40x40 from big image
-                        bool prev_swap = _hal->canvas()->getSwapBytes();
-                        _hal->canvas()->setSwapBytes(true);
+                        icon->iconSmall = UTILS::ICON_CACHE::get_small_icon(icon->iconBig);
+                    }
+                    bool prev_swap = _hal->canvas()->getSwapBytes();
+                    _hal->canvas()->setSwapBytes(true);
+                    if (icon->iconSmall != nullptr)
+                    {
+                        _hal->canvas()->pushImage(
+                            item->x + x_offset + 4, item->y + 4, 40, 40, icon->iconSmall, (uint16_t)0x3ce7);
+                    }
+                    else
+                    {
+                        // out of memory, render with resize to 40x40 from big image
                         _hal->canvas()->pushImageRotateZoom((float)(item->x + x_offset + 4),
                                                             (float)(item->y + 4),
                                                             0.0,
@@ -142,23 +154,10 @@ public:
                                                             0.7,
                                                             56,
                                                             56,
-                                                            ((AppIcon_t*)(item->userData))->iconBig,
+                                                            icon->iconBig,
                                                             (uint16_t)0x3ce7);
-                        _hal->canvas()->setSwapBytes(prev_swap);
-                    }
-                    else
-                    {
-                        // have small image, render it
-                        bool prev_swap = _hal->canvas()->getSwapBytes();
-                        _hal->canvas()->setSwapBytes(true);
-                        _hal->canvas()->pushImage(item->x + x_offset + 4,
-                                                  item->y + 4,
-                                                  40,
-                                                  40,
-                                                  ((AppIcon_t*)(item->userData))->iconSmall,
-                                                  (uint16_t)0x3ce7);
-                        _hal->canvas()->setSwapBytes(prev_swap);
                     }
+                    _hal->canvas()->setSwapBytes(prev_swap);
                 }
 
                 // Draw tag
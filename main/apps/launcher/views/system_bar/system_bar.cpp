@@ -91,9 +91,17 @@ void Launcher::_update_system_bar()
         
 
         _data.hal->canvas_system_bar()->setFont(FONT_16);
+        // Perf overlay takes the place of time
+        if (MOONCAKE::Trace::isRunning())
+        {
+            _data.hal->canvas_system_bar()->setTextColor(THEME_COLOR_SYSTEM_BAR_TEXT);
+            _data.hal->canvas_system_bar()->drawCenterString(
+                std::format("{}fps {:.1f}ms", MOONCAKE::Trace::getFps(), MOONCAKE::Trace::getWorstFrame() / 1000.0f).c_str(),
+                _data.hal->canvas_system_bar()->width() / 2 - 8,
+                _data.hal->canvas_system_bar()->height() / 2 - FONT_HEIGHT / 2 - 1);
+        }
         // Time
-        bool show_time = _data.hal->settings()->getBool("system", "show_time");
-        if (show_time)
+        else if (_data.hal->settings()->getBool(SETTINGS::SYSTEM_SHOW_TIME))
         {
             _data.hal->canvas_system_bar()->setTextColor(THEME_COLOR_SYSTEM_BAR_TEXT);
             _data.hal->canvas_system_bar()->drawCenterString(_data.system_state.time.c_str(),
@@ -105,7 +113,7 @@ void Launcher::_update_system_bar()
         x = _data.hal->canvas_system_bar()->width() - 45;
 
         // Voltage
-        bool show_voltage = _data.hal->settings()->getBool("system", "show_bat_volt");
+        bool show_voltage = _data.hal->settings()->getBool(SETTINGS::SYSTEM_SHOW_BAT_VOLT);
         if (show_voltage)
         {
             _data.hal->canvas_system_bar()->setTextColor(TFT_BLACK);
@@ -8,6 +8,7 @@
  *
  */
 #include "flash_tools.h"
+#include "ota_registry.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
 #include "esp_flash_partitions.h"
@@ -167,6 +168,11 @@ namespace UTILS
                 progress_cb(-1, "Erasing partition...", arg_cb);
             }
             ESP_LOGI(TAG, "Erasing partition...");
+            // Bootable apps are cached, this one is about to change
+            if (update_partition.type == ESP_PARTITION_TYPE_APP)
+            {
+                OTA_REGISTRY::invalidate();
+            }
             err = esp_partition_erase_range(&update_partition, 0, update_partition.size);
             if (err != ESP_OK)
             {
@@ -0,0 +1,152 @@
+/**
+ * @file ota_registry.cpp
+ * @brief Cached list of bootable OTA app partitions
+ * @version 0.1
+ * @date 2025-12-12
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "ota_registry.h"
+#include "flash_tools.h"
+#include "settings/settings.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "OTA_REGISTRY";
+
+#define OTA_REGISTRY_NAMESPACE "ota_apps"
+#define OTA_REGISTRY_KEY_HASH "ptable_hash"
+#define OTA_REGISTRY_KEY_MASK "bootable"
+
+namespace UTILS
+{
+    namespace OTA_REGISTRY
+    {
+        static uint32_t _fnv1a(uint32_t hash, const void* data, size_t len)
+        {
+            const uint8_t* bytes = (const uint8_t*)data;
+            for (size_t i = 0; i < len; i++)
+            {
+                hash ^= bytes[i];
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        // Hash of the partition table as loaded by IDF, no flash access
+        static uint32_t _ptable_hash()
+        {
+            uint32_t hash = 2166136261u;
+            esp_partition_iterator_t it = esp_partition_find(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, NULL);
+            while (it != NULL)
+            {
+                const esp_partition_t* partition = esp_partition_get(it);
+                hash = _fnv1a(hash, &partition->type, sizeof(partition->type));
+                hash = _fnv1a(hash, &partition->subtype, sizeof(partition->subtype));
+                hash = _fnv1a(hash, &partition->address, sizeof(partition->address));
+                hash = _fnv1a(hash, &partition->size, sizeof(partition->size));
+                hash = _fnv1a(hash, partition->label, sizeof(partition->label));
+                it = esp_partition_next(it);
+            }
+            esp_partition_iterator_release(it);
+            return hash;
+        }
+
+        std::vector<const esp_partition_t*> get_bootable_apps()
+        {
+            int64_t start = esp_timer_get_time();
+
+            // OTA slots, bit n of the mask is subtype OTA_MIN + n
+            std::vector<const esp_partition_t*> slots;
+            esp_partition_iterator_t it = esp_partition_find(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, NULL);
+            while (it != NULL)
+            {
+                const esp_partition_t* partition = esp_partition_get(it);
+                if (partition->subtype >= ESP_PARTITION_SUBTYPE_APP_OTA_MIN && partition->subtype < ESP_PARTITION_SUBTYPE_APP_OTA_MAX)
+                {
+                    slots.push_back(partition);
+                }
+                it = esp_partition_next(it);
+            }
+            esp_partition_iterator_release(it);
+
+            uint32_t hash = _ptable_hash();
+            uint32_t mask = 0;
+            bool cached = false;
+
+            nvs_handle_t nvs_handle;
+            esp_err_t err =
+                nvs_open_from_partition(SETTINGS::Settings::NVS_PARTITION, OTA_REGISTRY_NAMESPACE, NVS_READWRITE, &nvs_handle);
+            if (err == ESP_OK)
+            {
+                uint32_t cached_hash = 0;
+                cached = nvs_get_u32(nvs_handle, OTA_REGISTRY_KEY_HASH, &cached_hash) == ESP_OK && cached_hash == hash &&
+                         nvs_get_u32(nvs_handle, OTA_REGISTRY_KEY_MASK, &mask) == ESP_OK;
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+            }
+
+            if (!cached)
+            {
+                // Partition table changed or an app was written, read every header once
+                mask = 0;
+                for (const auto partition : slots)
+                {
+                    if (FLASH_TOOLS::is_partition_bootable(partition))
+                    {
+                        mask |= 1UL << (partition->subtype - ESP_PARTITION_SUBTYPE_APP_OTA_MIN);
+                    }
+                }
+                if (err == ESP_OK)
+                {
+                    if (nvs_set_u32(nvs_handle, OTA_REGISTRY_KEY_MASK, mask) != ESP_OK ||
+                        nvs_set_u32(nvs_handle, OTA_REGISTRY_KEY_HASH, hash) != ESP_OK || nvs_commit(nvs_handle) != ESP_OK)
+                    {
+                        ESP_LOGE(TAG, "Failed to save registry");
+                    }
+                }
+            }
+            if (err == ESP_OK)
+            {
+                nvs_close(nvs_handle);
+            }
+
+            std::vector<const esp_partition_t*> apps;
+            for (const auto partition : slots)
+            {
+                if (mask & (1UL << (partition->subtype - ESP_PARTITION_SUBTYPE_APP_OTA_MIN)))
+                {
+                    apps.push_back(partition);
+                }
+            }
+
+            ESP_LOGI(TAG,
+                     "%d bootable of %d OTA partitions (%s) in %lld us",
+                     apps.size(),
+                     slots.size(),
+                     cached ? "cached" : "scanned",
+                     esp_timer_get_time() - start);
+            return apps;
+        }
+
+        void invalidate()
+        {
+            nvs_handle_t nvs_handle;
+            if (nvs_open_from_partition(SETTINGS::Settings::NVS_PARTITION, OTA_REGISTRY_NAMESPACE, NVS_READWRITE, &nvs_handle) !=
+                ESP_OK)
+            {
+                return;
+            }
+            if (nvs_erase_key(nvs_handle, OTA_REGISTRY_KEY_HASH) == ESP_OK)
+            {
+                nvs_commit(nvs_handle);
+                ESP_LOGI(TAG, "Registry invalidated");
+            }
+            nvs_close(nvs_handle);
+        }
+    } // namespace OTA_REGISTRY
+} // namespace UTILS
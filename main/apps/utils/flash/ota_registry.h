@@ -0,0 +1,33 @@
+/**
+ * @file ota_registry.h
+ * @brief Cached list of bootable OTA app partitions
+ * @version 0.1
+ * @date 2025-12-12
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <vector>
+#include "esp_partition.h"
+
+namespace UTILS
+{
+    namespace OTA_REGISTRY
+    {
+        /**
+         * @brief Get the bootable OTA app partitions
+         *
+         * Partition headers are only read when the partition table changed since the last call,
+         * or the cache was invalidated. Otherwise the result is taken from NVS.
+         *
+         * @return std::vector<const esp_partition_t*> Partitions in table order
+         */
+        std::vector<const esp_partition_t*> get_bootable_apps();
+
+        /**
+         * @brief Drop the cached list, call after writing an app partition
+         */
+        void invalidate();
+    } // namespace OTA_REGISTRY
+} // namespace UTILS
@@ -0,0 +1,118 @@
+/**
+ * @file icon_cache.cpp
+ * @brief Implementation of the pre-scaled app icon cache
+ * @version 0.1
+ * @date 2025-12-04
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "icon_cache.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <algorithm>
+#include <map>
+
+static const char* TAG = "ICON_CACHE";
+
+// Keep this much internal RAM free before moving icon buffers to PSRAM
+#define ICON_CACHE_INTERNAL_RESERVE (48 * 1024)
+
+namespace UTILS
+{
+    namespace ICON_CACHE
+    {
+        static std::map<const uint16_t*, uint16_t*> _cache;
+
+        static uint16_t* _alloc_icon_buffer(size_t size)
+        {
+            uint16_t* buffer = nullptr;
+            if (heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) > size + ICON_CACHE_INTERNAL_RESERVE)
+            {
+                buffer = (uint16_t*)heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            }
+            if (buffer == nullptr)
+            {
+                buffer = (uint16_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            }
+            if (buffer == nullptr)
+            {
+                buffer = (uint16_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+            }
+            return buffer;
+        }
+
+        void downscale_rgb565(
+            const uint16_t* src, int src_w, int src_h, uint16_t* dst, int dst_w, int dst_h, uint16_t transparent)
+        {
+            // Destination pixel d covers [d * src, (d + 1) * src) and source pixel s covers
+            // [s * dst, (s + 1) * dst) in the same scaled units, so the overlap is the filter weight
+            const uint32_t total = src_w * src_h;
+            for (int dy = 0; dy < dst_h; dy++)
+            {
+                int y0 = dy * src_h;
+                int y1 = y0 + src_h;
+                for (int dx = 0; dx < dst_w; dx++)
+                {
+                    int x0 = dx * src_w;
+                    int x1 = x0 + src_w;
+                    uint32_t r = 0, g = 0, b = 0, opaque = 0;
+                    for (int sy = y0 / dst_h; sy * dst_h < y1; sy++)
+                    {
+                        uint32_t wy = std::min(y1, (sy + 1) * dst_h) - std::max(y0, sy * dst_h);
+                        const uint16_t* row = &src[sy * src_w];
+                        for (int sx = x0 / dst_w; sx * dst_w < x1; sx++)
+                        {
+                            uint16_t c = row[sx];
+                            if (c == transparent)
+                                continue;
+                            uint32_t w = wy * (std::min(x1, (sx + 1) * dst_w) - std::max(x0, sx * dst_w));
+                            r += (c >> 11) * w;
+                            g += ((c >> 5) & 0x3F) * w;
+                            b += (c & 0x1F) * w;
+                            opaque += w;
+                        }
+                    }
+                    // Mostly transparent area stays transparent, the rest averages opaque pixels only
+                    if (opaque * 2 < total)
+                    {
+                        dst[dy * dst_w + dx] = transparent;
+                        continue;
+                    }
+                    r = (r + opaque / 2) / opaque;
+                    g = (g + opaque / 2) / opaque;
+                    b = (b + opaque / 2) / opaque;
+                    uint16_t c = (r << 11) | (g << 5) | b;
+                    // Don't let an averaged color turn into the key
+                    if (c == transparent)
+                        c ^= 0x0001;
+                    dst[dy * dst_w + dx] = c;
+                }
+            }
+        }
+
+        const uint16_t* get_small_icon(const uint16_t* icon_big)
+        {
+            if (icon_big == nullptr)
+                return nullptr;
+
+            auto it = _cache.find(icon_big);
+            if (it != _cache.end())
+                return it->second;
+
+            uint16_t* icon_small = _alloc_icon_buffer(ICON_SMALL_SIZE * ICON_SMALL_SIZE * sizeof(uint16_t));
+            if (icon_small == nullptr)
+            {
+                ESP_LOGE(TAG, "Failed to allocate small icon buffer");
+                // Remember the failure, callers fall back to scaling the big icon
+                _cache[icon_big] = nullptr;
+                return nullptr;
+            }
+            downscale_rgb565(
+                icon_big, ICON_BIG_SIZE, ICON_BIG_SIZE, icon_small, ICON_SMALL_SIZE, ICON_SMALL_SIZE, ICON_TRANSPARENT);
+            _cache[icon_big] = icon_small;
+            ESP_LOGD(TAG, "Cached small icon for %p (%u icons)", icon_big, (unsigned)_cache.size());
+            return icon_small;
+        }
+    } // namespace ICON_CACHE
+} // namespace UTILS
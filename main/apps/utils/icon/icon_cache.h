@@ -0,0 +1,47 @@
+/**
+ * @file icon_cache.h
+ * @brief Cache of pre-scaled app icons for the launcher menu
+ * @version 0.1
+ * @date 2025-12-04
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <stdint.h>
+
+#define ICON_BIG_SIZE 56
+#define ICON_SMALL_SIZE 40
+#define ICON_TRANSPARENT (uint16_t)(0x3ce7)
+
+namespace UTILS
+{
+    namespace ICON_CACHE
+    {
+        /**
+         * @brief Get a 40x40 copy of a 56x56 RGB565 icon, downsampled once with an area-average filter
+         * Icons sharing the same source image share one cached buffer. Buffers live in internal RAM while
+         * there is enough of it (icons are blitted every menu frame), otherwise in PSRAM when available.
+         *
+         * @param icon_big Source icon in AppIcon_t::iconBig format, keyed with ICON_TRANSPARENT
+         * @return const uint16_t* Cached small icon, or nullptr if no memory could be allocated for it
+         */
+        const uint16_t* get_small_icon(const uint16_t* icon_big);
+
+        /**
+         * @brief Downsample an RGB565 image with an area-average (box) filter, keeping the transparent key
+         * Pixels equal to the key are left out of the average, output pixels less than half covered by
+         * opaque pixels become the key.
+         *
+         * @param src Source pixels
+         * @param src_w Source width
+         * @param src_h Source height
+         * @param dst Destination pixels
+         * @param dst_w Destination width, not bigger than src_w
+         * @param dst_h Destination height, not bigger than src_h
+         * @param transparent Raw transparent key
+         */
+        void downscale_rgb565(
+            const uint16_t* src, int src_w, int src_h, uint16_t* dst, int dst_w, int dst_h, uint16_t transparent);
+    } // namespace ICON_CACHE
+} // namespace UTILS
@@ -0,0 +1,192 @@
+/**
+ * @file image_cache.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-06
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "image_cache.h"
+#include <iterator>
+
+namespace UTILS
+{
+    namespace IMAGE_SERVICE
+    {
+        ImageCache::ImageCache(alloc_fn_t alloc, free_fn_t free, size_t internal_budget, size_t psram_budget)
+            : _alloc(alloc), _free(free), _internal_budget(internal_budget), _psram_budget(psram_budget)
+        {
+        }
+
+        ImageCache::~ImageCache()
+        {
+            for (auto e : _entries)
+            {
+                _free_buffer(e);
+                delete e;
+            }
+        }
+
+        Entry_t* ImageCache::_find(const char* key, int32_t w, int32_t h)
+        {
+            for (auto e : _entries)
+            {
+                if (!e->dropped && e->w == w && e->h == h && e->key == key)
+                    return e;
+            }
+            return nullptr;
+        }
+
+        void ImageCache::_free_buffer(Entry_t* e)
+        {
+            if (e->buffer == nullptr)
+                return;
+            _free(e->buffer);
+            e->buffer = nullptr;
+            if (e->in_psram)
+                _used_psram -= e->size;
+            else
+                _used_internal -= e->size;
+        }
+
+        // Free the least recently used decoded image in the given pool, pending ones are left alone
+        bool ImageCache::_evict_one(bool psram)
+        {
+            for (auto it = _entries.rbegin(); it != _entries.rend(); ++it)
+            {
+                Entry_t* e = *it;
+                if (e->state == IMAGE_PENDING || e->buffer == nullptr || e->in_psram != psram)
+                    continue;
+                _free_buffer(e);
+                _entries.erase(std::next(it).base());
+                delete e;
+                return true;
+            }
+            return false;
+        }
+
+        bool ImageCache::_alloc_buffer(Entry_t* e)
+        {
+            const bool pools[2] = {true, false};
+            for (bool psram : pools)
+            {
+                const size_t budget = psram ? _psram_budget : _internal_budget;
+                size_t& used = psram ? _used_psram : _used_internal;
+                if (e->size > budget)
+                    continue;
+                while (used + e->size > budget && _evict_one(psram))
+                {
+                }
+                if (used + e->size > budget)
+                    continue;
+                e->buffer = _alloc(e->size, psram);
+                if (e->buffer != nullptr)
+                {
+                    e->in_psram = psram;
+                    used += e->size;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void ImageCache::_drop(Entry_t* e)
+        {
+            if (e->state == IMAGE_PENDING)
+            {
+                // The decoder owns it until done()
+                e->dropped = true;
+                return;
+            }
+            _free_buffer(e);
+            _entries.remove(e);
+            delete e;
+        }
+
+        Entry_t* ImageCache::add(const char* key, const uint8_t* data, size_t len, int32_t w, int32_t h, bool& found)
+        {
+            found = false;
+            if (key == nullptr || w <= 0 || h <= 0)
+                return nullptr;
+
+            Entry_t* e = _find(key, w, h);
+            if (e != nullptr && e->state != IMAGE_FAILED)
+            {
+                found = true;
+                return nullptr;
+            }
+            // A file may be there by now, e.g. the card was put back
+            if (e != nullptr)
+                _drop(e);
+
+            e = new Entry_t;
+            e->key = key;
+            e->w = w;
+            e->h = h;
+            e->data = data;
+            e->len = len;
+            e->size = (size_t)w * h * sizeof(uint16_t);
+            if (!_alloc_buffer(e))
+            {
+                delete e;
+                return nullptr;
+            }
+            _entries.push_front(e);
+            return e;
+        }
+
+        void ImageCache::cancel(Entry_t* e)
+        {
+            _free_buffer(e);
+            _entries.remove(e);
+            delete e;
+        }
+
+        void ImageCache::done(Entry_t* e, bool ok)
+        {
+            if (e->dropped)
+            {
+                cancel(e);
+                return;
+            }
+            // Failed ones keep no memory
+            if (!ok)
+                _free_buffer(e);
+            e->state = ok ? IMAGE_READY : IMAGE_FAILED;
+        }
+
+        ImageState_t ImageCache::get_state(const char* key, int32_t w, int32_t h)
+        {
+            Entry_t* e = _find(key, w, h);
+            return e == nullptr ? IMAGE_NONE : e->state;
+        }
+
+        Entry_t* ImageCache::use(const char* key, int32_t w, int32_t h)
+        {
+            Entry_t* e = _find(key, w, h);
+            if (e == nullptr || e->state != IMAGE_READY)
+                return nullptr;
+            _entries.remove(e);
+            _entries.push_front(e);
+            return e;
+        }
+
+        void ImageCache::remove(const char* key, int32_t w, int32_t h)
+        {
+            Entry_t* e = _find(key, w, h);
+            if (e != nullptr)
+                _drop(e);
+        }
+
+        void ImageCache::clear()
+        {
+            auto entries = _entries;
+            for (auto e : entries)
+            {
+                if (!e->dropped)
+                    _drop(e);
+            }
+        }
+    } // namespace IMAGE_SERVICE
+} // namespace UTILS
@@ -0,0 +1,120 @@
+/**
+ * @file image_cache.h
+ * @brief Bookkeeping of decoded images for the image service, LRU order and memory budgets, free of IDF dependencies
+ * @version 0.1
+ * @date 2025-12-06
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <list>
+#include <string>
+
+namespace UTILS
+{
+    namespace IMAGE_SERVICE
+    {
+        enum ImageState_t
+        {
+            IMAGE_NONE = 0, // Not requested or evicted
+            IMAGE_PENDING,  // Waiting for or being decoded by the worker
+            IMAGE_READY,    // Decoded, get() returns the sprite
+            IMAGE_FAILED,   // Could not be opened or decoded, the next request tries again
+        };
+
+        struct Entry_t
+        {
+            std::string key;
+            int32_t w = 0;
+            int32_t h = 0;
+            const uint8_t* data = nullptr; // nullptr for files
+            size_t len = 0;
+            ImageState_t state = IMAGE_PENDING;
+            bool dropped = false;
+            bool in_psram = false;
+            void* buffer = nullptr;
+            size_t size = 0;
+        };
+
+        /**
+         * @brief Decoded RGB565 images keyed by path or name and size, most recently used first
+         * Buffers come from PSRAM first, then internal RAM, each pool within its own budget. Least recently used
+         * decoded images are evicted to make room, pending ones never: the decoder owns them till done().
+         * Not thread safe, the service calls it under its mutex.
+         */
+        class ImageCache
+        {
+        public:
+            using alloc_fn_t = std::function<void*(size_t size, bool psram)>;
+            using free_fn_t = std::function<void(void* buffer)>;
+
+            /**
+             * @param alloc Buffer allocation from a pool, nullptr on failure
+             * @param free Buffer release
+             * @param internal_budget Bytes of decoded images in internal RAM
+             * @param psram_budget Bytes of decoded images in PSRAM, 0 without PSRAM
+             */
+            ImageCache(alloc_fn_t alloc, free_fn_t free, size_t internal_budget, size_t psram_budget);
+            ~ImageCache();
+            ImageCache(const ImageCache&) = delete;
+            ImageCache& operator=(const ImageCache&) = delete;
+
+            /**
+             * @brief Add a request, a failed one is tried again
+             *
+             * @param found Set if the image is already decoded or pending, nothing to decode then
+             * @return Entry_t* New pending entry with its buffer, to be decoded and passed to done(), or nullptr
+             */
+            Entry_t* add(const char* key, const uint8_t* data, size_t len, int32_t w, int32_t h, bool& found);
+
+            /**
+             * @brief Take back an entry from add() that could not be handed to the decoder
+             */
+            void cancel(Entry_t* e);
+
+            /**
+             * @brief Decoding finished, a dropped entry is freed
+             */
+            void done(Entry_t* e, bool ok);
+
+            ImageState_t get_state(const char* key, int32_t w, int32_t h);
+
+            /**
+             * @brief Get a decoded image and mark it as recently used
+             * @return Entry_t* Ready entry, or nullptr
+             */
+            Entry_t* use(const char* key, int32_t w, int32_t h);
+
+            /**
+             * @brief Drop an image, a pending one is dropped once decoded
+             */
+            void remove(const char* key, int32_t w, int32_t h);
+
+            void clear();
+
+            size_t used_internal() const { return _used_internal; }
+            size_t used_psram() const { return _used_psram; }
+            size_t size() const { return _entries.size(); }
+
+        private:
+            alloc_fn_t _alloc;
+            free_fn_t _free;
+            size_t _internal_budget;
+            size_t _psram_budget;
+            size_t _used_internal = 0;
+            size_t _used_psram = 0;
+            // Most recently used first
+            std::list<Entry_t*> _entries;
+
+            Entry_t* _find(const char* key, int32_t w, int32_t h);
+            void _free_buffer(Entry_t* e);
+            bool _evict_one(bool psram);
+            bool _alloc_buffer(Entry_t* e);
+            void _drop(Entry_t* e);
+        };
+    } // namespace IMAGE_SERVICE
+} // namespace UTILS
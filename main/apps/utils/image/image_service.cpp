@@ -0,0 +1,253 @@
+/**
+ * @file image_service.cpp
+ * @brief Implementation of the background image decoding service
+ * @version 0.1
+ * @date 2025-12-06
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "image_service.h"
+#include "apps/utils/common_define.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/event_groups.h>
+#include <string.h>
+
+static const char* TAG = "IMAGE_SERVICE";
+
+#define IMAGE_EVENT_DONE BIT0
+
+namespace UTILS
+{
+    namespace IMAGE_SERVICE
+    {
+        static Config_t _config;
+        static QueueHandle_t _queue = nullptr;
+        static SemaphoreHandle_t _mutex = nullptr;
+        static EventGroupHandle_t _events = nullptr;
+        static ImageCache* _cache = nullptr;
+        // Sprite over the buffer handed out by get()
+        static LGFX_Sprite _view;
+
+        static void* _alloc(size_t size, bool psram)
+        {
+            if (psram && heap_caps_get_total_size(MALLOC_CAP_SPIRAM) == 0)
+                return nullptr;
+            return heap_caps_malloc(size,
+                                    psram ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+        }
+
+        static bool _decode(Entry_t* e)
+        {
+            lgfx::PointerWrapper memory;
+            lgfx::DataWrapperT<FILE> file;
+            lgfx::DataWrapper* data = &memory;
+            if (e->data != nullptr)
+            {
+                memory.set(e->data, e->len);
+            }
+            else
+            {
+                if (!file.open(e->key.c_str()))
+                {
+                    ESP_LOGE(TAG, "Failed to open %s", e->key.c_str());
+                    return false;
+                }
+                data = &file;
+            }
+
+            uint8_t magic[4] = {0};
+            data->read(magic, sizeof(magic));
+            data->seek(0);
+
+            LGFX_Sprite sprite;
+            sprite.setBuffer(e->buffer, e->w, e->h, 16);
+            sprite.fillScreen(_config.background_color);
+            // Fit into the sprite keeping the aspect ratio, centered
+            const auto datum = lgfx::datum_t::middle_center;
+            bool ret = false;
+            if (magic[0] == 0x89 && magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G')
+                ret = sprite.drawPng(data, 0, 0, e->w, e->h, 0, 0, 0.0f, 0.0f, datum);
+            else if (magic[0] == 0xFF && magic[1] == 0xD8)
+                ret = sprite.drawJpg(data, 0, 0, e->w, e->h, 0, 0, 0.0f, 0.0f, datum);
+            else if (magic[0] == 'B' && magic[1] == 'M')
+                ret = sprite.drawBmp(data, 0, 0, e->w, e->h, 0, 0, 0.0f, 0.0f, datum);
+            else if (memcmp(magic, "qoif", 4) == 0)
+                ret = sprite.drawQoi(data, 0, 0, e->w, e->h, 0, 0, 0.0f, 0.0f, datum);
+            else
+                ESP_LOGE(TAG, "Unknown image format: %s", e->key.c_str());
+
+            file.close();
+            return ret;
+        }
+
+        static void _worker_task(void* param)
+        {
+            Entry_t* e = nullptr;
+            while (1)
+            {
+                if (xQueueReceive(_queue, &e, portMAX_DELAY) != pdTRUE)
+                    continue;
+
+                int64_t start = millis();
+                bool ret = _decode(e);
+                ESP_LOGD(TAG, "Decoded %s %ldx%ld in %dms: %d", e->key.c_str(), e->w, e->h, (int)(millis() - start), ret);
+
+                xSemaphoreTake(_mutex, portMAX_DELAY);
+                _cache->done(e, ret);
+                xSemaphoreGive(_mutex);
+                xEventGroupSetBits(_events, IMAGE_EVENT_DONE);
+            }
+        }
+
+        bool init(const Config_t* config)
+        {
+            if (_queue != nullptr)
+                return true;
+            if (config != nullptr)
+                _config = *config;
+
+            _cache = new ImageCache(_alloc, heap_caps_free, _config.internal_budget, _config.psram_budget);
+            _mutex = xSemaphoreCreateMutex();
+            _events = xEventGroupCreate();
+            _queue = xQueueCreate(_config.queue_length, sizeof(Entry_t*));
+            if (_mutex == nullptr || _events == nullptr || _queue == nullptr)
+            {
+                ESP_LOGE(TAG, "Failed to create sync objects");
+                goto error;
+            }
+            if (xTaskCreate(_worker_task, "image_task", _config.task_stack_size, nullptr, _config.task_priority, nullptr) !=
+                pdPASS)
+            {
+                ESP_LOGE(TAG, "Failed to create worker task");
+                goto error;
+            }
+            return true;
+
+        error:
+            if (_queue != nullptr)
+                vQueueDelete(_queue);
+            if (_events != nullptr)
+                vEventGroupDelete(_events);
+            if (_mutex != nullptr)
+                vSemaphoreDelete(_mutex);
+            delete _cache;
+            _queue = nullptr;
+            _events = nullptr;
+            _mutex = nullptr;
+            _cache = nullptr;
+            return false;
+        }
+
+        static bool _request(const char* key, const uint8_t* data, size_t len, int32_t w, int32_t h)
+        {
+            if (key == nullptr || w <= 0 || h <= 0)
+                return false;
+            if (!init())
+                return false;
+
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+            bool found = false;
+            Entry_t* e = _cache->add(key, data, len, w, h, found);
+            if (found)
+            {
+                xSemaphoreGive(_mutex);
+                return true;
+            }
+            if (e == nullptr)
+            {
+                xSemaphoreGive(_mutex);
+                ESP_LOGE(TAG, "No memory for %s %ldx%ld", key, w, h);
+                return false;
+            }
+
+            if (xQueueSend(_queue, &e, 0) != pdTRUE)
+            {
+                _cache->cancel(e);
+                xSemaphoreGive(_mutex);
+                ESP_LOGW(TAG, "Request queue full");
+                return false;
+            }
+            xSemaphoreGive(_mutex);
+            return true;
+        }
+
+        bool request_file(const char* path, int32_t w, int32_t h) { return _request(path, nullptr, 0, w, h); }
+
+        bool request_memory(const char* name, const uint8_t* data, size_t len, int32_t w, int32_t h)
+        {
+            if (data == nullptr || len == 0)
+                return false;
+            return _request(name, data, len, w, h);
+        }
+
+        ImageState_t get_state(const char* key, int32_t w, int32_t h)
+        {
+            if (_mutex == nullptr)
+                return IMAGE_NONE;
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+            ImageState_t state = _cache->get_state(key, w, h);
+            xSemaphoreGive(_mutex);
+            return state;
+        }
+
+        LGFX_Sprite* get(const char* key, int32_t w, int32_t h)
+        {
+            if (_mutex == nullptr)
+                return nullptr;
+            LGFX_Sprite* sprite = nullptr;
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+            Entry_t* e = _cache->use(key, w, h);
+            if (e != nullptr)
+            {
+                _view.setBuffer(e->buffer, e->w, e->h, 16);
+                sprite = &_view;
+            }
+            xSemaphoreGive(_mutex);
+            return sprite;
+        }
+
+        bool wait(const char* key, int32_t w, int32_t h, uint32_t timeout_ms)
+        {
+            if (_events == nullptr)
+                return false;
+            int64_t start = millis();
+            while (1)
+            {
+                // Clear before checking, so a completion in between is not missed
+                xEventGroupClearBits(_events, IMAGE_EVENT_DONE);
+                ImageState_t state = get_state(key, w, h);
+                if (state != IMAGE_PENDING)
+                    return state == IMAGE_READY;
+                uint32_t elapsed = millis() - start;
+                if (elapsed >= timeout_ms)
+                    return false;
+                xEventGroupWaitBits(_events, IMAGE_EVENT_DONE, pdFALSE, pdFALSE, pdMS_TO_TICKS(timeout_ms - elapsed));
+            }
+        }
+
+        void remove(const char* key, int32_t w, int32_t h)
+        {
+            if (_mutex == nullptr)
+                return;
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+            _cache->remove(key, w, h);
+            xSemaphoreGive(_mutex);
+        }
+
+        void clear()
+        {
+            if (_mutex == nullptr)
+                return;
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+            _cache->clear();
+            const size_t used_internal = _cache->used_internal();
+            const size_t used_psram = _cache->used_psram();
+            xSemaphoreGive(_mutex);
+            ESP_LOGI(TAG, "Cleared, internal %u / psram %u bytes in use", (unsigned)used_internal, (unsigned)used_psram);
+        }
+    } // namespace IMAGE_SERVICE
+} // namespace UTILS
@@ -0,0 +1,115 @@
+/**
+ * @file image_service.h
+ * @brief Background image decoding into sprites with an LRU cache of decoded images
+ * Requests and cache lookups are meant to be made from the app (mooncake) task only.
+ * drawPng in M5GFX shares one decoder, avoid calling it from other tasks while a PNG is pending.
+ * @version 0.1
+ * @date 2025-12-06
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+// stdio before M5GFX, so it declares DataWrapperT<FILE>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <M5GFX.h>
+#include "image_cache.h"
+
+namespace UTILS
+{
+    namespace IMAGE_SERVICE
+    {
+        struct Config_t
+        {
+            // Decoded images kept in internal RAM / PSRAM, least recently used ones are evicted beyond this
+            size_t internal_budget = 96 * 1024;
+            size_t psram_budget = 1024 * 1024;
+            uint32_t task_stack_size = 6 * 1024;
+            uint32_t task_priority = 2;
+            uint32_t queue_length = 8;
+            // Letterbox color around images that don't match the requested aspect ratio
+            uint32_t background_color = 0x000000;
+        };
+
+        /**
+         * @brief Start the worker task, called by the first request with the default config if not called before
+         *
+         * @param config Config, nullptr for defaults
+         * @return true if the service is running
+         */
+        bool init(const Config_t* config = nullptr);
+
+        /**
+         * @brief Queue an image file (PNG, JPEG, BMP or QOI) for decoding, fitted into a w x h RGB565 sprite
+         * Does nothing if the same path and size is already cached or pending, a failed one is tried again.
+         *
+         * @param path File path, e.g. "/sdcard/pic.png"
+         * @param w Sprite width
+         * @param h Sprite height
+         * @return false if the request could not be queued or no memory is left within the budget
+         */
+        bool request_file(const char* path, int32_t w, int32_t h);
+
+        /**
+         * @brief Queue an in-memory image (e.g. an embedded file) for decoding
+         * The data must stay valid until the image is decoded.
+         *
+         * @param name Cache key used instead of a path
+         * @param data Encoded image
+         * @param len Encoded image size
+         * @param w Sprite width
+         * @param h Sprite height
+         * @return false if the request could not be queued or no memory is left within the budget
+         */
+        bool request_memory(const char* name, const uint8_t* data, size_t len, int32_t w, int32_t h);
+
+        /**
+         * @brief Get the state of a request
+         *
+         * @param key Path or name given to the request
+         * @param w Sprite width
+         * @param h Sprite height
+         * @return ImageState_t
+         */
+        ImageState_t get_state(const char* key, int32_t w, int32_t h);
+
+        /**
+         * @brief Get a decoded image and mark it as recently used
+         * The sprite stays valid until the next get, request, remove or clear call, so push it right away.
+         *
+         * @param key Path or name given to the request
+         * @param w Sprite width
+         * @param h Sprite height
+         * @return LGFX_Sprite* Decoded image, or nullptr if it is not ready
+         */
+        LGFX_Sprite* get(const char* key, int32_t w, int32_t h);
+
+        /**
+         * @brief Block until a request is decoded or failed
+         *
+         * @param key Path or name given to the request
+         * @param w Sprite width
+         * @param h Sprite height
+         * @param timeout_ms Max time to wait
+         * @return true if the image is ready
+         */
+        bool wait(const char* key, int32_t w, int32_t h, uint32_t timeout_ms);
+
+        /**
+         * @brief Drop an image from the cache, a pending one is dropped once decoded
+         *
+         * @param key Path or name given to the request
+         * @param w Sprite width
+         * @param h Sprite height
+         */
+        void remove(const char* key, int32_t w, int32_t h);
+
+        /**
+         * @brief Drop every cached image
+         *
+         */
+        void clear();
+    } // namespace IMAGE_SERVICE
+} // namespace UTILS
@@ -0,0 +1,118 @@
+/**
+ * @file png_writer.cpp
+ * @brief Implementation of the streaming PNG writer
+ * @version 0.1
+ * @date 2025-12-07
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "png_writer.h"
+#include "lgfx/utility/lgfx_miniz.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "PNG_WRITER";
+
+// Rows read from the screen per readRectRGB call
+#define PNG_WRITER_CHUNK_ROWS 15
+
+namespace UTILS
+{
+    namespace SCREENSHOT_TOOLS
+    {
+        static void _put_be32(uint8_t* p, uint32_t v)
+        {
+            p[0] = v >> 24;
+            p[1] = v >> 16;
+            p[2] = v >> 8;
+            p[3] = v;
+        }
+
+        static bool _write_chunk(FILE* file, const char* type, const uint8_t* data, size_t len)
+        {
+            uint8_t head[8];
+            uint8_t tail[4];
+            _put_be32(head, len);
+            memcpy(&head[4], type, 4);
+            uint32_t crc = lgfx_mz_crc32(MZ_CRC32_INIT, &head[4], 4);
+            if (len)
+                crc = lgfx_mz_crc32(crc, data, len);
+            _put_be32(tail, crc);
+            return fwrite(head, 1, 8, file) == 8 && (len == 0 || fwrite(data, 1, len, file) == len) &&
+                   fwrite(tail, 1, 4, file) == 4;
+        }
+
+        // tdefl output callback, every flushed block becomes its own IDAT chunk
+        static lgfx_mz_bool _put_idat(const void* buf, int len, void* user)
+        {
+            return _write_chunk((FILE*)user, "IDAT", (const uint8_t*)buf, len) ? MZ_TRUE : MZ_FALSE;
+        }
+
+        bool write_png(lgfx::LGFXBase* gfx, FILE* file, int32_t x, int32_t y, int32_t w, int32_t h, int level)
+        {
+            // Same probe counts as tdefl_write_image_to_png_file_in_memory_ex
+            static const uint16_t num_probes[11] = {0, 1, 6, 32, 16, 32, 128, 256, 512, 768, 1500};
+            if (w <= 0 || h <= 0)
+                return false;
+            level = level < 1 ? 1 : (level > 10 ? 10 : level);
+
+            const size_t stride = w * 3;
+            tdefl_compressor* comp = (tdefl_compressor*)malloc(sizeof(tdefl_compressor));
+            uint8_t* rgb = (uint8_t*)malloc(stride * PNG_WRITER_CHUNK_ROWS);
+            bool success = false;
+            if (!comp || !rgb)
+            {
+                ESP_LOGE(TAG,
+                         "Failed to allocate buffers (%u bytes)",
+                         (unsigned)(sizeof(tdefl_compressor) + stride * PNG_WRITER_CHUNK_ROWS));
+                goto cleanup;
+            }
+
+            {
+                static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a};
+                uint8_t ihdr[13] = {0};
+                _put_be32(&ihdr[0], w);
+                _put_be32(&ihdr[4], h);
+                ihdr[8] = 8; // Bit depth
+                ihdr[9] = 2; // Truecolor
+                if (fwrite(signature, 1, 8, file) != 8 || !_write_chunk(file, "IHDR", ihdr, sizeof(ihdr)))
+                {
+                    ESP_LOGE(TAG, "Failed to write header");
+                    goto cleanup;
+                }
+            }
+
+            tdefl_init(comp, _put_idat, file, num_probes[level] | TDEFL_WRITE_ZLIB_HEADER);
+            for (int32_t chunk_y = 0; chunk_y < h; chunk_y += PNG_WRITER_CHUNK_ROWS)
+            {
+                int32_t rows = (h - chunk_y < PNG_WRITER_CHUNK_ROWS) ? h - chunk_y : PNG_WRITER_CHUNK_ROWS;
+                gfx->readRectRGB(x, y + chunk_y, w, rows, rgb);
+                for (int32_t r = 0; r < rows; r++)
+                {
+                    // Filter type None, flat UI colors compress better unfiltered than with Sub/Up
+                    static const uint8_t filter = 0;
+                    if (tdefl_compress_buffer(comp, &filter, 1, TDEFL_NO_FLUSH) != TDEFL_STATUS_OKAY ||
+                        tdefl_compress_buffer(comp, &rgb[r * stride], stride, TDEFL_NO_FLUSH) != TDEFL_STATUS_OKAY)
+                    {
+                        ESP_LOGE(TAG, "Failed to write image data");
+                        goto cleanup;
+                    }
+                }
+            }
+            if (tdefl_compress_buffer(comp, nullptr, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE ||
+                !_write_chunk(file, "IEND", nullptr, 0))
+            {
+                ESP_LOGE(TAG, "Failed to finish image");
+                goto cleanup;
+            }
+            success = true;
+
+        cleanup:
+            free(rgb);
+            free(comp);
+            return success;
+        }
+    } // namespace SCREENSHOT_TOOLS
+} // namespace UTILS
@@ -0,0 +1,37 @@
+/**
+ * @file png_writer.h
+ * @brief Streaming PNG writer, deflates rows as they are read from the screen
+ * @version 0.1
+ * @date 2025-12-07
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+// stdio before M5GFX, like the rest of the file based helpers
+#include <stdio.h>
+#include <stdint.h>
+#include <M5GFX.h>
+
+namespace UTILS
+{
+    namespace SCREENSHOT_TOOLS
+    {
+        /**
+         * @brief Write a region of a display or sprite to a PNG file (24-bit RGB)
+         * Rows are read a few at a time with readRectRGB and deflated straight into IDAT chunks,
+         * so memory use does not depend on the image size. Only uses M5GFX and stdio, so it works on any
+         * M5GFX platform (device, SDL).
+         *
+         * @param gfx Display or sprite to read from
+         * @param file File opened for writing in binary mode
+         * @param x Region left
+         * @param y Region top
+         * @param w Region width
+         * @param h Region height
+         * @param level Compression level 1 (fastest) - 10 (smallest)
+         * @return true if the whole image was written
+         */
+        bool write_png(lgfx::LGFXBase* gfx, FILE* file, int32_t x, int32_t y, int32_t w, int32_t h, int level);
+    } // namespace SCREENSHOT_TOOLS
+} // namespace UTILS
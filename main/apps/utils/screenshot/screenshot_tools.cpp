@@ -8,6 +8,7 @@
  *
  */
 #include "screenshot_tools.h"
+#include "png_writer.h"
 #include "hal/hal.h"
 #include "hal/keyboard/keyboard.h"
 #include "apps/utils/common_define.h"
@@ -26,67 +27,14 @@ namespace UTILS
 {
     namespace SCREENSHOT_TOOLS
     {
-        bool take_screenshot(HAL::Hal* hal)
+        // Uncompressed 24-bit BMP, bottom-up rows
+        static bool _write_bmp(HAL::Hal* hal, FILE* file, int32_t width, int32_t height)
         {
-            ESP_LOGI(TAG, "Taking screenshot...");
-            bool sdcard_mounted = hal->sdcard()->is_mounted();
-
-            // Mount SD card
-            if (!sdcard_mounted)
-            {
-                if (!hal->sdcard()->mount(false))
-                {
-                    ESP_LOGE(TAG, "Failed to mount SD card for screenshot");
-                    return false;
-                }
-            }
-
-            // Create screenshots directory if it doesn't exist
-            const char* parent_dir = "/sdcard/m5apps";
-            const char* screenshots_dir = "/sdcard/m5apps/screenshots";
-            struct stat st;
-
-            // Create parent directory if it doesn't exist
-            if (stat(parent_dir, &st) != 0)
-            {
-                if (mkdir(parent_dir, 0777) != 0 && errno != EEXIST)
-                {
-                    ESP_LOGE(TAG, "Failed to create parent directory");
-                    return false;
-                }
-            }
-
-            // Create screenshots directory if it doesn't exist
-            if (stat(screenshots_dir, &st) != 0)
-            {
-                if (mkdir(screenshots_dir, 0777) != 0 && errno != EEXIST)
-                {
-                    ESP_LOGE(TAG, "Failed to create screenshots directory");
-                    return false;
-                }
-            }
-
-            // Get display dimensions
-            int32_t width = hal->display()->width();
-            int32_t height = hal->display()->height();
-
-            // Generate filename with timestamp
-            uint32_t timestamp = millis();
-            std::string filename = std::format("/sdcard/m5apps/screenshots/m5apps_{:08x}.bmp", timestamp);
-
             // Calculate row size (must be multiple of 4 bytes)
             uint32_t row_size = ((width * 3 + 3) / 4) * 4;
             uint32_t image_size = row_size * height;
             uint32_t file_size = 54 + image_size;
 
-            // Open file for writing
-            FILE* file = fopen(filename.c_str(), "wb");
-            if (!file)
-            {
-                ESP_LOGE(TAG, "Failed to open file for writing: %s", filename.c_str());
-                return false;
-            }
-
             // BMP file header (14 bytes)
             uint8_t bmp_header[14] = {
                 'B',
@@ -134,7 +82,6 @@ namespace UTILS
             if (fwrite(bmp_header, 1, 14, file) != 14 || fwrite(dib_header, 1, 40, file) != 40)
             {
                 ESP_LOGE(TAG, "Failed to write BMP headers");
-                fclose(file);
                 return false;
             }
 
@@ -153,7 +100,6 @@ namespace UTILS
                     free(rgb_chunk_buffer);
                 if (bmp_row_buffer)
                     free(bmp_row_buffer);
-                fclose(file);
                 return false;
             }
 
@@ -206,14 +152,81 @@ namespace UTILS
                     break;
             }
 
-            // Cleanup
             free(bmp_row_buffer);
             free(rgb_chunk_buffer);
-            fclose(file);
+            return success;
+        }
+
+        bool take_screenshot(HAL::Hal* hal)
+        {
+            ESP_LOGI(TAG, "Taking screenshot...");
+            bool sdcard_mounted = hal->sdcard()->is_mounted();
+
+            // Mount SD card
+            if (!sdcard_mounted)
+            {
+                if (!hal->sdcard()->mount(false))
+                {
+                    ESP_LOGE(TAG, "Failed to mount SD card for screenshot");
+                    return false;
+                }
+            }
+
+            // Create screenshots directory if it doesn't exist
+            const char* parent_dir = "/sdcard/m5apps";
+            const char* screenshots_dir = "/sdcard/m5apps/screenshots";
+            struct stat st;
+
+            // Create parent directory if it doesn't exist
+            if (stat(parent_dir, &st) != 0)
+            {
+                if (mkdir(parent_dir, 0777) != 0 && errno != EEXIST)
+                {
+                    ESP_LOGE(TAG, "Failed to create parent directory");
+                    return false;
+                }
+            }
+
+            // Create screenshots directory if it doesn't exist
+            if (stat(screenshots_dir, &st) != 0)
+            {
+                if (mkdir(screenshots_dir, 0777) != 0 && errno != EEXIST)
+                {
+                    ESP_LOGE(TAG, "Failed to create screenshots directory");
+                    return false;
+                }
+            }
+
+            // Get display dimensions
+            int32_t width = hal->display()->width();
+            int32_t height = hal->display()->height();
+
+            // Compression level 0 keeps the old uncompressed BMP format
+            int level = hal->settings()->getNumber(SETTINGS::SYSTEM_SHOT_LEVEL);
+
+            // Generate filename with timestamp
+            uint32_t timestamp = millis();
+            std::string filename =
+                std::format("/sdcard/m5apps/screenshots/m5apps_{:08x}.{}", timestamp, level > 0 ? "png" : "bmp");
+
+            // Open file for writing
+            FILE* file = fopen(filename.c_str(), "wb");
+            if (!file)
+            {
+                ESP_LOGE(TAG, "Failed to open file for writing: %s", filename.c_str());
+                return false;
+            }
+
+            uint32_t start_time = millis();
+            MC_TRACE_ZONE("screenshot_write");
+            bool success = level > 0 ? write_png(hal->display(), file, 0, 0, width, height, level)
+                                     : _write_bmp(hal, file, width, height);
+            if (fclose(file) != 0)
+                success = false;
 
             if (success)
             {
-                ESP_LOGI(TAG, "Screenshot saved: %s", filename.c_str());
+                ESP_LOGI(TAG, "Screenshot saved: %s in %ldms", filename.c_str(), (int32_t)(millis() - start_time));
             }
             else
             {
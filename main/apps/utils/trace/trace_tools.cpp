@@ -0,0 +1,134 @@
+/**
+ * @file trace_tools.cpp
+ * @brief Saving the performance trace to SD card
+ * @version 0.1
+ * @date 2025-12-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "trace_tools.h"
+#include "trace/trace.h"
+#include "hal/keyboard/keyboard.h"
+#include "apps/utils/common_define.h"
+#include "apps/utils/theme/theme_define.h"
+#include "esp_log.h"
+#include <format>
+#include <sys/stat.h>
+#include <errno.h>
+
+static const char* TAG = "TRACE_TOOLS";
+
+namespace UTILS
+{
+    namespace TRACE_TOOLS
+    {
+        static bool _make_dir(const char* path)
+        {
+            struct stat st;
+            if (stat(path, &st) != 0 && mkdir(path, 0777) != 0 && errno != EEXIST)
+            {
+                ESP_LOGE(TAG, "Failed to create directory %s", path);
+                return false;
+            }
+            return true;
+        }
+
+        bool save_trace(HAL::Hal* hal)
+        {
+            ESP_LOGI(TAG, "Saving trace, %d events", (int)MOONCAKE::Trace::getEventNum());
+            bool sdcard_mounted = hal->sdcard()->is_mounted();
+
+            // Mount SD card
+            if (!sdcard_mounted)
+            {
+                if (!hal->sdcard()->mount(false))
+                {
+                    ESP_LOGE(TAG, "Failed to mount SD card for trace");
+                    return false;
+                }
+            }
+
+            bool success = false;
+            if (_make_dir("/sdcard/m5apps") && _make_dir("/sdcard/m5apps/traces"))
+            {
+                std::string filename = std::format("/sdcard/m5apps/traces/m5apps_{:08x}.json", millis());
+                FILE* file = fopen(filename.c_str(), "w");
+                if (file)
+                {
+                    uint32_t start_time = millis();
+                    success = MOONCAKE::Trace::exportChromeJson(file);
+                    if (fclose(file) != 0)
+                        success = false;
+
+                    if (success)
+                    {
+                        ESP_LOGI(TAG, "Trace saved: %s in %ldms", filename.c_str(), (int32_t)(millis() - start_time));
+                    }
+                    else
+                    {
+                        ESP_LOGE(TAG, "Trace failed, removing incomplete file");
+                        remove(filename.c_str());
+                    }
+                }
+                else
+                {
+                    ESP_LOGE(TAG, "Failed to open file for writing: %s", filename.c_str());
+                }
+            }
+
+            // Unmount SD card
+            if (!sdcard_mounted)
+            {
+                hal->sdcard()->eject();
+            }
+
+            return success;
+        }
+
+        bool check_and_handle_trace(HAL::Hal* hal, bool* system_bar_force_update_flag)
+        {
+            // Only when something was recorded
+            if (MOONCAKE::Trace::getEventNum() == 0)
+            {
+                return false;
+            }
+            // Check for trace key combination: CTRL + T
+            if (!hal->keyboard()->keysState().ctrl || !hal->keyboard()->isKeyPressing(KEY_NUM_T))
+            {
+                return false;
+            }
+
+            hal->playKeyboardSound();
+            hal->keyboard()->waitForRelease(KEY_NUM_T);
+            bool success = save_trace(hal);
+            // show status
+            auto c = hal->canvas_system_bar();
+            int margin_x = 5;
+            int margin_y = 4;
+
+            c->fillScreen(THEME_COLOR_BG);
+            c->fillSmoothRoundRect(margin_x,
+                                   margin_y,
+                                   c->width() - margin_x * 2,
+                                   c->height() - margin_y * 2,
+                                   (c->height() - margin_y * 2) / 2,
+                                   success ? TFT_GREENYELLOW : TFT_RED);
+            c->setTextColor(success ? TFT_BLACK : TFT_WHITE);
+            c->setFont(FONT_16);
+            c->drawCenterString(success ? "Trace saved" : "Trace failed", c->width() / 2, (c->height() - 16) / 2 - 1);
+            hal->canvas_system_bar_update();
+            if (!success)
+            {
+                hal->playErrorSound();
+            }
+            delay(1000);
+            if (system_bar_force_update_flag)
+            {
+                *system_bar_force_update_flag = true;
+            }
+            return true;
+        }
+
+    } // namespace TRACE_TOOLS
+} // namespace UTILS
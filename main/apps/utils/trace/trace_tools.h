@@ -0,0 +1,36 @@
+/**
+ * @file trace_tools.h
+ * @brief Saving the performance trace to SD card
+ * @version 0.1
+ * @date 2025-12-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include "hal/hal.h"
+
+namespace UTILS
+{
+    namespace TRACE_TOOLS
+    {
+        /**
+         * @brief Save recorded trace events to SD card as Chrome trace JSON
+         *
+         * @param hal Pointer to HAL instance
+         * @return true if trace was saved successfully, false otherwise
+         */
+        bool save_trace(HAL::Hal* hal);
+
+        /**
+         * @brief Check for trace key combination (CTRL + T) and handle it
+         *
+         * @param hal Pointer to HAL instance
+         * @param system_bar_force_update_flag Pointer to flag that forces system bar update
+         * @return true if saving was attempted, false otherwise
+         */
+        bool check_and_handle_trace(HAL::Hal* hal, bool* system_bar_force_update_flag);
+
+    } // namespace TRACE_TOOLS
+} // namespace UTILS
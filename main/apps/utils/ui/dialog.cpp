@@ -37,7 +37,7 @@ namespace UTILS
         {
             ESP_LOGW(TAG, "show_dialog: title=%s, message=%s", title.c_str(), message.c_str());
             // set brightness to settings value
-            int brightness = hal->settings()->getNumber("system", "brightness");
+            int brightness = hal->settings()->getNumber(SETTINGS::SYSTEM_BRIGHTNESS);
             hal->display()->setBrightness(brightness == 0 ? 100 : brightness);
             // set font
             hal->canvas()->setFont(FONT_16);
@@ -539,7 +539,7 @@ namespace UTILS
                 hal->keyboard()->updateKeysState();
                 // Screenshot support
                 UTILS::SCREENSHOT_TOOLS::check_and_handle_screenshot(hal, nullptr);
-                auto keys_state = hal->keyboard()->keysState();
+                const auto& keys_state = hal->keyboard()->keysState();
                 // Draw controls hint
                 // hal->canvas()->drawCenterString(keys_state.fn ? "[DEL]" : "[UP] [DOWN] [LEFT] [RIGHT] [DEL] [ENTER]",
                 //                                 box_x + box_w / 2,
@@ -847,7 +847,7 @@ namespace UTILS
                 hal->keyboard()->updateKeysState();
                 // Screenshot support
                 UTILS::SCREENSHOT_TOOLS::check_and_handle_screenshot(hal, nullptr);
-                auto keys_state = hal->keyboard()->keysState();
+                const auto& keys_state = hal->keyboard()->keysState();
 
                 // Draw keyboard mode indicator
                 hal->canvas()->setFont(FONT_10);
@@ -1039,7 +1039,7 @@ namespace UTILS
             }
 
             // wake up screen
-            int brightness = hal->settings()->getNumber("system", "brightness");
+            int brightness = hal->settings()->getNumber(SETTINGS::SYSTEM_BRIGHTNESS);
             hal->display()->setBrightness(brightness == 0 ? 100 : brightness);
 
             int selected_index = default_index >= 0 && default_index < items.size() ? default_index : 0;
@@ -8,6 +8,7 @@
 #include "../anim/hl_text.h"
 #include "dialog.h"
 #include "../common_define.h"
+#include "trace/trace.h"
 
 static const char* TAG = "SETTINGS_SCREEN";
 static const char* HINT_ITEMS = "[UP][DOWN] [LEFT][RIGHT] [ESC] [ENTER]";
@@ -761,11 +762,12 @@ namespace UTILS
                     // if namespace == wifi - reinit wifi
                     if (group.nvs_namespace == "wifi")
                     {
+                        hal->waitInit();
                         hal->wifi()->deinit();
                         delay(100);
                         if (hal->wifi()->init())
                         {
-                            if (hal->settings()->getBool("wifi", "enabled"))
+                            if (hal->settings()->getBool(SETTINGS::WIFI_ENABLED))
                             {
                                 hal->wifi()->connect();
                             }
@@ -790,7 +792,7 @@ namespace UTILS
                             if (item.value == "true")
                             {
                                 // Start WiFi status LED
-                                if (hal->settings()->getBool("wifi", "enabled"))
+                                if (hal->settings()->getBool(SETTINGS::WIFI_ENABLED))
                                 {
                                     hal->wifi()->update_status();
                                 }
@@ -805,6 +807,18 @@ namespace UTILS
                                 hal->led()->off();
                             }
                         }
+                        else if (item.key == "perf_trace")
+                        {
+                            // Buffers stay allocated till restart, other tasks may still be writing
+                            if (item.value == "true")
+                            {
+                                MOONCAKE::Trace::start();
+                            }
+                            else
+                            {
+                                MOONCAKE::Trace::stop();
+                            }
+                        }
                     }
                 }
             }
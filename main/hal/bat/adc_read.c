@@ -1,202 +0,0 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "soc/soc_caps.h"
-#include "esp_log.h"
-#include "esp_adc/adc_oneshot.h"
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
-
-const static char* TAG = "ADC";
-
-/*---------------------------------------------------------------
-        ADC General Macros
----------------------------------------------------------------*/
-// ADC1 Channels
-#if CONFIG_IDF_TARGET_ESP32
-#define EXAMPLE_ADC1_CHAN0 ADC_CHANNEL_4
-#define EXAMPLE_ADC1_CHAN1 ADC_CHANNEL_5
-#else
-#define EXAMPLE_ADC1_CHAN0 ADC_CHANNEL_9
-#define EXAMPLE_ADC1_CHAN1 ADC_CHANNEL_3
-#endif
-
-#if (SOC_ADC_PERIPH_NUM >= 2) && !CONFIG_IDF_TARGET_ESP32C3
-/**
- * On ESP32C3, ADC2 is no longer supported, due to its HW limitation.
- * Search for errata on espressif website for more details.
- */
-#define EXAMPLE_USE_ADC2 1
-#endif
-
-#if EXAMPLE_USE_ADC2
-// ADC2 Channels
-#if CONFIG_IDF_TARGET_ESP32
-#define EXAMPLE_ADC2_CHAN0 ADC_CHANNEL_0
-#else
-#define EXAMPLE_ADC2_CHAN0 ADC_CHANNEL_0
-#endif
-#endif // #if EXAMPLE_USE_ADC2
-
-#define EXAMPLE_ADC_ATTEN ADC_ATTEN_DB_12
-
-static adc_oneshot_unit_handle_t adc1_handle;
-static int adc_raw;
-static int voltage;
-static bool do_calibration1_chan0 = false;
-static adc_cali_handle_t adc1_cali_chan0_handle = NULL;
-static bool
-example_adc_calibration_init(adc_unit_t unit, adc_channel_t channel, adc_atten_t atten, adc_cali_handle_t* out_handle);
-static void example_adc_calibration_deinit(adc_cali_handle_t handle);
-
-/*---------------------------------------------------------------
-        ADC Calibration
----------------------------------------------------------------*/
-static bool
-example_adc_calibration_init(adc_unit_t unit, adc_channel_t channel, adc_atten_t atten, adc_cali_handle_t* out_handle)
-{
-    adc_cali_handle_t handle = NULL;
-    esp_err_t ret = ESP_FAIL;
-    bool calibrated = false;
-
-#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
-    if (!calibrated)
-    {
-        ESP_LOGD(TAG, "calibration scheme version is %s", "Curve Fitting");
-        adc_cali_curve_fitting_config_t cali_config = {
-            .unit_id = unit,
-            .chan = channel,
-            .atten = atten,
-            .bitwidth = ADC_BITWIDTH_DEFAULT,
-        };
-        ret = adc_cali_create_scheme_curve_fitting(&cali_config, &handle);
-        if (ret == ESP_OK)
-        {
-            calibrated = true;
-        }
-    }
-#endif
-
-#if ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
-    if (!calibrated)
-    {
-        ESP_LOGD(TAG, "calibration scheme version is %s", "Line Fitting");
-        adc_cali_line_fitting_config_t cali_config = {
-            .unit_id = unit,
-            .atten = atten,
-            .bitwidth = ADC_BITWIDTH_DEFAULT,
-        };
-        ret = adc_cali_create_scheme_line_fitting(&cali_config, &handle);
-        if (ret == ESP_OK)
-        {
-            calibrated = true;
-        }
-    }
-#endif
-
-    *out_handle = handle;
-    if (ret == ESP_OK)
-    {
-        ESP_LOGD(TAG, "Calibration Success");
-    }
-    else if (ret == ESP_ERR_NOT_SUPPORTED || !calibrated)
-    {
-        ESP_LOGW(TAG, "eFuse not burnt, skip software calibration");
-    }
-    else
-    {
-        ESP_LOGE(TAG, "Invalid arg or no memory");
-    }
-
-    return calibrated;
-}
-
-static void example_adc_calibration_deinit(adc_cali_handle_t handle)
-{
-#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
-    ESP_LOGD(TAG, "deregister %s calibration scheme", "Curve Fitting");
-    ESP_ERROR_CHECK(adc_cali_delete_scheme_curve_fitting(handle));
-
-#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
-    ESP_LOGD(TAG, "deregister %s calibration scheme", "Line Fitting");
-    ESP_ERROR_CHECK(adc_cali_delete_scheme_line_fitting(handle));
-#endif
-}
-
-void adc_read_init(void)
-{
-    esp_err_t ret;
-    //-------------ADC1 Init---------------//
-    adc_oneshot_unit_init_cfg_t init_config1 = {
-        .unit_id = ADC_UNIT_1,
-    };
-
-    ret = adc_oneshot_new_unit(&init_config1, &adc1_handle);
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "adc_oneshot_new_unit failed, ret: %d", ret);
-        return;
-    }
-
-    //-------------ADC1 Config---------------//
-    adc_oneshot_chan_cfg_t config = {
-        .atten = EXAMPLE_ADC_ATTEN,
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-    };
-    ret = adc_oneshot_config_channel(adc1_handle, EXAMPLE_ADC1_CHAN0, &config);
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "adc_oneshot_config_channel failed, ret: %d", ret);
-        return;
-    }
-
-    //-------------ADC1 Calibration Init---------------//
-    do_calibration1_chan0 =
-        example_adc_calibration_init(ADC_UNIT_1, EXAMPLE_ADC1_CHAN0, EXAMPLE_ADC_ATTEN, &adc1_cali_chan0_handle);
-}
-
-void adc_read_deinit(void)
-{
-    esp_err_t ret;
-    ret = adc_oneshot_del_unit(adc1_handle);
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "adc_oneshot_del_unit failed, ret: %d", ret);
-    }
-    if (do_calibration1_chan0)
-    {
-        example_adc_calibration_deinit(adc1_cali_chan0_handle);
-    }
-}
-
-uint32_t adc_read_get_value()
-{
-    esp_err_t ret;
-    ret = adc_oneshot_read(adc1_handle, EXAMPLE_ADC1_CHAN0, &adc_raw);
-    if (ret != ESP_OK)
-    {
-        ESP_LOGE(TAG, "adc_oneshot_read failed, ret: %d", ret);
-    }
-    else
-    {
-        ESP_LOGD(TAG, "ADC%d Channel[%d] Raw Data: %d", ADC_UNIT_1 + 1, EXAMPLE_ADC1_CHAN0, adc_raw);
-
-        if (do_calibration1_chan0)
-        {
-            ret = adc_cali_raw_to_voltage(adc1_cali_chan0_handle, adc_raw, &voltage);
-            if (ret != ESP_OK)
-            {
-                ESP_LOGE(TAG, "adc_cali_raw_to_voltage failed CH0, ret: %d", ret);
-            }
-            else
-            {
-                ESP_LOGD(TAG, "ADC%d Channel[%d] Cali Voltage: %d mV", ADC_UNIT_1 + 1, EXAMPLE_ADC1_CHAN0, voltage);
-            }
-        }
-    }
-
-    // return last value
-    return voltage;
-}
@@ -0,0 +1,205 @@
+/**
+ * @file battery.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "battery.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <vector>
+#include <algorithm>
+
+static const char* TAG = "BATTERY";
+
+// Longest wait for a frame of conversions
+#define BATTERY_READ_TIMEOUT_MS 500
+
+namespace HAL
+{
+    bool Battery::begin()
+    {
+        if (_task_running)
+        {
+            return true;
+        }
+
+        const uint32_t frame_size = _cfg.conversions_per_reading * SOC_ADC_DIGI_RESULT_BYTES;
+        adc_continuous_handle_cfg_t handle_cfg = {
+            .max_store_buf_size = frame_size * 2,
+            .conv_frame_size = frame_size,
+        };
+        esp_err_t err = adc_continuous_new_handle(&handle_cfg, &_adc);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to create ADC: %s", esp_err_to_name(err));
+            return false;
+        }
+
+        adc_digi_pattern_config_t pattern = {
+            .atten = ADC_ATTEN_DB_12,
+            .channel = (uint8_t)_cfg.channel,
+            .unit = ADC_UNIT_1,
+            .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+        adc_continuous_config_t adc_cfg = {
+            .pattern_num = 1,
+            .adc_pattern = &pattern,
+            .sample_freq_hz = _cfg.sample_freq_hz,
+            .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+            .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+        };
+        err = adc_continuous_config(_adc, &adc_cfg);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to configure ADC: %s", esp_err_to_name(err));
+            adc_continuous_deinit(_adc);
+            _adc = nullptr;
+            return false;
+        }
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+        adc_cali_curve_fitting_config_t cali_cfg = {
+            .unit_id = ADC_UNIT_1,
+            .chan = _cfg.channel,
+            .atten = ADC_ATTEN_DB_12,
+            .bitwidth = (adc_bitwidth_t)SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+        if (adc_cali_create_scheme_curve_fitting(&cali_cfg, &_cali) != ESP_OK)
+        {
+            _cali = nullptr;
+        }
+#endif
+        if (_cali == nullptr)
+        {
+            ESP_LOGW(TAG, "eFuse not burnt, skip software calibration");
+        }
+
+        err = adc_continuous_start(_adc);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to start ADC: %s", esp_err_to_name(err));
+            end();
+            return false;
+        }
+
+        _task_running = true;
+        if (xTaskCreate(_task, "battery", 3072, this, _cfg.task_priority, &_task_handle) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create task");
+            _task_running = false;
+            end();
+            return false;
+        }
+
+        // First reading is one frame away, have it before anyone asks
+        for (int i = 0; i < BATTERY_READ_TIMEOUT_MS / 10 && _voltage_mv == 0; i++)
+        {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        return true;
+    }
+
+    void Battery::end()
+    {
+        // Wake the task and wait till it's gone
+        if (_task_running)
+        {
+            _task_running = false;
+            xTaskNotifyGive(_task_handle);
+            while (_task_handle != nullptr)
+            {
+                vTaskDelay(1);
+            }
+        }
+
+        if (_adc)
+        {
+            adc_continuous_stop(_adc);
+            adc_continuous_deinit(_adc);
+            _adc = nullptr;
+        }
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+        if (_cali)
+        {
+            adc_cali_delete_scheme_curve_fitting(_cali);
+            _cali = nullptr;
+        }
+#endif
+    }
+
+    uint8_t Battery::levelOf(float voltage) const
+    {
+        const uint32_t drop_mv = (uint32_t)_load_ma * _cfg.model.internal_mohm / 1000;
+        return BatteryModel::soc_of(voltage * 1000 + drop_mv) / 10;
+    }
+
+    bool Battery::_read(uint8_t* buffer, size_t size, std::vector<uint16_t>& raw)
+    {
+        // Conversions stored since the last reading are stale, wait for a new frame
+        adc_continuous_flush_pool(_adc);
+        uint32_t length = 0;
+        esp_err_t err = adc_continuous_read(_adc, buffer, size, &length, BATTERY_READ_TIMEOUT_MS);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "ADC read failed: %s", esp_err_to_name(err));
+            return false;
+        }
+
+        raw.clear();
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES)
+        {
+            const adc_digi_output_data_t* data = (const adc_digi_output_data_t*)&buffer[i];
+            if (data->type2.unit == ADC_UNIT_1 && data->type2.channel == _cfg.channel)
+            {
+                raw.push_back(data->type2.data);
+            }
+        }
+        if (raw.empty())
+        {
+            return false;
+        }
+
+        // Median of the frame, one reading
+        std::nth_element(raw.begin(), raw.begin() + raw.size() / 2, raw.end());
+        int mv = 0;
+        if (_cali == nullptr || adc_cali_raw_to_voltage(_cali, raw[raw.size() / 2], &mv) != ESP_OK)
+        {
+            // Nominal full scale at 12 dB
+            mv = raw[raw.size() / 2] * 3100 / ((1 << SOC_ADC_DIGI_MAX_BITWIDTH) - 1);
+        }
+
+        _model.setLoad(_load_ma);
+        _model.addSample(mv * _cfg.divider, esp_timer_get_time() / 1000);
+        _voltage_mv = _model.voltage();
+        _level = _model.level();
+        _minutes_to_empty = _model.minutesToEmpty();
+        ESP_LOGD(TAG, "%d mV, filtered %d mV, %d%%", mv * _cfg.divider, _model.voltage(), _model.level());
+        return true;
+    }
+
+    void Battery::_task(void* arg)
+    {
+        Battery* self = static_cast<Battery*>(arg);
+        {
+            const size_t size = self->_cfg.conversions_per_reading * SOC_ADC_DIGI_RESULT_BYTES;
+            std::vector<uint8_t> buffer(size);
+            std::vector<uint16_t> raw;
+            raw.reserve(self->_cfg.conversions_per_reading);
+
+            while (self->_task_running)
+            {
+                self->_read(buffer.data(), size, raw);
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(self->_cfg.reading_period_ms));
+            }
+        }
+
+        self->_task_handle = nullptr;
+        vTaskDelete(NULL);
+    }
+
+} // namespace HAL
@@ -0,0 +1,117 @@
+/**
+ * @file battery.h
+ * @brief Battery service, samples the battery voltage with the continuous ADC in the background
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "soc/soc_caps.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "battery_model.h"
+
+namespace HAL
+{
+    /**
+     * @brief Configuration structure for Battery
+     */
+    struct battery_config_t
+    {
+        /// ADC1 channel of the battery divider (GPIO10)
+        adc_channel_t channel = ADC_CHANNEL_9;
+
+        /// Battery voltage over the measured one
+        uint8_t divider = 2;
+
+        /// Conversion rate, the lowest the ADC runs at (Hz)
+        uint32_t sample_freq_hz = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+
+        /// Conversions taken for each reading, their median is the reading
+        size_t conversions_per_reading = 64;
+
+        /// Time between readings (ms)
+        uint32_t reading_period_ms = 1000;
+
+        /// Background task priority
+        uint8_t task_priority = 1;
+
+        /// Filtering and charge model
+        battery_model_config_t model;
+    };
+
+    /**
+     * @brief Battery service
+     *
+     * The ADC converts by DMA, a low priority task turns a frame of conversions into a reading once per period.
+     * Getters return cached values and are cheap enough for render loops
+     */
+    class Battery
+    {
+    public:
+        Battery(const battery_config_t& cfg = battery_config_t()) : _cfg(cfg), _model(cfg.model) {}
+        ~Battery() { end(); }
+
+        /**
+         * @brief Start sampling
+         * @return true if successful
+         */
+        bool begin();
+
+        /**
+         * @brief Stop sampling and free the ADC
+         */
+        void end();
+
+        /**
+         * @brief Set the estimated current drawn from the battery, for load compensation
+         */
+        void setLoad(uint16_t ma) { _load_ma = ma; }
+
+        /**
+         * @brief Filtered battery voltage
+         * @return Volts, 0 before the first reading
+         */
+        float voltage() const { return _voltage_mv / 1000.0f; }
+
+        /**
+         * @brief State of charge (0 - 100) from the load compensated voltage
+         */
+        uint8_t level() const { return _level; }
+
+        /**
+         * @brief State of charge (0 - 100) of a given battery voltage under the present load
+         */
+        uint8_t levelOf(float voltage) const;
+
+        /**
+         * @brief Time to empty at the measured discharge rate
+         * @return Minutes, -1 while charging or before a rate was measured
+         */
+        int32_t minutesToEmpty() const { return _minutes_to_empty; }
+
+    private:
+        battery_config_t _cfg;
+        BatteryModel _model;
+        adc_continuous_handle_t _adc = nullptr;
+        adc_cali_handle_t _cali = nullptr;
+        TaskHandle_t _task_handle = nullptr;
+        std::atomic<bool> _task_running = false;
+
+        std::atomic<uint16_t> _load_ma = 0;
+        std::atomic<uint16_t> _voltage_mv = 0;
+        std::atomic<uint8_t> _level = 0;
+        std::atomic<int32_t> _minutes_to_empty = -1;
+
+        static void _task(void* arg);
+        bool _read(uint8_t* buffer, size_t size, std::vector<uint16_t>& raw);
+    };
+
+} // namespace HAL
@@ -0,0 +1,108 @@
+/**
+ * @file battery_model.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "battery_model.h"
+#include <algorithm>
+
+namespace HAL
+{
+    // Open circuit voltage of a Li-ion cell against its charge, per mille
+    static const struct
+    {
+        uint16_t mv;
+        uint16_t soc;
+    } _ocv_table[] = {
+        {3300, 0},   {3450, 50},  {3680, 100}, {3740, 200}, {3770, 300},  {3790, 400},
+        {3820, 500}, {3870, 600}, {3920, 700}, {3980, 800}, {4060, 900}, {4200, 1000},
+    };
+
+    uint16_t BatteryModel::soc_of(uint16_t ocv_mv)
+    {
+        const size_t count = sizeof(_ocv_table) / sizeof(_ocv_table[0]);
+        if (ocv_mv <= _ocv_table[0].mv)
+        {
+            return 0;
+        }
+        for (size_t i = 1; i < count; i++)
+        {
+            if (ocv_mv < _ocv_table[i].mv)
+            {
+                const auto& lo = _ocv_table[i - 1];
+                const auto& hi = _ocv_table[i];
+                return lo.soc + (uint32_t)(ocv_mv - lo.mv) * (hi.soc - lo.soc) / (hi.mv - lo.mv);
+            }
+        }
+        return 1000;
+    }
+
+    uint16_t BatteryModel::_median(void) const
+    {
+        uint16_t sorted[9];
+        std::copy(_window, _window + _count, sorted);
+        std::sort(sorted, sorted + _count);
+        return sorted[_count / 2];
+    }
+
+    void BatteryModel::addSample(uint16_t mv, uint32_t now_ms)
+    {
+        const uint8_t window = std::min<uint8_t>(std::max<uint8_t>(_cfg.median_window, 1), 9);
+        _window[_next] = mv;
+        _next = (_next + 1) % window;
+        const bool first = (_count == 0);
+        _count = std::min<uint8_t>(_count + 1, window);
+
+        // Median drops spikes, then the average settles the rest
+        const uint32_t median = _median();
+        if (first)
+        {
+            _ewma = median << 8;
+        }
+        else
+        {
+            _ewma += ((int32_t)(median << 8) - (int32_t)_ewma) >> _cfg.ewma_shift;
+        }
+        _voltage = (_ewma + 128) >> 8;
+
+        // Rate from the charge lost over a whole window, single readings are too noisy for it
+        const uint16_t soc = soc_of(ocv());
+        if (first)
+        {
+            _window_start_ms = now_ms;
+            _window_start_soc = soc;
+            return;
+        }
+        const uint32_t elapsed_ms = now_ms - _window_start_ms;
+        if (elapsed_ms < _cfg.rate_window_ms)
+        {
+            return;
+        }
+        if (soc < _window_start_soc)
+        {
+            const uint32_t rate = (uint64_t)(_window_start_soc - soc) * 3600000 / elapsed_ms;
+            _rate = (_rate == 0) ? rate : (_rate * 3 + rate) / 4;
+        }
+        else
+        {
+            // Charging, or idle enough that no drop shows
+            _rate = 0;
+        }
+        _window_start_ms = now_ms;
+        _window_start_soc = soc;
+    }
+
+    int32_t BatteryModel::minutesToEmpty(void) const
+    {
+        if (_rate == 0)
+        {
+            return -1;
+        }
+        return (uint32_t)soc_of(ocv()) * 60 / _rate;
+    }
+
+} // namespace HAL
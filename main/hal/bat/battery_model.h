@@ -0,0 +1,103 @@
+/**
+ * @file battery_model.h
+ * @brief Battery voltage filtering and state of charge model, free of IDF dependencies
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace HAL
+{
+    /**
+     * @brief Configuration structure for BatteryModel
+     */
+    struct battery_model_config_t
+    {
+        /// Readings in the median, takes out single ADC spikes (max 9)
+        uint8_t median_window = 5;
+
+        /// EWMA weight of a new reading is 1 / 2^shift
+        uint8_t ewma_shift = 3;
+
+        /// Cell, protection and wiring resistance, the voltage drop under load (mOhm)
+        uint16_t internal_mohm = 200;
+
+        /// Discharge rate is measured over windows this long (ms)
+        uint32_t rate_window_ms = 5 * 60 * 1000;
+    };
+
+    /**
+     * @brief Turns battery voltage readings into a steady voltage, charge level and time to empty
+     */
+    class BatteryModel
+    {
+    public:
+        BatteryModel(const battery_model_config_t& cfg = battery_model_config_t()) : _cfg(cfg) {}
+
+        /**
+         * @brief Add a battery voltage reading
+         * @param now_ms Reading time, for the discharge rate
+         */
+        void addSample(uint16_t mv, uint32_t now_ms);
+
+        /**
+         * @brief Set the current drawn from the battery, the open circuit voltage is compensated for it
+         */
+        void setLoad(uint16_t ma) { _load_ma = ma; }
+
+        bool hasSample(void) const { return _count > 0; }
+
+        /**
+         * @brief Filtered battery voltage (mV)
+         */
+        uint16_t voltage(void) const { return _voltage; }
+
+        /**
+         * @brief Filtered voltage plus the drop under load (mV)
+         */
+        uint16_t ocv(void) const { return _voltage + (uint32_t)_load_ma * _cfg.internal_mohm / 1000; }
+
+        /**
+         * @brief State of charge (0 - 100)
+         */
+        uint8_t level(void) const { return soc_of(ocv()) / 10; }
+
+        /**
+         * @brief Time to empty at the measured discharge rate
+         * @return Minutes, -1 while charging or before a rate was measured
+         */
+        int32_t minutesToEmpty(void) const;
+
+        /**
+         * @brief State of charge of a single Li-ion cell at rest
+         * @return Per mille
+         */
+        static uint16_t soc_of(uint16_t ocv_mv);
+
+    private:
+        battery_model_config_t _cfg;
+        uint16_t _load_ma = 0;
+
+        uint16_t _window[9] = {};
+        uint8_t _count = 0;
+        uint8_t _next = 0;
+
+        /// Voltage with 8 fraction bits
+        uint32_t _ewma = 0;
+        uint16_t _voltage = 0;
+
+        /// Discharge rate, per mille of charge per hour
+        uint32_t _window_start_ms = 0;
+        uint16_t _window_start_soc = 0;
+        uint32_t _rate = 0;
+
+        uint16_t _median(void) const;
+    };
+
+} // namespace HAL
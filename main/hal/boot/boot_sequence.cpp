@@ -0,0 +1,162 @@
+/**
+ * @file boot_sequence.cpp
+ * @brief Runs hal init stages in parallel, ordered by their dependencies
+ * @version 0.1
+ * @date 2025-12-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "boot_sequence.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "trace/trace.h"
+
+static const char* TAG = "BOOT";
+
+namespace HAL
+{
+    BootSequence::StageMask_t BootSequence::addStage(const char* name,
+                                                     std::function<void()> func,
+                                                     StageMask_t depends,
+                                                     BaseType_t core,
+                                                     bool background,
+                                                     uint32_t stack_size)
+    {
+        if (_done != nullptr || _stage_num >= BOOT_SEQUENCE_MAX_STAGES)
+        {
+            ESP_LOGE(TAG, "Can't add stage %s", name);
+            return 0;
+        }
+        Stage_t& stage = _stages[_stage_num];
+        stage.name = name;
+        stage.func = func;
+        stage.depends = depends;
+        stage.core = core;
+        stage.background = background;
+        stage.stack_size = stack_size;
+        stage.start_us = 0;
+        stage.end_us = 0;
+        stage.ran_on_core = -1;
+        stage.owner = this;
+        return 1UL << _stage_num++;
+    }
+
+    void BootSequence::_run_stage(Stage_t* stage)
+    {
+        if (stage->depends != 0)
+        {
+            xEventGroupWaitBits(_done, stage->depends, pdFALSE, pdTRUE, portMAX_DELAY);
+        }
+        stage->ran_on_core = xPortGetCoreID();
+        stage->start_us = esp_timer_get_time();
+        {
+            MC_TRACE_ZONE(stage->name);
+            stage->func();
+        }
+        stage->end_us = esp_timer_get_time();
+
+        // Whoever finishes last reports, background stages included
+        bool last = ++_finished == _stage_num;
+        xEventGroupSetBits(_done, 1UL << (stage - _stages));
+        if (last)
+        {
+            printReport();
+        }
+    }
+
+    void BootSequence::_stage_task(void* param)
+    {
+        Stage_t* stage = (Stage_t*)param;
+        stage->owner->_run_stage(stage);
+        vTaskDelete(NULL);
+    }
+
+    bool BootSequence::run()
+    {
+        if (_done != nullptr)
+        {
+            ESP_LOGE(TAG, "Already running");
+            return false;
+        }
+        _done = xEventGroupCreate();
+        if (_done == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to create event group");
+            return false;
+        }
+        _run_us = esp_timer_get_time();
+
+        StageMask_t foreground = 0;
+        for (uint8_t i = 0; i < _stage_num; i++)
+        {
+            Stage_t& stage = _stages[i];
+            if (!stage.background)
+            {
+                foreground |= 1UL << i;
+            }
+            if (stage.depends & ~_all_stages())
+            {
+                ESP_LOGE(TAG, "Stage %s depends on unknown stages", stage.name);
+                stage.depends &= _all_stages();
+            }
+            if (xTaskCreatePinnedToCore(_stage_task,
+                                        stage.name,
+                                        stage.stack_size,
+                                        &stage,
+                                        BOOT_SEQUENCE_PRIORITY,
+                                        NULL,
+                                        stage.core) != pdPASS)
+            {
+                // Stages are added in dependency order, so running it here can't wait on a later one
+                ESP_LOGE(TAG, "Failed to create task for %s, running inline", stage.name);
+                _run_stage(&stage);
+            }
+        }
+        return wait(foreground);
+    }
+
+    bool BootSequence::wait(StageMask_t stages, uint32_t timeout_ms)
+    {
+        if (_done == nullptr)
+        {
+            return false;
+        }
+        if (stages == 0)
+        {
+            stages = _all_stages();
+        }
+        TickType_t ticks = timeout_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+        EventBits_t bits = xEventGroupWaitBits(_done, stages, pdFALSE, pdTRUE, ticks);
+        return (bits & stages) == stages;
+    }
+
+    void BootSequence::printReport()
+    {
+        int64_t busy_us = 0;
+        int64_t last_end_us = _run_us;
+        ESP_LOGI(TAG, "Boot profile, stages started at %d ms:", (int)(_run_us / 1000));
+        for (uint8_t i = 0; i < _stage_num; i++)
+        {
+            const Stage_t& stage = _stages[i];
+            if (stage.end_us == 0)
+            {
+                ESP_LOGI(TAG, "  %-10s not done", stage.name);
+                continue;
+            }
+            ESP_LOGI(TAG,
+                     "  %-10s +%4d ms  %7d us  core %d%s",
+                     stage.name,
+                     (int)((stage.start_us - _run_us) / 1000),
+                     (int)(stage.end_us - stage.start_us),
+                     (int)stage.ran_on_core,
+                     stage.background ? "  bg" : "");
+            busy_us += stage.end_us - stage.start_us;
+            if (stage.end_us > last_end_us)
+            {
+                last_end_us = stage.end_us;
+            }
+        }
+        ESP_LOGI(TAG, "  %d us of stages done in %d us", (int)busy_us, (int)(last_end_us - _run_us));
+    }
+} // namespace HAL
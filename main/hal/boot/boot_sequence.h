@@ -0,0 +1,95 @@
+/**
+ * @file boot_sequence.h
+ * @brief Runs hal init stages in parallel, ordered by their dependencies
+ * @version 0.1
+ * @date 2025-12-13
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+
+// Stage ids are event group bits, FreeRTOS keeps the top 8 bits for itself
+#define BOOT_SEQUENCE_MAX_STAGES 24
+#define BOOT_SEQUENCE_STACK_SIZE 4096
+#define BOOT_SEQUENCE_PRIORITY 5
+
+namespace HAL
+{
+    class BootSequence
+    {
+    public:
+        typedef uint32_t StageMask_t;
+
+        /**
+         * @brief Add a stage, stages are only started by run()
+         *
+         * @param name shown in the boot profile
+         * @param func init function, runs in its own task
+         * @param depends stages that must be done before this one starts
+         * @param core core to pin the task to, tskNO_AFFINITY for any
+         * @param background if true, run() does not wait for this stage
+         * @param stack_size
+         * @return StageMask_t bit of the new stage, 0 if out of stages
+         */
+        StageMask_t addStage(const char* name,
+                             std::function<void()> func,
+                             StageMask_t depends = 0,
+                             BaseType_t core = tskNO_AFFINITY,
+                             bool background = false,
+                             uint32_t stack_size = BOOT_SEQUENCE_STACK_SIZE);
+
+        /**
+         * @brief Start all stages and wait for the ones not in background
+         *
+         * @return true if all foreground stages are done
+         */
+        bool run();
+
+        /**
+         * @brief Wait for stages started by run()
+         *
+         * @param stages stages to wait for, 0 for all of them
+         * @param timeout_ms
+         * @return true if done in time
+         */
+        bool wait(StageMask_t stages = 0, uint32_t timeout_ms = UINT32_MAX);
+
+        /**
+         * @brief Log start, duration and core of every finished stage
+         */
+        void printReport();
+
+    private:
+        struct Stage_t
+        {
+            const char* name;
+            std::function<void()> func;
+            StageMask_t depends;
+            BaseType_t core;
+            bool background;
+            uint32_t stack_size;
+            // Filled in by the stage task, microseconds since power up
+            int64_t start_us;
+            int64_t end_us;
+            BaseType_t ran_on_core;
+            BootSequence* owner;
+        };
+
+        Stage_t _stages[BOOT_SEQUENCE_MAX_STAGES];
+        uint8_t _stage_num = 0;
+        EventGroupHandle_t _done = nullptr;
+        int64_t _run_us = 0;
+        std::atomic<uint8_t> _finished{0};
+
+        StageMask_t _all_stages() const { return (1UL << _stage_num) - 1; }
+        void _run_stage(Stage_t* stage);
+        static void _stage_task(void* param);
+    };
+} // namespace HAL
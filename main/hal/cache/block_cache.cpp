@@ -0,0 +1,353 @@
+/**
+ * @file block_cache.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "block_cache.h"
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+namespace HAL
+{
+    static uint16_t _le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+    static uint32_t _le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+    BlockCache::BlockCache(const block_cache_config_t& cfg) : _cfg(cfg)
+    {
+        const uint32_t slots = std::max<size_t>(cfg.capacity_bytes / cfg.block_size, 1);
+        _pool.resize((size_t)slots * cfg.block_size);
+        _index.reserve(slots);
+        for (uint32_t i = 0; i < slots; i++)
+        {
+            _free_slots.push_back(slots - 1 - i);
+        }
+    }
+
+    int BlockCache::attach(read_fn_t read, write_fn_t write, uint32_t sector_size)
+    {
+        if (sector_size != _cfg.block_size)
+        {
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (int dev = 0; dev < MAX_DEVICES; dev++)
+        {
+            if (!_devices[dev].used)
+            {
+                _devices[dev] = device_t();
+                _devices[dev].used = true;
+                _devices[dev].read = read;
+                _devices[dev].write = write;
+                return dev;
+            }
+        }
+        return -1;
+    }
+
+    void BlockCache::detach(int dev)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_valid(dev))
+        {
+            return;
+        }
+        _flush(dev);
+        _drop(dev);
+        _devices[dev].used = false;
+    }
+
+    void BlockCache::setWriteBack(int dev, uint32_t first, uint32_t count)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_valid(dev))
+        {
+            _devices[dev].wb_first = first;
+            _devices[dev].wb_count = count;
+        }
+    }
+
+    bool BlockCache::setWriteBackFat(int dev)
+    {
+        std::vector<uint8_t> sector(_cfg.block_size);
+        auto is_fat = [this](const uint8_t* b) {
+            return b[510] == 0x55 && b[511] == 0xAA && (b[0] == 0xEB || b[0] == 0xE9) && _le16(b + 11) == _cfg.block_size &&
+                   b[16] != 0 && _le16(b + 14) != 0;
+        };
+
+        // Boot sector, or a partition table pointing to it
+        uint32_t base = 0;
+        if (!read(dev, 0, 1, sector.data()))
+        {
+            return false;
+        }
+        if (!is_fat(sector.data()))
+        {
+            if (sector[510] != 0x55 || sector[511] != 0xAA)
+            {
+                return false;
+            }
+            base = _le32(&sector[446 + 8]);
+            if (base == 0 || !read(dev, base, 1, sector.data()) || !is_fat(sector.data()))
+            {
+                return false;
+            }
+        }
+
+        const uint32_t reserved = _le16(&sector[14]);
+        const uint32_t fats = sector[16];
+        const uint32_t fat_size = _le16(&sector[22]) ? _le16(&sector[22]) : _le32(&sector[36]);
+        if (fat_size == 0)
+        {
+            return false;
+        }
+        setWriteBack(dev, base + reserved, fats * fat_size);
+        return true;
+    }
+
+    bool BlockCache::read(int dev, uint32_t lba, uint32_t count, uint8_t* data)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (!_valid(dev))
+        {
+            return false;
+        }
+        device_t& device = _devices[dev];
+
+        if (count != 1)
+        {
+            // File data, straight from the device. Only calls for this device touch it, the lock is not needed
+            device.stats.bypassed += count;
+            read_fn_t read = device.read;
+            lock.unlock();
+            if (!read(lba, count, data))
+            {
+                return false;
+            }
+            // Dirty sectors are newer than the device
+            lock.lock();
+            for (uint32_t i = 0; i < count; i++)
+            {
+                auto found = _index.find(_key(dev, lba + i));
+                if (found != _index.end() && found->second->dirty)
+                {
+                    memcpy(data + (size_t)i * _cfg.block_size, _data(found->second->slot), _cfg.block_size);
+                }
+            }
+            return true;
+        }
+
+        auto found = _index.find(_key(dev, lba));
+        if (found != _index.end())
+        {
+            device.stats.hits++;
+            _lru.splice(_lru.begin(), _lru, found->second);
+            memcpy(data, _data(found->second->slot), _cfg.block_size);
+            return true;
+        }
+
+        device.stats.misses++;
+        auto entry = _insert(dev, lba);
+        if (entry == _lru.end())
+        {
+            // No room, the rest is dirty sectors of other devices
+            return device.read(lba, 1, data);
+        }
+        if (!device.read(lba, 1, _data(entry->slot)))
+        {
+            _free_slots.push_back(entry->slot);
+            _index.erase(entry->key);
+            _lru.erase(entry);
+            return false;
+        }
+        memcpy(data, _data(entry->slot), _cfg.block_size);
+        return true;
+    }
+
+    bool BlockCache::write(int dev, uint32_t lba, uint32_t count, const uint8_t* data)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (!_valid(dev))
+        {
+            return false;
+        }
+        device_t& device = _devices[dev];
+
+        // FAT sectors are rewritten over and over, hold them till the volume syncs
+        if (count == 1 && lba >= device.wb_first && lba - device.wb_first < device.wb_count)
+        {
+            auto found = _index.find(_key(dev, lba));
+            auto entry = found != _index.end() ? found->second : _insert(dev, lba);
+            if (entry != _lru.end())
+            {
+                _lru.splice(_lru.begin(), _lru, entry);
+                memcpy(_data(entry->slot), data, _cfg.block_size);
+                entry->dirty = true;
+                return true;
+            }
+        }
+
+        write_fn_t write = device.write;
+        lock.unlock();
+        if (!write(lba, count, data))
+        {
+            return false;
+        }
+
+        // Cached copies take the new data, the device has it now
+        lock.lock();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto found = _index.find(_key(dev, lba + i));
+            if (found != _index.end())
+            {
+                memcpy(_data(found->second->slot), data + (size_t)i * _cfg.block_size, _cfg.block_size);
+                found->second->dirty = false;
+            }
+        }
+        return true;
+    }
+
+    bool BlockCache::flush(int dev)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_valid(dev))
+        {
+            return false;
+        }
+        return _flush(dev);
+    }
+
+    block_cache_stats_t BlockCache::stats(int dev) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return (dev >= 0 && dev < MAX_DEVICES) ? _devices[dev].stats : block_cache_stats_t();
+    }
+
+    block_cache_stats_t BlockCache::stats() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        block_cache_stats_t total;
+        for (const device_t& device : _devices)
+        {
+            total.hits += device.stats.hits;
+            total.misses += device.stats.misses;
+            total.bypassed += device.stats.bypassed;
+            total.write_backs += device.stats.write_backs;
+            total.evictions += device.stats.evictions;
+        }
+        return total;
+    }
+
+    std::list<BlockCache::entry_t>::iterator BlockCache::_insert(int dev, uint32_t lba)
+    {
+        if (_free_slots.empty() && !_evict(dev))
+        {
+            return _lru.end();
+        }
+        const uint32_t slot = _free_slots.back();
+        _free_slots.pop_back();
+        _lru.push_front({_key(dev, lba), slot, false});
+        _index[_key(dev, lba)] = _lru.begin();
+        return _lru.begin();
+    }
+
+    bool BlockCache::_evict(int dev)
+    {
+        // Least recently used that needs no I/O, or only I/O on the caller's device
+        auto victim = _lru.end();
+        for (auto it = _lru.rbegin(); it != _lru.rend(); it++)
+        {
+            if (!it->dirty || (int)(it->key >> 32) == dev)
+            {
+                victim = std::prev(it.base());
+                break;
+            }
+        }
+        if (victim == _lru.end())
+        {
+            return false;
+        }
+
+        device_t& device = _devices[victim->key >> 32];
+        if (victim->dirty)
+        {
+            if (!device.write((uint32_t)victim->key, 1, _data(victim->slot)))
+            {
+                return false;
+            }
+            device.stats.write_backs++;
+        }
+        device.stats.evictions++;
+        _free_slots.push_back(victim->slot);
+        _index.erase(victim->key);
+        _lru.erase(victim);
+        return true;
+    }
+
+    bool BlockCache::_flush(int dev)
+    {
+        std::vector<entry_t*> dirty;
+        for (entry_t& entry : _lru)
+        {
+            if (entry.dirty && (int)(entry.key >> 32) == dev)
+            {
+                dirty.push_back(&entry);
+            }
+        }
+        std::sort(dirty.begin(), dirty.end(), [](const entry_t* a, const entry_t* b) { return a->key < b->key; });
+
+        // Adjacent sectors, the FAT copies mostly, in one command
+        bool ok = true;
+        std::vector<uint8_t> run;
+        for (size_t first = 0; first < dirty.size();)
+        {
+            size_t last = first + 1;
+            while (last < dirty.size() && dirty[last]->key == dirty[last - 1]->key + 1)
+            {
+                last++;
+            }
+            run.resize((last - first) * _cfg.block_size);
+            for (size_t i = first; i < last; i++)
+            {
+                memcpy(&run[(i - first) * _cfg.block_size], _data(dirty[i]->slot), _cfg.block_size);
+            }
+            if (_devices[dev].write((uint32_t)dirty[first]->key, last - first, run.data()))
+            {
+                for (size_t i = first; i < last; i++)
+                {
+                    dirty[i]->dirty = false;
+                }
+                _devices[dev].stats.write_backs += last - first;
+            }
+            else
+            {
+                ok = false;
+            }
+            first = last;
+        }
+        return ok;
+    }
+
+    void BlockCache::_drop(int dev)
+    {
+        for (auto it = _lru.begin(); it != _lru.end();)
+        {
+            if ((int)(it->key >> 32) == dev)
+            {
+                _free_slots.push_back(it->slot);
+                _index.erase(it->key);
+                it = _lru.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+
+} // namespace HAL
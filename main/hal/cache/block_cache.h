@@ -0,0 +1,146 @@
+/**
+ * @file block_cache.h
+ * @brief LRU sector cache shared by the FATFS volumes, free of IDF dependencies
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL
+{
+    /**
+     * @brief Configuration structure for BlockCache
+     */
+    struct block_cache_config_t
+    {
+        /// Memory for cached sectors, shared by all devices
+        size_t capacity_bytes = 16 * 1024;
+
+        /// Sector size the cache holds, devices with bigger sectors are refused
+        uint32_t block_size = 512;
+    };
+
+    /**
+     * @brief Cache statistics
+     */
+    struct block_cache_stats_t
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        /// Multi-sector reads, passed to the device
+        uint64_t bypassed = 0;
+        /// Dirty sectors written to the device
+        uint64_t write_backs = 0;
+        uint64_t evictions = 0;
+
+        /**
+         * @brief Hit rate of single sector reads
+         * @return Percent, 0 before any read
+         */
+        uint8_t hitRate() const { return hits + misses ? hits * 100 / (hits + misses) : 0; }
+    };
+
+    /**
+     * @brief Sector cache under the FATFS disk drivers
+     *
+     * Single sector reads are FAT, directory and partial file sectors, those are cached, least recently used first out.
+     * Multi-sector reads are file data and go to the device. Writes go through, except single sectors in the
+     * write-back range (the FATs), which stay dirty till flush(), eviction or detach()
+     *
+     * A device is only ever called from a call made for that device, so its driver sees one caller at a time as long as
+     * the callers of each device are serialized (FATFS does that per volume). Eviction takes clean sectors or the
+     * caller's own dirty ones, another device's dirty sectors wait for its own flush
+     */
+    class BlockCache
+    {
+    public:
+        using read_fn_t = std::function<bool(uint32_t lba, uint32_t count, uint8_t* data)>;
+        using write_fn_t = std::function<bool(uint32_t lba, uint32_t count, const uint8_t* data)>;
+
+        static constexpr int MAX_DEVICES = 4;
+
+        BlockCache(const block_cache_config_t& cfg = block_cache_config_t());
+
+        /**
+         * @brief Put a device under the cache
+         * @return Device id, -1 if the sector size does not fit or no slot is free
+         */
+        int attach(read_fn_t read, write_fn_t write, uint32_t sector_size);
+
+        /**
+         * @brief Flush and drop everything of a device
+         */
+        void detach(int dev);
+
+        /**
+         * @brief Sectors kept dirty on single sector writes
+         */
+        void setWriteBack(int dev, uint32_t first, uint32_t count);
+
+        /**
+         * @brief Find the FATs from the boot sector (or the first partition's) and set them as the write-back range
+         * @return true if a FAT volume was found
+         */
+        bool setWriteBackFat(int dev);
+
+        bool read(int dev, uint32_t lba, uint32_t count, uint8_t* data);
+        bool write(int dev, uint32_t lba, uint32_t count, const uint8_t* data);
+
+        /**
+         * @brief Write dirty sectors of a device, adjacent ones in one command
+         */
+        bool flush(int dev);
+
+        block_cache_stats_t stats(int dev) const;
+        block_cache_stats_t stats() const;
+
+    private:
+        struct entry_t
+        {
+            uint64_t key;
+            uint32_t slot;
+            bool dirty;
+        };
+
+        struct device_t
+        {
+            bool used = false;
+            read_fn_t read;
+            write_fn_t write;
+            uint32_t wb_first = 0;
+            uint32_t wb_count = 0;
+            block_cache_stats_t stats;
+        };
+
+        block_cache_config_t _cfg;
+        device_t _devices[MAX_DEVICES];
+
+        // Most recent first
+        std::list<entry_t> _lru;
+        std::unordered_map<uint64_t, std::list<entry_t>::iterator> _index;
+        std::vector<uint8_t> _pool;
+        std::vector<uint32_t> _free_slots;
+        mutable std::mutex _mutex;
+
+        static uint64_t _key(int dev, uint32_t lba) { return ((uint64_t)dev << 32) | lba; }
+        uint8_t* _data(uint32_t slot) { return &_pool[(size_t)slot * _cfg.block_size]; }
+        bool _valid(int dev) const { return dev >= 0 && dev < MAX_DEVICES && _devices[dev].used; }
+
+        std::list<entry_t>::iterator _insert(int dev, uint32_t lba);
+        bool _evict(int dev);
+        bool _flush(int dev);
+        void _drop(int dev);
+    };
+
+} // namespace HAL
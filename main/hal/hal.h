@@ -18,7 +18,10 @@
 #include "usb/usb.h"
 #include "wifi/wifi.h"
 #include "led/led.h"
+#include "bat/battery.h"
+#include "cache/block_cache.h"
 #include "settings/settings.h"
+#include "trace/trace.h"
 #include <iostream>
 #include <string>
 
@@ -44,6 +47,8 @@ namespace HAL
         USB* _usb;
         WiFi* _wifi;
         LED* _led;
+        Battery* _battery;
+        BlockCache* _block_cache;
         bool _sntp_adjusted;
         BoardType _board_type;
 
@@ -51,7 +56,7 @@ namespace HAL
         Hal(SETTINGS::Settings* settings)
             : _display(nullptr), _canvas(nullptr), _canvas_system_bar(nullptr), _canvas_space_bar(nullptr), _settings(settings),
               _keyboard(nullptr), _speaker(nullptr), _homeButton(nullptr), _sdcard(nullptr), _usb(nullptr), _wifi(nullptr),
-              _led(nullptr), _sntp_adjusted(false), _board_type(BoardType::AUTO_DETECT)
+              _led(nullptr), _battery(nullptr), _block_cache(nullptr), _sntp_adjusted(false), _board_type(BoardType::AUTO_DETECT)
         {
         }
 
@@ -68,18 +73,34 @@ namespace HAL
         inline Speaker* speaker() { return _speaker; }
         inline WiFi* wifi() { return _wifi; }
         inline LED* led() { return _led; }
+        inline Battery* battery() { return _battery; }
+        inline BlockCache* blockCache() { return _block_cache; }
 
         inline void setSntpAdjusted(bool isAdjusted) { _sntp_adjusted = isAdjusted; }
         inline bool isSntpAdjusted(void) { return _sntp_adjusted; }
 
         // Canvas
-        inline void canvas_system_bar_update() { _canvas_system_bar->pushSprite(_canvas_space_bar->width(), 0); }
-        inline void canvas_space_bar_update() { _canvas_space_bar->pushSprite(0, 0); }
-        inline void canvas_update() { _canvas->pushSprite(_canvas_space_bar->width(), _canvas_system_bar->height()); }
+        inline void canvas_system_bar_update()
+        {
+            MC_TRACE_ZONE("push_system_bar");
+            _canvas_system_bar->pushSprite(_canvas_space_bar->width(), 0);
+        }
+        inline void canvas_space_bar_update()
+        {
+            MC_TRACE_ZONE("push_space_bar");
+            _canvas_space_bar->pushSprite(0, 0);
+        }
+        inline void canvas_update()
+        {
+            MC_TRACE_ZONE("push_canvas");
+            _canvas->pushSprite(_canvas_space_bar->width(), _canvas_system_bar->height());
+        }
 
         // Override
         virtual std::string type() { return "null"; }
         virtual void init() {}
+        // Init may leave slow parts running in background, wait for them before touching those
+        virtual bool waitInit(uint32_t timeout_ms = UINT32_MAX) { return true; }
 
         virtual void playLastSound() {}
         virtual void playNextSound() {}
@@ -92,5 +113,7 @@ namespace HAL
 
         virtual uint8_t getBatLevel(float voltage) { return 100; }
         virtual float getBatVoltage() { return 4.15; }
+        // Minutes, -1 if unknown
+        virtual int32_t getBatMinutesToEmpty() { return -1; }
     };
 } // namespace HAL
@@ -11,11 +11,14 @@
 #include "hal_cardputer.h"
 #include <mooncake.h>
 #include "apps/utils/common_define.h"
-#include "bat/adc_read.h"
 #include "esp_log.h"
 
 static const char* TAG = "HAL";
 
+// Estimated battery current for load compensation, display and CPU, plus a connected radio
+#define BAT_LOAD_BASE_MA 120
+#define BAT_LOAD_WIFI_MA 80
+
 using namespace HAL;
 
 void HalCardputer::_init_display()
@@ -57,20 +60,37 @@ void HalCardputer::_init_speaker()
 
 void HalCardputer::_init_button() { _homeButton = new Button(0); }
 
-void HalCardputer::_init_bat() { adc_read_init(); }
+void HalCardputer::_init_bat()
+{
+    _battery = new Battery();
+    _battery->setLoad(BAT_LOAD_BASE_MA);
+    _battery->begin();
+}
 
-void HalCardputer::_init_sdcard() { _sdcard = new SDCard; }
+void HalCardputer::_init_sdcard()
+{
+    // Shared by the SD and USB volumes
+    _block_cache = new BlockCache();
+    _sdcard = new SDCard(_block_cache);
+}
 
 void HalCardputer::_init_usb() { _usb = new USB(this); }
 
 void HalCardputer::_init_wifi()
 {
     _wifi = new WiFi(_settings);
+    // "wifi_start" inits it in the background, callers wait for that
+    _wifi->deferInit();
     _wifi->set_status_callback(
         [this](wifi_status_t status)
         {
             // ESP_LOGI(TAG, "WiFi status: %d", status);
-            if (!_settings->getBool("system", "use_led"))
+            if (_battery != nullptr)
+            {
+                bool radio_on = status != WIFI_STATUS_IDLE && status != WIFI_STATUS_DISCONNECTED;
+                _battery->setLoad(BAT_LOAD_BASE_MA + (radio_on ? BAT_LOAD_WIFI_MA : 0));
+            }
+            if (!_settings->getBool(SETTINGS::SYSTEM_USE_LED))
             {
                 return;
             }
@@ -103,6 +123,19 @@ void HalCardputer::_init_wifi()
         });
 }
 
+void HalCardputer::_start_wifi()
+{
+    ESP_LOGI(TAG, "start wifi");
+    if (_wifi->init())
+    {
+        // Connect to WiFi if enabled
+        if (_settings->getBool(SETTINGS::WIFI_ENABLED))
+        {
+            _wifi->connect();
+        }
+    }
+}
+
 void HalCardputer::_init_led()
 {
     _led = new LED(RGB_LED_GPIO);
@@ -113,30 +146,27 @@ void HalCardputer::init()
 {
     ESP_LOGI(TAG, "HAL init");
 
-    _init_display();
-    _init_keyboard();
-    _init_speaker();
-    _init_button();
-    _init_bat();
-    _init_sdcard();
-    _init_led();
-    _init_wifi();
+    // M5GFX board autodetect probes pins of other boards too: keyboard matrix and G8/G9 (I2C_NUM_1), SD CS (G12),
+    // LED (G21), speaker I2S (G41/G42) and SPI2. Only the button (G0) and the battery ADC (G10) run alongside it.
+    // The ADV speaker codec sits on the I2C bus created by the keyboard
+    auto display = _boot.addStage("display", [this]() { _init_display(); }, 0, 0, false, 8192);
+    auto keyboard = _boot.addStage("keyboard", [this]() { _init_keyboard(); }, display, 1);
+    _boot.addStage("speaker", [this]() { _init_speaker(); }, keyboard, 1);
+    _boot.addStage("button", [this]() { _init_button(); });
+    auto bat = _boot.addStage("bat", [this]() { _init_bat(); });
+    _boot.addStage("sdcard", [this]() { _init_sdcard(); }, display);
+    auto led = _boot.addStage("led", [this]() { _init_led(); }, display);
+    // Status callback drives the LED and the battery load
+    auto wifi = _boot.addStage("wifi", [this]() { _init_wifi(); }, led | bat);
+    // Radio start up is the slowest part, it keeps going under the boot animation
+    _boot.addStage("wifi_start", [this]() { _start_wifi(); }, wifi, 0, true);
+
+    _boot.run();
 }
 
-uint8_t HalCardputer::getBatLevel(float voltage)
-{
-    uint8_t result = 0;
-    if (voltage >= 4.12)
-        result = 100;
-    else if (voltage >= 3.88)
-        result = 75;
-    else if (voltage >= 3.61)
-        result = 50;
-    else if (voltage >= 3.40)
-        result = 25;
-    else
-        result = 0;
-    return result;
-}
+uint8_t HalCardputer::getBatLevel(float voltage) { return _battery->levelOf(voltage); }
+
+// Cached by the battery service, no ADC access
+float HalCardputer::getBatVoltage() { return _battery->voltage(); }
 
-float HalCardputer::getBatVoltage() { return static_cast<float>(adc_read_get_value()) * 2 / 1000; }
+int32_t HalCardputer::getBatMinutesToEmpty() { return _battery->minutesToEmpty(); }
@@ -9,6 +9,7 @@
  *
  */
 #include "hal.h"
+#include "boot/boot_sequence.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
@@ -28,6 +29,8 @@ namespace HAL
     class HalCardputer : public Hal
     {
     private:
+        BootSequence _boot;
+
         void _init_display();
         void _init_keyboard();
         void _init_speaker();
@@ -36,6 +39,7 @@ namespace HAL
         void _init_sdcard();
         void _init_usb();
         void _init_wifi();
+        void _start_wifi();
         void _init_led();
 
     public:
@@ -53,6 +57,7 @@ namespace HAL
             }
         }
         void init() override;
+        bool waitInit(uint32_t timeout_ms = UINT32_MAX) override { return _boot.wait(0, timeout_ms); }
         void playErrorSound() override { _speaker->playWav(error_wav_start, error_wav_end - error_wav_start); }
         void playKeyboardSound() override { _speaker->tone(5000, 20); }
         void playLastSound() override { _speaker->tone(6000, 20); }
@@ -81,6 +86,7 @@ namespace HAL
         }
         uint8_t getBatLevel(float voltage) override;
         float getBatVoltage() override;
+        int32_t getBatMinutesToEmpty() override;
 
     public:
     };
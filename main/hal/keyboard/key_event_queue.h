@@ -0,0 +1,72 @@
+/**
+ * @file key_event_queue.h
+ * @brief Lock-free single producer / single consumer queue of key events
+ * @version 0.1
+ * @date 2025-12-09
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include "keyboard_reader.h"
+#include <atomic>
+#include <stddef.h>
+
+#define KEY_EVENT_QUEUE_SIZE 64
+
+namespace KEYBOARD
+{
+    /**
+     * @brief Ring buffer of key events
+     *
+     * push() is called by the keyboard service task only, pop() by the app task only,
+     * so no locks are needed. One slot is left empty to tell full from empty.
+     */
+    class KeyEventQueue
+    {
+    public:
+        /**
+         * @brief Add an event, producer side
+         * @return false if the queue is full, the event is dropped and the overflow flag set
+         */
+        bool push(const KeyEvent_t& event)
+        {
+            const size_t head = _head.load(std::memory_order_relaxed);
+            const size_t next = (head + 1) % KEY_EVENT_QUEUE_SIZE;
+            if (next == _tail.load(std::memory_order_acquire))
+            {
+                _overflow.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            _buffer[head] = event;
+            _head.store(next, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Take the oldest event, consumer side
+         * @return false if the queue is empty
+         */
+        bool pop(KeyEvent_t& event)
+        {
+            const size_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail == _head.load(std::memory_order_acquire))
+                return false;
+            event = _buffer[tail];
+            _tail.store((tail + 1) % KEY_EVENT_QUEUE_SIZE, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Check and clear the overflow flag, consumer side
+         * @return true if events were dropped since the last call
+         */
+        bool takeOverflow() { return _overflow.exchange(false, std::memory_order_relaxed); }
+
+    private:
+        KeyEvent_t _buffer[KEY_EVENT_QUEUE_SIZE];
+        std::atomic<size_t> _head{0};
+        std::atomic<size_t> _tail{0};
+        std::atomic<bool> _overflow{false};
+    };
+
+} // namespace KEYBOARD
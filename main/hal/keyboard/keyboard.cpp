@@ -12,6 +12,7 @@
 #include "keyboard_reader_iomatrix.h"
 #include "keyboard_reader_tca8418.h"
 #include <driver/gpio.h>
+#include <algorithm>
 #include "apps/utils/common_define.h"
 #include "esp_log.h"
 
@@ -57,9 +58,78 @@ void Keyboard::init()
         _keyboard_reader->init();
     }
 
+    _key_list.reserve(16);
+    _key_events.reserve(KEY_EVENT_QUEUE_SIZE);
+    _deferred_releases.reserve(16);
+    _keys_state_buffer.values.reserve(16);
+    _start_service();
+
     _last_pressed_time = millis();
 }
 
+void Keyboard::_start_service()
+{
+    _keyboard_reader->setEventHandler(_on_key_event, this);
+    if (xTaskCreate(_service_task_func,
+                    "keyboard",
+                    KEYBOARD_SERVICE_STACK_SIZE,
+                    this,
+                    KEYBOARD_SERVICE_PRIORITY,
+                    &_service_task) != pdPASS)
+    {
+        // updateKeyList() polls the reader itself then
+        ESP_LOGE(TAG, "Failed to create keyboard service task, polling instead");
+        _service_task = nullptr;
+        return;
+    }
+    _keyboard_reader->setNotifyTask(_service_task);
+}
+
+void Keyboard::_service_task_func(void* param)
+{
+    Keyboard* keyboard = static_cast<Keyboard*>(param);
+    KeyboardReader* reader = keyboard->_keyboard_reader.get();
+    const uint32_t interval = reader->scanInterval();
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1)
+    {
+        if (interval > 0)
+        {
+            // Scanned readers run on a fixed period
+            xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(interval));
+        }
+        else
+        {
+            // Interrupt driven readers sleep till the ISR notifies
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(KEYBOARD_SERVICE_IRQ_POLL_MS));
+        }
+        reader->update();
+
+        // The app lost events, post what is held now
+        if (keyboard->_resync.exchange(false))
+        {
+            const uint32_t now = millis();
+            for (const auto& key : reader->keyList())
+            {
+                _on_key_event({key, true, now}, keyboard);
+            }
+        }
+    }
+}
+
+void Keyboard::_on_key_event(const KeyEvent_t& event, void* arg)
+{
+    Keyboard* keyboard = static_cast<Keyboard*>(arg);
+    if (!keyboard->_event_queue.push(event))
+    {
+        return;
+    }
+    if (keyboard->_event_callback != nullptr)
+    {
+        keyboard->_event_callback(keyboard->_event_callback_arg);
+    }
+}
+
 uint8_t Keyboard::getKeyNum(Point2D_t keyCoor)
 {
     uint8_t ret = 0;
@@ -76,27 +146,106 @@ uint8_t Keyboard::getKeyNum(Point2D_t keyCoor)
 
 void Keyboard::updateKeyList()
 {
-    if (_keyboard_reader)
+    if (!_keyboard_reader)
+    {
+        return;
+    }
+
+    // No service, read the hardware here
+    if (_service_task == nullptr)
     {
         _keyboard_reader->update();
+    }
 
-        // Update last pressed time if keys are pressed
-        if (!_keyboard_reader->keyList().empty())
+    // Keys tapped before the last call were kept pressed for one update, release them now
+    for (const auto& key : _deferred_releases)
+    {
+        auto it = std::find(_key_list.begin(), _key_list.end(), key);
+        if (it != _key_list.end())
         {
-            _last_pressed_time = millis();
+            _key_list.erase(it);
         }
     }
-}
+    _deferred_releases.clear();
 
-bool Keyboard::isKeyPressing(int keyNum)
-{
-    const auto& keys = keyList();
-    for (const auto& key : keys)
+    // Lost events, drop the rest and start over from what the service reports as held
+    if (_event_queue.takeOverflow())
     {
-        if (getKeyNum(key) == keyNum)
-            return true;
+        ESP_LOGW(TAG, "Key event queue overflow");
+        KeyEvent_t dropped;
+        while (_event_queue.pop(dropped))
+        {
+        }
+        _key_list.clear();
+        _resync = true;
+        if (_service_task == nullptr)
+        {
+            for (const auto& key : _keyboard_reader->keyList())
+            {
+                _key_list.push_back(key);
+            }
+            _resync = false;
+        }
+    }
+
+    _key_events.clear();
+    KeyEvent_t event;
+    while (_event_queue.pop(event))
+    {
+        auto it = std::find(_key_list.begin(), _key_list.end(), event.key);
+        if (event.pressed)
+        {
+            if (it == _key_list.end())
+            {
+                _key_list.push_back(event.key);
+            }
+            // Pressed again right after a tap, keep it
+            auto deferred = std::find(_deferred_releases.begin(), _deferred_releases.end(), event.key);
+            if (deferred != _deferred_releases.end())
+            {
+                _deferred_releases.erase(deferred);
+            }
+        }
+        else if (it != _key_list.end())
+        {
+            // Pressed since the last call, let the app see it once
+            bool tapped = false;
+            for (const auto& e : _key_events)
+            {
+                if (e.pressed && e.key == event.key)
+                {
+                    tapped = true;
+                    break;
+                }
+            }
+            if (tapped)
+            {
+                _deferred_releases.push_back(event.key);
+            }
+            else
+            {
+                _key_list.erase(it);
+            }
+        }
+        _key_events.push_back(event);
+    }
+
+    _last_key_bits = _key_bits;
+    _key_bits = 0;
+    for (const auto& key : _key_list)
+    {
+        const uint8_t key_num = getKeyNum(key);
+        if (key_num > 0 && key_num <= KEYBOARD_KEY_COUNT)
+        {
+            _key_bits |= 1ULL << (key_num - 1);
+        }
+    }
+
+    // Update last pressed time if keys are pressed
+    if (!_key_list.empty())
+    {
+        _last_pressed_time = millis();
     }
-    return false;
 }
 
 bool Keyboard::waitForRelease(int keyNum, int timeout_ms)
@@ -117,65 +266,34 @@ bool Keyboard::waitForRelease(int keyNum, int timeout_ms)
 void Keyboard::updateKeysState()
 {
     _keys_state_buffer.reset();
-    _key_values_without_special_keys.clear();
-
-    const auto& keys = keyList();
-
-    // Process all keys in one pass
-    for (const auto& key : keys)
-    {
-        const auto& key_value = getKeyValue(key);
 
-        switch (key_value.key_type)
-        {
-        case KeyType::TAB:
-            _keys_state_buffer.tab = true;
-            break;
-        case KeyType::FN:
-            _keys_state_buffer.fn = true;
-            break;
-        case KeyType::SHIFT:
-            _keys_state_buffer.shift = true;
-            break;
-        case KeyType::CTRL:
-            _keys_state_buffer.ctrl = true;
-            break;
-        case KeyType::OPT:
-            _keys_state_buffer.opt = true;
-            break;
-        case KeyType::ALT:
-            _keys_state_buffer.alt = true;
-            break;
-        case KeyType::DEL:
-            _keys_state_buffer.del = true;
-            break;
-        case KeyType::ENTER:
-            _keys_state_buffer.enter = true;
-            break;
-        case KeyType::SPACE:
-            _keys_state_buffer.space = true;
-            break;
-        case KeyType::REGULAR:
-        default:
-            _key_values_without_special_keys.push_back(key);
-            break;
-        }
-    }
+    const uint64_t bits = _key_bits;
+    const auto& masks = _key_lut.type_mask;
+    _keys_state_buffer.tab = bits & masks[static_cast<int>(KeyType::TAB)];
+    _keys_state_buffer.fn = bits & masks[static_cast<int>(KeyType::FN)];
+    _keys_state_buffer.shift = bits & masks[static_cast<int>(KeyType::SHIFT)];
+    _keys_state_buffer.ctrl = bits & masks[static_cast<int>(KeyType::CTRL)];
+    _keys_state_buffer.opt = bits & masks[static_cast<int>(KeyType::OPT)];
+    _keys_state_buffer.alt = bits & masks[static_cast<int>(KeyType::ALT)];
+    _keys_state_buffer.del = bits & masks[static_cast<int>(KeyType::DEL)];
+    _keys_state_buffer.enter = bits & masks[static_cast<int>(KeyType::ENTER)];
+    _keys_state_buffer.space = bits & masks[static_cast<int>(KeyType::SPACE)];
 
-    // Process regular keys
+    // Regular keys in key position order
     const bool modifier_active = _keys_state_buffer.ctrl || _keys_state_buffer.shift || _is_caps_locked;
-    for (const auto& key : _key_values_without_special_keys)
+    const char* chars = modifier_active ? _key_lut.second : _key_lut.first;
+    uint64_t regular = bits & masks[static_cast<int>(KeyType::REGULAR)];
+    while (regular)
     {
-        const auto& key_value = getKeyValue(key);
-        _keys_state_buffer.values.push_back(modifier_active ? *key_value.value_second : *key_value.value_first);
+        _keys_state_buffer.values.push_back(chars[__builtin_ctzll(regular)]);
+        regular &= regular - 1;
     }
 }
 
 bool Keyboard::isChanged()
 {
-    const uint8_t current_size = keyList().size();
-    const bool changed = (_last_key_size != current_size);
-    _last_key_size = current_size;
+    const bool changed = (_changed_check_bits != _key_bits);
+    _changed_check_bits = _key_bits;
     return changed;
 }
 
@@ -12,8 +12,16 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <atomic>
 #include "board.h"
 #include "keyboard_reader.h"
+#include "key_event_queue.h"
+
+// Keyboard service task, scans or drains the keyboard in the background
+#define KEYBOARD_SERVICE_STACK_SIZE 3072
+#define KEYBOARD_SERVICE_PRIORITY 5
+// Fallback poll of interrupt driven readers, in case an edge is missed
+#define KEYBOARD_SERVICE_IRQ_POLL_MS 100
 
 #define KEY_A 0x04 // Keyboard a and A
 #define KEY_B 0x05 // Keyboard b and B
@@ -139,6 +147,10 @@
 #define KEY_NUM_RIGHT 55
 #define KEY_NUM_SPACE 56
 
+// Keys on the matrix, KEY_NUM_* - 1 is the key's bit in a key bitset
+#define KEYBOARD_KEY_COUNT 56
+#define KEYBOARD_COLS 14
+
 namespace KEYBOARD
 {
 
@@ -153,7 +165,9 @@ namespace KEYBOARD
         ALT = 6,
         DEL = 7,
         ENTER = 8,
-        SPACE = 9
+        SPACE = 9,
+        // Number of key types, keep last
+        COUNT
     };
 
     const std::vector<int> output_list = {8, 9, 11};
@@ -170,7 +184,7 @@ namespace KEYBOARD
         const KeyType key_type;
     };
 
-    const KeyValue_t _key_value_map[4][14] = {{{"`", KEY_GRAVE, "~", KEY_GRAVE, KeyType::REGULAR},
+    constexpr KeyValue_t _key_value_map[4][KEYBOARD_COLS] = {{{"`", KEY_GRAVE, "~", KEY_GRAVE, KeyType::REGULAR},
                                                {"1", KEY_1, "!", KEY_1, KeyType::REGULAR},
                                                {"2", KEY_2, "@", KEY_2, KeyType::REGULAR},
                                                {"3", KEY_3, "#", KEY_3, KeyType::REGULAR},
@@ -227,6 +241,34 @@ namespace KEYBOARD
                                                {"/", KEY_KPSLASH, "?", KEY_KPSLASH, KeyType::REGULAR},
                                                {"space", KEY_SPACE, "space", KEY_SPACE, KeyType::SPACE}}};
 
+    // Per key position lookup built from _key_value_map at compile time
+    struct KeyLut_t
+    {
+        char first[KEYBOARD_KEY_COUNT];
+        char second[KEYBOARD_KEY_COUNT];
+        // Bitset of the keys of each KeyType
+        uint64_t type_mask[static_cast<int>(KeyType::COUNT)];
+    };
+
+    constexpr KeyLut_t _make_key_lut()
+    {
+        KeyLut_t lut = {};
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < KEYBOARD_COLS; x++)
+            {
+                const KeyValue_t& value = _key_value_map[y][x];
+                const int i = y * KEYBOARD_COLS + x;
+                lut.first[i] = value.value_first[0];
+                lut.second[i] = value.value_second[0];
+                lut.type_mask[static_cast<int>(value.key_type)] |= 1ULL << i;
+            }
+        }
+        return lut;
+    }
+
+    constexpr KeyLut_t _key_lut = _make_key_lut();
+
     class Keyboard
     {
     public:
@@ -264,11 +306,28 @@ namespace KEYBOARD
 
     private:
         std::unique_ptr<KeyboardReader> _keyboard_reader;
-        std::vector<Point2D_t> _key_values_without_special_keys;
         KeysState _keys_state_buffer;
 
+        // Filled by the service task, drained in updateKeyList()
+        KeyEventQueue _event_queue;
+        std::atomic<bool> _resync{false};
+        TaskHandle_t _service_task;
+        void (*_event_callback)(void*);
+        void* _event_callback_arg;
+        // App side state, rebuilt from the events
+        std::vector<Point2D_t> _key_list;
+        std::vector<KeyEvent_t> _key_events;
+        std::vector<Point2D_t> _deferred_releases;
+        // Pressed keys as bits (KEY_NUM_* - 1), now and at the previous updateKeyList()
+        uint64_t _key_bits;
+        uint64_t _last_key_bits;
+        uint64_t _changed_check_bits;
+
+        void _start_service();
+        static void _service_task_func(void* param);
+        static void _on_key_event(const KeyEvent_t& event, void* arg);
+
         bool _is_caps_locked;
-        uint8_t _last_key_size;
         uint32_t _last_pressed_time;
         bool _is_dimmed;
 
@@ -276,7 +335,8 @@ namespace KEYBOARD
 
     public:
         Keyboard(HAL::BoardType board_type = HAL::BoardType::AUTO_DETECT)
-            : _is_caps_locked(false), _last_key_size(0), _board_type(board_type)
+            : _service_task(nullptr), _event_callback(nullptr), _event_callback_arg(nullptr), _key_bits(0),
+              _last_key_bits(0), _changed_check_bits(0), _is_caps_locked(false), _board_type(board_type)
         {
         }
         void init();
@@ -285,20 +345,55 @@ namespace KEYBOARD
 
         uint8_t getKeyNum(Point2D_t keyCoor);
 
+        /**
+         * @brief Take the key events posted by the keyboard service since the last call and update keyList()
+         * Cheap, no hardware access while the service is running. A key pressed and released in between
+         * stays in keyList() until the next call, so short taps are not missed.
+         */
         void updateKeyList();
-        inline const std::vector<KEYBOARD::Point2D_t>& keyList() const
+        inline const std::vector<KEYBOARD::Point2D_t>& keyList() const { return _key_list; }
+
+        /**
+         * @brief Key events taken by the last updateKeyList(), oldest first
+         */
+        inline const std::vector<KeyEvent_t>& keyEvents() const { return _key_events; }
+
+        /**
+         * @brief Set a callback run by the keyboard service after each key event, e.g. to wake up the app loop
+         * Runs in the service task, keep it short.
+         */
+        inline void setEventCallback(void (*callback)(void*), void* arg = nullptr)
         {
-            if (_keyboard_reader)
-            {
-                return _keyboard_reader->keyList();
-            }
-            static const std::vector<KEYBOARD::Point2D_t> empty_list;
-            return empty_list;
+            _event_callback_arg = arg;
+            _event_callback = callback;
         }
 
         inline KeyValue_t getKeyValue(const Point2D_t& keyCoor) { return _key_value_map[keyCoor.y][keyCoor.x]; }
 
-        bool isKeyPressing(int keyNum);
+        inline bool isKeyPressing(int keyNum) const
+        {
+            return keyNum > 0 && keyNum <= KEYBOARD_KEY_COUNT && ((_key_bits >> (keyNum - 1)) & 1);
+        }
+
+        /**
+         * @brief Pressed keys as a bitset, bit KEY_NUM_* - 1 is set while the key is pressed
+         */
+        inline uint64_t keyBits() const { return _key_bits; }
+
+        /**
+         * @brief Keys that went down / up in the last updateKeyList(), same bit layout as keyBits()
+         */
+        inline uint64_t pressedEdges() const { return (_key_bits ^ _last_key_bits) & _key_bits; }
+        inline uint64_t releasedEdges() const { return (_key_bits ^ _last_key_bits) & _last_key_bits; }
+
+        /**
+         * @brief Check if a key went down in the last updateKeyList(), unlike isKeyPressing() true only once per press
+         */
+        inline bool wasKeyPressed(int keyNum) const
+        {
+            return keyNum > 0 && keyNum <= KEYBOARD_KEY_COUNT && ((pressedEdges() >> (keyNum - 1)) & 1);
+        }
+
         bool waitForRelease(int keyNum, int timeout_ms = 0);
         uint32_t lastPressedTime() const;
 
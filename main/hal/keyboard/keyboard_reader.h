@@ -9,6 +9,9 @@
 #pragma once
 #include <vector>
 #include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "esp_timer.h"
 
 namespace KEYBOARD
 {
@@ -20,6 +23,15 @@ namespace KEYBOARD
         bool operator==(const Point2D_t& other) const { return x == other.x && y == other.y; }
     };
 
+    struct KeyEvent_t
+    {
+        Point2D_t key;
+        bool pressed;  // true = pressed, false = released
+        uint32_t time; // ms since boot, when the change was detected
+    };
+
+    typedef void (*KeyEventHandler_t)(const KeyEvent_t& event, void* arg);
+
     struct Chart_t
     {
         uint8_t value;
@@ -57,8 +69,41 @@ namespace KEYBOARD
          */
         inline const std::vector<Point2D_t>& keyList() const { return _key_list; }
 
+        /**
+         * @brief Time between update() calls the reader needs
+         * @return Scan period in ms, 0 if update() only has work to do after the notify task was woken
+         */
+        virtual uint32_t scanInterval() const { return 0; }
+
+        /**
+         * @brief Set the handler called from update() for every key press and release
+         */
+        inline void setEventHandler(KeyEventHandler_t handler, void* arg)
+        {
+            _event_handler = handler;
+            _event_handler_arg = arg;
+        }
+
+        /**
+         * @brief Set the task to notify (xTaskNotifyGive) when the hardware has new key events
+         */
+        inline void setNotifyTask(TaskHandle_t task) { _notify_task = task; }
+
     protected:
         std::vector<Point2D_t> _key_list;
+        TaskHandle_t _notify_task = nullptr;
+
+        inline void _post_event(const Point2D_t& key, bool pressed)
+        {
+            if (_event_handler == nullptr)
+                return;
+            KeyEvent_t event = {key, pressed, (uint32_t)(esp_timer_get_time() / 1000)};
+            _event_handler(event, _event_handler_arg);
+        }
+
+    private:
+        KeyEventHandler_t _event_handler = nullptr;
+        void* _event_handler_arg = nullptr;
     };
 
 } // namespace KEYBOARD
@@ -8,6 +8,7 @@
  */
 #include "keyboard_reader_iomatrix.h"
 #include <driver/gpio.h>
+#include <algorithm>
 
 #define digitalWrite(pin, level) gpio_set_level((gpio_num_t)pin, level)
 #define digitalRead(pin) gpio_get_level((gpio_num_t)pin)
@@ -55,11 +56,48 @@ namespace KEYBOARD
         }
 
         _set_output(output_list, 0);
+
+        // Enough for any sane number of keys held at once, so scans don't allocate
+        _key_list.reserve(16);
+        _scan_list.reserve(16);
+        _last_scan_list.reserve(16);
     }
 
     void IOMatrixKeyboardReader::update()
     {
-        _key_list.clear();
+        _scan(_scan_list);
+
+        // Debounce, a new state must be read the same a few scans in a row
+        if (_scan_list == _last_scan_list)
+        {
+            if (_stable_count < KEYBOARD_DEBOUNCE_SCANS)
+                _stable_count++;
+        }
+        else
+        {
+            _last_scan_list.swap(_scan_list);
+            _stable_count = 1;
+        }
+        if (_stable_count < KEYBOARD_DEBOUNCE_SCANS || _last_scan_list == _key_list)
+            return;
+
+        // Post the differences against the last taken state
+        for (const auto& key : _key_list)
+        {
+            if (std::find(_last_scan_list.begin(), _last_scan_list.end(), key) == _last_scan_list.end())
+                _post_event(key, false);
+        }
+        for (const auto& key : _last_scan_list)
+        {
+            if (std::find(_key_list.begin(), _key_list.end(), key) == _key_list.end())
+                _post_event(key, true);
+        }
+        _key_list = _last_scan_list;
+    }
+
+    void IOMatrixKeyboardReader::_scan(std::vector<Point2D_t>& keyList)
+    {
+        keyList.clear();
 
         Point2D_t coor;
         uint8_t input_value = 0;
@@ -86,7 +124,7 @@ namespace KEYBOARD
                         coor.y = -coor.y;
                         coor.y = coor.y + 3;
 
-                        _key_list.push_back(coor);
+                        keyList.push_back(coor);
                     }
                 }
             }
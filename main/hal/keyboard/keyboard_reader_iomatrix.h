@@ -10,13 +10,19 @@
 #include "keyboard_reader.h"
 #include <driver/gpio.h>
 
+// Matrix scan period when scanned by the keyboard service
+#define KEYBOARD_SCAN_INTERVAL_MS 5
+// Scans a new key state has to stay the same before it is taken
+#define KEYBOARD_DEBOUNCE_SCANS 2
+
 namespace KEYBOARD
 {
     /**
      * @brief IO Matrix keyboard reader implementation for CARDPUTER
      *
      * This implementation uses GPIO matrix scanning to read keyboard state.
-     * It scans 8 outputs and 7 inputs to detect key presses.
+     * It scans 8 outputs and 7 inputs to detect key presses, and posts events
+     * once a changed state is stable for KEYBOARD_DEBOUNCE_SCANS scans.
      */
     class IOMatrixKeyboardReader : public KeyboardReader
     {
@@ -26,6 +32,7 @@ namespace KEYBOARD
 
         void init() override;
         void update() override;
+        uint32_t scanInterval() const override { return KEYBOARD_SCAN_INTERVAL_MS; }
 
     private:
         const std::vector<int> output_list = {8, 9, 11};
@@ -33,8 +40,13 @@ namespace KEYBOARD
 
         const Chart_t X_map_chart[7] = {{1, 0, 1}, {2, 2, 3}, {4, 4, 5}, {8, 6, 7}, {16, 8, 9}, {32, 10, 11}, {64, 12, 13}};
 
+        std::vector<Point2D_t> _scan_list;
+        std::vector<Point2D_t> _last_scan_list;
+        uint8_t _stable_count = 0;
+
         void _set_output(const std::vector<int>& pinList, uint8_t output);
         uint8_t _get_input(const std::vector<int>& pinList);
+        void _scan(std::vector<Point2D_t>& keyList);
     };
 
 } // namespace KEYBOARD
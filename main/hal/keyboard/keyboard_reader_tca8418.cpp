@@ -11,6 +11,8 @@
 #include <algorithm>
 
 #define TAG "KB_TCA8418"
+// Depth of the TCA8418 key event FIFO
+#define TCA8418_FIFO_SIZE 10
 
 namespace KEYBOARD
 {
@@ -47,6 +49,14 @@ namespace KEYBOARD
     {
         TCA8418KeyboardReader* reader = static_cast<TCA8418KeyboardReader*>(arg);
         reader->_isr_flag = true;
+
+        // Wake the keyboard service to drain the FIFO
+        if (reader->_notify_task != nullptr)
+        {
+            BaseType_t woken = pdFALSE;
+            vTaskNotifyGiveFromISR(reader->_notify_task, &woken);
+            portYIELD_FROM_ISR(woken);
+        }
     }
 
     void TCA8418KeyboardReader::init()
@@ -99,22 +109,34 @@ namespace KEYBOARD
 
     void TCA8418KeyboardReader::update()
     {
-        if (!_isr_flag)
+        if (!_init_success)
         {
             return;
         }
 
-        // Get the key event
-        uint8_t event_raw = _tca8418->get_event();
-
-        // Skip if no event
-        if (event_raw == 0)
+        // INT is active low, also catches an edge missed while the flag was being cleared
+        if (!_isr_flag && _interrupt_pin >= 0 && gpio_get_level((gpio_num_t)_interrupt_pin))
         {
-            _isr_flag = false;
             return;
         }
 
-        _key_event_raw_buffer = getKeyEventRaw(event_raw);
+        // Drain the whole FIFO, so keys tapped while nobody was reading are not lost
+        for (int i = 0; i < TCA8418_FIFO_SIZE; i++)
+        {
+            uint8_t event_raw = _tca8418->get_event();
+            if (event_raw == 0)
+            {
+                break;
+            }
+
+            _key_event_raw_buffer = getKeyEventRaw(event_raw);
+
+            // Remap to match CARDPUTER coordinate system
+            remap(_key_event_raw_buffer);
+
+            // Update the key list
+            updateKeyList(_key_event_raw_buffer);
+        }
 
         // Try to clear the IRQ flag
         // If there are pending events it is not cleared
@@ -126,12 +148,6 @@ namespace KEYBOARD
         {
             _isr_flag = false;
         }
-
-        // Remap to match CARDPUTER coordinate system
-        remap(_key_event_raw_buffer);
-
-        // Update the key list
-        updateKeyList(_key_event_raw_buffer);
     }
 
     TCA8418KeyboardReader::KeyEventRaw_t TCA8418KeyboardReader::getKeyEventRaw(const uint8_t& eventRaw)
@@ -180,6 +196,7 @@ namespace KEYBOARD
             if (it == _key_list.end())
             {
                 _key_list.push_back(point);
+                _post_event(point, true);
             }
         }
         else
@@ -189,6 +206,7 @@ namespace KEYBOARD
             if (it != _key_list.end())
             {
                 _key_list.erase(it);
+                _post_event(point, false);
             }
         }
     }
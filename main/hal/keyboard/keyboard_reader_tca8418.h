@@ -28,7 +28,8 @@ namespace KEYBOARD
      * @brief TCA8418 I2C keyboard reader implementation for CARDPUTER_ADV
      *
      * This implementation uses the TCA8418 I2C keyboard controller to read
-     * keyboard state via interrupt-driven events.
+     * keyboard state via interrupt-driven events. The controller debounces keys and
+     * queues up to 10 events in its FIFO, update() drains all of them.
      */
     class TCA8418KeyboardReader : public KeyboardReader
     {
@@ -38,6 +39,8 @@ namespace KEYBOARD
 
         void init() override;
         void update() override;
+        // Interrupt driven, polled only without an interrupt pin
+        uint32_t scanInterval() const override { return _interrupt_pin >= 0 ? 0 : 10; }
         bool isInitialized() const { return _init_success; }
 
     private:
@@ -9,7 +9,6 @@
 #include "led.h"
 #include "esp_log.h"
 #include <cstring>
-#include <cmath>
 
 static const char* TAG = "LED";
 
@@ -86,13 +85,13 @@ namespace HAL
         LED* led = static_cast<LED*>(arg);
         if (led)
         {
-            led->process_pattern();
+            led->play_frame();
         }
     }
 
     LED::LED(int gpio_num)
         : _initialized(false), _gpio_num(gpio_num), _led_chan(nullptr), _encoder(nullptr), _timer(nullptr), _mutex(nullptr),
-          _mode(LEDMode::OFF), _color(), _param1(0), _param2(0), _param3(0), _param4(0), _pattern_step(0), _fade_step(0)
+          _pending(nullptr), _playing(nullptr), _frame(0)
     {
         memset(_led_pixel, 0, sizeof(_led_pixel));
     }
@@ -200,7 +199,7 @@ namespace HAL
         }
 
         _initialized = true;
-        _mode = LEDMode::OFF;
+        _requested = LEDAnimation::constant(Color());
         set_pixel_off();
         update_led();
 
@@ -215,13 +214,20 @@ namespace HAL
             return true;
         }
 
-        // Stop timer
+        // Stop timer, a running callback may arm it again for its next frame
         if (_timer)
         {
             esp_timer_stop(_timer);
-            esp_timer_delete(_timer);
+            while (esp_timer_delete(_timer) == ESP_ERR_INVALID_STATE)
+            {
+                esp_timer_stop(_timer);
+            }
             _timer = nullptr;
         }
+        delete _pending.exchange(nullptr);
+        delete _playing;
+        _playing = nullptr;
+        _requested = LEDAnimation();
 
         // Turn off LED
         set_pixel_off();
@@ -272,359 +278,102 @@ namespace HAL
 
     void LED::set_pixel_off() { memset(_led_pixel, 0, sizeof(_led_pixel)); }
 
-    void LED::stop_timer()
-    {
-        if (_timer && _initialized)
-        {
-            esp_timer_stop(_timer);
-        }
-    }
-
-    void LED::start_timer(uint64_t period_us)
-    {
-        if (_timer && _initialized)
-        {
-            esp_timer_stop(_timer);
-
-            esp_timer_start_once(_timer, period_us);
-        }
-    }
-
-    void LED::process_pattern()
+    void LED::play_frame()
     {
-        // Check if mutex is valid
-        if (_mutex == nullptr)
+        // Only the timer touches the playback state, tables are handed over by the pointer exchange
+        LEDAnimation* next = _pending.exchange(nullptr);
+        if (next != nullptr)
         {
-            return;
+            delete _playing;
+            _playing = next;
+            _frame = 0;
         }
-
-        // Lock mutex to protect shared state
-        if (xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
+        if (_playing == nullptr || _frame >= _playing->frames.size())
         {
             return;
         }
 
-        switch (_mode)
-        {
-        case LEDMode::SINGLE_BLINK:
-        {
-            if (_pattern_step == 0)
-            {
-                set_pixel_color(_color);
-                update_led();
-                start_timer(_param1 * 1000); // on_ms
-                _pattern_step = 1;
-            }
-            else
-            {
-                set_pixel_off();
-                update_led();
-                stop_timer();
-                _mode = LEDMode::OFF;
-                _pattern_step = 0;
-            }
-            break;
-        }
+        const led_frame_t& frame = _playing->frames[_frame];
+        set_pixel_color(frame.color);
+        update_led();
 
-        case LEDMode::PERIODIC_BLINK:
+        if (++_frame == _playing->frames.size())
         {
-            if (_pattern_step == 0)
+            if (_playing->holds())
             {
-                // Turn on
-                set_pixel_color(_color);
-                update_led();
-                start_timer(_param1 * 1000); // on_ms
-                _pattern_step = 1;
+                return;
             }
-            else
-            {
-                // Turn off
-                set_pixel_off();
-                update_led();
-                start_timer(_param2 * 1000); // off_ms
-                _pattern_step = 0;
-            }
-            break;
+            _frame = 0;
         }
-
-        case LEDMode::DOUBLE_BLINK:
+        if (frame.duration_ms > 0)
         {
-            switch (_pattern_step)
-            {
-            case 0: // First blink on
-                _cur_color = _color;
-                set_pixel_color(_cur_color);
-                update_led();
-                start_timer(_param1 * 1000); // blink_ms
-                _pattern_step = 1;
-                break;
-            case 1: // First blink off (gap)
-                set_pixel_off();
-                update_led();
-                start_timer(_param2 * 1000); // gap_ms
-                _pattern_step = 2;
-                break;
-            case 2: // Second blink on
-                set_pixel_color(_cur_color);
-                update_led();
-                start_timer(_param1 * 1000); // blink_ms
-                _pattern_step = 3;
-                break;
-            case 3: // Second blink off (pause)
-                set_pixel_off();
-                update_led();
-                start_timer(_param4 * 1000); // pause_ms
-                _pattern_step = 0;
-                break;
-            }
-            break;
+            esp_timer_start_once(_timer, (uint64_t)frame.duration_ms * 1000);
         }
-
-        case LEDMode::FADE:
-        {
-            uint32_t total_fade_steps = FADE_STEPS * 2 + 1; // fade in + hold + fade out
-
-            if (_fade_step <= FADE_STEPS)
-            {
-                // Fade in
-                float brightness = static_cast<float>(_fade_step) / FADE_STEPS;
-                Color faded_color(static_cast<uint8_t>(_color.r * brightness),
-                                  static_cast<uint8_t>(_color.g * brightness),
-                                  static_cast<uint8_t>(_color.b * brightness));
-                set_pixel_color(faded_color);
-                update_led();
-
-                if (_fade_step == FADE_STEPS)
-                {
-                    // At peak, hold
-                    start_timer(_param3 * 1000); // hold_ms
-                }
-                else
-                {
-                    start_timer((_param1 * 1000) / FADE_STEPS); // fade_in_ms per step
-                }
-                _fade_step++;
-            }
-            else if (_fade_step == FADE_STEPS + 1)
-            {
-                // Done holding, start fade out
-                _fade_step++;
-                start_timer((_param2 * 1000) / FADE_STEPS); // fade_out_ms per step
-            }
-            else if (_fade_step < total_fade_steps + 1)
-            {
-                // Fade out
-                uint32_t fade_out_step = _fade_step - FADE_STEPS - 1;
-                float brightness = 1.0f - (static_cast<float>(fade_out_step) / FADE_STEPS);
-                Color faded_color(static_cast<uint8_t>(_color.r * brightness),
-                                  static_cast<uint8_t>(_color.g * brightness),
-                                  static_cast<uint8_t>(_color.b * brightness));
-                set_pixel_color(faded_color);
-                update_led();
-                _fade_step++;
-            }
-            else
-            {
-                // Complete cycle, restart
-                set_pixel_off();
-                update_led();
-                _fade_step = 0;
-            }
-            break;
-        }
-
-        case LEDMode::CONSTANT:
-        case LEDMode::OFF:
-        default:
-            // Nothing to do
-            stop_timer();
-            break;
-        }
-
-        // Release mutex
-        xSemaphoreGive(_mutex);
     }
 
-    bool LED::set_color(const Color& color)
+    bool LED::play(const LEDAnimation& animation)
     {
-        if (!check_initialized())
+        if (!check_initialized() || animation.frames.empty())
         {
             return false;
         }
 
-        // Lock mutex to protect shared state
+        // Lock mutex to serialize callers
         if (xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
         {
             return false;
         }
 
-        stop_timer();
-        _mode = LEDMode::CONSTANT;
-        _color = color;
-        set_pixel_color(color);
-        update_led();
-
-        // Release mutex
-        xSemaphoreGive(_mutex);
-        return true;
-    }
-
-    bool LED::off()
-    {
-        if (!check_initialized())
+        // Status callbacks ask for the same pattern again and again, let it run on in phase.
+        // A one shot pattern is played again though
+        if ((animation.loop || animation.frames.size() == 1) && animation == _requested)
         {
-            return false;
+            xSemaphoreGive(_mutex);
+            return true;
         }
+        _requested = animation;
 
-        // Lock mutex to protect shared state
-        if (xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
+        // A table the timer didn't take yet is still ours to free
+        delete _pending.exchange(new LEDAnimation(animation));
+
+        // Fire now, the callback may be arming the timer for its current frame meanwhile
+        esp_timer_stop(_timer);
+        while (esp_timer_start_once(_timer, 0) == ESP_ERR_INVALID_STATE)
         {
-            return false;
+            esp_timer_stop(_timer);
         }
 
-        stop_timer();
-        _mode = LEDMode::OFF;
-        set_pixel_off();
-        update_led();
-
         // Release mutex
         xSemaphoreGive(_mutex);
         return true;
     }
 
-    bool LED::blink_once(const Color& color, uint32_t duration_ms)
-    {
-        if (!check_initialized())
-        {
-            return false;
-        }
-
-        // Lock mutex to protect shared state
-        if (xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
-        {
-            return false;
-        }
+    bool LED::set_color(const Color& color) { return play(LEDAnimation::constant(color)); }
 
-        stop_timer();
-        _mode = LEDMode::SINGLE_BLINK;
-        _color = color;
-        _param1 = duration_ms;
-        _pattern_step = 0;
-        start_timer(1000);
+    bool LED::off() { return play(LEDAnimation::constant(Color())); }
 
-        // Release mutex
-        xSemaphoreGive(_mutex);
-        return true;
+    bool LED::blink_once(const Color& color, uint32_t duration_ms)
+    {
+        return play(LEDAnimation::blink_once(color, duration_ms));
     }
 
     bool LED::blink_periodic(const Color& color, uint32_t on_ms, uint32_t off_ms)
     {
-        if (!check_initialized())
-        {
-            return false;
-        }
-
-        // Lock mutex to protect shared state
-        if (xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
-        {
-            return false;
-        }
-
-        if (_mode == LEDMode::PERIODIC_BLINK)
-        {
-            _color = color;
-            _param1 = on_ms;
-            _param2 = off_ms;
-        }
-        else
-        {
-            stop_timer();
-            _mode = LEDMode::PERIODIC_BLINK;
-            _color = color;
-            _param1 = on_ms;
-            _param2 = off_ms;
-            _pattern_step = 0;
-            start_timer(1000);
-        }
-        // Release mutex
-        xSemaphoreGive(_mutex);
-        return true;
+        return play(LEDAnimation::blink(color, on_ms, off_ms));
     }
 
     bool LED::blink_periodic_double(const Color& color, uint32_t blink_ms, uint32_t gap_ms, uint32_t period_ms)
     {
-        if (!check_initialized())
-        {
-            return false;
-        }
-
-        // Calculate pause after second blink
-        uint32_t pause_ms = period_ms - (2 * blink_ms + gap_ms);
-
-        // Lock mutex to protect shared state
-        if (xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
-        {
-            return false;
-        }
-
-        if (_mode == LEDMode::DOUBLE_BLINK)
-        {
-            _color = color;
-            _param1 = blink_ms;
-            _param2 = gap_ms;
-            _param3 = period_ms;
-            _param4 = pause_ms;
-        }
-        else
-        {
-            stop_timer();
-            _mode = LEDMode::DOUBLE_BLINK;
-            _color = color;
-            _param1 = blink_ms;
-            _param2 = gap_ms;
-            _param3 = period_ms;
-            _param4 = pause_ms;
-            _pattern_step = 0;
-            start_timer(1000);
-        }
-
-        // Release mutex
-        xSemaphoreGive(_mutex);
-        return true;
+        return play(LEDAnimation::double_blink(color, blink_ms, gap_ms, period_ms));
     }
 
     bool LED::fade(const Color& color, uint32_t fade_in_ms, uint32_t fade_out_ms, uint32_t hold_ms)
     {
-        if (!check_initialized())
-        {
-            return false;
-        }
-
-        // Lock mutex to protect shared state
-        if (xSemaphoreTake(_mutex, portMAX_DELAY) != pdTRUE)
-        {
-            return false;
-        }
-
-        stop_timer();
-        _mode = LEDMode::FADE;
-        _color = color;
-        _param1 = fade_in_ms;
-        _param2 = fade_out_ms;
-        _param3 = hold_ms;
-        _fade_step = 0;
-
-        // Start fade in
-        start_timer((fade_in_ms * 1000) / FADE_STEPS);
-
-        // Release mutex
-        xSemaphoreGive(_mutex);
-        return true;
+        return play(LEDAnimation::fade(color, fade_in_ms, fade_out_ms, hold_ms));
     }
 
     bool LED::stop()
     {
-        // off() already has mutex protection
         return off();
     }
 
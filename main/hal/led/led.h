@@ -13,38 +13,17 @@
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "led_animation.h"
 #include <stdint.h>
+#include <atomic>
 
 namespace HAL
 {
-    /**
-     * @brief RGB color structure
-     */
-    struct Color
-    {
-        uint8_t r; ///< Red component (0-255)
-        uint8_t g; ///< Green component (0-255)
-        uint8_t b; ///< Blue component (0-255)
-
-        Color() : r(0), g(0), b(0) {}
-        Color(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
-    };
-
-    /**
-     * @brief LED mode enumeration
-     */
-    enum class LEDMode
-    {
-        OFF,
-        CONSTANT,
-        SINGLE_BLINK,
-        PERIODIC_BLINK,
-        DOUBLE_BLINK,
-        FADE
-    };
-
     /**
      * @brief LED class for controlling WS2812 RGB LED
+     *
+     * Patterns are precomputed into frame tables and played back by a one shot timer, woken once per
+     * frame. Asking again for the pattern that's playing changes nothing
      */
     class LED
     {
@@ -120,6 +99,13 @@ namespace HAL
          */
         bool stop();
 
+        /**
+         * @brief Play a frame table, the patterns above are made with LEDAnimation
+         * @param animation Frames to play
+         * @return true on success, false otherwise
+         */
+        bool play(const LEDAnimation& animation);
+
     private:
         // RMT encoder callback
         static size_t ws2812_encoder_callback(const void* data,
@@ -137,9 +123,7 @@ namespace HAL
         void update_led();
         void set_pixel_color(const Color& color);
         void set_pixel_off();
-        void process_pattern();
-        void stop_timer();
-        void start_timer(uint64_t period_us);
+        void play_frame();
         bool check_initialized();
 
         // State variables
@@ -148,15 +132,15 @@ namespace HAL
         rmt_channel_handle_t _led_chan;
         rmt_encoder_handle_t _encoder;
         esp_timer_handle_t _timer;
-        SemaphoreHandle_t _mutex; // Mutex for serializing access to shared data
+        SemaphoreHandle_t _mutex; // Serializes callers, never taken by the timer
+
+        // Last pattern asked for, under the mutex
+        LEDAnimation _requested;
 
-        // Pattern state
-        LEDMode _mode;
-        Color _color;
-        Color _cur_color;
-        uint32_t _param1, _param2, _param3, _param4;
-        uint32_t _pattern_step;
-        uint32_t _fade_step;
+        // Handed to the timer by pointer exchange, then owned by it with the playback position
+        std::atomic<LEDAnimation*> _pending;
+        LEDAnimation* _playing;
+        size_t _frame;
 
         // Pixel buffer (GRB format for WS2812)
         uint8_t _led_pixel[3];
@@ -164,7 +148,6 @@ namespace HAL
     public:
         // WS2812 timing constants
         static constexpr uint32_t RMT_RESOLUTION_HZ = 10000000; // 10MHz
-        static constexpr uint32_t FADE_STEPS = 50;
     };
 
 } // namespace HAL
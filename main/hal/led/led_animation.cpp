@@ -0,0 +1,134 @@
+/**
+ * @file led_animation.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "led_animation.h"
+
+namespace HAL
+{
+    static Color _scale(const Color& color, uint32_t level)
+    {
+        return Color(color.r * level / LEDAnimation::FADE_STEPS,
+                     color.g * level / LEDAnimation::FADE_STEPS,
+                     color.b * level / LEDAnimation::FADE_STEPS);
+    }
+
+    void LEDAnimation::_push(const Color& color, uint32_t duration_ms)
+    {
+        if (duration_ms == 0)
+        {
+            return;
+        }
+        if (!frames.empty() && frames.back().color == color)
+        {
+            frames.back().duration_ms += duration_ms;
+            return;
+        }
+        frames.push_back({color, duration_ms});
+    }
+
+    void LEDAnimation::_close(void)
+    {
+        // Looping back to the same color is one frame, not two timer shots
+        if (loop && frames.size() > 1 && frames.front().color == frames.back().color)
+        {
+            frames.front().duration_ms += frames.back().duration_ms;
+            frames.pop_back();
+        }
+        if (loop && frames.size() == 1)
+        {
+            frames[0].duration_ms = 0;
+        }
+    }
+
+    LEDAnimation LEDAnimation::constant(const Color& color)
+    {
+        LEDAnimation animation;
+        animation.frames.push_back({color, 0});
+        return animation;
+    }
+
+    LEDAnimation LEDAnimation::blink_once(const Color& color, uint32_t duration_ms)
+    {
+        LEDAnimation animation;
+        animation._push(color, duration_ms);
+        animation.frames.push_back({Color(), 0});
+        return animation;
+    }
+
+    LEDAnimation LEDAnimation::blink(const Color& color, uint32_t on_ms, uint32_t off_ms)
+    {
+        LEDAnimation animation;
+        animation.loop = true;
+        animation._push(color, on_ms);
+        animation._push(Color(), off_ms);
+        animation._close();
+        return animation;
+    }
+
+    LEDAnimation LEDAnimation::double_blink(const Color& color, uint32_t blink_ms, uint32_t gap_ms, uint32_t period_ms)
+    {
+        LEDAnimation animation;
+        animation.loop = true;
+        const uint32_t busy_ms = 2 * blink_ms + gap_ms;
+        animation._push(color, blink_ms);
+        animation._push(Color(), gap_ms);
+        animation._push(color, blink_ms);
+        animation._push(Color(), period_ms > busy_ms ? period_ms - busy_ms : 0);
+        animation._close();
+        return animation;
+    }
+
+    LEDAnimation LEDAnimation::fade(const Color& color, uint32_t fade_in_ms, uint32_t fade_out_ms, uint32_t hold_ms)
+    {
+        LEDAnimation animation;
+        animation.loop = true;
+
+        // Step times are rounded from the ramp start, so the ramps keep their length
+        for (uint32_t step = 0; step < FADE_STEPS; step++)
+        {
+            uint32_t duration = fade_in_ms * (step + 1) / FADE_STEPS - fade_in_ms * step / FADE_STEPS;
+            animation._push(_scale(color, step), duration);
+        }
+        animation._push(color, hold_ms);
+        for (uint32_t step = 0; step < FADE_STEPS; step++)
+        {
+            uint32_t duration = fade_out_ms * (step + 1) / FADE_STEPS - fade_out_ms * step / FADE_STEPS;
+            animation._push(_scale(color, FADE_STEPS - step), duration);
+        }
+        animation._close();
+        return animation;
+    }
+
+    uint32_t LEDAnimation::period_ms(void) const
+    {
+        uint32_t period = 0;
+        for (const auto& frame : frames)
+        {
+            period += frame.duration_ms;
+        }
+        return period;
+    }
+
+    bool LEDAnimation::operator==(const LEDAnimation& other) const
+    {
+        if (loop != other.loop || frames.size() != other.frames.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            if (frames[i].color != other.frames[i].color || frames[i].duration_ms != other.frames[i].duration_ms)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace HAL
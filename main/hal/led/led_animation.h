@@ -0,0 +1,80 @@
+/**
+ * @file led_animation.h
+ * @brief LED patterns precomputed into frame tables, free of IDF dependencies
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace HAL
+{
+    /**
+     * @brief RGB color structure
+     */
+    struct Color
+    {
+        uint8_t r; ///< Red component (0-255)
+        uint8_t g; ///< Green component (0-255)
+        uint8_t b; ///< Blue component (0-255)
+
+        Color() : r(0), g(0), b(0) {}
+        Color(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+
+        bool operator==(const Color& other) const { return r == other.r && g == other.g && b == other.b; }
+        bool operator!=(const Color& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @brief One color shown for a while
+     */
+    struct led_frame_t
+    {
+        Color color;
+        uint32_t duration_ms; ///< 0 holds the frame till the next animation
+    };
+
+    /**
+     * @brief Frame table of a pattern, played back one timer shot per frame
+     *
+     * Consecutive frames of the same color are merged, so a dim fade has fewer frames than steps
+     */
+    struct LEDAnimation
+    {
+        std::vector<led_frame_t> frames;
+        bool loop = false;
+
+        /// Brightness steps of each fade ramp
+        static constexpr uint32_t FADE_STEPS = 50;
+
+        static LEDAnimation constant(const Color& color);
+        static LEDAnimation blink_once(const Color& color, uint32_t duration_ms);
+        static LEDAnimation blink(const Color& color, uint32_t on_ms, uint32_t off_ms);
+        static LEDAnimation double_blink(const Color& color, uint32_t blink_ms, uint32_t gap_ms, uint32_t period_ms);
+        static LEDAnimation fade(const Color& color, uint32_t fade_in_ms, uint32_t fade_out_ms, uint32_t hold_ms);
+
+        /**
+         * @brief Check if the last frame stays on, playback stops there
+         */
+        bool holds(void) const { return frames.size() <= 1 || !loop; }
+
+        /**
+         * @brief Total length of one pass, without a final hold
+         */
+        uint32_t period_ms(void) const;
+
+        bool operator==(const LEDAnimation& other) const;
+        bool operator!=(const LEDAnimation& other) const { return !(*this == other); }
+
+    private:
+        void _push(const Color& color, uint32_t duration_ms);
+        void _close(void);
+    };
+
+} // namespace HAL
@@ -16,8 +16,11 @@
 #include "driver/sdmmc_host.h"
 #include "driver/sdspi_host.h"
 #include "esp_vfs_fat.h"
+#include "diskio_impl.h"
+#include "diskio_sdmmc.h"
 #include "sdmmc_cmd.h"
 #include "sdcard.h"
+#include "trace/trace.h"
 
 #define PIN_NUM_MISO 39
 #define PIN_NUM_MOSI 14
@@ -27,8 +30,47 @@
 static const char* MOUNT_POINT = "/sdcard";
 static const char* TAG = "SDCARD";
 
+/**
+ * @brief FATFS disk driver of the card, sectors go through the shared cache
+ */
+struct SDCardDiskIO
+{
+    static SDCard* sdcard;
+
+    static DSTATUS init(BYTE pdrv) { return 0; }
+    static DSTATUS status(BYTE pdrv) { return 0; }
+
+    static DRESULT read(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count)
+    {
+        return sdcard->_cache->read(sdcard->_cache_dev, sector, count, buff) ? RES_OK : RES_ERROR;
+    }
+
+    static DRESULT write(BYTE pdrv, const BYTE* buff, LBA_t sector, UINT count)
+    {
+        return sdcard->_cache->write(sdcard->_cache_dev, sector, count, buff) ? RES_OK : RES_ERROR;
+    }
+
+    static DRESULT ioctl(BYTE pdrv, BYTE cmd, void* buff)
+    {
+        switch (cmd)
+        {
+        case CTRL_SYNC:
+            return sdcard->_cache->flush(sdcard->_cache_dev) ? RES_OK : RES_ERROR;
+        case GET_SECTOR_COUNT:
+            *(LBA_t*)buff = sdcard->card->csd.capacity;
+            return RES_OK;
+        case GET_SECTOR_SIZE:
+            *(WORD*)buff = sdcard->card->csd.sector_size;
+            return RES_OK;
+        }
+        return RES_ERROR;
+    }
+};
+SDCard* SDCardDiskIO::sdcard = nullptr;
+
 bool SDCard::mount(bool format_if_mount_failed)
 {
+    MC_TRACE_ZONE("sd_mount");
     if (_is_mounted)
     {
         ESP_LOGI(TAG, "SD card already mounted");
@@ -78,6 +120,7 @@ bool SDCard::mount(bool format_if_mount_failed)
     };
 
     sdmmc_card_print_info(stdout, card);
+    _attach_cache();
     _is_mounted = true;
 
     return true;
@@ -90,6 +133,7 @@ bool SDCard::eject()
         ESP_LOGI(TAG, "SD card not mounted");
         return true;
     }
+    _detach_cache();
     esp_err_t ret = esp_vfs_fat_sdcard_unmount(MOUNT_POINT, card);
     if (ret != ESP_OK)
     {
@@ -103,6 +147,58 @@ bool SDCard::eject()
     return true;
 }
 
+void SDCard::_attach_cache()
+{
+    BYTE pdrv = ff_diskio_get_pdrv_card(card);
+    if (_cache == nullptr || pdrv == 0xFF)
+    {
+        return;
+    }
+    _cache_dev = _cache->attach(
+        [this](uint32_t lba, uint32_t count, uint8_t* data) { return sdmmc_read_sectors(card, data, lba, count) == ESP_OK; },
+        [this](uint32_t lba, uint32_t count, const uint8_t* data) {
+            return sdmmc_write_sectors(card, data, lba, count) == ESP_OK;
+        },
+        card->csd.sector_size);
+    if (_cache_dev < 0)
+    {
+        ESP_LOGW(TAG, "Block cache not available, sector size %d", card->csd.sector_size);
+        return;
+    }
+    _cache->setWriteBackFat(_cache_dev);
+
+    // The volume is mounted over the plain SD driver, take its place
+    SDCardDiskIO::sdcard = this;
+    static const ff_diskio_impl_t diskio = {
+        .init = SDCardDiskIO::init,
+        .status = SDCardDiskIO::status,
+        .read = SDCardDiskIO::read,
+        .write = SDCardDiskIO::write,
+        .ioctl = SDCardDiskIO::ioctl,
+    };
+    ff_diskio_register(pdrv, &diskio);
+}
+
+void SDCard::_detach_cache()
+{
+    if (_cache_dev < 0)
+    {
+        return;
+    }
+    HAL::block_cache_stats_t stats = _cache->stats(_cache_dev);
+    ESP_LOGI(TAG,
+             "Block cache: %u%% hit rate, %llu hits, %llu misses, %llu written back",
+             stats.hitRate(),
+             stats.hits,
+             stats.misses,
+             stats.write_backs);
+
+    // Dirty FAT sectors go out, the plain driver is back for the unmount
+    _cache->detach(_cache_dev);
+    _cache_dev = -1;
+    ff_diskio_register_sdmmc(ff_diskio_get_pdrv_card(card), card);
+}
+
 bool SDCard::is_mounted() { return _is_mounted; }
 
 char* SDCard::get_mount_point() { return (char*)MOUNT_POINT; }
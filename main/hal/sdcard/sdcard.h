@@ -12,11 +12,14 @@
 #define SD_CARD_MANAGER_H
 
 #include "driver/sdspi_host.h"
+#include "cache/block_cache.h"
 #include <string>
 
 class SDCard
 {
 public:
+    SDCard(HAL::BlockCache* cache = nullptr) : _cache(cache) {}
+
     bool mount(bool format_if_mount_failed);
     bool eject();
     bool is_mounted();
@@ -32,6 +35,13 @@ private:
     sdmmc_host_t host = SDSPI_HOST_DEFAULT();
     sdmmc_card_t* card = nullptr;
     bool _is_mounted = false;
+
+    // Shared sector cache under the FATFS volume
+    friend struct SDCardDiskIO;
+    HAL::BlockCache* _cache = nullptr;
+    int _cache_dev = -1;
+    void _attach_cache();
+    void _detach_cache();
 };
 
 #endif // SD_CARD_MANAGER_H
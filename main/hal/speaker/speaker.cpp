@@ -7,9 +7,29 @@
 #include <algorithm>
 #include <driver/i2c_master.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 
 static const char* TAG = "SPEAKER";
 
+// ES8311 codec of the Cardputer ADV, register and value pairs
+static const uint8_t _codec_enable[][2] = {
+    {0x00, 0x80}, // 0x00 RESET/  CSM POWER ON
+    {0x01, 0xB5}, // 0x01 CLOCK_MANAGER/ MCLK=BCLK
+    {0x02, 0x18}, // 0x02 CLOCK_MANAGER/ MULT_PRE=3
+    {0x0D, 0x01}, // 0x0D SYSTEM/ Power up analog circuitry
+    {0x12, 0x00}, // 0x12 SYSTEM/ power-up DAC - NOT default
+    {0x13, 0x10}, // 0x13 SYSTEM/ Enable output to HP drive - NOT default
+    {0x32, 0xBF}, // 0x32 DAC/ DAC volume (0xBF == ±0 dB )
+    {0x37, 0x08}, // 0x37 DAC/ Bypass DAC equalizer - NOT default
+};
+
+static const uint8_t _codec_suspend[][2] = {
+    {0x32, 0x00}, // 0x32 DAC/ DAC volume muted
+    {0x13, 0x00}, // 0x13 SYSTEM/ Disable output to HP drive
+    {0x12, 0x02}, // 0x12 SYSTEM/ power-down DAC
+    {0x0D, 0xFA}, // 0x0D SYSTEM/ Power down analog circuitry
+};
+
 namespace HAL
 {
     // Default tone waveform (sine-like wave)
@@ -53,6 +73,8 @@ namespace HAL
         }
 
         // Create speaker task (no semaphore needed, we use task notifications)
+        // Running before it's created, on the other core it may start right away
+        _task_running = true;
         BaseType_t result;
         if (_cfg.task_pinned_core < 2)
         {
@@ -71,10 +93,10 @@ namespace HAL
 
         if (result != pdPASS)
         {
+            _task_running = false;
             return false;
         }
 
-        _task_running = true;
         return true;
     }
 
@@ -104,10 +126,14 @@ namespace HAL
             _task_handle = nullptr;
         }
 
-        // Delete I2S channel
+        // Delete I2S channel, already disabled if suspended
         if (_tx_chan)
         {
-            i2s_channel_disable(_tx_chan);
+            if (!_suspended)
+            {
+                i2s_channel_disable(_tx_chan);
+            }
+            _suspended = false;
             i2s_del_channel(_tx_chan);
             _tx_chan = nullptr;
         }
@@ -126,22 +152,6 @@ namespace HAL
 
     bool Speaker::_init_cardputer_adv(bool enabled)
     {
-        struct RegValue
-        {
-            uint8_t value[2];
-        };
-
-        const RegValue enable_data[] = {
-            {0x00, 0x80}, // 0x00 RESET/  CSM POWER ON
-            {0x01, 0xB5}, // 0x01 CLOCK_MANAGER/ MCLK=BCLK
-            {0x02, 0x18}, // 0x02 CLOCK_MANAGER/ MULT_PRE=3
-            {0x0D, 0x01}, // 0x0D SYSTEM/ Power up analog circuitry
-            {0x12, 0x00}, // 0x12 SYSTEM/ power-up DAC - NOT default
-            {0x13, 0x10}, // 0x13 SYSTEM/ Enable output to HP drive - NOT default
-            {0x32, 0xBF}, // 0x32 DAC/ DAC volume (0xBF == ±0 dB )
-            {0x37, 0x08}, // 0x37 DAC/ Bypass DAC equalizer - NOT default
-        };
-
         // get i2c master bus handle
         _bus_handle = nullptr;
         esp_err_t ret = i2c_master_get_bus_handle(SPEAKER_I2C_PORT, &_bus_handle);
@@ -164,14 +174,9 @@ namespace HAL
                 ESP_LOGE(TAG, "Failed to add device to I2C bus");
                 return false;
             }
-            for (auto& chunk : enable_data)
+            if (!_write_codec(_codec_enable, sizeof(_codec_enable) / sizeof(_codec_enable[0])))
             {
-                ret = i2c_master_transmit(_dev_handle, chunk.value, 2, SPEAKER_I2C_TIMEOUT_MS);
-                if (ret != ESP_OK)
-                {
-                    ESP_LOGE(TAG, "Failed to write to I2C device");
-                    return false;
-                }
+                return false;
             }
         }
         else
@@ -186,6 +191,42 @@ namespace HAL
         return true;
     }
 
+    bool Speaker::_write_codec(const uint8_t (*regs)[2], size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i2c_master_transmit(_dev_handle, regs[i], 2, SPEAKER_I2C_TIMEOUT_MS) != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to write to I2C device");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Speaker::_suspend(void)
+    {
+        // DMA only holds silence by now
+        _wake_request_us = 0;
+        i2s_channel_disable(_tx_chan);
+        if (_board_type == BoardType::CARDPUTER_ADV)
+        {
+            _write_codec(_codec_suspend, sizeof(_codec_suspend) / sizeof(_codec_suspend[0]));
+        }
+        _suspended = true;
+        ESP_LOGD(TAG, "Suspended after %lu ms idle", (unsigned long)_cfg.idle_suspend_ms);
+    }
+
+    void Speaker::_resume(void)
+    {
+        if (_board_type == BoardType::CARDPUTER_ADV)
+        {
+            _write_codec(_codec_enable, sizeof(_codec_enable) / sizeof(_codec_enable[0]));
+        }
+        i2s_channel_enable(_tx_chan);
+        _suspended = false;
+    }
+
     bool Speaker::_setup_i2s(void)
     {
         // Configure I2S channel
@@ -247,6 +288,9 @@ namespace HAL
         sample_rate_x256 = 0;
         data = nullptr;
         length = 0;
+        mix = nullptr;
+        stream = nullptr;
+        block_align = 0;
         flg = 0;
     }
 
@@ -294,9 +338,16 @@ namespace HAL
     {
         if (channel < sound_channel_max)
         {
+            bool had_stream = _ch_info[channel].wavinfo[0].stream || _ch_info[channel].wavinfo[1].stream;
             _ch_info[channel].wavinfo[0].clear();
             _ch_info[channel].wavinfo[1].clear();
-            _ch_info[channel].index = 0;
+            _ch_info[channel].state.index = 0;
+
+            // Streams can be ended once the frame being mixed is done with them
+            while (had_stream && _mixing)
+            {
+                vTaskDelay(1);
+            }
         }
     }
 
@@ -419,14 +470,20 @@ namespace HAL
         uint16_t audio_format = *(uint16_t*)(wav_data + offset + 8);
         uint16_t num_channels = *(uint16_t*)(wav_data + offset + 10);
         uint32_t sample_rate = *(uint32_t*)(wav_data + offset + 12);
+        uint16_t block_align = *(uint16_t*)(wav_data + offset + 20);
         uint16_t bits_per_sample = *(uint16_t*)(wav_data + offset + 22);
 
-        if (audio_format != 1) // Only PCM supported
+        // PCM, or mono IMA-ADPCM decoded by the mixer
+        bool is_adpcm = (audio_format == ADPCM::WAV_FORMAT);
+        if (is_adpcm ? (num_channels != 1 || bits_per_sample != 4 || block_align <= ADPCM::BLOCK_HEADER_SIZE)
+                     : audio_format != 1)
         {
+            ESP_LOGE(TAG, "Unsupported WAV format %d, %d channels, %d bits", audio_format, num_channels, bits_per_sample);
             return false;
         }
 
-        // Find data chunk
+        // Find data chunk, ADPCM has its sample count in the fact chunk
+        size_t fact_samples = 0;
         offset += 8 + *(uint32_t*)(wav_data + offset + 4);
         while (offset + 8 <= data_len)
         {
@@ -434,6 +491,10 @@ namespace HAL
             {
                 break;
             }
+            if (memcmp(wav_data + offset, "fact", 4) == 0 && offset + 12 <= data_len)
+            {
+                fact_samples = *(uint32_t*)(wav_data + offset + 8);
+            }
             uint32_t chunk_size = *(uint32_t*)(wav_data + offset + 4);
             offset += 8 + chunk_size;
         }
@@ -445,6 +506,33 @@ namespace HAL
 
         uint32_t data_size = *(uint32_t*)(wav_data + offset + 4);
         const uint8_t* audio_data = wav_data + offset + 8;
+
+        if (is_adpcm)
+        {
+            size_t sample_count = ADPCM::samples_per_block(block_align) * (data_size / block_align);
+            if (data_size % block_align >= ADPCM::BLOCK_HEADER_SIZE)
+            {
+                // Last block is cut short
+                sample_count += ADPCM::samples_per_block(data_size % block_align);
+            }
+            if (fact_samples && fact_samples < sample_count)
+            {
+                sample_count = fact_samples;
+            }
+            return _play_raw(audio_data,
+                             sample_count,
+                             true,
+                             true,
+                             sample_rate,
+                             false,
+                             repeat,
+                             channel,
+                             stop_current_sound,
+                             false,
+                             nullptr,
+                             block_align);
+        }
+
         size_t sample_count = data_size / (bits_per_sample / 8) / num_channels;
 
         bool stereo = (num_channels == 2);
@@ -463,6 +551,27 @@ namespace HAL
                          false);
     }
 
+    bool Speaker::playStream(SpeakerStream* stream, int channel, bool stop_current_sound)
+    {
+        if (stream == nullptr || stream->_ring == nullptr)
+        {
+            return false;
+        }
+
+        const StreamSource* source = stream->source();
+        return _play_raw(stream->_ring,
+                         stream->_ring_size / (source->is_16bit ? 2 : 1),
+                         source->is_16bit,
+                         source->is_signed,
+                         source->sample_rate,
+                         source->is_stereo,
+                         ~0u,
+                         channel,
+                         stop_current_sound,
+                         false,
+                         stream);
+    }
+
     bool Speaker::_play_raw(const void* wav,
                             size_t array_len,
                             bool flg_16bit,
@@ -472,7 +581,9 @@ namespace HAL
                             uint32_t repeat_count,
                             int channel,
                             bool stop_current_sound,
-                            bool no_clear_index)
+                            bool no_clear_index,
+                            SpeakerStream* stream,
+                            uint16_t adpcm_block_align)
     {
         if (!_task_running || wav == nullptr || array_len == 0)
         {
@@ -512,6 +623,10 @@ namespace HAL
         wav_info.is_signed = flg_signed;
         wav_info.stop_current = stop_current_sound;
         wav_info.no_clear_index = no_clear_index;
+        wav_info.mix = adpcm_block_align ? MIXER::get_adpcm_mix_func(_cfg.stereo)
+                                         : MIXER::get_mix_func(flg_16bit, flg_signed, flg_stereo, _cfg.stereo);
+        wav_info.stream = stream;
+        wav_info.block_align = adpcm_block_align;
 
         return _set_next_wav(channel, wav_info);
     }
@@ -532,8 +647,8 @@ namespace HAL
             ch_info.wavinfo[1].clear();
             if (!wav.no_clear_index)
             {
-                ch_info.index = 0;
-                ch_info.diff = 0; // Reset diff accumulator
+                ch_info.state.index = 0;
+                ch_info.state.diff = 0; // Reset diff accumulator
             }
             ch_info.flip = false;
 
@@ -554,7 +669,11 @@ namespace HAL
             return false;
         }
 
-        // Wake up task via task notification
+        // Wake up task via task notification, timing the wake if it sleeps
+        if (_suspended)
+        {
+            _wake_request_us = (uint32_t)esp_timer_get_time();
+        }
         if (_task_handle)
         {
             xTaskNotifyGive(_task_handle);
@@ -563,7 +682,7 @@ namespace HAL
         return true;
     }
 
-    void Speaker::_mix_channels(int16_t* output, size_t samples)
+    void Speaker::_mix_channels(int16_t* output, int32_t* mix_buf, size_t samples)
     {
         uint16_t playing_bits = _play_channel_bits.load();
         if (playing_bits == 0)
@@ -574,16 +693,11 @@ namespace HAL
 
         const bool out_stereo = _cfg.stereo;
         const size_t output_len = samples * (out_stereo ? 2 : 1);
-        const int32_t spk_rate_x256 = _cfg.sample_rate << 8;
+        const uint8_t master_volume = _master_volume;
 
-        // Allocate int32 mixing buffer for better precision
-        int32_t* mix_buf = (int32_t*)alloca(output_len * sizeof(int32_t));
+        // int32 mixing buffer for better precision
         memset(mix_buf, 0, output_len * sizeof(int32_t));
 
-        // Calculate base volume: magnification * (master_volume^2) / sample_rate / 2^28
-        const float base_volume =
-            (_cfg.magnification << out_stereo) * (_master_volume * _master_volume) / (float)spk_rate_x256 / (1 << 28);
-
         // Mix each active channel
         for (size_t ch = 0; ch < sound_channel_max; ++ch)
         {
@@ -604,8 +718,8 @@ namespace HAL
 
                 if (reset_position)
                 {
-                    ch_info.index = 0;
-                    ch_info.diff = 0;
+                    ch_info.state.index = 0;
+                    ch_info.state.diff = 0;
                     if (wav->repeat == 0)
                     {
                         _play_channel_bits.fetch_and(~(1 << ch));
@@ -614,136 +728,42 @@ namespace HAL
                 }
             }
 
-            if (wav->repeat == 0)
+            if (wav->repeat == 0 || wav->mix == nullptr)
             {
                 _play_channel_bits.fetch_and(~(1 << ch));
                 continue;
             }
 
-            // Calculate channel volume (squared for perceptual linearity, boost 8-bit)
-            int32_t vol_sq = ch_info.volume * ch_info.volume;
-            if (!wav->is_16bit)
-                vol_sq <<= 8;
-            const float ch_volume = base_volume * vol_sq;
-
-            const bool in_stereo = wav->is_stereo;
-            const int32_t in_rate = wav->sample_rate_x256;
-            float* curr_sample = ch_info.liner_buf[0]; // Current interpolated sample
-            float* prev_sample = ch_info.liner_buf[1]; // Previous sample for interpolation
+            MIXER::mix_source_t source;
+            source.data = wav->data;
+            source.length = wav->length;
+            source.in_rate = wav->sample_rate_x256;
+            source.out_rate = _cfg.sample_rate << 8;
+            source.volume = MIXER::get_volume(_cfg.magnification, out_stereo, master_volume, ch_info.volume);
+            source.block_align = wav->block_align;
 
-            int diff = ch_info.diff;        // Sample rate converter accumulator
-            size_t src_idx = ch_info.index; // Source audio position
-            size_t dst_idx = 0;             // Destination buffer position
-
-            // Mix loop: read source samples and resample to output rate
-            do
+            if (wav->stream == nullptr)
             {
-                // Read new source samples when accumulator is non-negative
-                while (diff >= 0)
-                {
-                    // Handle loop wrap-around
-                    if (src_idx >= wav->length)
-                    {
-                        src_idx -= wav->length;
-                        if (wav->repeat != ~0u && --wav->repeat == 0)
-                            goto end_channel_mix;
-                    }
-
-                    // Read sample (L and R channels)
-                    int32_t left, right;
-                    if (wav->is_16bit)
-                    {
-                        auto data16 = (const int16_t*)wav->data;
-                        left = data16[src_idx];
-                        right = data16[src_idx + in_stereo];
-                        src_idx += 1 + in_stereo;
-
-                        if (!wav->is_signed)
-                        {
-                            left = (left & 0xFFFF) + INT16_MIN;
-                            right = (right & 0xFFFF) + INT16_MIN;
-                        }
-                    }
-                    else
-                    {
-                        auto data8 = (const uint8_t*)wav->data;
-                        left = data8[src_idx];
-                        right = data8[src_idx + in_stereo];
-                        src_idx += 1 + in_stereo;
-
-                        if (wav->is_signed)
-                        {
-                            left = (int8_t)left;
-                            right = (int8_t)right;
-                        }
-                        else
-                        {
-                            left += INT8_MIN;
-                            right += INT8_MIN;
-                        }
-                    }
-
-                    // Store for interpolation and apply volume
-                    prev_sample[0] = curr_sample[0];
-                    if (out_stereo)
-                    {
-                        prev_sample[1] = curr_sample[1];
-                        curr_sample[1] = right * ch_volume;
-                    }
-                    else
-                    {
-                        left += right; // Mix stereo to mono
-                    }
-                    curr_sample[0] = left * ch_volume;
-
-                    diff -= spk_rate_x256; // Consume one input sample
-                }
-                // Linear interpolation: generate output samples between prev and curr
-                float lerp_left = curr_sample[0];
-                float delta_left = lerp_left - prev_sample[0];
-                float start_left = lerp_left * spk_rate_x256 + delta_left * diff;
-                float step_left = delta_left * in_rate;
-
-                if (out_stereo)
-                {
-                    float lerp_right = curr_sample[1];
-                    float delta_right = lerp_right - prev_sample[1];
-                    float start_right = lerp_right * spk_rate_x256 + delta_right * diff;
-                    float step_right = delta_right * in_rate;
-
-                    // Write stereo samples
-                    do
-                    {
-                        mix_buf[dst_idx++] += (int32_t)start_left;
-                        mix_buf[dst_idx++] += (int32_t)start_right;
-                        start_left += step_left;
-                        start_right += step_right;
-                        diff += in_rate;
-                    } while (dst_idx < output_len && diff < 0);
-                }
-                else
-                {
-                    // Write mono samples
-                    do
-                    {
-                        mix_buf[dst_idx++] += (int32_t)start_left;
-                        start_left += step_left;
-                        diff += in_rate;
-                    } while (dst_idx < output_len && diff < 0);
-                }
-            } while (dst_idx < output_len);
+                // Resample and add, loop specialized for the format
+                wav->mix(mix_buf, output_len, source, ch_info.state, wav->repeat);
+                continue;
+            }
 
-        end_channel_mix:
-            ch_info.diff = diff;
-            ch_info.index = src_idx;
+            // Stream: read no further than the reader got, the ring is the looping source
+            const size_t value_size = wav->is_16bit ? 2 : 1;
+            const size_t start_index = ch_info.state.index;
+            source.available = wav->stream->_available() / value_size;
+            size_t mixed = wav->mix(mix_buf, output_len, source, ch_info.state, wav->repeat);
+            size_t read = (ch_info.state.index + wav->length - start_index) % wav->length;
+            wav->stream->_consume(read * value_size, (output_len - mixed) >> out_stereo);
+            if (wav->stream->isFinished())
+            {
+                wav->repeat = 0;
+            }
         }
 
         // Convert mixed int32 buffer to int16 output with clamping
-        for (size_t i = 0; i < output_len; ++i)
-        {
-            int32_t val = mix_buf[i] >> 8;
-            output[i] = (val < INT16_MIN) ? INT16_MIN : (val > INT16_MAX) ? INT16_MAX : (int16_t)val;
-        }
+        MIXER::saturate(mix_buf, output, output_len);
     }
 
     void Speaker::spk_task(void* args)
@@ -752,9 +772,11 @@ namespace HAL
         const size_t samples_per_frame = 256;
         const size_t buffer_size = samples_per_frame * (self->_cfg.stereo ? 2 : 1);
         int16_t* buffer = new int16_t[buffer_size];
+        int32_t* mix_buf = new int32_t[buffer_size];
 
         uint8_t buf_cnt = 0;
         bool flg_nodata = false;
+        bool flg_woke = false;
 
         while (self->_task_running)
         {
@@ -782,8 +804,18 @@ namespace HAL
 
                     if (!retry)
                     {
-                        // Wait for new data
-                        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                        // Wait for new data, powering down I2S and the codec if it's long in coming
+                        const uint32_t idle_ms = self->_cfg.idle_suspend_ms;
+                        if (!ulTaskNotifyTake(pdTRUE, idle_ms ? pdMS_TO_TICKS(idle_ms) : portMAX_DELAY))
+                        {
+                            self->_suspend();
+                            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                            if (self->_task_running)
+                            {
+                                self->_resume();
+                                flg_woke = true;
+                            }
+                        }
                     }
                 }
             }
@@ -806,7 +838,9 @@ namespace HAL
             else
             {
                 // Mix channels
-                self->_mix_channels(buffer, samples_per_frame);
+                self->_mixing = true;
+                self->_mix_channels(buffer, mix_buf, samples_per_frame);
+                self->_mixing = false;
                 flg_nodata = false; // We have data
             }
 
@@ -814,6 +848,18 @@ namespace HAL
             size_t bytes_written = 0;
             i2s_channel_write(self->_tx_chan, buffer, buffer_size * sizeof(int16_t), &bytes_written, portMAX_DELAY);
 
+            // First frame after a wake is in DMA
+            if (flg_woke)
+            {
+                flg_woke = false;
+                uint32_t request_us = self->_wake_request_us;
+                if (request_us)
+                {
+                    self->_wake_latency_us = (uint32_t)esp_timer_get_time() - request_us;
+                    ESP_LOGD(TAG, "Woke in %lu us", (unsigned long)self->_wake_latency_us);
+                }
+            }
+
             // Track buffer count
             if (!flg_nodata)
             {
@@ -825,6 +871,7 @@ namespace HAL
         }
 
         delete[] buffer;
+        delete[] mix_buf;
         vTaskDelete(nullptr);
     }
 
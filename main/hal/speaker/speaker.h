@@ -12,6 +12,9 @@
 #include "driver/i2s_std.h"
 #include "driver/i2c_master.h"
 #include "hal/board.h"
+#include "speaker_mixer.h"
+#include "speaker_adpcm.h"
+#include "speaker_stream.h"
 
 // Pin configuration macros for M5Cardputer
 #define SPEAKER_PIN_DATA_OUT 42
@@ -62,6 +65,9 @@ namespace HAL
 
         /// I2S port
         i2s_port_t i2s_port = SPEAKER_I2S_PORT;
+
+        /// Power down I2S and the codec after this long without sound (msec), 0 keeps them running
+        uint32_t idle_suspend_ms = 2000;
     };
 
     /**
@@ -98,6 +104,16 @@ namespace HAL
          */
         bool isRunning(void) const { return _task_running; }
 
+        /**
+         * @brief Check if I2S and the codec are powered down for idling
+         */
+        bool isSuspended(void) const { return _suspended; }
+
+        /**
+         * @brief Time from the play call that woke the speaker to its first frame in DMA, last wake (usec)
+         */
+        uint32_t getWakeLatency(void) const { return _wake_latency_us; }
+
         /**
          * @brief Check if speaker is enabled
          */
@@ -223,7 +239,7 @@ namespace HAL
                      bool stop_current_sound = false);
 
         /**
-         * @brief Play WAV format data
+         * @brief Play WAV format data, PCM or mono IMA-ADPCM
          * @param wav_data WAV data with header
          * @param data_len Length of data
          * @param repeat Repeat count (1 for once)
@@ -236,6 +252,15 @@ namespace HAL
                      int channel = -1,
                      bool stop_current_sound = false);
 
+        /**
+         * @brief Play a stream, started with SpeakerStream::begin()
+         * Plays till the source ends, stop the channel before ending the stream
+         * @param stream Stream to play
+         * @param channel Channel number (-1 for auto)
+         * @param stop_current_sound Stop current sound on channel
+         */
+        bool playStream(SpeakerStream* stream, int channel = -1, bool stop_current_sound = true);
+
     private:
         BoardType _board_type;
         i2c_master_bus_handle_t _bus_handle;
@@ -252,6 +277,9 @@ namespace HAL
             uint32_t sample_rate_x256 = 0;
             const void* data = nullptr;
             size_t length = 0;
+            MIXER::mix_func_t mix = nullptr; // picked for the format when queued
+            SpeakerStream* stream = nullptr; // data is the stream's ring buffer
+            uint16_t block_align = 0;        // IMA-ADPCM block size, 0 for PCM
             union
             {
                 volatile uint8_t flg = 0;
@@ -274,12 +302,9 @@ namespace HAL
         struct channel_info_t
         {
             wav_info_t wavinfo[2]; // current/next flip info
-            size_t index = 0;
-            int diff = 0;
+            MIXER::mix_state_t state;
             volatile uint8_t volume = 255; // channel volume
             volatile bool flip = false;
-
-            float liner_buf[2][2] = {{0, 0}, {0, 0}};
         };
 
         channel_info_t _ch_info[sound_channel_max];
@@ -288,6 +313,10 @@ namespace HAL
         volatile uint8_t _master_volume = 0;
 
         volatile bool _task_running = false;
+        std::atomic<bool> _mixing = {false};
+        volatile bool _suspended = false;
+        std::atomic<uint32_t> _wake_request_us = {0};
+        uint32_t _wake_latency_us = 0;
         std::atomic<uint16_t> _play_channel_bits = {0};
 
         TaskHandle_t _task_handle = nullptr;
@@ -299,6 +328,21 @@ namespace HAL
          */
         static void spk_task(void* args);
 
+        /**
+         * @brief Power down I2S and the codec, called by the speaker task once idle
+         */
+        void _suspend(void);
+
+        /**
+         * @brief Power them back up before the next frame
+         */
+        void _resume(void);
+
+        /**
+         * @brief Write codec register and value pairs
+         */
+        bool _write_codec(const uint8_t (*regs)[2], size_t count);
+
         /**
          * @brief Setup I2S interface
          */
@@ -316,7 +360,9 @@ namespace HAL
                        uint32_t repeat_count,
                        int channel,
                        bool stop_current_sound,
-                       bool no_clear_index);
+                       bool no_clear_index,
+                       SpeakerStream* stream = nullptr,
+                       uint16_t adpcm_block_align = 0);
 
         /**
          * @brief Set next wave for channel
@@ -325,8 +371,9 @@ namespace HAL
 
         /**
          * @brief Mix audio channels
+         * @param mix_buf Scratch buffer, same length as output
          */
-        void _mix_channels(int16_t* output, size_t samples);
+        void _mix_channels(int16_t* output, int32_t* mix_buf, size_t samples);
 
         /**
          * @brief Initialize cardputer adv
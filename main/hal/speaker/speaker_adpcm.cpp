@@ -0,0 +1,165 @@
+/**
+ * @file speaker_adpcm.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-17
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "speaker_adpcm.h"
+#include <algorithm>
+
+namespace HAL
+{
+    namespace ADPCM
+    {
+        const int16_t step_table[89] = {
+            7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+            31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+            130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+            544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+            2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+            9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+        const int8_t index_table[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+        static uint8_t _quantize(int32_t sample, int32_t predictor, int32_t step_index)
+        {
+            int32_t diff = sample - predictor;
+            uint8_t nibble = 0;
+            if (diff < 0)
+            {
+                nibble = 8;
+                diff = -diff;
+            }
+
+            // Quantize the difference in steps, as the decoder adds it back
+            int32_t step = step_table[step_index];
+            if (diff >= step)
+            {
+                nibble |= 4;
+                diff -= step;
+            }
+            step >>= 1;
+            if (diff >= step)
+            {
+                nibble |= 2;
+                diff -= step;
+            }
+            step >>= 1;
+            if (diff >= step)
+            {
+                nibble |= 1;
+            }
+            return nibble;
+        }
+
+        static int64_t _error(const int16_t* pcm, size_t count, int32_t predictor, int32_t step_index, uint8_t nibble)
+        {
+            // Squared error of this nibble, then the best the following ones can do
+            const int64_t diff = pcm[0] - decode_nibble(nibble, predictor, step_index);
+            int64_t error = diff * diff;
+            if (count > 1)
+            {
+                int64_t best = INT64_MAX;
+                for (uint8_t next = 0; next < 16; next++)
+                {
+                    best = std::min(best, _error(pcm + 1, count - 1, predictor, step_index, next));
+                }
+                error += best;
+            }
+            return error;
+        }
+
+        static uint8_t _encode_sample(const int16_t* pcm, size_t lookahead, int32_t& predictor, int32_t& step_index)
+        {
+            uint8_t nibble = _quantize(pcm[0], predictor, step_index);
+
+            // Plain quantizing is greedy, a step index that adapts late costs more on the samples after
+            if (lookahead > 0)
+            {
+                int64_t best = _error(pcm, lookahead + 1, predictor, step_index, nibble);
+                for (uint8_t other = 0; other < 16; other++)
+                {
+                    int64_t error = _error(pcm, lookahead + 1, predictor, step_index, other);
+                    if (error < best)
+                    {
+                        best = error;
+                        nibble = other;
+                    }
+                }
+            }
+
+            // Track the decoder, not the input
+            decode_nibble(nibble, predictor, step_index);
+            return nibble;
+        }
+
+        size_t encoded_size(size_t samples, uint16_t block_align)
+        {
+            const size_t block_samples = samples_per_block(block_align);
+            const size_t rest = samples % block_samples;
+            return samples / block_samples * block_align + (rest ? BLOCK_HEADER_SIZE + rest / 2 : 0);
+        }
+
+        size_t encode(const int16_t* pcm, size_t samples, uint8_t* output, uint16_t block_align, size_t lookahead)
+        {
+            const size_t block_samples = samples_per_block(block_align);
+            int32_t predictor = 0;
+            int32_t step_index = 0;
+            uint8_t* out = output;
+
+            for (size_t start = 0; start < samples; start += block_samples)
+            {
+                const size_t count = (samples - start < block_samples) ? samples - start : block_samples;
+
+                // Header restarts the predictor on the real sample, step index carries over
+                predictor = pcm[start];
+                out[0] = predictor & 0xFF;
+                out[1] = (predictor >> 8) & 0xFF;
+                out[2] = step_index;
+                out[3] = 0;
+                out += BLOCK_HEADER_SIZE;
+
+                // Two samples per byte, low nibble first
+                for (size_t i = 1; i < count; i += 2)
+                {
+                    uint8_t byte = _encode_sample(&pcm[start + i], std::min(lookahead, count - i - 1), predictor, step_index);
+                    if (i + 1 < count)
+                    {
+                        byte |= _encode_sample(&pcm[start + i + 1], std::min(lookahead, count - i - 2), predictor,
+                                               step_index)
+                                << 4;
+                    }
+                    *out++ = byte;
+                }
+            }
+            return out - output;
+        }
+
+        size_t decode(const uint8_t* data, size_t size, size_t samples, int16_t* output, uint16_t block_align)
+        {
+            const size_t block_samples = samples_per_block(block_align);
+            size_t decoded = 0;
+
+            for (size_t offset = 0; offset + BLOCK_HEADER_SIZE <= size && decoded < samples; offset += block_align)
+            {
+                const uint8_t* block = data + offset;
+                int32_t predictor = (int16_t)(block[0] | (block[1] << 8));
+                int32_t step_index = block[2] > 88 ? 88 : block[2];
+                output[decoded++] = predictor;
+
+                const size_t bytes = ((size - offset < block_align) ? size - offset : block_align) - BLOCK_HEADER_SIZE;
+                for (size_t i = 0; i < bytes * 2 && i + 1 < block_samples && decoded < samples; i++)
+                {
+                    uint8_t byte = block[BLOCK_HEADER_SIZE + i / 2];
+                    output[decoded++] = decode_nibble((i & 1) ? byte >> 4 : byte & 0x0F, predictor, step_index);
+                }
+            }
+            return decoded;
+        }
+
+    } // namespace ADPCM
+
+} // namespace HAL
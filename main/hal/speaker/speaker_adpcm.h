@@ -0,0 +1,83 @@
+/**
+ * @file speaker_adpcm.h
+ * @brief IMA-ADPCM codec for sound assets, 4 bits per sample, free of IDF dependencies
+ * @version 0.1
+ * @date 2025-12-17
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace HAL
+{
+    namespace ADPCM
+    {
+        /// WAV format tag of IMA-ADPCM
+        static constexpr uint16_t WAV_FORMAT = 0x11;
+
+        /// Block size the encoder uses by default, 505 samples of mono
+        static constexpr uint16_t DEFAULT_BLOCK_ALIGN = 256;
+
+        /// Bytes at the start of each block: first sample, step index and a reserved byte
+        static constexpr size_t BLOCK_HEADER_SIZE = 4;
+
+        extern const int16_t step_table[89];
+        extern const int8_t index_table[16];
+
+        /**
+         * @brief Mono samples in a block, the header holds the first one
+         */
+        inline size_t samples_per_block(uint16_t block_align) { return (block_align - BLOCK_HEADER_SIZE) * 2 + 1; }
+
+        /**
+         * @brief Decode one nibble, updating the predictor and step index
+         */
+        inline int32_t decode_nibble(uint8_t nibble, int32_t& predictor, int32_t& step_index)
+        {
+            const int32_t step = step_table[step_index];
+            int32_t diff = step >> 3;
+            if (nibble & 1)
+                diff += step >> 2;
+            if (nibble & 2)
+                diff += step >> 1;
+            if (nibble & 4)
+                diff += step;
+            predictor += (nibble & 8) ? -diff : diff;
+            predictor = predictor < INT16_MIN ? INT16_MIN : (predictor > INT16_MAX ? INT16_MAX : predictor);
+            step_index += index_table[nibble];
+            step_index = step_index < 0 ? 0 : (step_index > 88 ? 88 : step_index);
+            return predictor;
+        }
+
+        /**
+         * @brief Encoded size of mono samples, the last block is cut short
+         */
+        size_t encoded_size(size_t samples, uint16_t block_align = DEFAULT_BLOCK_ALIGN);
+
+        /**
+         * @brief Encode mono 16 bit samples
+         * @param output encoded_size() bytes
+         * @param lookahead Samples weighed ahead of each nibble, costs 16x per sample, for host side encoding
+         * @return Bytes written
+         */
+        size_t encode(const int16_t* pcm,
+                      size_t samples,
+                      uint8_t* output,
+                      uint16_t block_align = DEFAULT_BLOCK_ALIGN,
+                      size_t lookahead = 0);
+
+        /**
+         * @brief Decode mono samples
+         * @param output samples values
+         * @return Samples decoded, less than asked if data ends first
+         */
+        size_t decode(const uint8_t* data, size_t size, size_t samples, int16_t* output,
+                      uint16_t block_align = DEFAULT_BLOCK_ALIGN);
+
+    } // namespace ADPCM
+
+} // namespace HAL
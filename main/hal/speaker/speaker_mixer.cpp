@@ -0,0 +1,233 @@
+/**
+ * @file speaker_mixer.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "speaker_mixer.h"
+#include "speaker_adpcm.h"
+#include <algorithm>
+
+namespace HAL
+{
+    namespace MIXER
+    {
+        template <bool IS_16BIT, bool IS_SIGNED>
+        static inline int32_t _read(const void* data, size_t index)
+        {
+            if (IS_16BIT)
+            {
+                int32_t value = ((const int16_t*)data)[index];
+                return IS_SIGNED ? value : (value & 0xFFFF) + INT16_MIN;
+            }
+            int32_t value = ((const uint8_t*)data)[index];
+            return IS_SIGNED ? (int8_t)value : value + INT8_MIN;
+        }
+
+        static inline int32_t _decode_adpcm(const mix_source_t& source, adpcm_state_t& adpcm, size_t block_samples)
+        {
+            const uint8_t* block = (const uint8_t*)source.data + adpcm.block;
+            int32_t value;
+            if (adpcm.pos == 0)
+            {
+                // Block header holds the first sample
+                adpcm.predictor = (int16_t)(block[0] | (block[1] << 8));
+                adpcm.step_index = std::min<int32_t>(block[2], 88);
+                value = adpcm.predictor;
+            }
+            else
+            {
+                // Two samples per byte, low nibble first
+                const uint8_t byte = block[ADPCM::BLOCK_HEADER_SIZE + ((adpcm.pos - 1) >> 1)];
+                value = ADPCM::decode_nibble((adpcm.pos & 1) ? byte & 0x0F : byte >> 4, adpcm.predictor,
+                                             adpcm.step_index);
+            }
+            if (++adpcm.pos == block_samples)
+            {
+                adpcm.pos = 0;
+                adpcm.block += source.block_align;
+            }
+            adpcm.next++;
+            return value;
+        }
+
+        static void _seek_adpcm(const mix_source_t& source, adpcm_state_t& adpcm, size_t index, size_t block_samples)
+        {
+            // Decode from the start of the block, predictor depends on every sample before
+            adpcm.data = source.data;
+            adpcm.block = index / block_samples * source.block_align;
+            adpcm.pos = 0;
+            adpcm.next = index - index % block_samples;
+            while (adpcm.next < index)
+            {
+                _decode_adpcm(source, adpcm, block_samples);
+            }
+        }
+
+        static inline int32_t _read_adpcm(const mix_source_t& source, adpcm_state_t& adpcm, size_t index,
+                                          size_t block_samples)
+        {
+            // Reads are in order, except after a loop or another sound
+            if (index != adpcm.next || source.data != adpcm.data)
+            {
+                _seek_adpcm(source, adpcm, index, block_samples);
+            }
+            return _decode_adpcm(source, adpcm, block_samples);
+        }
+
+        template <bool IS_16BIT>
+        static inline int32_t _apply_volume(int32_t sample, int64_t volume)
+        {
+            // 8 bit sources are boosted by 256
+            constexpr int shift = IS_16BIT ? 28 : 20;
+            return (int32_t)((sample * volume + ((int64_t)1 << (shift - 1))) >> shift);
+        }
+
+        static inline int32_t _trunc(int32_t value)
+        {
+            // Toward zero like the float mixer did
+            return (value + ((value >> 31) & ((1 << ACC_BITS) - 1))) >> ACC_BITS;
+        }
+
+        template <bool IS_16BIT, bool IS_SIGNED, bool IN_STEREO, bool OUT_STEREO, bool IS_ADPCM = false>
+        static size_t _mix(int32_t* mix_buf,
+                           size_t output_len,
+                           const mix_source_t& source,
+                           mix_state_t& state,
+                           volatile uint32_t& repeat)
+        {
+            const int32_t in_rate = source.in_rate;
+            const int32_t out_rate = source.out_rate;
+            const int64_t volume = source.volume;
+
+            // Position between prev and curr is (out_rate + diff) / out_rate, reciprocal saves a division per read
+            const uint64_t inv_out_rate = ((uint64_t)1 << (32 + FRAC_BITS)) / out_rate;
+            // Only used while upsampling, downsampling reads again after every output
+            const uint32_t step = ((uint64_t)std::min(in_rate, out_rate) << FRAC_BITS) / out_rate;
+            const size_t block_samples = IS_ADPCM ? ADPCM::samples_per_block(source.block_align) : 0;
+
+            int32_t prev_l = state.prev[0];
+            int32_t curr_l = state.curr[0];
+            int32_t prev_r = state.prev[1];
+            int32_t curr_r = state.curr[1];
+            int32_t diff = state.diff;
+            size_t src_idx = state.index;
+            size_t dst_idx = 0;
+            size_t available = source.available;
+
+            do
+            {
+                // Read new source samples when accumulator is non-negative
+                while (diff >= 0)
+                {
+                    // Handle loop wrap-around
+                    if (src_idx >= source.length)
+                    {
+                        src_idx -= source.length;
+                        if (repeat != ~0u && --repeat == 0)
+                            goto end_mix;
+                    }
+
+                    // Stream ran dry, carry on from here next time
+                    if (available < 1 + IN_STEREO)
+                        goto end_mix;
+                    available -= 1 + IN_STEREO;
+
+                    int32_t left = IS_ADPCM ? _read_adpcm(source, state.adpcm, src_idx, block_samples)
+                                            : _read<IS_16BIT, IS_SIGNED>(source.data, src_idx);
+                    int32_t right = IN_STEREO ? _read<IS_16BIT, IS_SIGNED>(source.data, src_idx + 1) : left;
+                    src_idx += 1 + IN_STEREO;
+
+                    prev_l = curr_l;
+                    if (OUT_STEREO)
+                    {
+                        prev_r = curr_r;
+                        curr_r = _apply_volume<IS_16BIT>(right, volume);
+                    }
+                    else
+                    {
+                        left += right; // Mix stereo to mono
+                    }
+                    curr_l = _apply_volume<IS_16BIT>(left, volume);
+
+                    diff -= out_rate; // Consume one input sample
+                }
+
+                // Linear interpolation: generate output samples between prev and curr
+                const int64_t pos = ((uint64_t)(out_rate + diff) * inv_out_rate) >> 32;
+                const int64_t delta_l = curr_l - prev_l;
+                int32_t acc_l = ((int64_t)prev_l << ACC_BITS) + ((delta_l * pos) >> (FRAC_BITS - ACC_BITS));
+                const int32_t step_l = (delta_l * step) >> (FRAC_BITS - ACC_BITS);
+                if (OUT_STEREO)
+                {
+                    const int64_t delta_r = curr_r - prev_r;
+                    int32_t acc_r = ((int64_t)prev_r << ACC_BITS) + ((delta_r * pos) >> (FRAC_BITS - ACC_BITS));
+                    const int32_t step_r = (delta_r * step) >> (FRAC_BITS - ACC_BITS);
+                    do
+                    {
+                        mix_buf[dst_idx++] += _trunc(acc_l);
+                        mix_buf[dst_idx++] += _trunc(acc_r);
+                        acc_l += step_l;
+                        acc_r += step_r;
+                        diff += in_rate;
+                    } while (dst_idx < output_len && diff < 0);
+                }
+                else
+                {
+                    do
+                    {
+                        mix_buf[dst_idx++] += _trunc(acc_l);
+                        acc_l += step_l;
+                        diff += in_rate;
+                    } while (dst_idx < output_len && diff < 0);
+                }
+            } while (dst_idx < output_len);
+
+        end_mix:
+            state.prev[0] = prev_l;
+            state.curr[0] = curr_l;
+            state.prev[1] = prev_r;
+            state.curr[1] = curr_r;
+            state.diff = diff;
+            state.index = src_idx;
+            return dst_idx;
+        }
+
+        template <bool IS_16BIT, bool IS_SIGNED>
+        static mix_func_t _get_mix_func(bool in_stereo, bool out_stereo)
+        {
+            if (in_stereo)
+                return out_stereo ? _mix<IS_16BIT, IS_SIGNED, true, true> : _mix<IS_16BIT, IS_SIGNED, true, false>;
+            return out_stereo ? _mix<IS_16BIT, IS_SIGNED, false, true> : _mix<IS_16BIT, IS_SIGNED, false, false>;
+        }
+
+        mix_func_t get_mix_func(bool is_16bit, bool is_signed, bool in_stereo, bool out_stereo)
+        {
+            if (is_16bit)
+                return is_signed ? _get_mix_func<true, true>(in_stereo, out_stereo)
+                                 : _get_mix_func<true, false>(in_stereo, out_stereo);
+            return is_signed ? _get_mix_func<false, true>(in_stereo, out_stereo)
+                             : _get_mix_func<false, false>(in_stereo, out_stereo);
+        }
+
+        mix_func_t get_adpcm_mix_func(bool out_stereo)
+        {
+            // Decodes to signed 16 bit mono
+            return out_stereo ? _mix<true, true, false, true, true> : _mix<true, true, false, false, true>;
+        }
+
+        void saturate(const int32_t* mix_buf, int16_t* output, size_t len)
+        {
+            // Branch free, vectorized on host and a single clamps per sample on Xtensa
+            for (size_t i = 0; i < len; ++i)
+            {
+                output[i] = std::min(std::max(mix_buf[i] >> MIX_SHIFT, (int32_t)INT16_MIN), (int32_t)INT16_MAX);
+            }
+        }
+
+    } // namespace MIXER
+
+} // namespace HAL
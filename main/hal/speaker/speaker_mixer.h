@@ -0,0 +1,128 @@
+/**
+ * @file speaker_mixer.h
+ * @brief Fixed-point resampling mixer used by the speaker task, free of IDF dependencies
+ * @version 0.1
+ * @date 2025-12-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace HAL
+{
+    namespace MIXER
+    {
+        /// Fraction bits of the interpolation position
+        static constexpr int FRAC_BITS = 24;
+
+        /// Fraction bits of the interpolated sample, in mix buffer units
+        static constexpr int ACC_BITS = 5;
+
+        /// Mix buffer holds output samples with 8 fraction bits
+        static constexpr int MIX_SHIFT = 8;
+
+        /**
+         * @brief Where an IMA-ADPCM source was decoded up to
+         */
+        struct adpcm_state_t
+        {
+            /// Source it belongs to, and the next sample it can decode without seeking
+            const void* data = nullptr;
+            size_t next = 0;
+
+            /// Byte offset of the current block and sample within it
+            size_t block = 0;
+            size_t pos = 0;
+
+            int32_t predictor = 0;
+            int32_t step_index = 0;
+        };
+
+        /**
+         * @brief Resampler state of a channel, kept across blocks and queued sounds
+         */
+        struct mix_state_t
+        {
+            /// Source position
+            size_t index = 0;
+
+            /// Rate converter accumulator
+            int32_t diff = 0;
+
+            /// Last two samples read with volume applied, in mix buffer units
+            int32_t prev[2] = {0, 0};
+            int32_t curr[2] = {0, 0};
+
+            /// Decoder of IMA-ADPCM sources
+            adpcm_state_t adpcm;
+        };
+
+        /**
+         * @brief One sound as the mixer reads it
+         */
+        struct mix_source_t
+        {
+            const void* data = nullptr;
+
+            /// Number of 8 or 16 bit values, or IMA-ADPCM samples
+            size_t length = 0;
+
+            /// IMA-ADPCM block size in bytes, 0 for PCM
+            uint16_t block_align = 0;
+
+            /// Source and output rates (Hz x 256)
+            int32_t in_rate = 0;
+            int32_t out_rate = 0;
+
+            /// From get_volume()
+            int64_t volume = 0;
+
+            /// Values that can be read before the source runs dry, streams only
+            size_t available = SIZE_MAX;
+        };
+
+        /**
+         * @brief Resample a source into the mix buffer, specialized per format
+         * @param mix_buf Buffer added to, MIX_SHIFT fraction bits
+         * @param output_len Number of values to add (x2 for stereo output)
+         * @param repeat Decremented at each loop of the source, stops at 0, ~0u never stops
+         * @return Number of values added, less than output_len if the source ended or ran dry
+         */
+        typedef size_t (*mix_func_t)(int32_t* mix_buf,
+                                     size_t output_len,
+                                     const mix_source_t& source,
+                                     mix_state_t& state,
+                                     volatile uint32_t& repeat);
+
+        /**
+         * @brief Pick the mix loop for a source format
+         */
+        mix_func_t get_mix_func(bool is_16bit, bool is_signed, bool in_stereo, bool out_stereo);
+
+        /**
+         * @brief Mix loop of mono IMA-ADPCM sources, decoding as it reads
+         */
+        mix_func_t get_adpcm_mix_func(bool out_stereo);
+
+        /**
+         * @brief Channel gain, magnification * master^2 * channel^2
+         * @param out_stereo Doubles the gain, mono output sums both source channels instead
+         */
+        inline int64_t get_volume(uint8_t magnification, bool out_stereo, uint8_t master_volume, uint8_t channel_volume)
+        {
+            return (int64_t)((magnification << out_stereo) * (master_volume * master_volume)) *
+                   (channel_volume * channel_volume);
+        }
+
+        /**
+         * @brief Convert the mix buffer to 16 bit output, saturating
+         */
+        void saturate(const int32_t* mix_buf, int16_t* output, size_t len);
+
+    } // namespace MIXER
+
+} // namespace HAL
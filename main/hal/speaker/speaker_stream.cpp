@@ -0,0 +1,280 @@
+/**
+ * @file speaker_stream.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "speaker_stream.h"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "esp_log.h"
+
+static const char* TAG = "SPEAKER_STREAM";
+
+namespace HAL
+{
+    bool FileStreamSource::openWav(const char* path)
+    {
+        close();
+        _file = fopen(path, "rb");
+        if (_file == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to open %s", path);
+            return false;
+        }
+
+        // Check RIFF header
+        uint8_t header[12];
+        if (fread(header, 1, sizeof(header), _file) != sizeof(header) || memcmp(header, "RIFF", 4) != 0 ||
+            memcmp(header + 8, "WAVE", 4) != 0)
+        {
+            ESP_LOGE(TAG, "%s is not a WAV file", path);
+            close();
+            return false;
+        }
+
+        // Walk chunks till data, fmt comes before it
+        bool has_fmt = false;
+        uint8_t chunk[8];
+        while (fread(chunk, 1, sizeof(chunk), _file) == sizeof(chunk))
+        {
+            uint32_t chunk_size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+            if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16)
+            {
+                uint8_t fmt[16];
+                if (fread(fmt, 1, sizeof(fmt), _file) != sizeof(fmt))
+                {
+                    break;
+                }
+                uint16_t audio_format = fmt[0] | (fmt[1] << 8);
+                uint16_t num_channels = fmt[2] | (fmt[3] << 8);
+                uint16_t bits_per_sample = fmt[14] | (fmt[15] << 8);
+                if (audio_format != 1 || num_channels < 1 || num_channels > 2 ||
+                    (bits_per_sample != 8 && bits_per_sample != 16))
+                {
+                    ESP_LOGE(TAG, "Unsupported WAV format %d, %d channels, %d bits",
+                             audio_format, num_channels, bits_per_sample);
+                    break;
+                }
+                sample_rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+                is_16bit = (bits_per_sample == 16);
+                is_signed = is_16bit; // 8bit WAV is unsigned
+                is_stereo = (num_channels == 2);
+                has_fmt = true;
+                chunk_size -= sizeof(fmt);
+            }
+            else if (memcmp(chunk, "data", 4) == 0)
+            {
+                if (!has_fmt)
+                {
+                    break;
+                }
+                _remaining = chunk_size;
+                return true;
+            }
+            // Chunks are word aligned
+            if (fseek(_file, chunk_size + (chunk_size & 1), SEEK_CUR) != 0)
+            {
+                break;
+            }
+        }
+
+        ESP_LOGE(TAG, "No playable data in %s", path);
+        close();
+        return false;
+    }
+
+    bool FileStreamSource::openRaw(const char* path, uint32_t sample_rate, bool is_16bit, bool is_signed, bool is_stereo)
+    {
+        close();
+        _file = fopen(path, "rb");
+        if (_file == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to open %s", path);
+            return false;
+        }
+        this->sample_rate = sample_rate;
+        this->is_16bit = is_16bit;
+        this->is_signed = is_signed;
+        this->is_stereo = is_stereo;
+        _remaining = SIZE_MAX;
+        return true;
+    }
+
+    void FileStreamSource::close()
+    {
+        if (_file)
+        {
+            fclose(_file);
+            _file = nullptr;
+        }
+        _remaining = 0;
+    }
+
+    int FileStreamSource::read(void* buffer, size_t size)
+    {
+        if (_file == nullptr)
+        {
+            return -1;
+        }
+        size_t len = fread(buffer, 1, std::min(size, _remaining), _file);
+        if (len == 0)
+        {
+            return ferror(_file) ? -1 : 0;
+        }
+        _remaining -= len;
+        return len;
+    }
+
+    SpeakerStream::SpeakerStream(StreamSource* source, const speaker_stream_config_t& cfg) : _source(source), _cfg(cfg) {}
+
+    SpeakerStream::~SpeakerStream() { end(); }
+
+    bool SpeakerStream::begin(void)
+    {
+        if (_ring)
+        {
+            return true;
+        }
+        if (_source == nullptr || _source->sample_rate == 0)
+        {
+            return false;
+        }
+
+        // Whole frames of any format, so the mixer never reads a pair across the wrap
+        _frame_size = (_source->is_16bit ? 2 : 1) * (_source->is_stereo ? 2 : 1);
+        _ring_size = _cfg.ring_size & ~(size_t)3;
+        _cfg.read_size = std::min(_cfg.read_size, _ring_size / 2);
+        _ring = (uint8_t*)malloc(_ring_size);
+        if (_ring == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to allocate %d bytes ring buffer", (int)_ring_size);
+            return false;
+        }
+
+        _written = 0;
+        _consumed = 0;
+        _eof = false;
+        _underruns = 0;
+        _underrun_samples = 0;
+
+        // Prefetch half the ring, playback starts from memory
+        while (_available() < _ring_size / 2 && _fill(_cfg.read_size))
+        {
+        }
+        if (_eof)
+        {
+            return true;
+        }
+
+        _running = true;
+        _task_done = false;
+        if (xTaskCreate(_reader_task, "stream_reader", _cfg.task_stack_size, this, _cfg.task_priority, &_task_handle) !=
+            pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create reader task");
+            _running = false;
+            _task_done = true;
+            free(_ring);
+            _ring = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void SpeakerStream::end(void)
+    {
+        _running = false;
+        if (_task_handle)
+        {
+            // Let the reader finish its current read, it may hold the file system lock
+            xTaskNotifyGive(_task_handle);
+            while (!_task_done)
+            {
+                vTaskDelay(1);
+            }
+            _task_handle = nullptr;
+        }
+
+        if (_ring)
+        {
+            if (_underruns)
+            {
+                ESP_LOGW(TAG, "%lu underruns, %lu samples lost",
+                         (unsigned long)_underruns.load(), (unsigned long)_underrun_samples.load());
+            }
+            free(_ring);
+            _ring = nullptr;
+        }
+    }
+
+    void SpeakerStream::_consume(size_t bytes, size_t starved)
+    {
+        _consumed.fetch_add(bytes);
+        if (starved && !_eof)
+        {
+            _underruns++;
+            _underrun_samples += starved;
+        }
+        if (_task_handle)
+        {
+            xTaskNotifyGive(_task_handle);
+        }
+    }
+
+    bool SpeakerStream::_fill(size_t max_size)
+    {
+        size_t pos = _written.load() % _ring_size;
+        size_t len = std::min({max_size, _ring_size - _available(), _ring_size - pos});
+        if (len == 0)
+        {
+            return true;
+        }
+
+        int read = _source->read(_ring + pos, len);
+        if (read <= 0)
+        {
+            if (read < 0)
+            {
+                ESP_LOGE(TAG, "Source read failed");
+            }
+            _eof = true;
+            return false;
+        }
+        _written.fetch_add(read, std::memory_order_release);
+        return true;
+    }
+
+    void SpeakerStream::_reader_task(void* args)
+    {
+        SpeakerStream* self = static_cast<SpeakerStream*>(args);
+
+        while (self->_running)
+        {
+            // Wait for the mixer to make room for a whole read
+            if (self->_ring_size - self->_available() < self->_cfg.read_size)
+            {
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+                continue;
+            }
+            if (!self->_fill(self->_cfg.read_size))
+            {
+                break;
+            }
+        }
+
+        // Stay till end(), the speaker task keeps notifying while the rest plays
+        while (self->_running)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        self->_task_done = true;
+        vTaskDelete(nullptr);
+    }
+
+} // namespace HAL
@@ -0,0 +1,165 @@
+/**
+ * @file speaker_stream.h
+ * @brief Audio streamed into a speaker channel through a prefetching ring buffer
+ * @version 0.1
+ * @date 2025-12-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace HAL
+{
+    /**
+     * @brief Where streamed PCM comes from, a file or a network stream
+     */
+    class StreamSource
+    {
+    public:
+        virtual ~StreamSource() = default;
+
+        /**
+         * @brief Read PCM data, called from the stream's reader task
+         * @return Bytes read, 0 at the end, -1 on error
+         */
+        virtual int read(void* buffer, size_t size) = 0;
+
+        /// PCM format, valid once opened
+        uint32_t sample_rate = 0;
+        bool is_16bit = true;
+        bool is_signed = true;
+        bool is_stereo = false;
+    };
+
+    /**
+     * @brief WAV or raw PCM file
+     */
+    class FileStreamSource : public StreamSource
+    {
+    public:
+        ~FileStreamSource() override { close(); }
+
+        /**
+         * @brief Open a PCM WAV file, positioned at its data chunk
+         */
+        bool openWav(const char* path);
+
+        /**
+         * @brief Open a headerless PCM file
+         */
+        bool openRaw(const char* path, uint32_t sample_rate, bool is_16bit, bool is_signed, bool is_stereo);
+
+        void close();
+
+        int read(void* buffer, size_t size) override;
+
+    private:
+        FILE* _file = nullptr;
+        /// Data chunk bytes left, WAV files can have chunks after it
+        size_t _remaining = 0;
+    };
+
+    /**
+     * @brief Configuration structure for SpeakerStream
+     */
+    struct speaker_stream_config_t
+    {
+        /// Ring buffer size (bytes)
+        size_t ring_size = 16384;
+
+        /// Bytes the reader asks the source for at a time
+        size_t read_size = 4096;
+
+        /// Reader task priority, above the UI so SD reads keep up
+        uint8_t task_priority = 3;
+
+        /// Reader task stack size
+        uint32_t task_stack_size = 4096;
+    };
+
+    /**
+     * @brief A reader task prefetches the source into a ring buffer, a speaker channel plays from it
+     * Play it with Speaker::playStream(), stop the channel before end()
+     */
+    class SpeakerStream
+    {
+        friend class Speaker;
+
+    public:
+        SpeakerStream(StreamSource* source, const speaker_stream_config_t& cfg = speaker_stream_config_t());
+        ~SpeakerStream();
+
+        /**
+         * @brief Fill the ring buffer and start the reader task
+         */
+        bool begin(void);
+
+        /**
+         * @brief Stop the reader task and free the ring buffer
+         */
+        void end(void);
+
+        StreamSource* source(void) const { return _source; }
+
+        /**
+         * @brief Check if the source was read to its end and played
+         */
+        bool isFinished(void) const { return _eof && _available() < _frame_size; }
+
+        /**
+         * @brief Number of mixer frames that ran dry before the end of the source
+         */
+        uint32_t getUnderruns(void) const { return _underruns; }
+
+        /**
+         * @brief Output samples lost to underruns
+         */
+        uint32_t getUnderrunSamples(void) const { return _underrun_samples; }
+
+    private:
+        StreamSource* _source;
+        speaker_stream_config_t _cfg;
+
+        uint8_t* _ring = nullptr;
+        size_t _ring_size = 0;
+        size_t _frame_size = 0;
+
+        /// Running byte counts, the ring holds written - consumed
+        std::atomic<size_t> _written = {0};
+        std::atomic<size_t> _consumed = {0};
+
+        std::atomic<bool> _eof = {false};
+        std::atomic<bool> _running = {false};
+        std::atomic<bool> _task_done = {true};
+        TaskHandle_t _task_handle = nullptr;
+
+        std::atomic<uint32_t> _underruns = {0};
+        std::atomic<uint32_t> _underrun_samples = {0};
+
+        size_t _available(void) const { return _written.load(std::memory_order_acquire) - _consumed.load(); }
+
+        /**
+         * @brief Called by the speaker task after mixing a frame
+         * @param bytes Bytes the mixer read
+         * @param starved Output samples it couldn't produce
+         */
+        void _consume(size_t bytes, size_t starved);
+
+        /**
+         * @brief Read once from the source into the ring buffer
+         * @return false at the end of the source
+         */
+        bool _fill(size_t max_size);
+
+        static void _reader_task(void* args);
+    };
+
+} // namespace HAL
@@ -0,0 +1,107 @@
+/**
+ * @file sector_readahead.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "sector_readahead.h"
+#include <algorithm>
+#include <cstring>
+
+namespace HAL
+{
+    SectorReadAhead::SectorReadAhead(read_fn_t read,
+                                     write_fn_t write,
+                                     uint32_t sector_size,
+                                     uint32_t sector_count,
+                                     const sector_readahead_config_t& cfg)
+        : _read(read), _write(write), _sector_size(sector_size), _sector_count(sector_count)
+    {
+        _window = std::max<uint32_t>(cfg.window_bytes / sector_size, 1);
+        _buffer.resize((size_t)_window * sector_size);
+    }
+
+    bool SectorReadAhead::read(uint32_t lba, uint32_t count, uint8_t* data)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (lba >= _sector_count || count > _sector_count - lba)
+        {
+            return false;
+        }
+
+        // Already a big command, nothing to gain
+        if (count >= _window)
+        {
+            _stats.miss_sectors += count;
+            _stats.device_reads++;
+            _next = lba + count;
+            return _read(lba, count, data);
+        }
+
+        // Sequential if it goes on from the last read, or from the window past reads in between (FAT lookups)
+        const bool sequential = (lba == _next) || (_win_count > 0 && lba >= _win_lba && lba <= _win_lba + _win_count);
+        _next = lba + count;
+
+        while (count > 0)
+        {
+            if (_win_count > 0 && _in_window(lba))
+            {
+                const uint32_t n = std::min(count, _win_lba + _win_count - lba);
+                memcpy(data, &_buffer[(size_t)(lba - _win_lba) * _sector_size], (size_t)n * _sector_size);
+                _stats.hit_sectors += n;
+                lba += n;
+                data += (size_t)n * _sector_size;
+                count -= n;
+                continue;
+            }
+
+            if (!sequential)
+            {
+                _stats.miss_sectors += count;
+                _stats.device_reads++;
+                return _read(lba, count, data);
+            }
+
+            // Fetch a window, cut at the end of the device
+            const uint32_t n = std::min(_window, _sector_count - lba);
+            _stats.device_reads++;
+            if (n < count || !_read(lba, n, _buffer.data()))
+            {
+                _win_count = 0;
+                return false;
+            }
+            _win_lba = lba;
+            _win_count = n;
+            _stats.miss_sectors += count;
+            memcpy(data, _buffer.data(), (size_t)count * _sector_size);
+            return true;
+        }
+        return true;
+    }
+
+    bool SectorReadAhead::write(uint32_t lba, uint32_t count, const uint8_t* data)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Keep the window the same as the device
+        if (_win_count > 0 && lba < _win_lba + _win_count && lba + count > _win_lba)
+        {
+            const uint32_t first = std::max(lba, _win_lba);
+            const uint32_t last = std::min(lba + count, _win_lba + _win_count);
+            memcpy(&_buffer[(size_t)(first - _win_lba) * _sector_size],
+                   data + (size_t)(first - lba) * _sector_size,
+                   (size_t)(last - first) * _sector_size);
+        }
+
+        _stats.device_writes++;
+        if (!_write(lba, count, data))
+        {
+            _win_count = 0;
+            return false;
+        }
+        return true;
+    }
+
+} // namespace HAL
@@ -0,0 +1,95 @@
+/**
+ * @file sector_readahead.h
+ * @brief Read-ahead window for sequential sector reads of a slow block device, free of IDF dependencies
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace HAL
+{
+    /**
+     * @brief Configuration structure for SectorReadAhead
+     */
+    struct sector_readahead_config_t
+    {
+        /// Bytes fetched in one device command once reads turn sequential
+        size_t window_bytes = 16 * 1024;
+    };
+
+    /**
+     * @brief Read-ahead statistics, in sectors
+     */
+    struct sector_readahead_stats_t
+    {
+        uint64_t hit_sectors = 0;
+        uint64_t miss_sectors = 0;
+        uint32_t device_reads = 0;
+        uint32_t device_writes = 0;
+    };
+
+    /**
+     * @brief Sits between FATFS and the device
+     *
+     * Small reads that continue the previous one, or the window, fetch a whole window in one command.
+     * Other reads and all writes go straight through in one command each, writes update the window.
+     * Calls are serialized, the device callbacks run under the lock
+     */
+    class SectorReadAhead
+    {
+    public:
+        using read_fn_t = std::function<bool(uint32_t lba, uint32_t count, uint8_t* data)>;
+        using write_fn_t = std::function<bool(uint32_t lba, uint32_t count, const uint8_t* data)>;
+
+        SectorReadAhead(read_fn_t read,
+                        write_fn_t write,
+                        uint32_t sector_size,
+                        uint32_t sector_count,
+                        const sector_readahead_config_t& cfg = sector_readahead_config_t());
+
+        bool read(uint32_t lba, uint32_t count, uint8_t* data);
+        bool write(uint32_t lba, uint32_t count, const uint8_t* data);
+
+        /**
+         * @brief Drop the window, e.g. after the device was written around this layer
+         */
+        void invalidate(void)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _win_count = 0;
+        }
+
+        sector_readahead_stats_t stats(void) const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _stats;
+        }
+
+    private:
+        read_fn_t _read;
+        write_fn_t _write;
+        uint32_t _sector_size;
+        uint32_t _sector_count;
+        uint32_t _window;
+
+        std::vector<uint8_t> _buffer;
+        uint32_t _win_lba = 0;
+        uint32_t _win_count = 0;
+        uint32_t _next = UINT32_MAX;
+
+        sector_readahead_stats_t _stats;
+        mutable std::mutex _mutex;
+
+        bool _in_window(uint32_t lba) const { return lba >= _win_lba && lba < _win_lba + _win_count; }
+    };
+
+} // namespace HAL
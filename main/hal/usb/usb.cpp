@@ -5,10 +5,20 @@
 #include "esp_log.h"
 #include "../hal.h"
 #include "usb.h"
+#include "esp_vfs_fat.h"
+#include "diskio_impl.h"
+#include "esp_timer.h"
 #include <sys/stat.h>
 #include <string.h>
+#include <vector>
 
 static const char* TAG = "USB";
+// Sequential reads are fetched this much at a time
+#define USB_READAHEAD_SIZE (16 * 1024)
+// Only commands this big count for the speed readout, sector sized ones are all latency
+#define USB_SPEED_MIN_SIZE (16 * 1024)
+// Read at mount so the speed is known before the first file
+#define USB_SPEED_PROBE_SIZE (64 * 1024)
 // workaround for msc_host.h cant see MSC_DEVICE_CONNECTED and MSC_DEVICE_DISCONNECTED
 #define MSC_DEVICE_CONNECTED 0
 #define MSC_DEVICE_DISCONNECTED 1
@@ -43,6 +53,52 @@ namespace HAL
         return result;
     }
     const char* USB::MOUNT_POINT = "/usb";
+
+    /**
+     * @brief FATFS disk driver of the mounted device, sectors go through the read-ahead
+     */
+    struct USBDiskIO
+    {
+        static USB* usb;
+
+        static DSTATUS init(BYTE pdrv) { return 0; }
+        static DSTATUS status(BYTE pdrv) { return 0; }
+
+        static DRESULT read(BYTE pdrv, BYTE* buff, LBA_t sector, UINT count)
+        {
+            bool ok = usb->_cache_dev >= 0 ? usb->_cache->read(usb->_cache_dev, sector, count, buff)
+                                           : usb->_readahead->read(sector, count, buff);
+            return ok ? RES_OK : RES_ERROR;
+        }
+
+        static DRESULT write(BYTE pdrv, const BYTE* buff, LBA_t sector, UINT count)
+        {
+            bool ok = usb->_cache_dev >= 0 ? usb->_cache->write(usb->_cache_dev, sector, count, buff)
+                                           : usb->_readahead->write(sector, count, buff);
+            return ok ? RES_OK : RES_ERROR;
+        }
+
+        static DRESULT ioctl(BYTE pdrv, BYTE cmd, void* buff)
+        {
+            switch (cmd)
+            {
+            case CTRL_SYNC:
+                return usb->_cache_dev < 0 || usb->_cache->flush(usb->_cache_dev) ? RES_OK : RES_ERROR;
+            case GET_SECTOR_COUNT:
+                *(LBA_t*)buff = usb->_device_info.sectorCount;
+                return RES_OK;
+            case GET_SECTOR_SIZE:
+                *(WORD*)buff = usb->_device_info.sectorSize;
+                return RES_OK;
+            case GET_BLOCK_SIZE:
+                *(DWORD*)buff = 1;
+                return RES_OK;
+            }
+            return RES_PARERR;
+        }
+    };
+    USB* USBDiskIO::usb = nullptr;
+
     /**
      * @brief Context structure passed to USB task
      */
@@ -53,7 +109,9 @@ namespace HAL
 
     USB::USB(void* hal)
         : _usb_task_handle(nullptr), _usb_initialized(false), _device_connected(false), _is_mounted(false), _device_addr(0),
-          _device_info({}), _msc_device(nullptr), _vfs_handle(nullptr), _hal(hal)
+          _device_info({}), _msc_device(nullptr), _readahead(nullptr), _cache(nullptr), _cache_dev(-1),
+          _pdrv(FF_DRV_NOT_USED), _fs(nullptr), _hal(hal),
+          _read_bytes(0), _read_us(0), _write_bytes(0), _write_us(0), _read_speed(0), _write_speed(0)
     {
         _app_queue = xQueueCreate(5, sizeof(TaskMessage));
         BaseType_t task_created;
@@ -290,21 +348,9 @@ namespace HAL
             ESP_LOGI(TAG, "Mount: device already mounted");
             return true;
         }
-        const esp_vfs_fat_mount_config_t mount_config = {.format_if_mount_failed = false,
-                                                         .max_files = 3,
-                                                         .allocation_unit_size = 8192,
-                                                         .disk_status_check_enable = false,
-                                                         .use_one_fat = false};
-        ESP_LOGI(TAG, "Mounting USB device: %p %s", _msc_device, MOUNT_POINT);
-        esp_err_t err = msc_host_vfs_register(_msc_device, MOUNT_POINT, &mount_config, &_vfs_handle);
-        if (err != ESP_OK)
-        {
-            ESP_LOGE(TAG, "Failed to register VFS: %s", esp_err_to_name(err));
-            return false;
-        }
-        // Read device info
+        // Read device info, the disk driver needs the geometry
         msc_host_device_info_t device_info;
-        err = msc_host_get_device_info(_msc_device, &device_info);
+        esp_err_t err = msc_host_get_device_info(_msc_device, &device_info);
         if (err != ESP_OK)
         {
             ESP_LOGE(TAG, "Failed to get device info: %s", esp_err_to_name(err));
@@ -328,29 +374,120 @@ namespace HAL
                  _device_info.sectorCount,
                  _device_info.capacityBytes);
 
+        if (_device_info.sectorSize > FF_MAX_SS)
+        {
+            ESP_LOGE(TAG, "Sector size %ld not supported", _device_info.sectorSize);
+            return false;
+        }
+
+        _read_bytes = _read_us = _write_bytes = _write_us = 0;
+        _read_speed = _write_speed = 0;
+        _probe_speed();
+
+        // FATFS over our own disk driver, so sequential reads can be fetched ahead in big commands
+        ESP_LOGI(TAG, "Mounting USB device: %p %s", _msc_device, MOUNT_POINT);
+        if (ff_diskio_get_drive(&_pdrv) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "No free FATFS drive");
+            return false;
+        }
+        sector_readahead_config_t readahead_config;
+        readahead_config.window_bytes = USB_READAHEAD_SIZE;
+        _readahead = new SectorReadAhead(
+            [this](uint32_t lba, uint32_t count, uint8_t* data) { return _device_read(lba, count, data); },
+            [this](uint32_t lba, uint32_t count, const uint8_t* data) { return _device_write(lba, count, data); },
+            _device_info.sectorSize,
+            _device_info.sectorCount,
+            readahead_config);
+        // Shared cache above the read-ahead, FAT and directory sectors stay around
+        _cache = _hal ? static_cast<HAL::Hal*>(_hal)->blockCache() : nullptr;
+        if (_cache != nullptr)
+        {
+            _cache_dev = _cache->attach(
+                [this](uint32_t lba, uint32_t count, uint8_t* data) { return _readahead->read(lba, count, data); },
+                [this](uint32_t lba, uint32_t count, const uint8_t* data) { return _readahead->write(lba, count, data); },
+                _device_info.sectorSize);
+        }
+        USBDiskIO::usb = this;
+        static const ff_diskio_impl_t diskio = {
+            .init = USBDiskIO::init,
+            .status = USBDiskIO::status,
+            .read = USBDiskIO::read,
+            .write = USBDiskIO::write,
+            .ioctl = USBDiskIO::ioctl,
+        };
+        ff_diskio_register(_pdrv, &diskio);
+
+        const char drive[3] = {(char)('0' + _pdrv), ':', 0};
+        const esp_vfs_fat_conf_t vfs_config = {.base_path = MOUNT_POINT, .fat_drive = drive, .max_files = 3};
+        err = esp_vfs_fat_register_cfg(&vfs_config, &_fs);
+        FRESULT fres = err == ESP_OK ? f_mount(_fs, drive, 1) : FR_INT_ERR;
+        if (fres != FR_OK)
+        {
+            ESP_LOGE(TAG, "Failed to mount FATFS: %s / %d", esp_err_to_name(err), fres);
+            unmount();
+            return false;
+        }
+
+        if (_cache_dev >= 0)
+        {
+            _cache->setWriteBack(_cache_dev, _fs->fatbase, _fs->fsize * _fs->n_fats);
+        }
+
         _is_mounted = true;
-        ESP_LOGI(TAG, "Mount: device mounted at %s", MOUNT_POINT);
+        ESP_LOGI(TAG, "Mount: device mounted at %s, %lu KB/s", MOUNT_POINT, get_read_speed());
         return true;
     }
 
     bool USB::unmount()
     {
         ESP_LOGI(TAG, "Unmounting USB device");
-        if (!_is_mounted)
+        if (!_is_mounted && _pdrv == FF_DRV_NOT_USED)
         {
             ESP_LOGI(TAG, "Unmount: device is not mounted");
             return true;
         }
 
-        esp_err_t err;
-        if (_vfs_handle != nullptr)
+        // Dirty FAT sectors go out while the device is still there
+        if (_cache_dev >= 0)
+        {
+            block_cache_stats_t stats = _cache->stats(_cache_dev);
+            ESP_LOGI(TAG,
+                     "Block cache: %u%% hit rate, %llu hits, %llu misses, %llu written back",
+                     stats.hitRate(),
+                     stats.hits,
+                     stats.misses,
+                     stats.write_backs);
+            _cache->detach(_cache_dev);
+            _cache_dev = -1;
+        }
+        if (_fs != nullptr)
         {
-            err = msc_host_vfs_unregister(_vfs_handle);
+            const char drive[3] = {(char)('0' + _pdrv), ':', 0};
+            f_mount(nullptr, drive, 0);
+            esp_err_t err = esp_vfs_fat_unregister_path(MOUNT_POINT);
             if (err != ESP_OK)
             {
                 ESP_LOGE(TAG, "Failed to unmount VFS: %s", esp_err_to_name(err));
             }
-            _vfs_handle = nullptr;
+            _fs = nullptr;
+        }
+        if (_pdrv != FF_DRV_NOT_USED)
+        {
+            ff_diskio_register(_pdrv, nullptr);
+            _pdrv = FF_DRV_NOT_USED;
+        }
+        if (_readahead != nullptr)
+        {
+            const sector_readahead_stats_t stats = _readahead->stats();
+            ESP_LOGI(TAG,
+                     "Read-ahead: %llu hit, %llu miss sectors in %lu reads, %lu writes",
+                     stats.hit_sectors,
+                     stats.miss_sectors,
+                     stats.device_reads,
+                     stats.device_writes);
+            delete _readahead;
+            _readahead = nullptr;
         }
         _is_mounted = false;
 
@@ -358,4 +495,59 @@ namespace HAL
         return true;
     }
 
+    bool USB::_device_read(uint32_t lba, uint32_t count, uint8_t* data)
+    {
+        const size_t size = (size_t)count * _device_info.sectorSize;
+        const int64_t start = esp_timer_get_time();
+        esp_err_t err = msc_host_read_sector(_msc_device, lba, data, size);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read %lu sectors at %lu: %s", count, lba, esp_err_to_name(err));
+            return false;
+        }
+        if (size >= USB_SPEED_MIN_SIZE)
+        {
+            _read_us += esp_timer_get_time() - start;
+            _read_bytes += size;
+            _read_speed = _read_us ? _read_bytes * 1000000 / _read_us / 1024 : 0;
+        }
+        return true;
+    }
+
+    bool USB::_device_write(uint32_t lba, uint32_t count, const uint8_t* data)
+    {
+        const size_t size = (size_t)count * _device_info.sectorSize;
+        const int64_t start = esp_timer_get_time();
+        esp_err_t err = msc_host_write_sector(_msc_device, lba, data, size);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to write %lu sectors at %lu: %s", count, lba, esp_err_to_name(err));
+            return false;
+        }
+        if (size >= USB_SPEED_MIN_SIZE)
+        {
+            _write_us += esp_timer_get_time() - start;
+            _write_bytes += size;
+            _write_speed = _write_us ? _write_bytes * 1000000 / _write_us / 1024 : 0;
+        }
+        return true;
+    }
+
+    void USB::_probe_speed()
+    {
+        const uint32_t count = USB_SPEED_MIN_SIZE / _device_info.sectorSize;
+        if (count == 0 || _device_info.sectorCount < USB_SPEED_PROBE_SIZE / _device_info.sectorSize)
+        {
+            return;
+        }
+        std::vector<uint8_t> buffer(USB_SPEED_MIN_SIZE);
+        for (uint32_t lba = 0; lba < USB_SPEED_PROBE_SIZE / _device_info.sectorSize; lba += count)
+        {
+            if (!_device_read(lba, count, buffer.data()))
+            {
+                return;
+            }
+        }
+    }
+
 } // namespace HAL
\ No newline at end of file
@@ -7,13 +7,16 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string>
+#include <atomic>
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "usb/usb_host.h"
 #include "msc_host.h"
-#include "msc_host_vfs.h"
+#include "ff.h"
+#include "sector_readahead.h"
+#include "cache/block_cache.h"
 
 namespace HAL
 {
@@ -49,9 +52,22 @@ namespace HAL
         uint8_t _device_addr;
         USBDeviceInfo _device_info;
         msc_host_device_handle_t _msc_device;
-        msc_host_vfs_handle_t _vfs_handle;
+        SectorReadAhead* _readahead;
+        BlockCache* _cache;
+        int _cache_dev;
+        uint8_t _pdrv;
+        FATFS* _fs;
         void* _hal;
 
+        // Device commands of a bulk size, timed for the speed readout. The totals belong to the I/O path, other tasks
+        // only see the KB/s published from them
+        uint64_t _read_bytes;
+        uint64_t _read_us;
+        uint64_t _write_bytes;
+        uint64_t _write_us;
+        std::atomic<uint32_t> _read_speed;
+        std::atomic<uint32_t> _write_speed;
+
         // Internal message types
         enum MessageType
         {
@@ -72,6 +88,12 @@ namespace HAL
         // MSC event callback
         static void msc_event_callback(const void* event, void* arg);
 
+        // Sector access for the FATFS disk driver
+        friend struct USBDiskIO;
+        bool _device_read(uint32_t lba, uint32_t count, uint8_t* data);
+        bool _device_write(uint32_t lba, uint32_t count, const uint8_t* data);
+        void _probe_speed();
+
     public:
         USB(void* hal);
         ~USB();
@@ -135,6 +157,20 @@ namespace HAL
          * @return uint64_t Capacity in bytes
          */
         uint64_t get_capacity() const { return _device_info.capacityBytes; }
+
+        /**
+         * @brief Get measured read speed
+         *
+         * @return uint32_t KB/s, 0 if not measured yet
+         */
+        uint32_t get_read_speed() const { return _read_speed; }
+
+        /**
+         * @brief Get measured write speed
+         *
+         * @return uint32_t KB/s, 0 if not measured yet
+         */
+        uint32_t get_write_speed() const { return _write_speed; }
     };
 
 } // namespace HAL
\ No newline at end of file
@@ -0,0 +1,97 @@
+/**
+ * @file link_quality.cpp
+ * @brief
+ * @version 0.1
+ * @date 2025-12-17
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include "link_quality.h"
+
+namespace HAL
+{
+    void LinkQuality::restart(void)
+    {
+        _ewma_valid = false;
+        _level = LEVEL_WEAK;
+        _stats.rssi = 0;
+        _rx_pending = 0;
+        _tx_pending = 0;
+        _stats.rx_bps = 0;
+        _stats.tx_bps = 0;
+    }
+
+    LinkQuality::level_t LinkQuality::_level_of(int32_t rssi) const
+    {
+        if (rssi >= _cfg.strong_dbm)
+        {
+            return LEVEL_STRONG;
+        }
+        return (rssi >= _cfg.good_dbm) ? LEVEL_GOOD : LEVEL_WEAK;
+    }
+
+    bool LinkQuality::addSample(int8_t rssi, uint32_t now_ms)
+    {
+        // Traffic since the last sample
+        const uint32_t rx = _rx_pending.exchange(0, std::memory_order_relaxed);
+        const uint32_t tx = _tx_pending.exchange(0, std::memory_order_relaxed);
+        _stats.rx_bytes += rx;
+        _stats.tx_bytes += tx;
+        if (_ewma_valid && now_ms != _last_sample_ms)
+        {
+            const uint32_t elapsed_ms = now_ms - _last_sample_ms;
+            _stats.rx_bps = (uint64_t)rx * 8000 / elapsed_ms;
+            _stats.tx_bps = (uint64_t)tx * 8000 / elapsed_ms;
+        }
+        _last_sample_ms = now_ms;
+
+        _stats.rssi_min = (_stats.samples == 0 || rssi < _stats.rssi_min) ? rssi : _stats.rssi_min;
+        _stats.rssi_max = (_stats.samples == 0 || rssi > _stats.rssi_max) ? rssi : _stats.rssi_max;
+        _stats.samples++;
+
+        if (!_ewma_valid)
+        {
+            // First sample of a connection sets the level outright
+            _ewma = rssi * 256;
+            _ewma_valid = true;
+            _stats.rssi = rssi;
+            level_t level = _level_of(rssi);
+            bool changed = (level != _level);
+            _level = level;
+            _stats.level_changes += changed;
+            return changed;
+        }
+
+        _ewma += (rssi * 256 - _ewma) >> _cfg.ewma_shift;
+        const int32_t smoothed = (_ewma + 128) >> 8;
+        _stats.rssi = smoothed;
+
+        // Move a level only once past its boundary by the hysteresis
+        level_t level = _level;
+        const int32_t h = _cfg.hysteresis_db;
+        while (level < LEVEL_STRONG && smoothed >= (level == LEVEL_WEAK ? _cfg.good_dbm : _cfg.strong_dbm) + h)
+        {
+            level = (level_t)(level + 1);
+        }
+        while (level > LEVEL_WEAK && smoothed < (level == LEVEL_STRONG ? _cfg.strong_dbm : _cfg.good_dbm) - h)
+        {
+            level = (level_t)(level - 1);
+        }
+
+        if (level == _level)
+        {
+            return false;
+        }
+        _level = level;
+        _stats.level_changes++;
+        return true;
+    }
+
+    void LinkQuality::countDisconnect(uint8_t reason)
+    {
+        _stats.disconnects++;
+        _stats.last_disconnect_reason = reason;
+    }
+
+} // namespace HAL
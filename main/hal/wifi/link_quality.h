@@ -0,0 +1,121 @@
+/**
+ * @file link_quality.h
+ * @brief Smoothed signal level and traffic statistics of the station link, free of IDF dependencies
+ * @version 0.1
+ * @date 2025-12-17
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+namespace HAL
+{
+    /**
+     * @brief Configuration structure for LinkQuality
+     */
+    struct link_quality_config_t
+    {
+        /// Level boundaries (dBm), below good is weak
+        int8_t good_dbm = -80;
+        int8_t strong_dbm = -67;
+
+        /// A level is left only this far past its boundary (dB)
+        uint8_t hysteresis_db = 3;
+
+        /// EWMA weight of a new sample is 1 / 2^shift
+        uint8_t ewma_shift = 2;
+    };
+
+    /**
+     * @brief Link statistics
+     */
+    struct link_stats_t
+    {
+        /// Smoothed and raw extremes of the AP RSSI (dBm)
+        int8_t rssi = 0;
+        int8_t rssi_min = 0;
+        int8_t rssi_max = 0;
+        uint32_t samples = 0;
+        uint32_t level_changes = 0;
+
+        /// Station traffic, totals and rates over the last sample period
+        uint64_t rx_bytes = 0;
+        uint64_t tx_bytes = 0;
+        uint32_t rx_bps = 0;
+        uint32_t tx_bps = 0;
+
+        /// Link losses and the reconnect attempts they caused
+        uint32_t disconnects = 0;
+        uint32_t reconnects = 0;
+        uint32_t beacon_timeouts = 0;
+        uint8_t last_disconnect_reason = 0;
+    };
+
+    /**
+     * @brief Turns periodic RSSI samples into a level that doesn't flap, and counts link traffic
+     */
+    class LinkQuality
+    {
+    public:
+        enum level_t : uint8_t
+        {
+            LEVEL_WEAK = 0,
+            LEVEL_GOOD,
+            LEVEL_STRONG,
+        };
+
+        LinkQuality(const link_quality_config_t& cfg = link_quality_config_t()) : _cfg(cfg) {}
+
+        /**
+         * @brief Forget the smoothed RSSI on a new connection, counters carry on
+         */
+        void restart(void);
+
+        /**
+         * @brief Add an RSSI sample
+         * @param now_ms Sample time, for the traffic rates
+         * @return true if the level changed
+         */
+        bool addSample(int8_t rssi, uint32_t now_ms);
+
+        /**
+         * @brief Count traffic, safe from any task
+         */
+        void addRx(size_t bytes) { _rx_pending.fetch_add(bytes, std::memory_order_relaxed); }
+        void addTx(size_t bytes) { _tx_pending.fetch_add(bytes, std::memory_order_relaxed); }
+
+        void countDisconnect(uint8_t reason);
+        void countReconnect(void) { _stats.reconnects++; }
+        void countBeaconTimeout(void) { _stats.beacon_timeouts++; }
+
+        /**
+         * @brief Check if a sample was taken since restart()
+         */
+        bool hasSample(void) const { return _ewma_valid; }
+
+        level_t level(void) const { return _level; }
+        int8_t rssi(void) const { return _stats.rssi; }
+        const link_stats_t& stats(void) const { return _stats; }
+
+    private:
+        link_quality_config_t _cfg;
+        link_stats_t _stats;
+        level_t _level = LEVEL_WEAK;
+
+        /// RSSI with 8 fraction bits
+        int32_t _ewma = 0;
+        bool _ewma_valid = false;
+
+        std::atomic<uint32_t> _rx_pending = {0};
+        std::atomic<uint32_t> _tx_pending = {0};
+        uint32_t _last_sample_ms = 0;
+
+        level_t _level_of(int32_t rssi) const;
+    };
+
+} // namespace HAL
@@ -10,49 +10,234 @@
 #include "lwip/sys.h"
 #include "lwip/dns.h"
 #include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+#include "nvs.h"
 #include <cstdlib>
 
 static const char* TAG = "WIFI";
 
+// How often the AP RSSI is sampled while connected
+#define LINK_SAMPLE_PERIOD_MS 2000
+
+// Set once no init() is pending
+#define WIFI_INIT_DONE_BIT BIT0
+
+// Last joined AP, in the settings NVS partition
+#define AP_CACHE_NAMESPACE "wifi_ap"
+#define AP_CACHE_KEY "last"
+
 namespace HAL
 {
+    // Link level changes, posted by the sample timer so the status callback runs on the event loop task
+    ESP_EVENT_DEFINE_BASE(WIFI_LINK_EVENT);
+    enum
+    {
+        WIFI_LINK_EVENT_LEVEL_CHANGED,
+    };
 
     // Static instance pointer for event handler
     static WiFi* s_wifi_instance = nullptr;
 
+    // lwIP entry points of the station netif, wrapped to count its own traffic
+    static LinkQuality* s_link = nullptr;
+    static netif_input_fn s_netif_input = nullptr;
+    static netif_linkoutput_fn s_netif_linkoutput = nullptr;
+
+    static err_t _counting_input(struct pbuf* p, struct netif* inp)
+    {
+        s_link->addRx(p->tot_len);
+        return s_netif_input(p, inp);
+    }
+
+    static err_t _counting_linkoutput(struct netif* netif, struct pbuf* p)
+    {
+        s_link->addTx(p->tot_len);
+        return s_netif_linkoutput(netif, p);
+    }
+
+    static uint32_t _ssid_hash(const std::string& ssid)
+    {
+        uint32_t hash = 2166136261u;
+        for (char c : ssid)
+        {
+            hash ^= (uint8_t)c;
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
     WiFi::WiFi(SETTINGS::Settings* settings)
-        : _settings(settings), _status(WIFI_STATUS_IDLE), _initialized(false), _rssi(0), _last_status_check(0)
+        : _settings(settings), _status(WIFI_STATUS_IDLE), _initialized(false), _rssi(0), _last_status_check(0),
+          _sta_netif(nullptr), _link_timer(nullptr), _directed(false), _link_established(false), _connect_start_us(0),
+          _init_events(xEventGroupCreate()), _init_task(nullptr)
     {
         s_wifi_instance = this;
+        xEventGroupSetBits(_init_events, WIFI_INIT_DONE_BIT);
         // memset(_sta_mac, 0, sizeof(_sta_mac));
     }
 
     WiFi::~WiFi()
     {
         deinit();
+        vEventGroupDelete(_init_events);
         s_wifi_instance = nullptr;
     }
 
-    void WiFi::_wifi_promiscuous_rx_cb(void* buf, wifi_promiscuous_pkt_type_t type)
+    void WiFi::deferInit() { xEventGroupClearBits(_init_events, WIFI_INIT_DONE_BIT); }
+
+    void WiFi::_wait_init()
     {
-        if (s_wifi_instance == nullptr)
+        if (_init_task == xTaskGetCurrentTaskHandle())
+        {
             return;
+        }
+        xEventGroupWaitBits(_init_events, WIFI_INIT_DONE_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+
+    void WiFi::_link_timer_cb(void* arg) { static_cast<WiFi*>(arg)->_sample_link(); }
 
-        // Only process data frames
-        if (type == WIFI_PKT_MGMT)
+    void WiFi::_sample_link()
+    {
+        int rssi = 0;
+        if (!is_connected() || esp_wifi_sta_get_rssi(&rssi) != ESP_OK)
         {
-            wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buf;
-            if (pkt != nullptr)
-            {
-                int8_t rssi = pkt->rx_ctrl.rssi;
-                // Update RSSI if it changed significantly (to avoid too frequent callbacks)
-                if (abs(s_wifi_instance->_rssi - rssi) >= 5 || s_wifi_instance->_rssi == 0)
-                {
-                    s_wifi_instance->_rssi = rssi;
-                    s_wifi_instance->_update_status_from_rssi();
-                }
-            }
+            return;
+        }
+
+        // Callback only when the smoothed level moves
+        bool changed = _link.addSample(rssi, esp_timer_get_time() / 1000);
+        _rssi = _link.rssi();
+        if (changed)
+        {
+            ESP_LOGD(TAG, "Link level %d, RSSI %d dBm", _link.level(), _rssi);
+            // The status callback does HAL work, too much for the timer task stack.
+            // A full loop drops the event, the next change catches up
+            esp_event_post(WIFI_LINK_EVENT, WIFI_LINK_EVENT_LEVEL_CHANGED, nullptr, 0, 0);
+        }
+    }
+
+    void WiFi::_start_link_monitor()
+    {
+        // Count traffic of the netif, created again by each init()
+        struct netif* netif = (struct netif*)esp_netif_get_netif_impl(_sta_netif);
+        if (netif != nullptr && netif->input != _counting_input)
+        {
+            s_link = &_link;
+            s_netif_input = netif->input;
+            s_netif_linkoutput = netif->linkoutput;
+            netif->input = _counting_input;
+            netif->linkoutput = _counting_linkoutput;
+        }
+
+        _link.restart();
+        _sample_link();
+        if (_link_timer)
+        {
+            esp_timer_stop(_link_timer);
+            esp_timer_start_periodic(_link_timer, LINK_SAMPLE_PERIOD_MS * 1000);
+        }
+    }
+
+    void WiFi::_stop_link_monitor()
+    {
+        if (_link_timer)
+        {
+            esp_timer_stop(_link_timer);
+        }
+    }
+
+    bool WiFi::_load_ap_cache()
+    {
+        _ap_cache = wifi_ap_cache_t();
+        nvs_handle_t nvs_handle;
+        if (nvs_open_from_partition(SETTINGS::Settings::NVS_PARTITION, AP_CACHE_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK)
+        {
+            return false;
+        }
+        wifi_ap_cache_t cache;
+        size_t size = sizeof(cache);
+        bool valid = nvs_get_blob(nvs_handle, AP_CACHE_KEY, &cache, &size) == ESP_OK && size == sizeof(cache) &&
+                     cache.ssid_hash == _ssid_hash(_wifi_settings.ssid) && cache.channel != 0;
+        nvs_close(nvs_handle);
+        if (valid)
+        {
+            _ap_cache = cache;
+        }
+        return valid;
+    }
+
+    void WiFi::_save_ap_cache(const wifi_event_sta_connected_t* event)
+    {
+        wifi_ap_cache_t cache;
+        cache.ssid_hash = _ssid_hash(_wifi_settings.ssid);
+        memcpy(cache.bssid, event->bssid, sizeof(cache.bssid));
+        cache.channel = event->channel;
+        cache.authmode = event->authmode;
+
+        // Write only when the AP changed, not on every reconnect
+        if (memcmp(&cache, &_ap_cache, sizeof(cache)) == 0)
+        {
+            return;
+        }
+        nvs_handle_t nvs_handle;
+        if (nvs_open_from_partition(SETTINGS::Settings::NVS_PARTITION, AP_CACHE_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to open NVS for the AP cache");
+            return;
+        }
+        if (nvs_set_blob(nvs_handle, AP_CACHE_KEY, &cache, sizeof(cache)) == ESP_OK && nvs_commit(nvs_handle) == ESP_OK)
+        {
+            _ap_cache = cache;
+            ESP_LOGI(TAG, "Cached AP " MACSTR " on channel %d", MAC2STR(cache.bssid), cache.channel);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Failed to save the AP cache");
+        }
+        nvs_close(nvs_handle);
+    }
+
+    void WiFi::_clear_ap_cache()
+    {
+        _ap_cache = wifi_ap_cache_t();
+        nvs_handle_t nvs_handle;
+        if (nvs_open_from_partition(SETTINGS::Settings::NVS_PARTITION, AP_CACHE_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK)
+        {
+            return;
+        }
+        if (nvs_erase_key(nvs_handle, AP_CACHE_KEY) == ESP_OK)
+        {
+            nvs_commit(nvs_handle);
         }
+        nvs_close(nvs_handle);
+    }
+
+    bool WiFi::_set_sta_config(bool directed)
+    {
+        wifi_config_t wifi_config = {};
+        memset(&wifi_config, 0, sizeof(wifi_config_t));
+
+        strncpy((char*)wifi_config.sta.ssid, _wifi_settings.ssid.c_str(), sizeof(wifi_config.sta.ssid) - 1);
+        strncpy((char*)wifi_config.sta.password, _wifi_settings.password.c_str(), sizeof(wifi_config.sta.password) - 1);
+
+        if (directed)
+        {
+            // Join the cached AP on its channel, the other channels are not scanned
+            memcpy(wifi_config.sta.bssid, _ap_cache.bssid, sizeof(wifi_config.sta.bssid));
+            wifi_config.sta.bssid_set = true;
+            wifi_config.sta.channel = _ap_cache.channel;
+            wifi_config.sta.threshold.authmode = (wifi_auth_mode_t)_ap_cache.authmode;
+            wifi_config.sta.pmf_cfg.required = _ap_cache.authmode == WIFI_AUTH_WPA3_PSK;
+        }
+
+        esp_err_t err = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to set WiFi config: %s", esp_err_to_name(err));
+            return false;
+        }
+        _directed = directed;
+        return true;
     }
 
     void WiFi::_wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
@@ -63,6 +248,7 @@ namespace HAL
         if (event_base == WIFI_EVENT)
         {
             bool status_changed = false;
+            bool link_up = false;
             switch (event_id)
             {
             case WIFI_EVENT_STA_START:
@@ -76,6 +262,9 @@ namespace HAL
                 ESP_LOGI(TAG, "WiFi connected");
                 status_changed = s_wifi_instance->_status != WIFI_STATUS_CONNECTED_WEAK;
                 s_wifi_instance->_status = WIFI_STATUS_CONNECTED_WEAK;
+                s_wifi_instance->_link_established = true;
+                s_wifi_instance->_save_ap_cache((wifi_event_sta_connected_t*)event_data);
+                link_up = true;
 
                 // // Get connected AP info
                 // wifi_ap_record_t ap_info;
@@ -88,68 +277,105 @@ namespace HAL
                 // Get our station MAC address
                 // esp_wifi_get_mac(WIFI_IF_STA, s_wifi_instance->_sta_mac);
 
-                // Status will be updated based on RSSI in promiscuous callback
+                // Level follows from the first RSSI sample, then from samples on a timer
+                break;
+
+            case WIFI_EVENT_STA_BEACON_TIMEOUT:
+                s_wifi_instance->_link.countBeaconTimeout();
                 break;
 
             case WIFI_EVENT_STA_DISCONNECTED:
-                ESP_LOGI(TAG, "WiFi disconnected");
-                // Disable promiscuous mode
-                esp_wifi_set_promiscuous(false);
-                esp_wifi_set_promiscuous_rx_cb(nullptr);
-                ESP_LOGD(TAG, "Promiscuous mode disabled");
+            {
+                wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*)event_data;
+                ESP_LOGI(TAG, "WiFi disconnected, reason %d", event->reason);
+                bool was_connected = s_wifi_instance->_link_established;
+                s_wifi_instance->_link_established = false;
+                s_wifi_instance->_stop_link_monitor();
+                s_wifi_instance->_link.countDisconnect(event->reason);
                 status_changed = s_wifi_instance->_status != WIFI_STATUS_DISCONNECTED;
                 s_wifi_instance->_status = WIFI_STATUS_DISCONNECTED;
                 s_wifi_instance->_rssi = 0;
                 // Clear AP BSSID
                 // memset(s_wifi_instance->_ap_bssid, 0, sizeof(s_wifi_instance->_ap_bssid));
                 // Try to reconnect if enabled
-                if (s_wifi_instance->_settings->getBool("wifi", "enabled"))
+                if (s_wifi_instance->_settings->getBool(SETTINGS::WIFI_ENABLED))
                 {
+                    // The cached AP is gone or moved, find the SSID by scanning from now on
+                    if (s_wifi_instance->_directed && !was_connected && event->reason != WIFI_REASON_ASSOC_LEAVE)
+                    {
+                        ESP_LOGI(TAG, "Directed connect failed, scanning");
+                        s_wifi_instance->_clear_ap_cache();
+                        s_wifi_instance->_set_sta_config(false);
+                    }
                     ESP_LOGI(TAG, "WiFi reconnecting...");
+                    s_wifi_instance->_connect_start_us = esp_timer_get_time();
                     esp_wifi_connect();
+                    s_wifi_instance->_link.countReconnect();
                     status_changed = s_wifi_instance->_status != WIFI_STATUS_CONNECTING;
                     s_wifi_instance->_status = WIFI_STATUS_CONNECTING;
                 }
                 break;
             }
+            }
             if (status_changed && s_wifi_instance->_status_callback)
             {
                 s_wifi_instance->_status_callback(s_wifi_instance->_status);
             }
+            if (link_up)
+            {
+                s_wifi_instance->_start_link_monitor();
+            }
         }
         else if (event_base == IP_EVENT)
         {
             if (event_id == IP_EVENT_STA_GOT_IP)
             {
                 ip_event_got_ip_t* event = (ip_event_got_ip_t*)event_data;
-                ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+                ESP_LOGI(TAG,
+                         "Got IP: " IPSTR " in %lld ms (%s)",
+                         IP2STR(&event->ip_info.ip),
+                         (esp_timer_get_time() - s_wifi_instance->_connect_start_us) / 1000,
+                         s_wifi_instance->_directed ? "directed" : "scanned");
                 // set IP, mask and gateway to settings
-                s_wifi_instance->_settings->setString("wifi", "ip", ip4addr_ntoa((ip4_addr_t*)&event->ip_info.ip));
-                s_wifi_instance->_settings->setString("wifi", "mask", ip4addr_ntoa((ip4_addr_t*)&event->ip_info.netmask));
-                s_wifi_instance->_settings->setString("wifi", "gateway", ip4addr_ntoa((ip4_addr_t*)&event->ip_info.gw));
+                s_wifi_instance->_settings->setString(SETTINGS::WIFI_IP, ip4addr_ntoa((ip4_addr_t*)&event->ip_info.ip));
+                s_wifi_instance->_settings->setString(SETTINGS::WIFI_MASK, ip4addr_ntoa((ip4_addr_t*)&event->ip_info.netmask));
+                s_wifi_instance->_settings->setString(SETTINGS::WIFI_GW, ip4addr_ntoa((ip4_addr_t*)&event->ip_info.gw));
             }
         }
+        else if (event_base == WIFI_LINK_EVENT)
+        {
+            s_wifi_instance->_update_status_from_rssi();
+        }
     }
 
     bool WiFi::init()
+    {
+        _init_task = xTaskGetCurrentTaskHandle();
+        bool ok = _init();
+        _init_task = nullptr;
+        xEventGroupSetBits(_init_events, WIFI_INIT_DONE_BIT);
+        return ok;
+    }
+
+    bool WiFi::_init()
     {
         if (_initialized)
         {
             deinit();
         }
-        if (!_settings->getBool("wifi", "enabled"))
+        if (!_settings->getBool(SETTINGS::WIFI_ENABLED))
         {
             _status = WIFI_STATUS_IDLE;
             ESP_LOGD(TAG, "WiFi is disabled by settings");
             return true;
         }
-        _wifi_settings.ssid = _settings->getString("wifi", "ssid");
-        _wifi_settings.password = _settings->getString("wifi", "pass");
-        _wifi_settings.static_ip = _settings->getBool("wifi", "static_ip");
-        _wifi_settings.ip = _settings->getString("wifi", "ip");
-        _wifi_settings.mask = _settings->getString("wifi", "mask");
-        _wifi_settings.gateway = _settings->getString("wifi", "gateway");
-        _wifi_settings.dns = _settings->getString("wifi", "dns");
+        _wifi_settings.ssid = _settings->getString(SETTINGS::WIFI_SSID);
+        _wifi_settings.password = _settings->getString(SETTINGS::WIFI_PASS);
+        _wifi_settings.static_ip = _settings->getBool(SETTINGS::WIFI_STATIC_IP);
+        _wifi_settings.ip = _settings->getString(SETTINGS::WIFI_IP);
+        _wifi_settings.mask = _settings->getString(SETTINGS::WIFI_MASK);
+        _wifi_settings.gateway = _settings->getString(SETTINGS::WIFI_GW);
+        _wifi_settings.dns = _settings->getString(SETTINGS::WIFI_DNS);
 
         ESP_LOGI(TAG,
                  "Initializing WiFi with SSID: %s, password: %s",
@@ -164,11 +390,6 @@ namespace HAL
             return false;
         }
 
-        // Enable promiscuous mode for RSSI updates
-        esp_wifi_set_promiscuous_rx_cb(&WiFi::_wifi_promiscuous_rx_cb);
-        esp_wifi_set_promiscuous(true);
-        ESP_LOGD(TAG, "Promiscuous mode enabled for RSSI updates");
-
         // Create default event loop if not already created
         err = esp_event_loop_create_default();
         if (err != ESP_OK)
@@ -229,13 +450,12 @@ namespace HAL
             ESP_LOGE(TAG, "Failed to register IP event handler: %s", esp_err_to_name(err));
             return false;
         }
-
-        // Configure WiFi station
-        wifi_config_t wifi_config = {};
-        memset(&wifi_config, 0, sizeof(wifi_config_t));
-
-        strncpy((char*)wifi_config.sta.ssid, _wifi_settings.ssid.c_str(), sizeof(wifi_config.sta.ssid) - 1);
-        strncpy((char*)wifi_config.sta.password, _wifi_settings.password.c_str(), sizeof(wifi_config.sta.password) - 1);
+        err = esp_event_handler_register(WIFI_LINK_EVENT, ESP_EVENT_ANY_ID, &_wifi_event_handler, NULL);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to register link event handler: %s", esp_err_to_name(err));
+            return false;
+        }
 
         err = esp_wifi_set_mode(WIFI_MODE_STA);
         if (err != ESP_OK)
@@ -243,13 +463,36 @@ namespace HAL
             ESP_LOGE(TAG, "Failed to set WiFi mode: %s", esp_err_to_name(err));
             return false;
         }
-        err = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
-        if (err != ESP_OK)
+
+        // Configure WiFi station, directed to the last AP when it's known
+        bool directed = _load_ap_cache();
+        if (directed)
+        {
+            ESP_LOGI(TAG, "Directed connect to " MACSTR " on channel %d", MAC2STR(_ap_cache.bssid), _ap_cache.channel);
+        }
+        if (!_set_sta_config(directed))
         {
-            ESP_LOGE(TAG, "Failed to set WiFi config: %s", esp_err_to_name(err));
             return false;
         }
 
+        // Link monitor, started once connected
+        if (_link_timer == nullptr)
+        {
+            esp_timer_create_args_t timer_args = {
+                .callback = _link_timer_cb,
+                .arg = this,
+                .dispatch_method = ESP_TIMER_TASK,
+                .name = "wifi_link",
+                .skip_unhandled_events = true,
+            };
+            err = esp_timer_create(&timer_args, &_link_timer);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to create link timer: %s", esp_err_to_name(err));
+                return false;
+            }
+        }
+
         _initialized = true;
         _status = WIFI_STATUS_DISCONNECTED;
 
@@ -258,15 +501,23 @@ namespace HAL
 
     void WiFi::deinit()
     {
+        _wait_init();
         if (!_initialized)
             return;
 
         disconnect();
-        // Disable promiscuous mode if enabled
-        esp_wifi_set_promiscuous(false);
-        esp_wifi_set_promiscuous_rx_cb(nullptr);
+        if (_link_timer)
+        {
+            esp_timer_delete(_link_timer);
+            _link_timer = nullptr;
+        }
 
-        esp_err_t err = esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, &_wifi_event_handler);
+        esp_err_t err = esp_event_handler_unregister(WIFI_LINK_EVENT, ESP_EVENT_ANY_ID, &_wifi_event_handler);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to unregister link event handler: %s", esp_err_to_name(err));
+        }
+        err = esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, &_wifi_event_handler);
         if (err != ESP_OK)
         {
             ESP_LOGE(TAG, "Failed to unregister IP event handler: %s", esp_err_to_name(err));
@@ -304,6 +555,7 @@ namespace HAL
 
     bool WiFi::connect()
     {
+        _wait_init();
         if (!_initialized)
         {
             ESP_LOGE(TAG, "WiFi not initialized");
@@ -316,6 +568,8 @@ namespace HAL
             return true;
         }
 
+        _link_established = false;
+        _connect_start_us = esp_timer_get_time();
         esp_err_t err = esp_wifi_start();
         if (err != ESP_OK)
         {
@@ -335,11 +589,13 @@ namespace HAL
 
     void WiFi::disconnect()
     {
+        _wait_init();
         if (!_initialized)
             return;
 
         ESP_LOGD(TAG, "Disconnecting WiFi");
 
+        _stop_link_monitor();
         esp_wifi_disconnect();
         esp_wifi_stop();
 
@@ -394,22 +650,18 @@ namespace HAL
         // update only signal level, not connection status
         if (_initialized && is_connected())
         {
-            // Update status based on RSSI
-            if (_rssi == 0)
-            {
-                _status = WIFI_STATUS_CONNECTED_WEAK;
-            }
-            else if (_rssi < -80)
-            {
-                _status = WIFI_STATUS_CONNECTED_WEAK;
-            }
-            else if (_rssi < -67)
-            {
-                _status = WIFI_STATUS_CONNECTED_GOOD;
-            }
-            else
+            // Update status from the smoothed level
+            switch (_link.level())
             {
+            case LinkQuality::LEVEL_STRONG:
                 _status = WIFI_STATUS_CONNECTED_STRONG;
+                break;
+            case LinkQuality::LEVEL_GOOD:
+                _status = WIFI_STATUS_CONNECTED_GOOD;
+                break;
+            default:
+                _status = WIFI_STATUS_CONNECTED_WEAK;
+                break;
             }
         }
         // Notify if status changed
@@ -428,6 +680,9 @@ namespace HAL
         uint16_t num_aps = 0;
         wifi_ap_record_t* ap_records = nullptr;
 
+        // A background init would race the temporary one below
+        _wait_init();
+
         // If WiFi is not initialized, perform temporary initialization
         if (!_initialized)
         {
@@ -5,8 +5,12 @@
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 #include "mooncake.h"
 #include "settings/settings.h"
+#include "link_quality.h"
 
 namespace HAL
 {
@@ -38,6 +42,17 @@ namespace HAL
         std::string dns;
     };
 
+    /**
+     * @brief Last AP the station joined, kept in NVS for a directed connect on the next start
+     */
+    struct wifi_ap_cache_t
+    {
+        uint32_t ssid_hash = 0;
+        uint8_t bssid[6] = {};
+        uint8_t channel = 0;
+        uint8_t authmode = 0;
+    };
+
     /**
      * @brief WiFi module class
      */
@@ -54,6 +69,12 @@ namespace HAL
          */
         bool init();
 
+        /**
+         * @brief Announce an init() about to run on another task
+         * deinit(), connect(), disconnect() and scan() wait for it to finish
+         */
+        void deferInit();
+
         /**
          * @brief Deinitialize WiFi module
          */
@@ -77,11 +98,16 @@ namespace HAL
         wifi_status_t get_status() const;
 
         /**
-         * @brief Get current RSSI (signal strength)
+         * @brief Get current RSSI (signal strength), smoothed
          * @return RSSI value in dBm, or 0 if not connected
          */
         int8_t get_rssi() const;
 
+        /**
+         * @brief Get link statistics: RSSI, traffic, disconnects and reconnect attempts
+         */
+        link_stats_t get_link_stats() const { return _link.stats(); }
+
         /**
          * @brief Check if WiFi is connected
          * @return true if connected
@@ -90,7 +116,7 @@ namespace HAL
 
         /**
          * @brief Set connection status callback
-         * @param callback Function to call when connection status changes
+         * @param callback Function to call when connection status or signal level changes
          */
         void set_status_callback(std::function<void(wifi_status_t)> callback);
 
@@ -119,12 +145,29 @@ namespace HAL
         uint32_t _last_status_check;
         esp_netif_t* _sta_netif;
         std::function<void(wifi_status_t)> _status_callback;
+        LinkQuality _link;
+        esp_timer_handle_t _link_timer;
+        wifi_ap_cache_t _ap_cache;
+        bool _directed;         // Station config locked to the cached AP
+        bool _link_established; // Associated since the last connect attempt
+        int64_t _connect_start_us;
+        EventGroupHandle_t _init_events; // Done bit, cleared while a deferred init is pending
+        TaskHandle_t _init_task;         // Task inside init(), its own calls don't wait
         // uint8_t _ap_bssid[6]; // Connected AP's MAC address
         // uint8_t _sta_mac[6];  // Our station MAC address
 
         static void _wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
-        static void _wifi_promiscuous_rx_cb(void* buf, wifi_promiscuous_pkt_type_t type);
+        static void _link_timer_cb(void* arg);
+        bool _init();
+        void _wait_init();
+        void _sample_link();
+        void _start_link_monitor();
+        void _stop_link_monitor();
         void _update_status_from_rssi();
+        bool _set_sta_config(bool directed);
+        bool _load_ap_cache();
+        void _save_ap_cache(const wifi_event_sta_connected_t* event);
+        void _clear_ap_cache();
     };
 
 } // namespace HAL
\ No newline at end of file
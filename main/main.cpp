@@ -41,11 +41,13 @@
 #include "apps/apps.h"
 #include "esp_log.h"
 #include "esp_partition.h"
-#include "apps/utils/flash/flash_tools.h"
+#include "apps/utils/flash/ota_registry.h"
 
 
 
 static const char* TAG = "MAIN";
+// Cap of the app loop, same as the launcher menu period
+#define TARGET_FPS 100
 
 using namespace HAL;
 using namespace SETTINGS;
@@ -66,31 +68,12 @@ void _data_base_setup_callback(SIMPLEKV::SimpleKV& db)
 // Create apps for all bootable OTA partitions
 void install_ota_apps(Mooncake& mc)
 {
-    esp_partition_iterator_t it = esp_partition_find(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, NULL);
-
-    while (it != NULL)
-    {
-        const esp_partition_t* partition = esp_partition_get(it);
-
-        // Check if this is an OTA partition
-        if (partition->subtype >= ESP_PARTITION_SUBTYPE_APP_OTA_MIN && partition->subtype < ESP_PARTITION_SUBTYPE_APP_OTA_MAX)
-        {
-            // Check if partition is bootable
-            if (UTILS::FLASH_TOOLS::is_partition_bootable(partition))
-            {
-                ESP_LOGI(TAG, "Found bootable OTA partition: %s at 0x%lx", partition->label, partition->address);
-                // Create and install app packer
-                auto packer = new APPS::OtaApp_Packer(partition);
-                mc.installApp(packer);
-            }
-        }
-
-        it = esp_partition_next(it);
-    }
-
-    if (it)
+    // Headers are only read when partitions changed since the last boot
+    for (const auto partition : UTILS::OTA_REGISTRY::get_bootable_apps())
     {
-        esp_partition_iterator_release(it);
+        ESP_LOGI(TAG, "Found bootable OTA partition: %s at 0x%lx", partition->label, partition->address);
+        // Create and install app packer
+        mc.installApp(new APPS::OtaApp_Packer(partition));
     }
 }
 
@@ -99,12 +82,24 @@ extern "C" void app_main(void)
     // Settings init
     settings.init();
 
+    // Record boot and frames from here on
+    if (settings.getBool(SYSTEM_PERF_TRACE))
+    {
+        Trace::start();
+    }
+
+    // Decode the boot logo while hal starts
+    APPS::Launcher::prefetchBootLogo();
+
     // Init hal
     hal.init();
 
     // Init framework
     mooncake.setDatabaseSetupCallback(_data_base_setup_callback);
     mooncake.init();
+    mooncake.setTargetFps(TARGET_FPS);
+    // Key events wake the app loop up
+    hal.keyboard()->setEventCallback([](void*) { mooncake.wakeUp(MC_EVENT_INPUT); });
 
     // Install launcher
     auto launcher = new APPS::Launcher_Packer;
@@ -122,7 +117,7 @@ extern "C" void app_main(void)
     mooncake.createApp(launcher);
 
     
-    // Update framework
+    // Update framework, sleeps between frames till apps have work to do
     while (1)
         mooncake.update();
 }
@@ -4,7 +4,12 @@
  */
 
 #include "settings.h"
-#include <format>
+#include "esp_system.h"
+#include "esp_crc.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -15,8 +20,102 @@
 
 static const char* TAG = "SETTINGS";
 
+#define SETTINGS_FLUSH_TASK_STACK 4096
+#define SETTINGS_FLUSH_TASK_PRIORITY 2
+
+#define SETTINGS_SNAPSHOT_MAGIC "M5ST"
+#define SETTINGS_SNAPSHOT_VERSION 1
+// Sanity limit for reading snapshot files
+#define SETTINGS_SNAPSHOT_MAX_SIZE 16384
+// Copy of the snapshot being applied, kept till all namespaces are committed
+#define SETTINGS_JOURNAL_NAMESPACE "settings_tx"
+#define SETTINGS_JOURNAL_KEY "pending"
+
 namespace SETTINGS
 {
+    struct SettingKey_t
+    {
+        const char* ns;
+        const char* key;
+    };
+
+    // NVS namespace and key of every SettingId, in enum order
+    static const SettingKey_t s_setting_keys[] = {
+        {"wifi", "enabled"},
+        {"wifi", "ssid"},
+        {"wifi", "pass"},
+        {"wifi", "static_ip"},
+        {"wifi", "ip"},
+        {"wifi", "mask"},
+        {"wifi", "gw"},
+        {"wifi", "dns"},
+        {"system", "brightness"},
+        {"system", "volume"},
+        {"system", "use_led"},
+        {"system", "dim_time"},
+        {"system", "boot_sound"},
+        {"system", "show_bat_volt"},
+        {"system", "show_time"},
+        {"system", "shot_level"},
+        {"system", "last_app"},
+        {"system", "last_app_to"},
+        {"system", "perf_trace"},
+        {"installer", "run_on_install"},
+        {"installer", "custom_install"},
+        {"installer", "auto_delete"},
+        {"installer", "dl_path"},
+    };
+    static_assert(sizeof(s_setting_keys) / sizeof(s_setting_keys[0]) == SETTING_COUNT, "Setting key table out of sync");
+    // Imports track the settings they carry in a 32-bit mask
+    static_assert(SETTING_COUNT <= 32, "Too many settings for the import mask");
+
+    // Snapshot file header, entries follow as
+    // type u8, ns length u8, key length u8, value length u16, ns, key, value (numbers are int32 little endian)
+    struct SnapshotHeader_t
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t count;
+        // Size and CRC32 of the entries
+        uint32_t size;
+        uint32_t crc;
+    };
+    static_assert(sizeof(SnapshotHeader_t) == 16, "Snapshot header must not be padded");
+
+    // For the shutdown handler, there is only one settings instance
+    static Settings* s_instance = nullptr;
+
+    // Whole string as a 32-bit decimal, no exceptions on bad input
+    static bool _parse_number(const std::string& str, int32_t& value)
+    {
+        if (str.empty())
+        {
+            return false;
+        }
+        char* end = nullptr;
+        errno = 0;
+        long long num = strtoll(str.c_str(), &end, 10);
+        if (errno != 0 || *end != '\0' || num < INT32_MIN || num > INT32_MAX)
+        {
+            return false;
+        }
+        value = (int32_t)num;
+        return true;
+    }
+
+    static bool _number_in_range(const SettingItem_t* item, int32_t num)
+    {
+        int32_t limit;
+        if (!item->min_val.empty() && _parse_number(item->min_val, limit) && num < limit)
+        {
+            return false;
+        }
+        if (!item->max_val.empty() && _parse_number(item->max_val, limit) && num > limit)
+        {
+            return false;
+        }
+        return true;
+    }
 
     const char* Settings::NVS_PARTITION = "apps_nvs";
 
@@ -58,6 +157,14 @@ namespace SETTINGS
             {"boot_sound", "Boot sound", TYPE_BOOL, "true", "true", "", "", "Play boot sound on startup"},
             {"show_bat_volt", "Battery voltage", TYPE_BOOL, "true", "true", "", "", "Show battery voltage on the system bar"},
             {"show_time", "Show time", TYPE_BOOL, "true", "true", "", "", "Show time on the system bar"},
+            {"shot_level",
+             "Screenshot PNG",
+             TYPE_NUMBER,
+             "3",
+             "3",
+             "0",
+             "10",
+             "Screenshot PNG compression level (1-10), higher is smaller but slower. 0 saves uncompressed BMP"},
             {"last_app", "Run last app", TYPE_BOOL, "true", "true", "", "", "Run the last used app on startup"},
             {"last_app_to",
              "Run timeout",
@@ -68,6 +175,15 @@ namespace SETTINGS
              "60",
              "Time before running last app in seconds (0-60). Holding any key on boot will cancel running last app and open "
              "Apps menu"},
+            {"perf_trace",
+             "Perf trace",
+             TYPE_BOOL,
+             "false",
+             "false",
+             "",
+             "",
+             "Record frame timing, and boot timing from the next restart. Shows FPS and worst frame time on the system bar, "
+             "[Ctrl] + [T] saves the trace to SD card"},
 
         };
         SettingGroup_t installer_group;
@@ -117,14 +233,28 @@ namespace SETTINGS
         import_group.items = {};
 
         _metadata = {wifi_group, sys_group, installer_group, export_group, import_group};
+        _initCache();
     }
 
     Settings::~Settings()
     {
         if (_initialized)
         {
+            esp_unregister_shutdown_handler(_shutdownHandler);
+            if (_flush_task)
+            {
+                vTaskDelete(_flush_task);
+                _flush_task = nullptr;
+            }
+            flush();
             _deinitNvs();
         }
+        if (_mutex)
+        {
+            vSemaphoreDelete(_mutex);
+            _mutex = nullptr;
+        }
+        s_instance = nullptr;
     }
 
     bool Settings::init()
@@ -133,15 +263,34 @@ namespace SETTINGS
         {
             return true;
         }
-        ESP_LOGW(TAG, "Settings init");
 
+        ESP_LOGW(TAG, "Settings init");
         if (!_initNvs())
         {
             return false;
         }
 
+        _mutex = xSemaphoreCreateMutex();
+        if (_mutex == nullptr)
+        {
+            ESP_LOGE(TAG, "Failed to create mutex");
+            _deinitNvs();
+            return false;
+        }
+
         _loadSettings();
+        _resumeImport();
         _initialized = true;
+
+        // Without the task settings are still saved by flush() and on restart
+        if (xTaskCreate(_flushTask, "settings", SETTINGS_FLUSH_TASK_STACK, this, SETTINGS_FLUSH_TASK_PRIORITY, &_flush_task) !=
+            pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create flush task");
+            _flush_task = nullptr;
+        }
+        s_instance = this;
+        esp_register_shutdown_handler(_shutdownHandler);
         return true;
     }
 
@@ -161,6 +310,7 @@ namespace SETTINGS
             }
             err = nvs_flash_init_partition(NVS_PARTITION);
         }
+
         if (err != ESP_OK)
         {
             ESP_LOGE(TAG, "Failed to initialize NVS: %s", esp_err_to_name(err));
@@ -177,9 +327,16 @@ namespace SETTINGS
         }
     }
 
-    std::string Settings::_makeKey(const std::string& ns, const std::string& key) const
+    SettingId Settings::findId(const std::string& ns, const std::string& key)
     {
-        return std::format("{}-{}", ns, key);
+        for (int i = 0; i < SETTING_COUNT; i++)
+        {
+            if (key == s_setting_keys[i].key && ns == s_setting_keys[i].ns)
+            {
+                return (SettingId)i;
+            }
+        }
+        return SETTING_INVALID;
     }
 
     const SettingItem_t* Settings::_findItem(const std::string& ns, const std::string& key) const
@@ -200,12 +357,50 @@ namespace SETTINGS
         return nullptr;
     }
 
+    void Settings::_initCache()
+    {
+        // Defaults are parsed once here, lookups never touch the metadata strings again
+        for (const auto& group : _metadata)
+        {
+            for (const auto& item : group.items)
+            {
+                if (item.type == TYPE_NONE)
+                    continue;
+
+                SettingId id = findId(group.nvs_namespace, item.key);
+                if (id == SETTING_INVALID)
+                {
+                    ESP_LOGE(TAG, "Setting %s-%s has no ID", group.nvs_namespace.c_str(), item.key.c_str());
+                    continue;
+                }
+
+                CachedValue& cached_value = _cache[id];
+                cached_value.type = item.type;
+                switch (item.type)
+                {
+                case TYPE_BOOL:
+                    cached_value.bool_val = item.default_val == "true";
+                    break;
+                case TYPE_NUMBER:
+                    cached_value.num_val = std::stoi(item.default_val);
+                    break;
+                case TYPE_STRING:
+                    cached_value.str_val = item.default_val;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+
     void Settings::_loadSettings()
     {
         for (const auto& group : _metadata)
         {
             if (group.nvs_namespace.empty())
                 continue;
+
             nvs_handle_t nvs_handle;
             esp_err_t err = nvs_open_from_partition(NVS_PARTITION, group.nvs_namespace.c_str(), NVS_READONLY, &nvs_handle);
             if (err != ESP_OK)
@@ -216,35 +411,32 @@ namespace SETTINGS
 
             for (const auto& item : group.items)
             {
-                if (item.type == TYPE_NONE)
+                SettingId id = findId(group.nvs_namespace, item.key);
+                if (item.type == TYPE_NONE || id == SETTING_INVALID)
                     continue;
 
-                std::string cache_key = _makeKey(group.nvs_namespace, item.key);
-                CachedValue cached_value;
-                cached_value.type = item.type;
-
+                // Values missing from NVS keep the defaults set by _initCache()
+                CachedValue& cached_value = _cache[id];
                 switch (item.type)
                 {
                 case TYPE_BOOL:
                 {
                     uint8_t value;
-                    if (nvs_get_u8(nvs_handle, item.key.c_str(), &value) != ESP_OK)
+                    if (nvs_get_u8(nvs_handle, item.key.c_str(), &value) == ESP_OK)
                     {
-                        value = item.default_val == "true" ? 1 : 0;
+                        cached_value.bool_val = value == 1;
                     }
-                    cached_value.bool_val = value == 1;
-                    ESP_LOGI(TAG, "Loaded bool %s = %d", cache_key.c_str(), cached_value.bool_val);
+                    ESP_LOGI(TAG, "Loaded bool %s-%s = %d", group.nvs_namespace.c_str(), item.key.c_str(), cached_value.bool_val);
                     break;
                 }
                 case TYPE_NUMBER:
                 {
                     int32_t value;
-                    if (nvs_get_i32(nvs_handle, item.key.c_str(), &value) != ESP_OK)
+                    if (nvs_get_i32(nvs_handle, item.key.c_str(), &value) == ESP_OK)
                     {
-                        value = std::stoi(item.default_val);
+                        cached_value.num_val = value;
                     }
-                    cached_value.num_val = value;
-                    ESP_LOGI(TAG, "Loaded number %s = %ld", cache_key.c_str(), cached_value.num_val);
+                    ESP_LOGI(TAG, "Loaded number %s-%s = %ld", group.nvs_namespace.c_str(), item.key.c_str(), cached_value.num_val);
                     break;
                 }
                 case TYPE_STRING:
@@ -253,199 +445,575 @@ namespace SETTINGS
                     if (nvs_get_str(nvs_handle, item.key.c_str(), nullptr, &required_size) == ESP_OK)
                     {
                         std::vector<char> value(required_size);
-                        if (nvs_get_str(nvs_handle, item.key.c_str(), value.data(), &required_size) == ESP_OK)
+                        if (nvs_get_str(nvs_handle, item.key.c_str(), value.data(), &required_size) == ESP_OK &&
+                            value[0] != '\0')
                         {
                             cached_value.str_val = std::string(value.data());
                         }
                     }
-                    if (cached_value.str_val.empty())
-                    {
-                        cached_value.str_val = item.default_val;
-                    }
-                    ESP_LOGI(TAG, "Loaded string %s = %s", cache_key.c_str(), cached_value.str_val.c_str());
+                    ESP_LOGI(TAG,
+                             "Loaded string %s-%s = %s",
+                             group.nvs_namespace.c_str(),
+                             item.key.c_str(),
+                             cached_value.str_val.c_str());
                     break;
                 }
                 default:
                     break;
                 }
-
-                _cache[cache_key] = cached_value;
             }
+
             nvs_close(nvs_handle);
         }
     }
 
-    bool Settings::getBool(const std::string& ns, const std::string& key)
+    void Settings::_lock() const
+    {
+        if (_mutex)
+            xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    void Settings::_unlock() const
+    {
+        if (_mutex)
+            xSemaphoreGive(_mutex);
+    }
+
+    void Settings::_markDirty(CachedValue& value)
     {
-        std::string cache_key = _makeKey(ns, key);
-        auto it = _cache.find(cache_key);
-        if (it != _cache.end() && it->second.type == TYPE_BOOL)
+        value.dirty = true;
+        // Every change restarts the flush delay in the task
+        if (_flush_task)
+            xTaskNotifyGive(_flush_task);
+    }
+
+    bool Settings::getBool(SettingId id) const
+    {
+        if (id >= SETTING_COUNT || _cache[id].type != TYPE_BOOL)
         {
-            return it->second.bool_val;
+            return false;
         }
-
-        const SettingItem_t* item = _findItem(ns, key);
-        return item ? (item->default_val == "true") : false;
+        return _cache[id].bool_val;
     }
 
-    int32_t Settings::getNumber(const std::string& ns, const std::string& key)
+    int32_t Settings::getNumber(SettingId id) const
     {
-        std::string cache_key = _makeKey(ns, key);
-        auto it = _cache.find(cache_key);
-        if (it != _cache.end() && it->second.type == TYPE_NUMBER)
+        if (id >= SETTING_COUNT || _cache[id].type != TYPE_NUMBER)
         {
-            return it->second.num_val;
+            return 0;
         }
+        return _cache[id].num_val;
+    }
 
-        const SettingItem_t* item = _findItem(ns, key);
-        return item ? std::stoi(item->default_val) : 0;
+    std::string Settings::getString(SettingId id) const
+    {
+        if (id >= SETTING_COUNT || _cache[id].type != TYPE_STRING)
+        {
+            return "";
+        }
+        // Strings can be set from the WiFi event task
+        _lock();
+        std::string value = _cache[id].str_val;
+        _unlock();
+        return value;
     }
 
-    std::string Settings::getString(const std::string& ns, const std::string& key)
+    bool Settings::setBool(SettingId id, bool value)
     {
-        std::string cache_key = _makeKey(ns, key);
-        auto it = _cache.find(cache_key);
-        if (it != _cache.end() && it->second.type == TYPE_STRING)
+        if (id >= SETTING_COUNT || _cache[id].type != TYPE_BOOL)
         {
-            return it->second.str_val;
+            return false;
         }
 
-        const SettingItem_t* item = _findItem(ns, key);
-        return item ? item->default_val : "";
+        _lock();
+        if (_cache[id].bool_val != value)
+        {
+            _cache[id].bool_val = value;
+            _markDirty(_cache[id]);
+        }
+        _unlock();
+        return true;
     }
 
-    bool Settings::setBool(const std::string& ns, const std::string& key, bool value)
+    bool Settings::setNumber(SettingId id, int32_t value)
     {
-        const SettingItem_t* item = _findItem(ns, key);
-        if (!item || item->type != TYPE_BOOL)
+        if (id >= SETTING_COUNT || _cache[id].type != TYPE_NUMBER)
         {
             return false;
         }
 
-        std::string cache_key = _makeKey(ns, key);
-        CachedValue cached_value;
-        cached_value.type = TYPE_BOOL;
-        cached_value.bool_val = value;
-        _cache[cache_key] = cached_value;
+        _lock();
+        if (_cache[id].num_val != value)
+        {
+            _cache[id].num_val = value;
+            _markDirty(_cache[id]);
+        }
+        _unlock();
+        return true;
+    }
 
-        nvs_handle_t nvs_handle;
-        esp_err_t err = nvs_open_from_partition(NVS_PARTITION, ns.c_str(), NVS_READWRITE, &nvs_handle);
-        if (err != ESP_OK)
+    bool Settings::setString(SettingId id, const std::string& value)
+    {
+        if (id >= SETTING_COUNT || _cache[id].type != TYPE_STRING)
         {
             return false;
         }
 
-        err = nvs_set_u8(nvs_handle, key.c_str(), value ? 1 : 0);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
+        _lock();
+        if (_cache[id].str_val != value)
+        {
+            _cache[id].str_val = value;
+            _markDirty(_cache[id]);
+        }
+        _unlock();
+        return true;
+    }
 
-        return err == ESP_OK;
+    bool Settings::getBool(const std::string& ns, const std::string& key) { return getBool(findId(ns, key)); }
+
+    int32_t Settings::getNumber(const std::string& ns, const std::string& key) { return getNumber(findId(ns, key)); }
+
+    std::string Settings::getString(const std::string& ns, const std::string& key) { return getString(findId(ns, key)); }
+
+    bool Settings::setBool(const std::string& ns, const std::string& key, bool value)
+    {
+        return setBool(findId(ns, key), value);
     }
 
     bool Settings::setNumber(const std::string& ns, const std::string& key, int32_t value)
     {
-        const SettingItem_t* item = _findItem(ns, key);
-        if (!item || item->type != TYPE_NUMBER)
+        return setNumber(findId(ns, key), value);
+    }
+
+    bool Settings::setString(const std::string& ns, const std::string& key, const std::string& value)
+    {
+        return setString(findId(ns, key), value);
+    }
+
+    bool Settings::flush() { return _flush(false); }
+
+    bool Settings::saveAll() { return _flush(true); }
+
+    bool Settings::_flush(bool all)
+    {
+        if (!_initialized)
         {
             return false;
         }
 
-        std::string cache_key = _makeKey(ns, key);
-        CachedValue cached_value;
-        cached_value.type = TYPE_NUMBER;
-        cached_value.num_val = value;
-        _cache[cache_key] = cached_value;
+        _lock();
+        bool success = _writeValues(_cache, all);
+        _unlock();
 
-        nvs_handle_t nvs_handle;
-        esp_err_t err = nvs_open_from_partition(NVS_PARTITION, ns.c_str(), NVS_READWRITE, &nvs_handle);
-        if (err != ESP_OK)
+        return success;
+    }
+
+    esp_err_t Settings::_writeValue(nvs_handle_t nvs_handle, const char* key, const CachedValue& value)
+    {
+        switch (value.type)
         {
-            return false;
+        case TYPE_BOOL:
+            return nvs_set_u8(nvs_handle, key, value.bool_val ? 1 : 0);
+        case TYPE_NUMBER:
+            return nvs_set_i32(nvs_handle, key, value.num_val);
+        case TYPE_STRING:
+            return nvs_set_str(nvs_handle, key, value.str_val.c_str());
+        default:
+            return ESP_OK;
         }
+    }
 
-        err = nvs_set_i32(nvs_handle, key.c_str(), value);
-        nvs_commit(nvs_handle);
-        nvs_close(nvs_handle);
+    bool Settings::_writeValues(CachedValue* values, bool all)
+    {
+        bool success = true;
+        nvs_handle_t nvs_handle = 0;
+        const char* open_ns = nullptr;
+        bool open_ok = false;
 
-        return err == ESP_OK;
+        // IDs are grouped by namespace, so each namespace is opened and committed once
+        for (int i = 0; i < SETTING_COUNT; i++)
+        {
+            CachedValue& cached_value = values[i];
+            if (cached_value.type == TYPE_NONE || (!all && !cached_value.dirty))
+                continue;
+
+            const char* ns = s_setting_keys[i].ns;
+            if (open_ns == nullptr || strcmp(open_ns, ns) != 0)
+            {
+                if (open_ok && nvs_commit(nvs_handle) != ESP_OK)
+                {
+                    ESP_LOGE(TAG, "Failed to commit NVS namespace %s", open_ns);
+                    success = false;
+                }
+                if (open_ok)
+                    nvs_close(nvs_handle);
+
+                open_ns = ns;
+                open_ok = nvs_open_from_partition(NVS_PARTITION, ns, NVS_READWRITE, &nvs_handle) == ESP_OK;
+                if (!open_ok)
+                {
+                    ESP_LOGE(TAG, "Error opening NVS namespace %s", ns);
+                    success = false;
+                }
+            }
+            if (!open_ok)
+                continue;
+
+            const char* key = s_setting_keys[i].key;
+            esp_err_t err = _writeValue(nvs_handle, key, cached_value);
+            if (err == ESP_OK)
+            {
+                cached_value.dirty = false;
+                ESP_LOGI(TAG, "Saved %s-%s", ns, key);
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Failed to save %s-%s: %s", ns, key, esp_err_to_name(err));
+                success = false;
+            }
+        }
+
+        if (open_ok)
+        {
+            if (nvs_commit(nvs_handle) != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to commit NVS namespace %s", open_ns);
+                success = false;
+            }
+            nvs_close(nvs_handle);
+        }
+
+        return success;
     }
 
-    bool Settings::setString(const std::string& ns, const std::string& key, const std::string& value)
+    void Settings::_flushTask(void* arg)
     {
-        const SettingItem_t* item = _findItem(ns, key);
-        if (!item || item->type != TYPE_STRING)
+        Settings* settings = (Settings*)arg;
+        while (true)
         {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            // Wait until changes stop coming for a while, then write them all at once
+            while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SETTINGS_FLUSH_DELAY_MS)) > 0)
+            {
+            }
+            settings->flush();
+        }
+    }
+
+    void Settings::_shutdownHandler()
+    {
+        if (s_instance)
+        {
+            s_instance->flush();
+        }
+    }
+
+    void Settings::_encodeSnapshot(const CachedValue* values, uint32_t mask, std::vector<uint8_t>& out)
+    {
+        out.assign(sizeof(SnapshotHeader_t), 0);
+        SnapshotHeader_t header = {};
+        memcpy(header.magic, SETTINGS_SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SETTINGS_SNAPSHOT_VERSION;
+
+        // Entries are keyed by name, so IDs can change between firmware versions
+        for (int i = 0; i < SETTING_COUNT; i++)
+        {
+            const CachedValue& value = values[i];
+            if (value.type == TYPE_NONE || !(mask & (1UL << i)))
+                continue;
+
+            const char* ns = s_setting_keys[i].ns;
+            const char* key = s_setting_keys[i].key;
+            uint16_t value_len = value.type == TYPE_BOOL ? 1 : value.type == TYPE_NUMBER ? 4 : value.str_val.size();
+            out.push_back(value.type);
+            out.push_back(strlen(ns));
+            out.push_back(strlen(key));
+            out.push_back(value_len & 0xFF);
+            out.push_back(value_len >> 8);
+            out.insert(out.end(), ns, ns + strlen(ns));
+            out.insert(out.end(), key, key + strlen(key));
+            switch (value.type)
+            {
+            case TYPE_BOOL:
+                out.push_back(value.bool_val ? 1 : 0);
+                break;
+            case TYPE_NUMBER:
+                for (int shift = 0; shift < 32; shift += 8)
+                    out.push_back((uint32_t)value.num_val >> shift);
+                break;
+            default:
+                out.insert(out.end(), value.str_val.begin(), value.str_val.end());
+                break;
+            }
+            header.count++;
+        }
+
+        header.size = out.size() - sizeof(SnapshotHeader_t);
+        header.crc = esp_crc32_le(0, out.data() + sizeof(SnapshotHeader_t), header.size);
+        memcpy(out.data(), &header, sizeof(header));
+    }
+
+    bool Settings::_decodeSnapshot(const uint8_t* data, size_t size, CachedValue* staged, uint32_t* mask) const
+    {
+        SnapshotHeader_t header;
+        if (size < sizeof(header))
+        {
+            ESP_LOGE(TAG, "Snapshot too short");
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, SETTINGS_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != SETTINGS_SNAPSHOT_VERSION)
+        {
+            ESP_LOGE(TAG, "Not a settings snapshot, or unsupported version %d", header.version);
+            return false;
+        }
+        data += sizeof(header);
+        if (header.size != size - sizeof(header) || header.crc != esp_crc32_le(0, data, header.size))
+        {
+            ESP_LOGE(TAG, "Snapshot is truncated or corrupted");
             return false;
         }
 
-        std::string cache_key = _makeKey(ns, key);
-        CachedValue cached_value;
-        cached_value.type = TYPE_STRING;
-        cached_value.str_val = value;
-        _cache[cache_key] = cached_value;
+        *mask = 0;
+        const uint8_t* end = data + header.size;
+        for (int n = 0; n < header.count; n++)
+        {
+            if (end - data < 5)
+            {
+                ESP_LOGE(TAG, "Snapshot entry %d is truncated", n);
+                return false;
+            }
+            SettingType type = (SettingType)data[0];
+            size_t key_pos = 5 + data[1];
+            size_t value_pos = key_pos + data[2];
+            size_t value_len = data[3] | (data[4] << 8);
+            if ((size_t)(end - data) < value_pos + value_len)
+            {
+                ESP_LOGE(TAG, "Snapshot entry %d is truncated", n);
+                return false;
+            }
+            std::string ns((const char*)data + 5, data[1]);
+            std::string key((const char*)data + key_pos, data[2]);
+            const uint8_t* value = data + value_pos;
+            data += value_pos + value_len;
+
+            // Settings this firmware doesn't know are skipped, newer firmware may export more
+            SettingId id = findId(ns, key);
+            if (id == SETTING_INVALID)
+            {
+                ESP_LOGW(TAG, "Skipping unknown setting %s-%s", ns.c_str(), key.c_str());
+                continue;
+            }
+            if (type != _cache[id].type)
+            {
+                ESP_LOGE(TAG, "Setting %s-%s has wrong type %d", ns.c_str(), key.c_str(), type);
+                return false;
+            }
 
+            CachedValue& staged_value = staged[id];
+            staged_value.type = type;
+            switch (type)
+            {
+            case TYPE_BOOL:
+                if (value_len != 1 || value[0] > 1)
+                {
+                    ESP_LOGE(TAG, "Setting %s-%s has invalid bool", ns.c_str(), key.c_str());
+                    return false;
+                }
+                staged_value.bool_val = value[0] == 1;
+                break;
+            case TYPE_NUMBER:
+            {
+                if (value_len != 4)
+                {
+                    ESP_LOGE(TAG, "Setting %s-%s has invalid number", ns.c_str(), key.c_str());
+                    return false;
+                }
+                int32_t num = (int32_t)(value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t)value[3] << 24));
+                const SettingItem_t* item = _findItem(ns, key);
+                if (item && !_number_in_range(item, num))
+                {
+                    ESP_LOGE(TAG, "Setting %s-%s = %ld is out of range", ns.c_str(), key.c_str(), num);
+                    return false;
+                }
+                staged_value.num_val = num;
+                break;
+            }
+            default:
+                staged_value.str_val = std::string((const char*)value, value_len);
+                break;
+            }
+            *mask |= 1UL << id;
+        }
+        if (data != end)
+        {
+            ESP_LOGE(TAG, "Snapshot has %d trailing bytes", (int)(end - data));
+            return false;
+        }
+        return true;
+    }
+
+    bool Settings::_applyStaged(const CachedValue* staged, uint32_t mask)
+    {
+        std::vector<uint8_t> journal;
+        _encodeSnapshot(staged, mask, journal);
+
+        _lock();
+        // Journal first, an apply cut short by power loss is finished by the next init()
         nvs_handle_t nvs_handle;
-        esp_err_t err = nvs_open_from_partition(NVS_PARTITION, ns.c_str(), NVS_READWRITE, &nvs_handle);
+        esp_err_t err = nvs_open_from_partition(NVS_PARTITION, SETTINGS_JOURNAL_NAMESPACE, NVS_READWRITE, &nvs_handle);
+        const bool opened = err == ESP_OK;
+        if (opened)
+        {
+            err = nvs_set_blob(nvs_handle, SETTINGS_JOURNAL_KEY, journal.data(), journal.size());
+            if (err == ESP_OK)
+                err = nvs_commit(nvs_handle);
+        }
         if (err != ESP_OK)
         {
+            ESP_LOGE(TAG, "Failed to write import journal: %s", esp_err_to_name(err));
+            if (opened)
+                nvs_close(nvs_handle);
+            _unlock();
             return false;
         }
 
-        err = nvs_set_str(nvs_handle, key.c_str(), value.c_str());
+        // Values not in the snapshot keep what they have now
+        CachedValue* merged = new CachedValue[SETTING_COUNT];
+        for (int i = 0; i < SETTING_COUNT; i++)
+        {
+            merged[i] = (mask & (1UL << i)) ? staged[i] : _cache[i];
+        }
+
+        bool success = _writeValues(merged, true);
+        if (success)
+        {
+            for (int i = 0; i < SETTING_COUNT; i++)
+            {
+                _cache[i] = merged[i];
+            }
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Import failed, rolling back");
+            if (!_writeValues(_cache, true))
+            {
+                ESP_LOGE(TAG, "Rollback failed");
+            }
+        }
+        delete[] merged;
+
+        nvs_erase_key(nvs_handle, SETTINGS_JOURNAL_KEY);
         nvs_commit(nvs_handle);
         nvs_close(nvs_handle);
-
-        return err == ESP_OK;
+        _unlock();
+        return success;
     }
 
-    bool Settings::saveAll()
+    void Settings::_resumeImport()
     {
-        bool success = true;
-        for (const auto& group : _metadata)
+        nvs_handle_t nvs_handle;
+        if (nvs_open_from_partition(NVS_PARTITION, SETTINGS_JOURNAL_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK)
         {
-            nvs_handle_t nvs_handle;
-            esp_err_t err = nvs_open_from_partition(NVS_PARTITION, group.nvs_namespace.c_str(), NVS_READWRITE, &nvs_handle);
-            if (err != ESP_OK)
+            return;
+        }
+        size_t size = 0;
+        std::vector<uint8_t> journal;
+        if (nvs_get_blob(nvs_handle, SETTINGS_JOURNAL_KEY, nullptr, &size) == ESP_OK && size > 0)
+        {
+            journal.resize(size);
+            if (nvs_get_blob(nvs_handle, SETTINGS_JOURNAL_KEY, journal.data(), &size) != ESP_OK)
             {
-                success = false;
-                continue;
+                journal.clear();
             }
+        }
+        nvs_close(nvs_handle);
+        if (journal.empty())
+        {
+            return;
+        }
 
-            for (const auto& item : group.items)
-            {
-                if (item.type == TYPE_NONE)
-                    continue;
+        ESP_LOGW(TAG, "Finishing interrupted settings import");
+        CachedValue* staged = new CachedValue[SETTING_COUNT];
+        uint32_t mask = 0;
+        if (!_decodeSnapshot(journal.data(), journal.size(), staged, &mask) || !_applyStaged(staged, mask))
+        {
+            ESP_LOGE(TAG, "Failed to finish interrupted import");
+        }
+        delete[] staged;
+    }
 
-                std::string cache_key = _makeKey(group.nvs_namespace, item.key);
-                auto it = _cache.find(cache_key);
-                if (it == _cache.end())
-                    continue;
+    bool Settings::exportSnapshot(const std::string& filename) const
+    {
+        ESP_LOGI(TAG, "Exporting settings snapshot to %s", filename.c_str());
 
-                switch (item.type)
-                {
-                case TYPE_BOOL:
-                    err = nvs_set_u8(nvs_handle, item.key.c_str(), it->second.bool_val ? 1 : 0);
-                    break;
-                case TYPE_NUMBER:
-                    err = nvs_set_i32(nvs_handle, item.key.c_str(), it->second.num_val);
-                    break;
-                case TYPE_STRING:
-                    err = nvs_set_str(nvs_handle, item.key.c_str(), it->second.str_val.c_str());
-                    break;
-                default:
-                    break;
-                }
+        std::vector<uint8_t> snapshot;
+        _lock();
+        _encodeSnapshot(_cache, UINT32_MAX, snapshot);
+        _unlock();
+
+        FILE* file = fopen(filename.c_str(), "wb");
+        if (!file)
+        {
+            ESP_LOGE(TAG, "Failed to open file %s for writing", filename.c_str());
+            return false;
+        }
+        bool success = fwrite(snapshot.data(), 1, snapshot.size(), file) == snapshot.size();
+        if (fclose(file) != 0)
+        {
+            success = false;
+        }
+        if (!success)
+        {
+            ESP_LOGE(TAG, "Failed to write %s", filename.c_str());
+            remove(filename.c_str());
+            return false;
+        }
+        ESP_LOGI(TAG, "Exported %d bytes", (int)snapshot.size());
+        return true;
+    }
 
-                if (err != ESP_OK)
+    bool Settings::importSnapshot(const std::string& filename)
+    {
+        ESP_LOGI(TAG, "Importing settings snapshot from %s", filename.c_str());
+
+        FILE* file = fopen(filename.c_str(), "rb");
+        if (!file)
+        {
+            ESP_LOGE(TAG, "Failed to open file %s for reading", filename.c_str());
+            return false;
+        }
+        std::vector<uint8_t> snapshot;
+        if (fseek(file, 0, SEEK_END) == 0)
+        {
+            long size = ftell(file);
+            if (size > 0 && size <= SETTINGS_SNAPSHOT_MAX_SIZE && fseek(file, 0, SEEK_SET) == 0)
+            {
+                snapshot.resize(size);
+                if (fread(snapshot.data(), 1, size, file) != (size_t)size)
                 {
-                    success = false;
+                    snapshot.clear();
                 }
             }
-
-            nvs_commit(nvs_handle);
-            nvs_close(nvs_handle);
+        }
+        fclose(file);
+        if (snapshot.empty())
+        {
+            ESP_LOGE(TAG, "Failed to read %s", filename.c_str());
+            return false;
         }
 
+        // Nothing is touched unless the whole snapshot is valid
+        CachedValue* staged = new CachedValue[SETTING_COUNT];
+        uint32_t mask = 0;
+        bool success = _decodeSnapshot(snapshot.data(), snapshot.size(), staged, &mask) && _applyStaged(staged, mask);
+        delete[] staged;
+
+        if (success)
+        {
+            ESP_LOGI(TAG, "Settings successfully imported from %s", filename.c_str());
+        }
         return success;
     }
 
@@ -497,6 +1065,7 @@ namespace SETTINGS
             ESP_LOGI(TAG, "File %s does not exist, creating new", filename.c_str());
         }
         // replacing settings in map with current values
+        _lock();
         for (const auto& group : _metadata)
         {
             for (const auto& item : group.items)
@@ -504,28 +1073,29 @@ namespace SETTINGS
                 if (item.type == TYPE_NONE)
                     continue;
 
-                std::string cache_key = _makeKey(group.nvs_namespace, item.key);
-                auto it = _cache.find(cache_key);
-                if (it == _cache.end())
+                std::string cache_key = group.nvs_namespace + "-" + item.key;
+                SettingId id = findId(group.nvs_namespace, item.key);
+                if (id == SETTING_INVALID)
                 {
                     ESP_LOGW(TAG, "Setting %s not found in cache during export, skipping", cache_key.c_str());
                     continue;
                 }
+                const CachedValue& cached_value = _cache[id];
 
                 // outfile << cache_key << "=";
                 std::string str_val;
                 switch (item.type)
                 {
                 case TYPE_BOOL:
-                    str_val = (it->second.bool_val ? "true" : "false");
+                    str_val = (cached_value.bool_val ? "true" : "false");
                     break;
                 case TYPE_NUMBER:
-                    str_val = std::to_string(it->second.num_val);
+                    str_val = std::to_string(cached_value.num_val);
                     break;
                 case TYPE_STRING:
                 {
                     std::string escaped_str;
-                    for (char c : it->second.str_val)
+                    for (char c : cached_value.str_val)
                     {
                         if (c == '\n')
                         {
@@ -546,6 +1116,7 @@ namespace SETTINGS
                 existing_settings[cache_key] = str_val;
             }
         }
+        _unlock();
         // saving to file
         std::ofstream outfile(filename);
         if (!outfile.is_open())
@@ -573,8 +1144,11 @@ namespace SETTINGS
         }
 
         std::string line;
-        bool success = false;
         int line_num = 0;
+        // Values are staged and applied together once the whole file is read
+        CachedValue* staged = new CachedValue[SETTING_COUNT];
+        uint32_t mask = 0;
+        bool valid = true;
 
         while (std::getline(infile, line))
         {
@@ -608,7 +1182,8 @@ namespace SETTINGS
             std::string key = cache_key.substr(separator_pos + 1);
 
             const SettingItem_t* item = _findItem(ns, key);
-            if (!item)
+            SettingId id = findId(ns, key);
+            if (!item || id == SETTING_INVALID)
             {
                 ESP_LOGW(TAG,
                          "Setting %s (ns=%s, key=%s) not found in metadata, skipping line %d",
@@ -619,28 +1194,42 @@ namespace SETTINGS
                 continue;
             }
 
-            bool import_ok = false;
+            // One bad value rejects the file, nothing is applied
+            CachedValue& staged_value = staged[id];
+            staged_value.type = item->type;
             switch (item->type)
             {
             case TYPE_BOOL:
             {
-                bool val = (value_str == "true");
                 if (value_str != "true" && value_str != "false")
                 {
-                    ESP_LOGW(TAG,
-                             "Invalid boolean value '%s' for %s on line %d, using default",
+                    ESP_LOGE(TAG,
+                             "Invalid boolean value '%s' for %s on line %d",
                              value_str.c_str(),
                              cache_key.c_str(),
                              line_num);
-                    val = (item->default_val == "true");
+                    valid = false;
+                    break;
                 }
-                import_ok = setBool(ns, key, val);
+                staged_value.bool_val = (value_str == "true");
                 break;
             }
             case TYPE_NUMBER:
             {
-                int32_t val = std::stoi(value_str);
-                import_ok = setNumber(ns, key, val);
+                int32_t num = 0;
+                if (!_parse_number(value_str, num))
+                {
+                    ESP_LOGE(TAG, "Invalid number '%s' for %s on line %d", value_str.c_str(), cache_key.c_str(), line_num);
+                    valid = false;
+                    break;
+                }
+                if (!_number_in_range(item, num))
+                {
+                    ESP_LOGE(TAG, "Setting %s = %ld on line %d is out of range", cache_key.c_str(), num, line_num);
+                    valid = false;
+                    break;
+                }
+                staged_value.num_val = num;
                 break;
             }
             case TYPE_STRING:
@@ -658,27 +1247,40 @@ namespace SETTINGS
                         unescaped_str += value_str[i];
                     }
                 }
-                import_ok = setString(ns, key, unescaped_str);
+                staged_value.str_val = unescaped_str;
                 break;
             }
             case TYPE_NONE:
             default:
-                break;
-            }
-
-            if (import_ok)
-            {
-                ESP_LOGI(TAG, "Imported setting: %s = %s", cache_key.c_str(), value_str.c_str());
-                success = true;
+                ESP_LOGW(TAG, "Failed to import setting %s on line %d", cache_key.c_str(), line_num);
+                continue;
             }
-            else
+            if (!valid)
             {
-                ESP_LOGW(TAG, "Failed to import setting %s on line %d", cache_key.c_str(), line_num);
+                break;
             }
+
+            ESP_LOGI(TAG, "Imported setting: %s = %s", cache_key.c_str(), value_str.c_str());
+            mask |= 1UL << id;
         }
 
         infile.close();
 
+        if (!valid)
+        {
+            delete[] staged;
+            ESP_LOGE(TAG, "Settings file %s rejected, nothing imported", filename.c_str());
+            return false;
+        }
+
+        bool success = mask != 0;
+        if (success && !_applyStaged(staged, mask))
+        {
+            ESP_LOGE(TAG, "Failed to save imported settings");
+            success = false;
+        }
+        delete[] staged;
+
         if (success)
         {
             ESP_LOGI(TAG, "Settings successfully imported from %s", filename.c_str());
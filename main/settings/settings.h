@@ -7,9 +7,11 @@
 
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include "nvs_flash.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 
 #define SETTINGS_GROUP_WIFI 0
 #define SETTINGS_GROUP_SYSTEM 1
@@ -17,6 +19,9 @@
 #define SETTINGS_GROUP_EXPORT 3
 #define SETTINGS_GROUP_IMPORT 4
 
+// Delay after the last change before dirty settings are written to NVS
+#define SETTINGS_FLUSH_DELAY_MS 2000
+
 namespace SETTINGS
 {
 
@@ -28,6 +33,40 @@ namespace SETTINGS
         TYPE_STRING
     };
 
+    /**
+     * @brief Compile-time setting IDs, index into the settings cache
+     *
+     * Keep in sync with the key table in settings.cpp
+     */
+    enum SettingId
+    {
+        WIFI_ENABLED,
+        WIFI_SSID,
+        WIFI_PASS,
+        WIFI_STATIC_IP,
+        WIFI_IP,
+        WIFI_MASK,
+        WIFI_GW,
+        WIFI_DNS,
+        SYSTEM_BRIGHTNESS,
+        SYSTEM_VOLUME,
+        SYSTEM_USE_LED,
+        SYSTEM_DIM_TIME,
+        SYSTEM_BOOT_SOUND,
+        SYSTEM_SHOW_BAT_VOLT,
+        SYSTEM_SHOW_TIME,
+        SYSTEM_SHOT_LEVEL,
+        SYSTEM_LAST_APP,
+        SYSTEM_LAST_APP_TO,
+        SYSTEM_PERF_TRACE,
+        INSTALLER_RUN_ON_INSTALL,
+        INSTALLER_CUSTOM_INSTALL,
+        INSTALLER_AUTO_DELETE,
+        INSTALLER_DL_PATH,
+        SETTING_COUNT,
+        SETTING_INVALID = SETTING_COUNT
+    };
+
     struct SettingItem_t
     {
         std::string key;
@@ -65,6 +104,59 @@ namespace SETTINGS
          */
         std::vector<SettingGroup_t> getMetadata() const;
 
+        /**
+         * @brief Get boolean setting value, cheap enough for render loops
+         * @param id Setting ID
+         * @return Boolean value
+         */
+        bool getBool(SettingId id) const;
+
+        /**
+         * @brief Get number setting value, cheap enough for render loops
+         * @param id Setting ID
+         * @return Integer value
+         */
+        int32_t getNumber(SettingId id) const;
+
+        /**
+         * @brief Get string setting value
+         * @param id Setting ID
+         * @return String value
+         */
+        std::string getString(SettingId id) const;
+
+        /**
+         * @brief Set boolean setting value, written to NVS on the next flush
+         * @param id Setting ID
+         * @param value Boolean value
+         * @return true if the setting exists and has this type
+         */
+        bool setBool(SettingId id, bool value);
+
+        /**
+         * @brief Set number setting value, written to NVS on the next flush
+         * @param id Setting ID
+         * @param value Integer value
+         * @return true if the setting exists and has this type
+         */
+        bool setNumber(SettingId id, int32_t value);
+
+        /**
+         * @brief Set string setting value, written to NVS on the next flush
+         * @param id Setting ID
+         * @param value String value
+         * @return true if the setting exists and has this type
+         */
+        bool setString(SettingId id, const std::string& value);
+
+        /**
+         * @brief Find the ID of a setting by its namespace and key
+         * @param ns Namespace
+         * @param key Setting key
+         * @return Setting ID, SETTING_INVALID if not found
+         */
+        static SettingId findId(const std::string& ns, const std::string& key);
+
         /**
          * @brief Get boolean setting value
          * @param ns Namespace
@@ -117,7 +209,13 @@ namespace SETTINGS
         bool setString(const std::string& ns, const std::string& key, const std::string& value);
 
         /**
-         * @brief Save all modified settings to NVS
+         * @brief Write modified settings to NVS now, one commit per namespace
+         * @return true if successful
+         */
+        bool flush();
+
+        /**
+         * @brief Write all settings to NVS, modified or not
          * @return true if successful
          */
         bool saveAll();
@@ -130,36 +228,69 @@ namespace SETTINGS
         bool exportToFile(const std::string& filename) const;
 
         /**
-         * @brief Import settings from a file
+         * @brief Import settings from a file, applied like importSnapshot()
          * @param filename The name of the file to import from
          * @return true if successful
          */
         bool importFromFile(const std::string& filename);
 
-    private:
+        /**
+         * @brief Export all settings to a versioned binary snapshot with CRC, in one write
+         * @param filename The name of the file to export to
+         * @return true if successful
+         */
+        bool exportSnapshot(const std::string& filename) const;
+
+        /**
+         * @brief Import settings from a binary snapshot
+         * The whole file is validated first, nothing changes if any of it is bad.
+         * Values are written with one commit per namespace and rolled back on failure
+         * @param filename The name of the file to import from
+         * @return true if successful
+         */
+        bool importSnapshot(const std::string& filename);
+
+        // NVS partition holding settings, also used by other persistent caches
         static const char* NVS_PARTITION;
 
-        // Cache storage
+    private:
+
+        // Cache storage, indexed by SettingId
         struct CachedValue
         {
-            SettingType type;
+            SettingType type = TYPE_NONE;
+            bool dirty = false;
             union
             {
                 bool bool_val;
-                int32_t num_val;
+                int32_t num_val = 0;
             };
             std::string str_val;
         };
 
-        std::unordered_map<std::string, CachedValue> _cache;
+        CachedValue _cache[SETTING_COUNT];
         std::vector<SettingGroup_t> _metadata;
         bool _initialized = false;
+        SemaphoreHandle_t _mutex = nullptr;
+        TaskHandle_t _flush_task = nullptr;
 
         bool _initNvs();
         void _deinitNvs();
         void _loadSettings();
-        std::string _makeKey(const std::string& ns, const std::string& key) const;
+        void _initCache();
+        void _lock() const;
+        void _unlock() const;
+        void _markDirty(CachedValue& value);
+        bool _flush(bool all);
+        bool _writeValues(CachedValue* values, bool all);
+        static esp_err_t _writeValue(nvs_handle_t nvs_handle, const char* key, const CachedValue& value);
+        static void _encodeSnapshot(const CachedValue* values, uint32_t mask, std::vector<uint8_t>& out);
+        bool _decodeSnapshot(const uint8_t* data, size_t size, CachedValue* staged, uint32_t* mask) const;
+        bool _applyStaged(const CachedValue* staged, uint32_t mask);
+        void _resumeImport();
         const SettingItem_t* _findItem(const std::string& ns, const std::string& key) const;
+        static void _flushTask(void* arg);
+        static void _shutdownHandler();
     };
 
 } // namespace SETTINGS
@@ -0,0 +1,164 @@
+/**
+ * @file adpcm_encoder.cpp
+ * @brief Host tool, converts a PCM WAV into a mono IMA-ADPCM WAV the speaker plays from flash
+ * @version 0.1
+ * @date 2025-12-17
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * Usage: adpcm_encoder <input.wav> <output.wav> [block_align] [lookahead]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <speaker/speaker_adpcm.h>
+
+
+using namespace HAL;
+
+
+static uint32_t _get_le(const uint8_t* data, int bytes)
+{
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+
+static void _put_le(std::vector<uint8_t>& out, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        out.push_back((value >> (i * 8)) & 0xFF);
+}
+
+
+/* PCM WAV to mono 16 bit, stereo is mixed down */
+static bool _read_wav(const char* path, std::vector<int16_t>& pcm, uint32_t& sampleRate)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        printf("can't open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> wav;
+    uint8_t buffer[4096];
+    size_t len;
+    while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        wav.insert(wav.end(), buffer, buffer + len);
+    fclose(file);
+
+    if (wav.size() < 12 || memcmp(wav.data(), "RIFF", 4) != 0 || memcmp(wav.data() + 8, "WAVE", 4) != 0)
+    {
+        printf("%s is not a WAV file\n", path);
+        return false;
+    }
+
+    int channels = 0;
+    int bits = 0;
+    for (size_t offset = 12; offset + 8 <= wav.size();)
+    {
+        const uint8_t* chunk = wav.data() + offset;
+        size_t size = std::min<size_t>(_get_le(chunk + 4, 4), wav.size() - offset - 8);
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            if (_get_le(chunk + 8, 2) != 1)
+            {
+                printf("%s is not PCM\n", path);
+                return false;
+            }
+            channels = _get_le(chunk + 10, 2);
+            sampleRate = _get_le(chunk + 12, 4);
+            bits = _get_le(chunk + 22, 2);
+        }
+        else if (memcmp(chunk, "data", 4) == 0 && channels > 0)
+        {
+            if ((bits != 8 && bits != 16) || channels > 2)
+            {
+                printf("%d bits, %d channels not supported\n", bits, channels);
+                return false;
+            }
+            const int frame_size = bits / 8 * channels;
+            for (size_t i = 0; i + frame_size <= size; i += frame_size)
+            {
+                int32_t sum = 0;
+                for (int ch = 0; ch < channels; ch++)
+                {
+                    const uint8_t* value = chunk + 8 + i + ch * bits / 8;
+                    sum += (bits == 16) ? (int16_t)_get_le(value, 2) : (value[0] - 128) * 256;
+                }
+                pcm.push_back(sum / channels);
+            }
+            return true;
+        }
+        offset += 8 + size + (size & 1);
+    }
+    printf("%s has no data\n", path);
+    return false;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("usage: %s <input.wav> <output.wav> [block_align] [lookahead]\n", argv[0]);
+        return -1;
+    }
+    const uint16_t block_align = (argc > 3) ? atoi(argv[3]) : ADPCM::DEFAULT_BLOCK_ALIGN;
+    /* Clicks and fast attacks gain a few dB, each lookahead sample costs 16x the encoding time */
+    const size_t lookahead = (argc > 4) ? atoi(argv[4]) : 2;
+    if (block_align <= ADPCM::BLOCK_HEADER_SIZE)
+    {
+        printf("block_align must be above %zu\n", ADPCM::BLOCK_HEADER_SIZE);
+        return -1;
+    }
+
+    std::vector<int16_t> pcm;
+    uint32_t sample_rate = 0;
+    if (!_read_wav(argv[1], pcm, sample_rate) || pcm.empty())
+        return -1;
+
+    std::vector<uint8_t> data(ADPCM::encoded_size(pcm.size(), block_align));
+    ADPCM::encode(pcm.data(), pcm.size(), data.data(), block_align, lookahead);
+
+    /* fmt with the samples per block extension, fact holds the real sample count */
+    const uint32_t block_samples = ADPCM::samples_per_block(block_align);
+    std::vector<uint8_t> out;
+    out.insert(out.end(), {'R', 'I', 'F', 'F'});
+    _put_le(out, 4 + (8 + 20) + (8 + 4) + (8 + data.size() + (data.size() & 1)), 4);
+    out.insert(out.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    _put_le(out, 20, 4);
+    _put_le(out, ADPCM::WAV_FORMAT, 2);
+    _put_le(out, 1, 2);
+    _put_le(out, sample_rate, 4);
+    _put_le(out, (uint64_t)sample_rate * block_align / block_samples, 4);
+    _put_le(out, block_align, 2);
+    _put_le(out, 4, 2);
+    _put_le(out, 2, 2);
+    _put_le(out, block_samples, 2);
+    out.insert(out.end(), {'f', 'a', 'c', 't'});
+    _put_le(out, 4, 4);
+    _put_le(out, pcm.size(), 4);
+    out.insert(out.end(), {'d', 'a', 't', 'a'});
+    _put_le(out, data.size(), 4);
+    out.insert(out.end(), data.begin(), data.end());
+    if (data.size() & 1)
+        out.push_back(0);
+
+    FILE* file = fopen(argv[2], "wb");
+    if (file == nullptr || fwrite(out.data(), 1, out.size(), file) != out.size())
+    {
+        printf("can't write %s\n", argv[2]);
+        if (file)
+            fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    printf("%s: %zu samples at %u Hz, %zu bytes\n", argv[2], pcm.size(), sample_rate, out.size());
+    return 0;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file battery_model_test.cpp
+ * @brief Battery voltage filtering, charge table, load compensation and time to empty
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <bat/battery_model.h>
+
+
+using namespace HAL;
+
+
+#define READING_PERIOD_MS               1000
+
+
+/* Resting voltage of a charge, per mille */
+static uint16_t _ocv_of(uint16_t soc)
+{
+    uint16_t lo = 3000;
+    uint16_t hi = 4300;
+    while (lo < hi)
+    {
+        uint16_t mid = (lo + hi) / 2;
+        if (BatteryModel::soc_of(mid) < soc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+/* ADC noise of a few mV and a spike now and then */
+static uint16_t _noisy(uint16_t mv)
+{
+    int noise = rand() % 21 - 10;
+    if (rand() % 50 == 0)
+        noise += (rand() % 2) ? 300 : -300;
+    return mv + noise;
+}
+
+
+int main()
+{
+    srand(1234);
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Charge table]\n");
+    {
+        if (BatteryModel::soc_of(3000) != 0 || BatteryModel::soc_of(3300) != 0 || BatteryModel::soc_of(4200) != 1000 ||
+            BatteryModel::soc_of(4350) != 1000)
+            return -1;
+        if (BatteryModel::soc_of(3820) != 500 || BatteryModel::soc_of(3845) != 550)
+            return -1;
+        uint16_t last = 0;
+        for (uint16_t mv = 3200; mv <= 4300; mv++)
+        {
+            uint16_t soc = BatteryModel::soc_of(mv);
+            if (soc < last)
+                return -1;
+            last = soc;
+        }
+        printf("3.70 V %u, 3.85 V %u, 4.10 V %u per mille\n", BatteryModel::soc_of(3700), BatteryModel::soc_of(3850),
+               BatteryModel::soc_of(4100));
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Filtering]\n");
+    {
+        BatteryModel model;
+        uint32_t now = 0;
+        int raw_min = 10000, raw_max = 0;
+        int min = 10000, max = 0;
+        for (int i = 0; i < 600; i++, now += READING_PERIOD_MS)
+        {
+            uint16_t mv = _noisy(3900);
+            model.addSample(mv, now);
+            raw_min = std::min<int>(raw_min, mv);
+            raw_max = std::max<int>(raw_max, mv);
+            if (i >= 20)
+            {
+                min = std::min<int>(min, model.voltage());
+                max = std::max<int>(max, model.voltage());
+            }
+        }
+        printf("raw %d..%d mV, filtered %d..%d mV\n", raw_min, raw_max, min, max);
+        if (min < 3895 || max > 3905 || raw_max - raw_min < 500)
+            return -1;
+
+        /* The first reading is taken as it is */
+        BatteryModel fresh;
+        fresh.addSample(3700, 0);
+        if (!fresh.hasSample() || fresh.voltage() != 3700)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Load compensation]\n");
+    {
+        BatteryModel model;
+        model.setLoad(200);
+        model.addSample(3800, 0);
+        printf("3800 mV at 200 mA, %u mV resting, %u%%\n", model.ocv(), model.level());
+        if (model.ocv() != 3840 || model.level() != BatteryModel::soc_of(3840) / 10)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Time to empty]\n");
+    {
+        /* Full to empty in 4 hours */
+        const uint32_t runtime_ms = 4 * 3600 * 1000;
+        BatteryModel model;
+        model.setLoad(150);
+        uint32_t now = 0;
+        int32_t first_estimate_ms = -1;
+        for (; now < runtime_ms * 3 / 4; now += READING_PERIOD_MS)
+        {
+            uint16_t soc = 1000 - (uint64_t)now * 1000 / runtime_ms;
+            model.addSample(_noisy(_ocv_of(soc) - 30), now);
+            if (first_estimate_ms < 0 && model.minutesToEmpty() >= 0)
+                first_estimate_ms = now;
+            if (now % (30 * 60 * 1000) == 0 && now > 0)
+            {
+                printf("at %3u min: %3u%%, %4d min left, really %u\n", now / 60000, model.level(),
+                       model.minutesToEmpty(), (runtime_ms - now) / 60000);
+            }
+        }
+        int32_t left = model.minutesToEmpty();
+        int32_t expected = (runtime_ms - now) / 60000;
+        printf("first estimate after %d min\n", first_estimate_ms / 60000);
+        if (first_estimate_ms < 0 || first_estimate_ms > 11 * 60 * 1000 || std::abs(left - expected) > expected / 5)
+            return -1;
+
+        /* Charging, no estimate */
+        for (int i = 0; i < 1200; i++, now += READING_PERIOD_MS)
+        {
+            model.addSample(_noisy(3800 + i / 4), now);
+        }
+        printf("charging: %d\n", model.minutesToEmpty());
+        if (model.minutesToEmpty() != -1)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+    printf("\ndone\n");
+    return 0;
+}
@@ -0,0 +1,379 @@
+/**
+ * @file block_cache_test.cpp
+ * @brief Block cache over FAT image files, hit rate, LRU order, FAT write-back, two volumes on two tasks
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cache/block_cache.h>
+
+
+using namespace HAL;
+
+
+#define SECTOR_SIZE                     512
+#define SECTOR_COUNT                    2048
+#define RESERVED_SECTORS                4
+#define FAT_SECTORS                     16
+#define PARTITION_START                 63
+
+
+/* FAT image in a temporary file */
+struct ImageFile
+{
+    FILE* file = tmpfile();
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    uint32_t written_sectors = 0;
+    uint32_t base = 0;
+
+    /* Set once a device call comes from another thread than the owner, or overlaps another call */
+    std::thread::id owner = std::this_thread::get_id();
+    std::atomic<int> in_call{0};
+    std::atomic<bool> foreign_call{false};
+
+    ImageFile(bool partitioned)
+    {
+        std::vector<uint8_t> sector(SECTOR_SIZE);
+        for (uint32_t lba = 0; lba < SECTOR_COUNT; lba++)
+        {
+            for (int i = 0; i < SECTOR_SIZE; i++)
+                sector[i] = rand();
+            fwrite(sector.data(), 1, SECTOR_SIZE, file);
+        }
+
+        /* FAT16 boot sector, 2 FATs */
+        memset(sector.data(), 0, SECTOR_SIZE);
+        sector[0] = 0xEB;
+        sector[11] = SECTOR_SIZE & 0xFF;
+        sector[12] = SECTOR_SIZE >> 8;
+        sector[13] = 4;
+        sector[14] = RESERVED_SECTORS;
+        sector[16] = 2;
+        sector[22] = FAT_SECTORS;
+        sector[510] = 0x55;
+        sector[511] = 0xAA;
+        if (partitioned)
+        {
+            base = PARTITION_START;
+            _put(base, sector.data());
+            memset(sector.data(), 0, SECTOR_SIZE);
+            sector[446 + 4] = 0x06;
+            sector[446 + 8] = PARTITION_START;
+            sector[510] = 0x55;
+            sector[511] = 0xAA;
+        }
+        _put(0, sector.data());
+    }
+
+    ~ImageFile() { fclose(file); }
+
+    void _put(uint32_t lba, const uint8_t* data)
+    {
+        fseek(file, lba * SECTOR_SIZE, SEEK_SET);
+        fwrite(data, 1, SECTOR_SIZE, file);
+    }
+
+    int attach(BlockCache& cache)
+    {
+        return cache.attach(
+            [this](uint32_t lba, uint32_t count, uint8_t* out) {
+                _enter();
+                reads++;
+                fseek(file, lba * SECTOR_SIZE, SEEK_SET);
+                bool ok = fread(out, SECTOR_SIZE, count, file) == count;
+                in_call--;
+                return ok;
+            },
+            [this](uint32_t lba, uint32_t count, const uint8_t* in) {
+                _enter();
+                writes++;
+                written_sectors += count;
+                fseek(file, lba * SECTOR_SIZE, SEEK_SET);
+                bool ok = fwrite(in, SECTOR_SIZE, count, file) == count;
+                in_call--;
+                return ok;
+            },
+            SECTOR_SIZE);
+    }
+
+    void _enter()
+    {
+        if (in_call++ != 0 || std::this_thread::get_id() != owner)
+            foreign_call = true;
+    }
+
+    bool same(uint32_t lba, uint32_t count, const uint8_t* data)
+    {
+        std::vector<uint8_t> disk(count * SECTOR_SIZE);
+        fseek(file, lba * SECTOR_SIZE, SEEK_SET);
+        if (fread(disk.data(), SECTOR_SIZE, count, file) != count)
+            return false;
+        return memcmp(disk.data(), data, disk.size()) == 0;
+    }
+
+    uint32_t fat(uint32_t copy, uint32_t sector) { return base + RESERVED_SECTORS + copy * FAT_SECTORS + sector; }
+};
+
+
+int main()
+{
+    srand(1234);
+    std::vector<uint8_t> buffer(64 * SECTOR_SIZE);
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Browsing]\n");
+    {
+        /* A FAT sector and a handful of directory sectors, read again and again */
+        BlockCache cache;
+        ImageFile image(false);
+        int dev = image.attach(cache);
+        if (dev < 0)
+            return -1;
+        uint32_t working_set[] = {image.fat(0, 0), image.fat(0, 1), 100, 101, 102, 103, 200, 201};
+        for (int i = 0; i < 500; i++)
+        {
+            uint32_t lba = working_set[rand() % 8];
+            if (!cache.read(dev, lba, 1, buffer.data()) || !image.same(lba, 1, buffer.data()))
+                return -1;
+        }
+        block_cache_stats_t stats = cache.stats(dev);
+        printf("%u device reads, hit rate %u%%\n", image.reads, stats.hitRate());
+        if (image.reads != 8 || stats.hitRate() < 98 || stats.misses != 8)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[LRU]\n");
+    {
+        /* 16 KB holds 32 sectors, a scan over 100 evicts but the hot sector stays */
+        BlockCache cache;
+        ImageFile image(false);
+        int dev = image.attach(cache);
+        for (uint32_t lba = 300; lba < 400; lba++)
+        {
+            cache.read(dev, 5, 1, buffer.data());
+            cache.read(dev, lba, 1, buffer.data());
+        }
+        block_cache_stats_t stats = cache.stats(dev);
+        printf("%llu hits, %llu misses, %llu evictions\n", (unsigned long long)stats.hits,
+               (unsigned long long)stats.misses, (unsigned long long)stats.evictions);
+        if (stats.hits != 99 || stats.misses != 101 || stats.evictions != 101 - 32)
+            return -1;
+
+        /* Multi-sector reads are file data, not cached */
+        uint32_t reads = image.reads;
+        cache.read(dev, 1000, 8, buffer.data());
+        cache.read(dev, 1000, 8, buffer.data());
+        if (image.reads != reads + 2 || cache.stats(dev).bypassed != 16 || !image.same(1000, 8, buffer.data()))
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[FAT write-back]\n");
+    for (bool partitioned : {false, true})
+    {
+        BlockCache cache;
+        ImageFile image(partitioned);
+        int dev = image.attach(cache);
+        if (!cache.setWriteBackFat(dev))
+            return -1;
+
+        /* Both FAT copies updated 20 times, nothing reaches the image */
+        std::vector<uint8_t> fat(SECTOR_SIZE);
+        uint32_t writes = image.writes;
+        for (int i = 0; i < 20; i++)
+        {
+            memset(fat.data(), i, SECTOR_SIZE);
+            for (uint32_t copy = 0; copy < 2; copy++)
+            {
+                for (uint32_t sector = 3; sector < 6; sector++)
+                {
+                    if (!cache.write(dev, image.fat(copy, sector), 1, fat.data()))
+                        return -1;
+                }
+            }
+        }
+        if (image.writes != writes || image.same(image.fat(0, 3), 1, fat.data()))
+            return -1;
+
+        /* Reads see the cached FAT, also through a multi-sector read */
+        if (!cache.read(dev, image.fat(1, 4), 1, buffer.data()) || memcmp(buffer.data(), fat.data(), SECTOR_SIZE) != 0)
+            return -1;
+        if (!cache.read(dev, image.fat(0, 0), 8, buffer.data()) ||
+            memcmp(&buffer[4 * SECTOR_SIZE], fat.data(), SECTOR_SIZE) != 0)
+            return -1;
+
+        /* Data sectors go through */
+        if (!cache.write(dev, 1500, 1, fat.data()) || image.writes != writes + 1 || !image.same(1500, 1, fat.data()))
+            return -1;
+
+        /* Sync, one command per FAT copy */
+        if (!cache.flush(dev))
+            return -1;
+        printf("%s: %u writes after flush, %llu sectors written back\n", partitioned ? "partitioned" : "plain",
+               image.writes - writes, (unsigned long long)cache.stats(dev).write_backs);
+        if (image.writes != writes + 3 || cache.stats(dev).write_backs != 6)
+            return -1;
+        for (uint32_t copy = 0; copy < 2; copy++)
+        {
+            for (uint32_t sector = 3; sector < 6; sector++)
+            {
+                if (!image.same(image.fat(copy, sector), 1, fat.data()))
+                    return -1;
+            }
+        }
+        if (!cache.flush(dev) || image.writes != writes + 3)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Eviction and detach]\n");
+    {
+        /* Two volumes share the cache, a volume only pushes out its own dirty sectors, detach writes the rest */
+        BlockCache cache;
+        ImageFile sd(false);
+        ImageFile usb(true);
+        int sd_dev = sd.attach(cache);
+        int usb_dev = usb.attach(cache);
+        if (sd_dev < 0 || usb_dev < 0 || sd_dev == usb_dev)
+            return -1;
+        cache.setWriteBackFat(sd_dev);
+        cache.setWriteBackFat(usb_dev);
+
+        std::vector<uint8_t> fat(SECTOR_SIZE, 0x5A);
+        cache.write(sd_dev, sd.fat(0, 0), 1, fat.data());
+        cache.write(usb_dev, usb.fat(0, 0), 1, fat.data());
+        uint32_t sd_reads = sd.reads;
+        for (uint32_t lba = 500; lba < 540; lba++)
+        {
+            cache.read(usb_dev, lba, 1, buffer.data());
+        }
+        if (sd.reads != sd_reads || sd.writes != 0 || sd.same(sd.fat(0, 0), 1, fat.data()) ||
+            !usb.same(usb.fat(0, 0), 1, fat.data()))
+            return -1;
+
+        /* The SD sector is still there for the SD volume */
+        if (!cache.read(sd_dev, sd.fat(0, 0), 1, buffer.data()) || memcmp(buffer.data(), fat.data(), SECTOR_SIZE) != 0 ||
+            sd.reads != sd_reads)
+            return -1;
+
+        cache.write(sd_dev, sd.fat(1, 7), 1, fat.data());
+        cache.detach(sd_dev);
+        if (!sd.same(sd.fat(0, 0), 1, fat.data()) || !sd.same(sd.fat(1, 7), 1, fat.data()) ||
+            cache.read(sd_dev, 0, 1, buffer.data()))
+            return -1;
+
+        block_cache_stats_t total = cache.stats();
+        printf("total: %llu misses, %llu evictions, %llu written back\n", (unsigned long long)total.misses,
+               (unsigned long long)total.evictions, (unsigned long long)total.write_backs);
+        if (total.write_backs != 3 || cache.stats(usb_dev).write_backs != 1)
+            return -1;
+
+        /* Sectors bigger than the cache blocks are refused */
+        if (cache.attach(nullptr, nullptr, 4096) != -1)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Two volumes, two tasks]\n");
+    {
+        /* 4 KB, 8 slots, the FAT writes of one volume fill it while the other reads, each device sees only its task */
+        BlockCache cache({4 * 1024, SECTOR_SIZE});
+        ImageFile sd(false);
+        ImageFile usb(true);
+        int devs[2] = {sd.attach(cache), usb.attach(cache)};
+        ImageFile* images[2] = {&sd, &usb};
+        std::atomic<bool> failed{false};
+
+        auto volume = [&](int n) {
+            ImageFile& image = *images[n];
+            const int dev = devs[n];
+            image.owner = std::this_thread::get_id();
+            cache.setWriteBackFat(dev);
+
+            /* What the volume should read back, the image as FATFS last wrote it */
+            std::vector<uint8_t> shadow(SECTOR_COUNT * SECTOR_SIZE);
+            fseek(image.file, 0, SEEK_SET);
+            if (fread(shadow.data(), SECTOR_SIZE, SECTOR_COUNT, image.file) != SECTOR_COUNT)
+                failed = true;
+
+            std::minstd_rand random(n + 1);
+            std::vector<uint8_t> data(8 * SECTOR_SIZE);
+            for (int i = 0; i < 5000 && !failed; i++)
+            {
+                uint32_t lba;
+                uint32_t count = 1;
+                bool ok = true;
+                switch (random() % 5)
+                {
+                case 0:
+                    lba = image.fat(random() % 2, random() % 6);
+                    memset(data.data(), random(), SECTOR_SIZE);
+                    memcpy(&shadow[lba * SECTOR_SIZE], data.data(), SECTOR_SIZE);
+                    ok = cache.write(dev, lba, 1, data.data());
+                    break;
+                case 1:
+                    lba = image.fat(random() % 2, random() % 6);
+                    ok = cache.read(dev, lba, 1, data.data());
+                    break;
+                case 2:
+                    lba = 300 + random() % 40;
+                    ok = cache.read(dev, lba, 1, data.data());
+                    break;
+                case 3:
+                    lba = image.fat(0, 0) + random() % 30;
+                    count = 8;
+                    ok = cache.read(dev, lba, count, data.data());
+                    break;
+                default:
+                    ok = cache.flush(dev);
+                    continue;
+                }
+                if (!ok || memcmp(data.data(), &shadow[lba * SECTOR_SIZE], count * SECTOR_SIZE) != 0)
+                    failed = true;
+            }
+
+            if (!cache.flush(dev) || !image.same(0, SECTOR_COUNT, shadow.data()))
+                failed = true;
+        };
+
+        std::thread sd_task(volume, 0);
+        std::thread usb_task(volume, 1);
+        sd_task.join();
+        usb_task.join();
+
+        block_cache_stats_t total = cache.stats();
+        printf("%llu evictions, %llu written back, sd %u writes, usb %u writes\n", (unsigned long long)total.evictions,
+               (unsigned long long)total.write_backs, sd.writes, usb.writes);
+        if (failed || sd.foreign_call || usb.foreign_call || total.evictions == 0)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+    printf("\ndone\n");
+    return 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * @file image_cache_test.cpp
+ * @brief Image service cache, budgets per pool, LRU eviction, pending and failed images
+ * @version 0.1
+ * @date 2025-12-06
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <utils/image/image_cache.h>
+
+
+using namespace UTILS::IMAGE_SERVICE;
+
+
+/* Image sizes, RGB565 */
+#define ICON_W                          40
+#define ICON_H                          40
+#define ICON_SIZE                       (ICON_W * ICON_H * 2)
+#define LOGO_W                          240
+#define LOGO_H                          135
+#define LOGO_SIZE                       (LOGO_W * LOGO_H * 2)
+
+
+/* Heap with a PSRAM pool that may be missing */
+struct Heap
+{
+    bool has_psram = true;
+    int allocs = 0;
+    int frees = 0;
+
+    ImageCache make(size_t internal_budget, size_t psram_budget)
+    {
+        return ImageCache(
+            [this](size_t size, bool psram) -> void* {
+                if (psram && !has_psram)
+                    return nullptr;
+                allocs++;
+                return malloc(size);
+            },
+            [this](void* buffer) {
+                frees++;
+                free(buffer);
+            },
+            internal_budget,
+            psram_budget);
+    }
+};
+
+
+static Entry_t* request(ImageCache& cache, const char* key, int32_t w, int32_t h, bool& found)
+{
+    return cache.add(key, nullptr, 0, w, h, found);
+}
+
+
+int main()
+{
+    bool found = false;
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Request and decode]\n");
+    {
+        Heap heap;
+        ImageCache cache = heap.make(4 * ICON_SIZE, 0);
+        Entry_t* e = request(cache, "/sdcard/a.png", ICON_W, ICON_H, found);
+        if (e == nullptr || found || e->buffer == nullptr || e->in_psram || cache.used_internal() != ICON_SIZE)
+            return -1;
+        if (cache.get_state("/sdcard/a.png", ICON_W, ICON_H) != IMAGE_PENDING || cache.use("/sdcard/a.png", ICON_W, ICON_H))
+            return -1;
+
+        /* The same request again, nothing new to decode */
+        if (request(cache, "/sdcard/a.png", ICON_W, ICON_H, found) != nullptr || !found || cache.size() != 1)
+            return -1;
+
+        /* Another size is another image */
+        if (request(cache, "/sdcard/a.png", 2 * ICON_W, ICON_H, found) == nullptr || found)
+            return -1;
+
+        cache.done(e, true);
+        if (cache.get_state("/sdcard/a.png", ICON_W, ICON_H) != IMAGE_READY || cache.use("/sdcard/a.png", ICON_W, ICON_H) != e)
+            return -1;
+        printf("%u entries, %u bytes\n", (unsigned)cache.size(), (unsigned)cache.used_internal());
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[LRU within the budget]\n");
+    {
+        /* Room for 3 icons, the 4th evicts the least recently used one */
+        Heap heap;
+        heap.has_psram = false;
+        ImageCache cache = heap.make(3 * ICON_SIZE, 1024 * 1024);
+        const char* keys[] = {"a", "b", "c", "d"};
+        for (int i = 0; i < 3; i++)
+            cache.done(request(cache, keys[i], ICON_W, ICON_H, found), true);
+        cache.use("a", ICON_W, ICON_H);
+
+        Entry_t* d = request(cache, "d", ICON_W, ICON_H, found);
+        if (d == nullptr || d->in_psram)
+            return -1;
+        printf("a %d, b %d, c %d, %u bytes\n", cache.get_state("a", ICON_W, ICON_H), cache.get_state("b", ICON_W, ICON_H),
+               cache.get_state("c", ICON_W, ICON_H), (unsigned)cache.used_internal());
+        if (cache.get_state("a", ICON_W, ICON_H) != IMAGE_READY || cache.get_state("b", ICON_W, ICON_H) != IMAGE_NONE ||
+            cache.get_state("c", ICON_W, ICON_H) != IMAGE_READY || cache.used_internal() != 3 * ICON_SIZE)
+            return -1;
+
+        /* Pending images are never evicted, nothing fits beside 3 of them */
+        Entry_t* e = request(cache, "e", ICON_W, ICON_H, found);
+        Entry_t* f = request(cache, "f", ICON_W, ICON_H, found);
+        if (e == nullptr || f == nullptr || request(cache, "g", ICON_W, ICON_H, found) != nullptr)
+            return -1;
+
+        /* Bigger than the budget */
+        if (request(cache, "logo", LOGO_W, LOGO_H, found) != nullptr)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[PSRAM first]\n");
+    {
+        Heap heap;
+        ImageCache cache = heap.make(2 * ICON_SIZE, LOGO_SIZE);
+        Entry_t* logo = request(cache, "logo", LOGO_W, LOGO_H, found);
+        Entry_t* icon = request(cache, "icon", ICON_W, ICON_H, found);
+        printf("psram %u bytes, internal %u bytes\n", (unsigned)cache.used_psram(), (unsigned)cache.used_internal());
+        if (logo == nullptr || !logo->in_psram || icon == nullptr || icon->in_psram ||
+            cache.used_psram() != LOGO_SIZE || cache.used_internal() != ICON_SIZE)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Failed and dropped]\n");
+    {
+        Heap heap;
+        ImageCache cache = heap.make(4 * ICON_SIZE, 0);
+
+        /* A failed image keeps no memory and the next request tries again */
+        Entry_t* e = request(cache, "/sdcard/missing.png", ICON_W, ICON_H, found);
+        cache.done(e, false);
+        if (cache.get_state("/sdcard/missing.png", ICON_W, ICON_H) != IMAGE_FAILED || cache.used_internal() != 0)
+            return -1;
+        e = request(cache, "/sdcard/missing.png", ICON_W, ICON_H, found);
+        if (e == nullptr || found || cache.size() != 1 ||
+            cache.get_state("/sdcard/missing.png", ICON_W, ICON_H) != IMAGE_PENDING)
+            return -1;
+        cache.done(e, true);
+        if (cache.get_state("/sdcard/missing.png", ICON_W, ICON_H) != IMAGE_READY)
+            return -1;
+
+        /* Removed while pending, gone for callers, freed once decoded */
+        Entry_t* p = request(cache, "p", ICON_W, ICON_H, found);
+        cache.remove("p", ICON_W, ICON_H);
+        if (cache.get_state("p", ICON_W, ICON_H) != IMAGE_NONE || cache.used_internal() != 2 * ICON_SIZE)
+            return -1;
+        Entry_t* again = request(cache, "p", ICON_W, ICON_H, found);
+        if (again == nullptr || again == p)
+            return -1;
+        cache.done(p, true);
+        cache.done(again, true);
+        if (cache.use("p", ICON_W, ICON_H) != again || cache.used_internal() != 2 * ICON_SIZE)
+            return -1;
+
+        /* A request that could not be queued */
+        Entry_t* q = request(cache, "q", ICON_W, ICON_H, found);
+        cache.cancel(q);
+        if (cache.get_state("q", ICON_W, ICON_H) != IMAGE_NONE || cache.used_internal() != 2 * ICON_SIZE)
+            return -1;
+
+        /* Clear leaves pending images to the decoder */
+        Entry_t* r = request(cache, "r", ICON_W, ICON_H, found);
+        cache.clear();
+        if (cache.size() != 1 || cache.used_internal() != ICON_SIZE)
+            return -1;
+        cache.done(r, true);
+        printf("%d allocs, %d frees, %u entries\n", heap.allocs, heap.frees, (unsigned)cache.size());
+        if (cache.size() != 0 || cache.used_internal() != 0 || heap.allocs != heap.frees)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+    printf("\ndone\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file led_animation_test.cpp
+ * @brief LED pattern frame tables
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <cstdio>
+#include <led/led_animation.h>
+
+
+using namespace HAL;
+
+
+static void _print(const char* name, const LEDAnimation& animation)
+{
+    printf("%-14s %3zu frames, %5u ms%s\n", name, animation.frames.size(), animation.period_ms(),
+           animation.loop ? ", loops" : "");
+}
+
+
+/* Frames alternate between colors, only the last may hold */
+static bool _check_frames(const LEDAnimation& animation)
+{
+    for (size_t i = 0; i < animation.frames.size(); i++)
+    {
+        const led_frame_t& frame = animation.frames[i];
+        if (i > 0 && frame.color == animation.frames[i - 1].color)
+            return false;
+        if (frame.duration_ms == 0 && i + 1 != animation.frames.size())
+            return false;
+    }
+    return !animation.frames.empty();
+}
+
+
+int main()
+{
+    /* -------------------------------------------------------------- */
+    printf("\n[Blinks]\n");
+    {
+        /* WiFi status patterns */
+        LEDAnimation blink = LEDAnimation::blink({127, 0, 0}, 50, 2000);
+        _print("blink", blink);
+        if (!_check_frames(blink) || blink.frames.size() != 2 || blink.period_ms() != 2050 || !blink.loop ||
+            blink.holds())
+            return -1;
+
+        LEDAnimation double_blink = LEDAnimation::double_blink({0, 19, 127}, 50, 50, 2000);
+        _print("double blink", double_blink);
+        if (!_check_frames(double_blink) || double_blink.frames.size() != 4 || double_blink.period_ms() != 2000)
+            return -1;
+        if (double_blink.frames[0].color != Color(0, 19, 127) || double_blink.frames[3].duration_ms != 1850)
+            return -1;
+
+        /* Period too short for the blinks, no pause instead of a wrapped one */
+        LEDAnimation tight = LEDAnimation::double_blink({0, 19, 127}, 50, 50, 100);
+        if (!_check_frames(tight) || tight.period_ms() != 150)
+            return -1;
+
+        LEDAnimation once = LEDAnimation::blink_once({255, 255, 255}, 100);
+        _print("blink once", once);
+        if (!_check_frames(once) || once.loop || !once.holds() || once.frames.size() != 2 ||
+            once.frames[1].color != Color() || once.frames[1].duration_ms != 0)
+            return -1;
+
+        /* Nothing changes, nothing to wake up for */
+        LEDAnimation steady = LEDAnimation::blink({127, 0, 0}, 50, 0);
+        LEDAnimation dark = LEDAnimation::double_blink({0, 0, 0}, 50, 50, 2000);
+        if (steady.frames.size() != 1 || !steady.holds() || dark.frames.size() != 1 || !dark.holds())
+            return -1;
+        printf("steady patterns hold one frame\n");
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Fades]\n");
+    {
+        LEDAnimation bright = LEDAnimation::fade({255, 255, 255}, 500, 700, 200);
+        _print("fade bright", bright);
+        if (!_check_frames(bright) || bright.period_ms() != 1400 || bright.frames.size() > 2 * LEDAnimation::FADE_STEPS)
+            return -1;
+        if (bright.frames[0].color != Color())
+            return -1;
+
+        /* Ramps up to the hold, then down */
+        size_t peak = 0;
+        for (size_t i = 1; i < bright.frames.size(); i++)
+        {
+            if (bright.frames[i].color.r > bright.frames[peak].color.r)
+                peak = i;
+        }
+        if (bright.frames[peak].color != Color(255, 255, 255) || bright.frames[peak].duration_ms < 200)
+            return -1;
+        for (size_t i = 1; i < bright.frames.size(); i++)
+        {
+            bool rising = i <= peak;
+            if ((bright.frames[i].color.r > bright.frames[i - 1].color.r) != rising)
+                return -1;
+        }
+
+        /* A dim color has few distinct levels, so few frames */
+        LEDAnimation dim = LEDAnimation::fade({6, 3, 0}, 500, 700, 200);
+        _print("fade dim", dim);
+        if (!_check_frames(dim) || dim.period_ms() != 1400 || dim.frames.size() > 12)
+            return -1;
+
+        /* Ramps not divisible by the steps keep their length */
+        LEDAnimation odd = LEDAnimation::fade({200, 100, 50}, 333, 77, 0);
+        _print("fade odd", odd);
+        if (!_check_frames(odd) || odd.period_ms() != 410)
+            return -1;
+
+        LEDAnimation black = LEDAnimation::fade({0, 0, 0}, 500, 500, 500);
+        if (black.frames.size() != 1 || !black.holds())
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Compare]\n");
+    {
+        /* The LED keeps playing when asked for the same pattern */
+        if (LEDAnimation::blink({127, 0, 0}, 50, 1000) != LEDAnimation::blink({127, 0, 0}, 50, 1000))
+            return -1;
+        if (LEDAnimation::blink({127, 0, 0}, 50, 1000) == LEDAnimation::blink({127, 0, 0}, 50, 2000))
+            return -1;
+        if (LEDAnimation::constant({1, 2, 3}) == LEDAnimation::blink_once({1, 2, 3}, 0))
+            return -1;
+        printf("same patterns compare equal\n");
+    }
+    /* -------------------------------------------------------------- */
+
+
+    printf("\ndone\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file link_quality_test.cpp
+ * @brief WiFi link level smoothing, hysteresis and traffic rates
+ * @version 0.1
+ * @date 2025-12-17
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <wifi/link_quality.h>
+
+
+using namespace HAL;
+
+
+#define SAMPLE_PERIOD_MS                2000
+
+
+int main()
+{
+    srand(1234);
+
+    /* -------------------------------------------------------------- */
+    printf("\n[First sample]\n");
+    {
+        LinkQuality link;
+        if (!link.addSample(-60, 0) || link.level() != LinkQuality::LEVEL_STRONG || link.rssi() != -60)
+            return -1;
+
+        /* A new connection starts over from weak, like the connected status */
+        link.restart();
+        if (link.hasSample() || link.level() != LinkQuality::LEVEL_WEAK)
+            return -1;
+        if (!link.addSample(-75, 0) || link.level() != LinkQuality::LEVEL_GOOD)
+            return -1;
+        printf("level set outright\n");
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Noisy boundary]\n");
+    {
+        /* Fading around the strong boundary, +-4 dB */
+        LinkQuality link;
+        int raw_changes = 0;
+        bool raw_strong = false;
+        uint32_t now = 0;
+        for (int i = 0; i < 500; i++, now += SAMPLE_PERIOD_MS)
+        {
+            int8_t rssi = -67 + rand() % 9 - 4;
+            link.addSample(rssi, now);
+            raw_changes += (i > 0 && (rssi >= -67) != raw_strong);
+            raw_strong = (rssi >= -67);
+        }
+        printf("raw thresholds: %d changes, smoothed: %lu changes, rssi %d..%d\n", raw_changes,
+               (unsigned long)link.stats().level_changes, link.stats().rssi_min, link.stats().rssi_max);
+        if (link.stats().level_changes > 2 || raw_changes < 100)
+            return -1;
+        if (link.stats().rssi_min != -71 || link.stats().rssi_max != -63 || link.stats().samples != 500)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Real changes]\n");
+    {
+        /* Walking away from the AP, then back */
+        LinkQuality link;
+        uint32_t now = 0;
+        link.addSample(-55, now);
+        int samples = 0;
+        while (link.level() != LinkQuality::LEVEL_WEAK && samples < 20)
+        {
+            now += SAMPLE_PERIOD_MS;
+            link.addSample(-90, now);
+            samples++;
+        }
+        printf("strong to weak in %d samples\n", samples);
+        if (link.level() != LinkQuality::LEVEL_WEAK || samples > 8)
+            return -1;
+
+        samples = 0;
+        while (link.level() != LinkQuality::LEVEL_STRONG && samples < 20)
+        {
+            now += SAMPLE_PERIOD_MS;
+            link.addSample(-50, now);
+            samples++;
+        }
+        printf("weak to strong in %d samples\n", samples);
+        if (link.level() != LinkQuality::LEVEL_STRONG || samples > 8)
+            return -1;
+
+        /* Just past the boundary isn't enough to leave a level */
+        for (int i = 0; i < 50; i++, now += SAMPLE_PERIOD_MS)
+            link.addSample(-69, now);
+        if (link.level() != LinkQuality::LEVEL_STRONG)
+            return -1;
+        for (int i = 0; i < 50; i++, now += SAMPLE_PERIOD_MS)
+            link.addSample(-71, now);
+        if (link.level() != LinkQuality::LEVEL_GOOD)
+            return -1;
+        printf("hysteresis holds\n");
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Traffic]\n");
+    {
+        LinkQuality link;
+        link.addSample(-60, 1000);
+        for (int i = 0; i < 250; i++)
+        {
+            link.addRx(1000);
+            link.addTx(100);
+        }
+        link.addSample(-60, 1000 + SAMPLE_PERIOD_MS);
+        printf("rx %lu bps, tx %lu bps\n", (unsigned long)link.stats().rx_bps, (unsigned long)link.stats().tx_bps);
+        if (link.stats().rx_bps != 1000000 || link.stats().tx_bps != 100000 || link.stats().rx_bytes != 250000)
+            return -1;
+
+        /* Counters carry over a reconnect */
+        link.countDisconnect(201);
+        link.countReconnect();
+        link.restart();
+        link.addSample(-60, 9000);
+        if (link.stats().rx_bytes != 250000 || link.stats().disconnects != 1 || link.stats().reconnects != 1
+            || link.stats().last_disconnect_reason != 201 || link.stats().rx_bps != 0)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+    printf("\ndone\n");
+    return 0;
+}
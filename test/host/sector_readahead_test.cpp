@@ -0,0 +1,192 @@
+/**
+ * @file sector_readahead_test.cpp
+ * @brief Sector read-ahead against a RAM disk that counts its commands
+ * @version 0.1
+ * @date 2025-12-18
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <usb/sector_readahead.h>
+
+
+using namespace HAL;
+
+
+#define SECTOR_SIZE                     512
+#define SECTOR_COUNT                    4096
+
+
+struct RamDisk
+{
+    std::vector<uint8_t> data = std::vector<uint8_t>(SECTOR_SIZE * SECTOR_COUNT);
+    uint32_t reads = 0;
+    uint32_t writes = 0;
+    uint64_t read_sectors = 0;
+
+    RamDisk()
+    {
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = rand();
+    }
+
+    SectorReadAhead attach(size_t window_bytes = 16 * 1024)
+    {
+        sector_readahead_config_t cfg;
+        cfg.window_bytes = window_bytes;
+        return SectorReadAhead(
+            [this](uint32_t lba, uint32_t count, uint8_t* out) {
+                if (lba + count > SECTOR_COUNT)
+                    return false;
+                reads++;
+                read_sectors += count;
+                memcpy(out, &data[lba * SECTOR_SIZE], count * SECTOR_SIZE);
+                return true;
+            },
+            [this](uint32_t lba, uint32_t count, const uint8_t* in) {
+                if (lba + count > SECTOR_COUNT)
+                    return false;
+                writes++;
+                memcpy(&data[lba * SECTOR_SIZE], in, count * SECTOR_SIZE);
+                return true;
+            },
+            SECTOR_SIZE,
+            SECTOR_COUNT,
+            cfg);
+    }
+
+    bool same(uint32_t lba, uint32_t count, const uint8_t* buffer)
+    {
+        return memcmp(&data[lba * SECTOR_SIZE], buffer, count * SECTOR_SIZE) == 0;
+    }
+};
+
+
+int main()
+{
+    srand(1234);
+    std::vector<uint8_t> buffer(64 * SECTOR_SIZE);
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Sequential]\n");
+    {
+        /* 4 KB reads over 1 MB, like fread of a firmware image */
+        RamDisk disk;
+        SectorReadAhead readahead = disk.attach();
+        for (uint32_t lba = 100; lba < 100 + 2048; lba += 8)
+        {
+            if (!readahead.read(lba, 8, buffer.data()) || !disk.same(lba, 8, buffer.data()))
+                return -1;
+        }
+        const sector_readahead_stats_t stats = readahead.stats();
+        printf("%u commands, %llu hit, %llu miss sectors\n", disk.reads, (unsigned long long)stats.hit_sectors,
+               (unsigned long long)stats.miss_sectors);
+        /* One plain read to start the stream, then a window per 32 sectors */
+        if (disk.reads > 2048 / 32 + 2 || stats.hit_sectors + stats.miss_sectors != 2048)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Unaligned with FAT lookups]\n");
+    {
+        /* Head and tail sectors on their own, a FAT sector now and then */
+        RamDisk disk;
+        SectorReadAhead readahead = disk.attach();
+        uint32_t lba = 500;
+        for (int i = 0; i < 200; i++)
+        {
+            uint32_t counts[] = {1, 6, 1};
+            for (uint32_t count : counts)
+            {
+                if (!readahead.read(lba, count, buffer.data()) || !disk.same(lba, count, buffer.data()))
+                    return -1;
+                lba += count;
+            }
+            if (i % 16 == 0 && (!readahead.read(32 + i / 16, 1, buffer.data()) || !disk.same(32 + i / 16, 1, buffer.data())))
+                return -1;
+        }
+        printf("%u commands for %u reads\n", disk.reads, 200 * 3 + 13);
+        if (disk.reads > 200 * 8 / 32 + 13 + 2)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Random]\n");
+    {
+        /* Nothing fetched that was not asked for */
+        RamDisk disk;
+        SectorReadAhead readahead = disk.attach();
+        uint64_t asked = 0;
+        for (int i = 0; i < 500; i++)
+        {
+            uint32_t count = 1 + rand() % 4;
+            uint32_t lba = rand() % (SECTOR_COUNT - count);
+            if (!readahead.read(lba, count, buffer.data()) || !disk.same(lba, count, buffer.data()))
+                return -1;
+            asked += count;
+        }
+        printf("asked %llu, read %llu sectors\n", (unsigned long long)asked, (unsigned long long)disk.read_sectors);
+        if (disk.read_sectors > asked + 32 * 4)
+            return -1;
+
+        /* Big requests go straight through */
+        uint32_t reads = disk.reads;
+        if (!readahead.read(0, 64, buffer.data()) || !disk.same(0, 64, buffer.data()) || disk.reads != reads + 1)
+            return -1;
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Writes]\n");
+    {
+        RamDisk disk;
+        SectorReadAhead readahead = disk.attach();
+        readahead.read(1000, 8, buffer.data());
+        readahead.read(1008, 8, buffer.data());
+
+        /* Multi-sector write over the window in one command, later reads see it */
+        std::vector<uint8_t> fresh(16 * SECTOR_SIZE, 0xA5);
+        uint32_t writes = disk.writes;
+        if (!readahead.write(1012, 16, fresh.data()) || disk.writes != writes + 1)
+            return -1;
+        if (!readahead.read(1010, 8, buffer.data()) || !disk.same(1010, 8, buffer.data()) || buffer[2 * SECTOR_SIZE] != 0xA5)
+            return -1;
+        printf("window kept after write\n");
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[End of device]\n");
+    {
+        RamDisk disk;
+        SectorReadAhead readahead = disk.attach();
+        for (uint32_t lba = SECTOR_COUNT - 40; lba < SECTOR_COUNT; lba += 4)
+        {
+            if (!readahead.read(lba, 4, buffer.data()) || !disk.same(lba, 4, buffer.data()))
+                return -1;
+        }
+        if (readahead.read(SECTOR_COUNT - 2, 4, buffer.data()))
+            return -1;
+        printf("%u commands, none past the end\n", disk.reads);
+    }
+    /* -------------------------------------------------------------- */
+
+
+    printf("\ndone\n");
+    return 0;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file speaker_adpcm_test.cpp
+ * @brief IMA-ADPCM codec, and the mixer decoding it against the same sound as 16 bit PCM
+ * @version 0.1
+ * @date 2025-12-17
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <speaker/speaker_adpcm.h>
+#include <speaker/speaker_mixer.h>
+
+
+using namespace HAL;
+
+
+#define SAMPLES_PER_FRAME               256
+#define SPK_SAMPLE_RATE                 48000
+#define SPK_MAGNIFICATION               16
+
+
+/* Sine sweep with some noise, like the sounds apps play */
+static std::vector<int16_t> _make_pcm(size_t length)
+{
+    std::vector<int16_t> pcm(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        float value = sinf(i * (0.02f + i * 0.00001f)) * 0.8f + (rand() % 1000 - 500) / 20000.0f;
+        pcm[i] = value * 32767;
+    }
+    return pcm;
+}
+
+
+static double _snr(const std::vector<int16_t>& pcm, const std::vector<int16_t>& decoded)
+{
+    double signal = 0;
+    double noise = 0;
+    for (size_t i = 0; i < pcm.size(); i++)
+    {
+        signal += (double)pcm[i] * pcm[i];
+        noise += (double)(pcm[i] - decoded[i]) * (pcm[i] - decoded[i]);
+    }
+    return 10 * log10(signal / std::max(noise, 1.0));
+}
+
+
+/* Mix frames of a source till it ends, returns the output and checks the position stays the same */
+static bool _mix_all(MIXER::mix_func_t mix, const MIXER::mix_source_t& source, MIXER::mix_state_t& state,
+                     uint32_t repeat, bool outStereo, std::vector<int32_t>& output)
+{
+    const size_t output_len = SAMPLES_PER_FRAME * (outStereo ? 2 : 1);
+    volatile uint32_t remaining = repeat;
+    for (int frame = 0; remaining && frame < 2000; frame++)
+    {
+        output.resize(output.size() + output_len);
+        size_t num = mix(&output[output.size() - output_len], output_len, source, state, remaining);
+        output.resize(output.size() - output_len + num);
+    }
+    return remaining == 0;
+}
+
+
+int main()
+{
+    srand(1234);
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Codec]\n");
+
+    for (uint16_t block_align : {36, 256, 1024})
+    {
+        const size_t block_samples = ADPCM::samples_per_block(block_align);
+
+        /* Whole blocks, and last blocks cut short at odd and even lengths */
+        for (size_t length : {(size_t)1, block_samples, block_samples + 1, block_samples + 2, (size_t)8000})
+        {
+            std::vector<int16_t> pcm = _make_pcm(length);
+            std::vector<uint8_t> data(ADPCM::encoded_size(length, block_align));
+            size_t size = ADPCM::encode(pcm.data(), length, data.data(), block_align);
+            if (size != data.size())
+            {
+                printf("block %d, %zu samples: encoded %zu bytes, expected %zu\n", block_align, length, size,
+                       data.size());
+                return -1;
+            }
+
+            std::vector<int16_t> decoded(length);
+            if (ADPCM::decode(data.data(), size, length, decoded.data(), block_align) != length)
+            {
+                printf("block %d, %zu samples: short decode\n", block_align, length);
+                return -1;
+            }
+
+            /* Block headers hold the real sample */
+            for (size_t i = 0; i < length; i += block_samples)
+            {
+                if (decoded[i] != pcm[i])
+                    return -1;
+            }
+
+            if (length < 1000)
+                continue;
+            double snr = _snr(pcm, decoded);
+            printf("block %4d: %zu samples in %zu bytes, %.2f bits per sample, snr %.1f dB\n", block_align, length,
+                   size, size * 8.0 / length, snr);
+            /* About 4 bits per sample, a quarter of 16 bit PCM */
+            if (snr < 25 || size * 8 > length * 4.5)
+                return -1;
+
+            /* Weighing the next samples does better than quantizing each on its own */
+            std::vector<uint8_t> searched(data.size());
+            ADPCM::encode(pcm.data(), length, searched.data(), block_align, 2);
+            ADPCM::decode(searched.data(), size, length, decoded.data(), block_align);
+            double searched_snr = _snr(pcm, decoded);
+            printf("            lookahead 2, snr %.1f dB\n", searched_snr);
+            if (searched_snr < snr)
+                return -1;
+        }
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Mixer]\n");
+
+    /* Decoding in the mix loop sounds exactly like mixing the decoded samples */
+    const float rates[] = {8000, 16000, 22050, 44100, 96000};
+    for (int out_stereo = 0; out_stereo < 2; out_stereo++)
+    {
+        for (float rate : rates)
+        {
+            const size_t length = 3000;
+            std::vector<int16_t> pcm = _make_pcm(length);
+            std::vector<uint8_t> data(ADPCM::encoded_size(length));
+            ADPCM::encode(pcm.data(), length, data.data());
+            std::vector<int16_t> decoded(length);
+            ADPCM::decode(data.data(), data.size(), length, decoded.data());
+
+            MIXER::mix_source_t pcm_source;
+            pcm_source.data = decoded.data();
+            pcm_source.length = length;
+            pcm_source.in_rate = rate * 256.0f;
+            pcm_source.out_rate = SPK_SAMPLE_RATE << 8;
+            pcm_source.volume = MIXER::get_volume(SPK_MAGNIFICATION, out_stereo, 200, 180);
+            MIXER::mix_source_t adpcm_source = pcm_source;
+            adpcm_source.data = data.data();
+            adpcm_source.block_align = ADPCM::DEFAULT_BLOCK_ALIGN;
+
+            /* Looping sends the decoder back to the first block */
+            std::vector<int32_t> expected;
+            std::vector<int32_t> output;
+            MIXER::mix_state_t pcm_state;
+            MIXER::mix_state_t adpcm_state;
+            if (!_mix_all(MIXER::get_mix_func(true, true, false, out_stereo), pcm_source, pcm_state, 3, out_stereo,
+                          expected)
+                || !_mix_all(MIXER::get_adpcm_mix_func(out_stereo), adpcm_source, adpcm_state, 3, out_stereo, output))
+                return -1;
+            if (output != expected || adpcm_state.index != pcm_state.index || adpcm_state.diff != pcm_state.diff)
+            {
+                printf("%s out at %.0f Hz differs\n", out_stereo ? "stereo" : "mono", rate);
+                return -1;
+            }
+
+            /* Starting mid block, like a channel handed a position, seeks from the block header */
+            expected.clear();
+            output.clear();
+            pcm_state = MIXER::mix_state_t();
+            pcm_state.index = 700;
+            adpcm_state = pcm_state;
+            if (!_mix_all(MIXER::get_mix_func(true, true, false, out_stereo), pcm_source, pcm_state, 1, out_stereo,
+                          expected)
+                || !_mix_all(MIXER::get_adpcm_mix_func(out_stereo), adpcm_source, adpcm_state, 1, out_stereo, output))
+                return -1;
+            if (output != expected)
+            {
+                printf("%s out at %.0f Hz differs after a seek\n", out_stereo ? "stereo" : "mono", rate);
+                return -1;
+            }
+            printf("%s out at %5.0f Hz: %zu values match\n", out_stereo ? "stereo" : "  mono", rate, output.size());
+        }
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Assets]\n");
+
+    /* Embedded sounds are converted with adpcm_encoder, check they stay playable */
+    for (const char* name : {"boot_sound", "clock", "error", "usb_connected", "usb_disconnected"})
+    {
+        std::string path = std::string(SOUND_DIR) + "/" + name + ".wav";
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            printf("can't open %s\n", path.c_str());
+            return -1;
+        }
+        std::vector<uint8_t> wav(64 * 1024);
+        wav.resize(fread(wav.data(), 1, wav.size(), file));
+        fclose(file);
+
+        /* fmt, fact and data chunks as the speaker reads them */
+        uint16_t format = 0;
+        uint16_t block_align = 0;
+        uint32_t samples = 0;
+        const uint8_t* data = nullptr;
+        uint32_t size = 0;
+        for (size_t offset = 12; offset + 8 <= wav.size(); offset += 8 + *(uint32_t*)&wav[offset + 4])
+        {
+            if (memcmp(&wav[offset], "fmt ", 4) == 0)
+            {
+                format = *(uint16_t*)&wav[offset + 8];
+                block_align = *(uint16_t*)&wav[offset + 20];
+            }
+            else if (memcmp(&wav[offset], "fact", 4) == 0)
+                samples = *(uint32_t*)&wav[offset + 8];
+            else if (memcmp(&wav[offset], "data", 4) == 0)
+            {
+                data = &wav[offset + 8];
+                size = *(uint32_t*)&wav[offset + 4];
+                break;
+            }
+        }
+        if (format != ADPCM::WAV_FORMAT || data == nullptr || samples == 0)
+        {
+            printf("%s is not IMA-ADPCM\n", name);
+            return -1;
+        }
+
+        std::vector<int16_t> decoded(samples);
+        if (ADPCM::decode(data, size, samples, decoded.data(), block_align) != samples)
+            return -1;
+        printf("%-16s %6u samples, %5zu bytes\n", name, samples, wav.size());
+    }
+    /* -------------------------------------------------------------- */
+
+
+    printf("\ndone\n");
+    return 0;
+}
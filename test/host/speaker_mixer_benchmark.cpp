@@ -0,0 +1,159 @@
+/**
+ * @file speaker_mixer_benchmark.cpp
+ * @brief Cost of mixing a speaker frame, float mixer vs fixed-point mixer
+ * @version 0.1
+ * @date 2025-12-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <speaker/speaker_mixer.h>
+#include "speaker_mixer_reference.h"
+
+
+using namespace HAL;
+
+
+#define SAMPLES_PER_FRAME               256
+#define FRAMES_PER_RUN                  20000
+#define SPK_SAMPLE_RATE                 48000
+#define SPK_MAGNIFICATION               16
+#define SPK_MASTER_VOLUME               200
+
+
+struct Sound_t
+{
+    const char* name;
+    bool is_16bit;
+    bool is_stereo;
+    float sample_rate;
+};
+
+
+/* What apps play: wav files and tones */
+static const Sound_t _sounds[] = {
+    {"16bit mono 44100", true, false, 44100},
+    {"16bit stereo 22050", true, true, 22050},
+    {"8bit mono 16000", false, false, 16000},
+    {"8bit tone 1kHz", false, false, 1000 * 16},
+};
+static const int _sound_num = sizeof(_sounds) / sizeof(_sounds[0]);
+
+
+static std::vector<uint8_t> _make_data(const Sound_t& sound, size_t length)
+{
+    std::vector<uint8_t> data(length * (sound.is_16bit ? 2 : 1));
+    for (size_t i = 0; i < length; i++)
+    {
+        float value = sinf(i * 0.05f) * 0.9f;
+        if (sound.is_16bit)
+            ((int16_t*)data.data())[i] = value * 32767;
+        else
+            data[i] = value * 127 + 128;
+    }
+    return data;
+}
+
+
+/* Mix FRAMES_PER_RUN frames, returns ns per output sample */
+template<typename F>
+static double _run(F mixFrame, long& checksum)
+{
+    std::vector<int32_t> mix_buf(SAMPLES_PER_FRAME);
+    std::vector<int16_t> output(SAMPLES_PER_FRAME);
+
+    checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < FRAMES_PER_RUN; frame++)
+    {
+        std::fill(mix_buf.begin(), mix_buf.end(), 0);
+        mixFrame(mix_buf.data(), output.data());
+        checksum += output[frame % SAMPLES_PER_FRAME];
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / FRAMES_PER_RUN / SAMPLES_PER_FRAME;
+}
+
+
+static int _bench(int channelNum)
+{
+    std::vector<std::vector<uint8_t>> data;
+    std::vector<REFERENCE::mix_source_t> ref_sources(channelNum);
+    std::vector<REFERENCE::mix_state_t> ref_states(channelNum);
+    std::vector<MIXER::mix_source_t> sources(channelNum);
+    std::vector<MIXER::mix_state_t> states(channelNum);
+    std::vector<MIXER::mix_func_t> mix_funcs(channelNum);
+
+    for (int i = 0; i < channelNum; i++)
+    {
+        const Sound_t& sound = _sounds[i % _sound_num];
+        data.push_back(_make_data(sound, (i % _sound_num == 3) ? 16 : 4096));
+
+        ref_sources[i].data = data.back().data();
+        ref_sources[i].length = data.back().size() / (sound.is_16bit ? 2 : 1);
+        ref_sources[i].is_16bit = sound.is_16bit;
+        ref_sources[i].is_signed = sound.is_16bit;
+        ref_sources[i].is_stereo = sound.is_stereo;
+        ref_sources[i].sample_rate_x256 = sound.sample_rate * 256.0f;
+        ref_sources[i].volume = 128;
+
+        mix_funcs[i] = MIXER::get_mix_func(sound.is_16bit, sound.is_16bit, sound.is_stereo, false);
+        sources[i].data = ref_sources[i].data;
+        sources[i].length = ref_sources[i].length;
+        sources[i].in_rate = ref_sources[i].sample_rate_x256;
+        sources[i].out_rate = SPK_SAMPLE_RATE << 8;
+        sources[i].volume = MIXER::get_volume(SPK_MAGNIFICATION, false, SPK_MASTER_VOLUME, 128);
+    }
+
+    long ref_checksum = 0;
+    double ref_ns = _run(
+        [&](int32_t* mixBuf, int16_t* output) {
+            for (int i = 0; i < channelNum; i++)
+            {
+                volatile uint32_t repeat = ~0u;
+                REFERENCE::mix(mixBuf, SAMPLES_PER_FRAME, ref_sources[i], ref_states[i], repeat, false,
+                               SPK_SAMPLE_RATE, SPK_MAGNIFICATION, SPK_MASTER_VOLUME);
+            }
+            REFERENCE::saturate(mixBuf, output, SAMPLES_PER_FRAME);
+        },
+        ref_checksum);
+
+    long checksum = 0;
+    double ns = _run(
+        [&](int32_t* mixBuf, int16_t* output) {
+            for (int i = 0; i < channelNum; i++)
+            {
+                volatile uint32_t repeat = ~0u;
+                mix_funcs[i](mixBuf, SAMPLES_PER_FRAME, sources[i], states[i], repeat);
+            }
+            MIXER::saturate(mixBuf, output, SAMPLES_PER_FRAME);
+        },
+        checksum);
+
+    printf("%d channels: float %6.2f ns, fixed-point %6.2f ns per sample\n", channelNum, ref_ns, ns);
+
+    /* Both played the same thing, give or take an LSB per sample */
+    if (std::abs(checksum - ref_checksum) > FRAMES_PER_RUN)
+        return -1;
+    return 0;
+}
+
+
+int main()
+{
+    std::cout << "[Speaker mixer benchmark]\n\n";
+
+    for (int channel_num : {1, 2, 4, 8})
+    {
+        if (_bench(channel_num) != 0)
+            return -1;
+    }
+
+    std::cout << "\ndone\n";
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file speaker_mixer_reference.h
+ * @brief The previous float mixer of HAL::Speaker, kept here as baseline
+ * @version 0.1
+ * @date 2025-12-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+
+namespace REFERENCE
+{
+    struct mix_state_t
+    {
+        size_t index = 0;
+        int diff = 0;
+        float liner_buf[2][2] = {{0, 0}, {0, 0}};
+    };
+
+
+    struct mix_source_t
+    {
+        const void* data = nullptr;
+        size_t length = 0;
+        bool is_16bit = false;
+        bool is_signed = false;
+        bool is_stereo = false;
+        uint32_t sample_rate_x256 = 0;
+        uint8_t volume = 255;
+    };
+
+
+    /* Inner loop of Speaker::_mix_channels(), one channel */
+    static void mix(int32_t* mix_buf, size_t output_len, const mix_source_t& source, mix_state_t& state,
+                    volatile uint32_t& repeat, bool out_stereo, uint32_t sample_rate, uint8_t magnification,
+                    uint8_t master_volume)
+    {
+        const int32_t spk_rate_x256 = sample_rate << 8;
+        const float base_volume =
+            (magnification << out_stereo) * (master_volume * master_volume) / (float)spk_rate_x256 / (1 << 28);
+
+        int32_t vol_sq = source.volume * source.volume;
+        if (!source.is_16bit)
+            vol_sq <<= 8;
+        const float ch_volume = base_volume * vol_sq;
+
+        const bool in_stereo = source.is_stereo;
+        const int32_t in_rate = source.sample_rate_x256;
+        float* curr_sample = state.liner_buf[0];
+        float* prev_sample = state.liner_buf[1];
+
+        int diff = state.diff;
+        size_t src_idx = state.index;
+        size_t dst_idx = 0;
+
+        do
+        {
+            while (diff >= 0)
+            {
+                if (src_idx >= source.length)
+                {
+                    src_idx -= source.length;
+                    if (repeat != ~0u && --repeat == 0)
+                        goto end_channel_mix;
+                }
+
+                int32_t left, right;
+                if (source.is_16bit)
+                {
+                    auto data16 = (const int16_t*)source.data;
+                    left = data16[src_idx];
+                    right = data16[src_idx + in_stereo];
+                    src_idx += 1 + in_stereo;
+
+                    if (!source.is_signed)
+                    {
+                        left = (left & 0xFFFF) + INT16_MIN;
+                        right = (right & 0xFFFF) + INT16_MIN;
+                    }
+                }
+                else
+                {
+                    auto data8 = (const uint8_t*)source.data;
+                    left = data8[src_idx];
+                    right = data8[src_idx + in_stereo];
+                    src_idx += 1 + in_stereo;
+
+                    if (source.is_signed)
+                    {
+                        left = (int8_t)left;
+                        right = (int8_t)right;
+                    }
+                    else
+                    {
+                        left += INT8_MIN;
+                        right += INT8_MIN;
+                    }
+                }
+
+                prev_sample[0] = curr_sample[0];
+                if (out_stereo)
+                {
+                    prev_sample[1] = curr_sample[1];
+                    curr_sample[1] = right * ch_volume;
+                }
+                else
+                {
+                    left += right;
+                }
+                curr_sample[0] = left * ch_volume;
+
+                diff -= spk_rate_x256;
+            }
+            float lerp_left = curr_sample[0];
+            float delta_left = lerp_left - prev_sample[0];
+            float start_left = lerp_left * spk_rate_x256 + delta_left * diff;
+            float step_left = delta_left * in_rate;
+
+            if (out_stereo)
+            {
+                float lerp_right = curr_sample[1];
+                float delta_right = lerp_right - prev_sample[1];
+                float start_right = lerp_right * spk_rate_x256 + delta_right * diff;
+                float step_right = delta_right * in_rate;
+
+                do
+                {
+                    mix_buf[dst_idx++] += (int32_t)start_left;
+                    mix_buf[dst_idx++] += (int32_t)start_right;
+                    start_left += step_left;
+                    start_right += step_right;
+                    diff += in_rate;
+                } while (dst_idx < output_len && diff < 0);
+            }
+            else
+            {
+                do
+                {
+                    mix_buf[dst_idx++] += (int32_t)start_left;
+                    start_left += step_left;
+                    diff += in_rate;
+                } while (dst_idx < output_len && diff < 0);
+            }
+        } while (dst_idx < output_len);
+
+    end_channel_mix:
+        state.diff = diff;
+        state.index = src_idx;
+    }
+
+
+    static void saturate(const int32_t* mix_buf, int16_t* output, size_t len)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            int32_t val = mix_buf[i] >> 8;
+            output[i] = (val < INT16_MIN) ? INT16_MIN : (val > INT16_MAX) ? INT16_MAX : (int16_t)val;
+        }
+    }
+}
@@ -0,0 +1,307 @@
+/**
+ * @file speaker_mixer_test.cpp
+ * @brief Fixed-point speaker mixer against the previous float mixer
+ * @version 0.1
+ * @date 2025-12-16
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <speaker/speaker_mixer.h>
+#include "speaker_mixer_reference.h"
+
+
+using namespace HAL;
+
+
+#define SAMPLES_PER_FRAME               256
+#define MAX_FRAMES                      400
+#define SPK_SAMPLE_RATE                 48000
+#define SPK_MAGNIFICATION               16
+
+
+struct Channel_t
+{
+    std::vector<uint8_t> data;
+    REFERENCE::mix_source_t ref_source;
+    REFERENCE::mix_state_t ref_state;
+    volatile uint32_t ref_repeat;
+    MIXER::mix_func_t mix;
+    MIXER::mix_source_t source;
+    MIXER::mix_state_t state;
+    volatile uint32_t repeat;
+};
+
+
+/* Sine with some noise, full scale */
+static void _setup(Channel_t& channel, bool is16bit, bool isSigned, bool inStereo, bool outStereo, float sampleRate,
+                   size_t length, uint32_t repeat, uint8_t masterVolume, uint8_t volume)
+{
+    channel.data.resize(length * (is16bit ? 2 : 1));
+    for (size_t i = 0; i < length; i++)
+    {
+        float value = sinf(i * 0.05f + (inStereo && (i & 1)) * 1.3f) * 0.9f + (rand() % 1000 - 500) / 5000.0f;
+        int32_t sample = is16bit ? value * 32767 : value * 127;
+        if (!isSigned)
+            sample += is16bit ? 32768 : 128;
+        if (is16bit)
+            ((int16_t*)channel.data.data())[i] = sample;
+        else
+            channel.data[i] = sample;
+    }
+
+    channel.ref_source.data = channel.data.data();
+    channel.ref_source.length = length;
+    channel.ref_source.is_16bit = is16bit;
+    channel.ref_source.is_signed = isSigned;
+    channel.ref_source.is_stereo = inStereo;
+    channel.ref_source.sample_rate_x256 = sampleRate * 256.0f;
+    channel.ref_source.volume = volume;
+    channel.ref_state = REFERENCE::mix_state_t();
+    channel.ref_repeat = repeat;
+
+    channel.mix = MIXER::get_mix_func(is16bit, isSigned, inStereo, outStereo);
+    channel.source.data = channel.data.data();
+    channel.source.length = length;
+    channel.source.in_rate = channel.ref_source.sample_rate_x256;
+    channel.source.out_rate = SPK_SAMPLE_RATE << 8;
+    channel.source.volume = MIXER::get_volume(SPK_MAGNIFICATION, outStereo, masterVolume, volume);
+    channel.state = MIXER::mix_state_t();
+    channel.repeat = repeat;
+}
+
+
+struct Result_t
+{
+    long samples = 0;
+    long exact = 0;
+    long clipped = 0;
+    int max_error = 0;
+};
+
+
+/* Mix frames like the speaker task does, till every channel is done */
+static bool _run(std::vector<Channel_t>& channels, bool outStereo, uint8_t masterVolume, Result_t& result)
+{
+    const size_t output_len = SAMPLES_PER_FRAME * (outStereo ? 2 : 1);
+    std::vector<int32_t> ref_mix_buf(output_len);
+    std::vector<int32_t> mix_buf(output_len);
+    std::vector<int16_t> ref_output(output_len);
+    std::vector<int16_t> output(output_len);
+
+    for (int frame = 0; frame < MAX_FRAMES; frame++)
+    {
+        std::fill(ref_mix_buf.begin(), ref_mix_buf.end(), 0);
+        std::fill(mix_buf.begin(), mix_buf.end(), 0);
+
+        bool playing = false;
+        for (auto& channel : channels)
+        {
+            if (channel.ref_repeat == 0)
+                continue;
+            playing = true;
+            REFERENCE::mix(ref_mix_buf.data(), output_len, channel.ref_source, channel.ref_state, channel.ref_repeat,
+                           outStereo, SPK_SAMPLE_RATE, SPK_MAGNIFICATION, masterVolume);
+            channel.mix(mix_buf.data(), output_len, channel.source, channel.state, channel.repeat);
+
+            /* Same samples are consumed */
+            if (channel.state.index != channel.ref_state.index || channel.state.diff != channel.ref_state.diff
+                || channel.repeat != channel.ref_repeat)
+            {
+                printf("frame %d: position differs\n", frame);
+                return false;
+            }
+        }
+        if (!playing)
+            break;
+
+        REFERENCE::saturate(ref_mix_buf.data(), ref_output.data(), output_len);
+        MIXER::saturate(mix_buf.data(), output.data(), output_len);
+        for (size_t i = 0; i < output_len; i++)
+        {
+            int error = abs(output[i] - ref_output[i]);
+            result.samples++;
+            result.exact += (error == 0);
+            result.clipped += (output[i] == INT16_MAX || output[i] == INT16_MIN);
+            if (error > result.max_error)
+                result.max_error = error;
+        }
+    }
+    return true;
+}
+
+
+int main()
+{
+    srand(1234);
+    Result_t total;
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Formats]\n");
+
+    const float rates[] = {8000, 11025, 16000, 22050, 44100, 48000, 96000};
+    for (int out_stereo = 0; out_stereo < 2; out_stereo++)
+    {
+        for (int format = 0; format < 8; format++)
+        {
+            bool is_16bit = format & 1;
+            bool is_signed = format & 2;
+            bool in_stereo = format & 4;
+
+            Result_t result;
+            for (float rate : rates)
+            {
+                std::vector<Channel_t> channels(1);
+                _setup(channels[0], is_16bit, is_signed, in_stereo, out_stereo, rate, 3000, 3, 200, 180);
+                if (!_run(channels, out_stereo, 200, result))
+                    return -1;
+            }
+            printf("%s %-8s %s in, %s out: %ld samples, %.3f%% exact, max error %d\n",
+                   is_16bit ? "16bit" : " 8bit", is_signed ? "signed" : "unsigned", in_stereo ? "stereo" : "  mono",
+                   out_stereo ? "stereo" : "mono", result.samples, result.exact * 100.0 / result.samples,
+                   result.max_error);
+
+            total.samples += result.samples;
+            total.exact += result.exact;
+            if (result.max_error > total.max_error)
+                total.max_error = result.max_error;
+        }
+    }
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Tone and volumes]\n");
+
+    /* Tone's 16 sample wave, infinite repeat stopped by the frame limit */
+    for (uint8_t master_volume : {1, 16, 64, 128, 255})
+    {
+        for (uint8_t volume : {1, 40, 255})
+        {
+            Result_t result;
+            std::vector<Channel_t> channels(1);
+            _setup(channels[0], false, false, false, false, 1000.0f * 16, 16, ~0u, master_volume, volume);
+            if (!_run(channels, false, master_volume, result))
+                return -1;
+            if (result.max_error > total.max_error)
+                total.max_error = result.max_error;
+            total.samples += result.samples;
+            total.exact += result.exact;
+        }
+    }
+    printf("max error %d\n", total.max_error);
+    /* -------------------------------------------------------------- */
+
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Saturation]\n");
+
+    /* Loud channels mixed together clip */
+    for (int out_stereo = 0; out_stereo < 2; out_stereo++)
+    {
+        Result_t result;
+        std::vector<Channel_t> channels(8);
+        for (size_t i = 0; i < channels.size(); i++)
+            _setup(channels[i], i & 1, true, i & 2, out_stereo, rates[i % 7], 2000 + i * 300, 2, 255, 255);
+        if (!_run(channels, out_stereo, 255, result))
+            return -1;
+        printf("8 channels, %s out: %ld clipped, %.3f%% exact, max error %d\n", out_stereo ? "stereo" : "mono",
+               result.clipped, result.exact * 100.0 / result.samples, result.max_error);
+        if (result.clipped == 0)
+            return -1;
+        total.samples += result.samples;
+        total.exact += result.exact;
+        if (result.max_error > total.max_error)
+            total.max_error = result.max_error;
+    }
+    /* -------------------------------------------------------------- */
+
+
+    /* -------------------------------------------------------------- */
+    printf("\n[Streaming]\n");
+
+    /* A ring buffer fed in pieces plays the same as the whole sound, dry frames just pause it */
+    {
+        const size_t sound_len = 20000;
+        const size_t ring_len = 1000;
+        const size_t output_len = SAMPLES_PER_FRAME * 2;
+
+        Channel_t whole;
+        _setup(whole, true, true, true, true, 44100, sound_len, 1, 200, 255);
+        std::vector<int32_t> expected;
+        while (whole.repeat != 0)
+        {
+            expected.resize(expected.size() + output_len);
+            size_t num = whole.mix(&expected[expected.size() - output_len], output_len, whole.source, whole.state, whole.repeat);
+            expected.resize(expected.size() - output_len + num);
+        }
+
+        const int16_t* data = (const int16_t*)whole.data.data();
+        std::vector<int16_t> ring(ring_len);
+        MIXER::mix_source_t source = whole.source;
+        MIXER::mix_state_t state;
+        volatile uint32_t repeat = ~0u;
+        source.data = ring.data();
+        source.length = ring_len;
+
+        std::vector<int32_t> streamed;
+        size_t written = 0;
+        size_t read = 0;
+        int dry_frames = 0;
+        for (int frame = 0; read < sound_len; frame++)
+        {
+            /* Feed whole frames of a random amount, every 5th frame gets nothing */
+            size_t feed = (frame % 5 == 4) ? 0 : (rand() % ring_len) & ~(size_t)1;
+            feed = std::min({feed, ring_len - (written - read), sound_len - written});
+            for (size_t i = 0; i < feed; i++, written++)
+                ring[written % ring_len] = data[written];
+
+            source.available = written - read;
+            size_t index = state.index;
+            streamed.resize(streamed.size() + output_len);
+            size_t num = whole.mix(&streamed[streamed.size() - output_len], output_len, source, state, repeat);
+            streamed.resize(streamed.size() - output_len + num);
+            read += (state.index + ring_len - index) % ring_len;
+
+            if (read > written)
+                return -1;
+            if (num < output_len)
+                dry_frames++;
+        }
+        printf("%zu values streamed, %d dry frames\n", read, dry_frames);
+        if (dry_frames == 0)
+            return -1;
+
+        /* Tail of the whole sound was never interpolated to, as nothing came after */
+        if (streamed.size() < expected.size())
+            return -1;
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            /* Resuming mid frame restarts the interpolation step, a mix unit at most */
+            if (abs(streamed[i] - expected[i]) > 1)
+            {
+                printf("value %zu differs: %d %d\n", i, streamed[i], expected[i]);
+                return -1;
+            }
+        }
+    }
+    /* -------------------------------------------------------------- */
+
+
+    /* Float rounding of the old mixer shows up as an occasional LSB, never more */
+    printf("\ntotal: %ld samples, %.3f%% exact, max error %d\n", total.samples, total.exact * 100.0 / total.samples,
+           total.max_error);
+    if (total.max_error > 1 || total.exact * 1000 < total.samples * 995)
+        return -1;
+
+    printf("\ndone\n");
+    return 0;
+}